@@ -0,0 +1,228 @@
+/**
+ * @file   async_writer.c
+ * @version 5
+ * @updated  2026
+ * @brief  Text output formatted into large buffers and written by a background thread
+ *
+ * The caller reserves space in the current buffer, formats into it directly and commits what it wrote. A full buffer is
+ * handed to the background thread, which writes it while the caller fills the other one, so the caller only waits when
+ * it produces a buffer faster than the disk takes the previous one. Every buffer is flushed through to the stream once
+ * written, so it reaches a pipe without waiting for the stdio buffer to fill. If the thread cannot be created the
+ * buffers are written inline, which gives the same file.
+ *
+ * formatFixedDouble produces exactly the text of printf("%lf"): six decimals, rounded to nearest with ties to even on
+ * the exact binary value, and the sign of negative values kept even when they round to zero. The fraction is scaled
+ * with its exact rounding error from fma, so a value is only rounded once; values of 1e15 or more, infinities and NaN
+ * are left to snprintf.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <pthread.h>
+#include "async_writer.h"
+
+/**
+ * Format a value as printf("%lf") does.
+ *
+ * @param text   Buffer of at least FIXED_DOUBLE_MAX_LENGTH bytes.
+ * @param value  The value.
+ *
+ * @return       The number of characters written, without a terminating NUL for finite values below 1e15.
+ */
+int formatFixedDouble(char* text, double value) {
+	char digits[20];
+	char* cursor = text;
+	double whole, fraction, scaled, error, below;
+	uint64_t integer, micros;
+	int count = 0, i;
+
+	if (!(fabs(value) < 1e15))
+		return snprintf(text, FIXED_DOUBLE_MAX_LENGTH, "%lf", value);
+	if (signbit(value)) {
+		*cursor++ = '-';
+		value = -value;
+	}
+	whole = floor(value);
+	fraction = value - whole;
+	scaled = fraction * 1e6;
+	error = fma(fraction, 1e6, -scaled);
+	below = floor(scaled);
+	integer = (uint64_t)whole;
+	micros = (uint64_t)below;
+
+	// Round the exact scaled fraction, (scaled - below) + error, to nearest with ties to even
+	{
+		const double excess = ((scaled - below) - 0.5) + error;
+
+		if (excess > 0.0 || (excess == 0.0 && (micros & 1)))
+			++micros;
+	}
+	if (micros == 1000000) {
+		micros = 0;
+		++integer;
+	}
+	do {
+		digits[count++] = (char)('0' + integer % 10);
+		integer /= 10;
+	} while (integer > 0);
+	while (count > 0)
+		*cursor++ = digits[--count];
+	*cursor++ = '.';
+	for (i = 5; i >= 0; --i) {
+		cursor[i] = (char)('0' + micros % 10);
+		micros /= 10;
+	}
+	return (int)(cursor + 6 - text);
+}
+
+/**
+ * Background thread: write the buffers handed over until the writer stops.
+ */
+static void* runAsyncWriter(void* argument) {
+	AsyncWriter writer = (AsyncWriter)argument;
+
+	pthread_mutex_lock(&writer->lock);
+	for (;;) {
+		const char* buffer;
+		size_t length;
+		int failed;
+
+		while (writer->pending == NULL && !writer->stopping)
+			pthread_cond_wait(&writer->changed, &writer->lock);
+		if (writer->pending == NULL)
+			break;
+		buffer = writer->pending;
+		length = writer->pendingLength;
+		pthread_mutex_unlock(&writer->lock);
+		if (writer->copyHandle != NULL)
+			fwrite(buffer, 1, length, writer->copyHandle);
+		failed = fwrite(buffer, 1, length, writer->oHandle) != length || fflush(writer->oHandle) != 0;
+		pthread_mutex_lock(&writer->lock);
+		writer->failed = writer->failed || failed;
+		writer->pending = NULL;
+		pthread_cond_broadcast(&writer->changed);
+	}
+	pthread_mutex_unlock(&writer->lock);
+	return NULL;
+}
+
+/**
+ * Hand the current buffer to the background thread, once it has written the previous one, and switch buffers.
+ */
+static void handOverBuffer(AsyncWriter writer) {
+	if (writer->used == 0)
+		return;
+	if (!writer->threaded) {
+		if (writer->copyHandle != NULL)
+			fwrite(writer->buffers[writer->current], 1, writer->used, writer->copyHandle);
+		if (fwrite(writer->buffers[writer->current], 1, writer->used, writer->oHandle) != writer->used || fflush(writer->oHandle) != 0)
+			writer->failed = 1;
+	} else {
+		pthread_mutex_lock(&writer->lock);
+		while (writer->pending != NULL)
+			pthread_cond_wait(&writer->changed, &writer->lock);
+		writer->pending = writer->buffers[writer->current];
+		writer->pendingLength = writer->used;
+		pthread_cond_broadcast(&writer->changed);
+		pthread_mutex_unlock(&writer->lock);
+		writer->current = 1 - writer->current;
+	}
+	writer->used = 0;
+}
+
+/**
+ * Start a writer on an open stream.
+ *
+ * @param oHandle     The stream, which the writer writes to until it is closed.
+ * @param copyHandle  Stream receiving a copy of everything written, or NULL.
+ * @param capacity    Bytes of each buffer; the largest reservation must fit in one.
+ *
+ * @return          The writer, or NULL if its buffers cannot be allocated.
+ */
+AsyncWriter openAsyncWriter(FILE* oHandle, FILE* copyHandle, const size_t capacity) {
+	AsyncWriter writer = (AsyncWriter)calloc(1, sizeof(struct _AsyncWriter));
+
+	if (writer == NULL)
+		return NULL;
+	writer->oHandle = oHandle;
+	writer->copyHandle = copyHandle;
+	writer->capacity = capacity;
+	writer->buffers[0] = (char*)malloc(capacity);
+	writer->buffers[1] = (char*)malloc(capacity);
+	if (writer->buffers[0] == NULL || writer->buffers[1] == NULL) {
+		free(writer->buffers[0]);
+		free(writer->buffers[1]);
+		free(writer);
+		return NULL;
+	}
+	pthread_mutex_init(&writer->lock, NULL);
+	pthread_cond_init(&writer->changed, NULL);
+	writer->threaded = (pthread_create(&writer->thread, NULL, runAsyncWriter, writer) == 0);
+	return writer;
+}
+
+/**
+ * Space for the next text, handing the current buffer over first if it has too little left.
+ *
+ * @param writer  The writer.
+ * @param length  Bytes needed, at most the capacity of a buffer.
+ *
+ * @return        Where to write the text; pass its end to commitAsyncWriter.
+ */
+char* reserveAsyncWriter(AsyncWriter writer, const size_t length) {
+	if (writer->capacity - writer->used < length)
+		handOverBuffer(writer);
+	return writer->buffers[writer->current] + writer->used;
+}
+
+/**
+ * Keep the text written to the space last reserved.
+ *
+ * @param writer  The writer.
+ * @param end     The end of the text.
+ */
+void commitAsyncWriter(AsyncWriter writer, const char* end) {
+	writer->used = (size_t)(end - writer->buffers[writer->current]);
+}
+
+/**
+ * Hand the text committed so far to the output without waiting for the buffer to fill, for readers following the
+ * stream as it is written.
+ *
+ * @param writer  The writer.
+ */
+void flushAsyncWriter(AsyncWriter writer) {
+	handOverBuffer(writer);
+}
+
+/**
+ * Write the remaining text, stop the background thread and free the writer; the stream is left open.
+ *
+ * @param writer  The writer, or NULL.
+ *
+ * @return        0 if every write succeeded, -1 otherwise.
+ */
+int closeAsyncWriter(AsyncWriter writer) {
+	int failed;
+
+	if (writer == NULL)
+		return 0;
+	handOverBuffer(writer);
+	if (writer->threaded) {
+		pthread_mutex_lock(&writer->lock);
+		writer->stopping = 1;
+		pthread_cond_broadcast(&writer->changed);
+		pthread_mutex_unlock(&writer->lock);
+		pthread_join(writer->thread, NULL);
+	}
+	failed = writer->failed;
+	pthread_cond_destroy(&writer->changed);
+	pthread_mutex_destroy(&writer->lock);
+	free(writer->buffers[0]);
+	free(writer->buffers[1]);
+	free(writer);
+	return failed ? -1 : 0;
+}
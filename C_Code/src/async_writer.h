@@ -0,0 +1,41 @@
+/**
+ * @file   async_writer.h
+ * @version 5
+ * @updated  2026
+ * @brief  Text output formatted into large buffers and written by a background thread
+ */
+
+#define ASYNC_WRITER_BUFFER_SIZE (1 << 20)  ///< Bytes of each of the two buffers
+#define FIXED_DOUBLE_MAX_LENGTH 320         ///< Longest text of one value formatted as "%lf", the terminating NUL included
+
+/**
+ * Writer alternating between two buffers: one is filled by the caller while the other is written by the background thread
+ */
+typedef struct _AsyncWriter {
+	FILE* oHandle;            ///< The stream written to; left open by the writer.
+	FILE* copyHandle;         ///< Stream receiving a copy of every buffer, or NULL; left open, its errors are left to its owner.
+	char* buffers[2];         ///< The two buffers.
+	size_t capacity;          ///< Bytes of each buffer.
+	int current;              ///< The buffer being filled.
+	size_t used;              ///< Bytes filled in the current buffer.
+	const char* pending;      ///< The buffer handed to the background thread, or NULL once it is written.
+	size_t pendingLength;     ///< Bytes of the pending buffer.
+	int stopping;             ///< Set when no more buffers will be handed over.
+	int failed;               ///< Set when a write has failed.
+	int threaded;             ///< Whether the background thread runs; buffers are written inline otherwise.
+	pthread_mutex_t lock;     ///< Protects the hand-over fields.
+	pthread_cond_t changed;   ///< Signalled when a buffer is handed over or written, and when stopping.
+	pthread_t thread;         ///< The background thread.
+} *AsyncWriter;
+
+int formatFixedDouble(char* text, double value);
+
+AsyncWriter openAsyncWriter(FILE* oHandle, FILE* copyHandle, const size_t capacity);
+
+char* reserveAsyncWriter(AsyncWriter writer, const size_t length);
+
+void commitAsyncWriter(AsyncWriter writer, const char* end);
+
+void flushAsyncWriter(AsyncWriter writer);
+
+int closeAsyncWriter(AsyncWriter writer);
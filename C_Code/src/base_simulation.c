@@ -16,11 +16,12 @@
 #include <gsl/gsl_sf_exp.h>
 #include <gsl/gsl_sf_gamma.h>
 #include <gsl/gsl_errno.h>
-#include "carg_parser.h"
 #include "full_model.h"
+#include "fixed_step.h"
+#include "positive_step.h"
+#include "sensitivity.h"
 #include "base_simulation.h"
-
-extern int verbose;
+#include "trajectory_file.h"
 
 /**
  * Simulation result aggregator function. Calculates the summary statistics which are to be calculated for each time-point and
@@ -31,36 +32,25 @@ extern int verbose;
  * @param currentTime The absolute temporal coordinate for the current state.
  * @param counter     The number of time-points that have elapsed since the simulation started.
  * @param results     The results structure to be updated with the current simulation summary.
+ * @param trajectory  The trajectory file receiving the compartments, or NULL for none.
+ * @param verbose     Print the time-point to the standard output.
  */
-static void updateSimulationResultsPerTick(const ModelParameters mParam, const ModelVariables state, const double currentTime,
-                                           const int counter, SimulationResults results, const char* output, FILE* oHandleM) {
+void updateSimulationResultsPerTick(const ModelParameters mParam, const ModelVariables state, const double currentTime,
+                                    const int counter, SimulationResults results, struct _TrajectoryWriter* trajectory, const int verbose) {
 	int i;
 	double populationSum = 0.0;
     int timetocon;
     timetocon=((int)floorl(currentTime/mParam->steptime));
     double plasmaconcenc = mParam->realantibioticconc[timetocon];
 	double* compartmentBoundComplexState = &state->firstCompartmentBoundComplex;
-    //double* compartmentfreeAntibiotic = &state->freeAntibiotic;
-	double* compartmentfreeBoundComplex= &state->freeBoundComplex;
-    double* compartmentfreetarget= &state->freeTarget;
     
 	for (i = 0; i < mParam->targetMoleculeCount + 1; ++i)
 		populationSum += compartmentBoundComplexState[i];
     if (populationSum < 0) {
 		populationSum=0;
     }
-//	printf("CompartmentBoundComplexState vector at time %lf is:\n", currentTime);
-	if(output != NULL){
-		for (i = 0; i < mParam->targetMoleculeCount + 1; ++i)
-        //fprintf(oHandleM,"L \t%d\n", i);
-        fprintf(oHandleM, "%lf ", compartmentBoundComplexState[i]);
-        fprintf(oHandleM, "%lf ", currentTime);
-        fprintf(oHandleM, "%lf ", populationSum);
-        fprintf(oHandleM, "%lf ", mParam->realantibioticconc[timetocon]);
-        fprintf(oHandleM, "%lf ", compartmentfreeBoundComplex[i]);
-		fprintf(oHandleM, "\n");
-        
-	}
+	if (trajectory != NULL)
+		writeTrajectoryRow(trajectory, mParam, state, currentTime, populationSum, plasmaconcenc);
 	
 	results->timePoint[counter] = currentTime;
 	results->totalPopulation[counter] = populationSum;
@@ -73,57 +63,708 @@ static void updateSimulationResultsPerTick(const ModelParameters mParam, const M
 }
 
 /**
- * The main simulation loop function. Will set up the ODE system with GSL and run the simulation within the specified
- * time bounds. Will dump the output to the specified file.
+ * Make the vectors of the results hold at least the given number of time-points. Vectors which are already large enough,
+ * from an earlier simulation or provided by the caller with their capacity, are kept.
+ *
+ * @param results         The results, zero-initialised or holding the vectors of an earlier simulation.
+ * @param timePointCount  The number of time-points.
+ *
+ * @return                GSL_SUCCESS, or GSL_ENOMEM with the results unchanged.
+ */
+int reserveSimulationResults(SimulationResults results, const long timePointCount) {
+	double* timePoint;
+	double* totalPopulation;
+	double* unboundantibiotic;
+
+	if (results->capacity >= timePointCount)
+		return GSL_SUCCESS;
+	if ((timePoint = (double*)malloc(sizeof(double) * timePointCount)) == NULL ||
+	    (totalPopulation = (double*)malloc(sizeof(double) * timePointCount)) == NULL) {
+		free(timePoint);
+		return GSL_ENOMEM;
+	}
+	if ((unboundantibiotic = (double*)malloc(sizeof(double) * timePointCount)) == NULL) {
+		free(timePoint);
+		free(totalPopulation);
+		return GSL_ENOMEM;
+	}
+	freeSimulationResults(results);
+	results->timePoint = timePoint;
+	results->totalPopulation = totalPopulation;
+	results->unboundantibiotic = unboundantibiotic;
+	results->capacity = timePointCount;
+	return GSL_SUCCESS;
+}
+
+/**
+ * Free the vectors of the results, leaving them empty for reuse.
+ *
+ * @param results  The results.
+ */
+void freeSimulationResults(SimulationResults results) {
+	free(results->timePoint);
+	free(results->totalPopulation);
+	free(results->unboundantibiotic);
+	results->timePoint = NULL;
+	results->totalPopulation = NULL;
+	results->unboundantibiotic = NULL;
+	results->capacity = 0;
+}
+
+/**
+ * Select the integrator named as on the command-line: a GSL stepping function driven by the adaptive GSL driver, one of
+ * the native fixed-step integrators, or the positivity-preserving one. An unknown name leaves the selection unchanged.
+ *
+ * @param name     The name of the integrator.
+ * @param stepper  The integrator selection to update.
+ *
+ * @return         0 on success, -1 if the name is unknown.
+ */
+int parseSimulationStepper(const char* name, SimulationStepper stepper) {
+	if (!strcmp(name, "rk4"))
+		stepper->gslStepping = gsl_odeiv2_step_rk4;
+	else if (!strcmp(name, "rkf45"))
+		stepper->gslStepping = gsl_odeiv2_step_rkf45;
+	else if (!strcmp(name, "rkck"))
+		stepper->gslStepping = gsl_odeiv2_step_rkck;
+	else if (!strcmp(name, "msbdf"))//Vi added
+		stepper->gslStepping = gsl_odeiv2_step_msbdf;
+	else if (!strcmp(name, "rk2"))
+		stepper->gslStepping = gsl_odeiv2_step_rk2;
+	else if (!strcmp(name, "bsimp"))
+		stepper->gslStepping = gsl_odeiv2_step_bsimp;
+	else if (!strcmp(name, "msadams"))
+		stepper->gslStepping = gsl_odeiv2_step_msadams;
+	else if (!strcmp(name, "rk2-native")) {
+		stepper->gslStepping = NULL;
+		stepper->positivityPreserving = 0;
+		stepper->nativeMethod = FIXED_STEP_RK2;
+	}
+	else if (!strcmp(name, "rk4-native")) {
+		stepper->gslStepping = NULL;
+		stepper->positivityPreserving = 0;
+		stepper->nativeMethod = FIXED_STEP_RK4;
+	}
+	else if (!strcmp(name, "ssprk3")) {
+		stepper->gslStepping = NULL;
+		stepper->positivityPreserving = 0;
+		stepper->nativeMethod = FIXED_STEP_SSPRK3;
+	}
+	else if (!strcmp(name, "positive")) {
+		stepper->gslStepping = NULL;
+		stepper->positivityPreserving = 1;
+	}
+	else
+		return -1;
+	return 0;
+}
+
+/**
+ * Set one option of a simulation as its command-line letter would: V, n, r, k, R, K, A, D, C and M for the model, d,
+ * p and t for the simulation, S and H for the integrator, and T and N for the trajectory.
+ *
+ * @param code               The option letter.
+ * @param value              The argument of the option.
+ * @param stepper            The integrator selection to update.
+ * @param model              The model parameters to update; the profile is left alone.
+ * @param simulation         The simulation parameters to update.
+ * @param trajectoryOptions  The trajectory layout to update.
+ * @param message            Buffer of SIMULATION_MESSAGE_LENGTH bytes receiving the reason of a failure.
+ *
+ * @return                   0 on success, -1 otherwise.
+ */
+int parseSimulationOption(const char code, const char* value, SimulationStepper stepper, ModelParameters model,
+                          SimulationParameters simulation, struct _TrajectoryOptions* trajectoryOptions, char* message) {
+	int read = 1;
+
+	switch (code) {
+	case 'V':
+		read = sscanf(value, "%lg", &model->intracellularVolume);
+		break;
+	case 'n':
+		read = sscanf(value, "%d", &model->targetMoleculeCount);
+		break;
+	case 'r':
+		read = sscanf(value, "%d", &model->replicationThreshold);
+		break;
+	case 'k':
+		read = sscanf(value, "%d", &model->killingThreshold);
+		break;
+	case 'R':
+		read = sscanf(value, "%lg", &model->baselineReplication);
+		break;
+	case 'K':
+		read = sscanf(value, "%lg", &model->maximumKillRate);
+		break;
+	case 'A':
+		read = sscanf(value, "%lg", &model->targetAssociationRate);
+		break;
+	case 'D':
+		read = sscanf(value, "%lg", &model->targetDissociationRate);
+		break;
+	case 'C':
+		read = sscanf(value, "%lg", &model->carryingCapacity);
+		break;
+	case 'M':
+		read = sscanf(value, "%lg", &model->molecularweight);
+		break;
+	case 'd':
+		read = sscanf(value, "%lg", &simulation->startingAntibiotic);
+		break;
+	case 'p':
+		read = sscanf(value, "%lg", &simulation->startingPopulation);
+		break;
+	case 't':
+		read = sscanf(value, "%lg:%lg", &simulation->endTime, &simulation->stepSize);
+		break;
+	case 'N':
+		read = sscanf(value, "%d", &trajectoryOptions->plotPoints);
+		break;
+	case 'S':
+		if (parseSimulationStepper(value, stepper) != 0) {
+			snprintf(message, SIMULATION_MESSAGE_LENGTH, "Unknown stepping function");
+			return -1;
+		}
+		break;
+	case 'H':
+		read = sscanf(value, "%lg", &stepper->fixedStepSize);
+		break;
+	case 'T':
+		if (parseTrajectoryFormat(value, &trajectoryOptions->format, &trajectoryOptions->content) != 0) {
+			snprintf(message, SIMULATION_MESSAGE_LENGTH, "Unknown trajectory format");
+			return -1;
+		}
+		break;
+	default:
+		snprintf(message, SIMULATION_MESSAGE_LENGTH, "Option %c is not accepted", code);
+		return -1;
+	}
+	if (read < 1) {
+		snprintf(message, SIMULATION_MESSAGE_LENGTH, "Option %c needs a number", code);
+		return -1;
+	}
+	return 0;
+}
+
+/**
+ * Allocate the integrator selected by the stepper for the binding model.
  *
- * @param stepping      GSL stepping function to use for the ODE solver.
+ * @param stepper       The integrator selection.
  * @param mParam        Model parameters for the simulation.
- * @param endTime       The time to run the simulation until.
+ * @param timeInterval  The amount of time between data-points, used as the initial (GSL) or default (native) step.
+ *
+ * @return              The allocated integrator, or NULL if the allocation failed.
+ */
+SimulationIntegrator allocateSimulationIntegrator(const SimulationStepper stepper, const ModelParameters mParam, const double timeInterval) {
+	gsl_odeiv2_system system;
+	
+	system.function = (GSLDerivCalcFunc)calculateModelDerivative_BindingOnly;
+	system.jacobian = (GSLJacobianCalcFunc)calculateModelJacobian_BindingOnly;
+	system.dimension = NUMBER_FREE_KINETIC_VARIABLES + mParam->targetMoleculeCount + 1;
+	system.params = mParam;
+	return allocateSystemIntegrator(stepper, &system, system.dimension, timeInterval);
+}
+
+/**
+ * Allocate the integrator selected by the stepper for an arbitrary ODE system, such as the binding model augmented with
+ * further equations.
+ *
+ * @param stepper           The integrator selection.
+ * @param system            The ODE system, copied into the integrator.
+ * @param clippedDimension  Number of leading components which the positivity-preserving integrator keeps non-negative.
+ * @param timeInterval      The amount of time between data-points, used as the initial (GSL) or default (native) step.
+ *
+ * @return                  The allocated integrator, or NULL if the allocation failed.
+ */
+SimulationIntegrator allocateSystemIntegrator(const SimulationStepper stepper, const gsl_odeiv2_system* system, const size_t clippedDimension,
+                                              const double timeInterval) {
+	SimulationIntegrator integrator = (SimulationIntegrator)malloc(sizeof(struct _SimulationIntegrator));
+	
+	if (integrator == NULL)
+		return NULL;
+	integrator->system = *system;
+	integrator->driver = NULL;
+	integrator->workspace = NULL;
+	integrator->positiveWorkspace = NULL;
+	integrator->stepSize = (stepper->fixedStepSize > 0.0) ? stepper->fixedStepSize : timeInterval;
+	
+	if (stepper->gslStepping != NULL)
+		integrator->driver = gsl_odeiv2_driver_alloc_y_new(&integrator->system, stepper->gslStepping, timeInterval, SIMULATION_ABSOLUTE_TOLERANCE,
+		                                                   SIMULATION_RELATIVE_TOLERANCE);
+	else if (stepper->positivityPreserving) {
+		if ((integrator->positiveWorkspace = allocatePositiveStepWorkspace(&integrator->system, integrator->stepSize, SIMULATION_ABSOLUTE_TOLERANCE,
+		                                                                   SIMULATION_RELATIVE_TOLERANCE)) != NULL)
+			integrator->positiveWorkspace->clippedDimension = clippedDimension;
+	} else
+		integrator->workspace = allocateFixedStepWorkspace(stepper->nativeMethod, &integrator->system);
+	
+	if (integrator->driver == NULL && integrator->workspace == NULL && integrator->positiveWorkspace == NULL) {
+		free(integrator);
+		return NULL;
+	}
+	return integrator;
+}
+
+/**
+ * Whether the stepper needs the Jacobian of the system, i.e. is one of the implicit GSL stepping functions.
+ *
+ * @param stepper  The integrator selection.
+ *
+ * @return         Non-zero if the Jacobian is needed.
+ */
+int simulationStepperNeedsJacobian(const SimulationStepper stepper) {
+	return stepper->gslStepping == gsl_odeiv2_step_msbdf || stepper->gslStepping == gsl_odeiv2_step_bsimp ||
+	       stepper->gslStepping == gsl_odeiv2_step_rk1imp || stepper->gslStepping == gsl_odeiv2_step_rk2imp ||
+	       stepper->gslStepping == gsl_odeiv2_step_rk4imp;
+}
+
+/**
+ * Advance the ODE system from the current time to the next time with the allocated integrator.
+ *
+ * @param integrator   The integrator.
+ * @param curTime      The current time as input, the time reached as output.
+ * @param nextTime     The time to integrate until.
+ * @param stateVector  The current state as input, the state at the time reached as output.
+ *
+ * @return             GSL_SUCCESS if everything went well otherwise the GSL error code.
+ */
+int advanceSimulationIntegrator(SimulationIntegrator integrator, double* curTime, const double nextTime, double* stateVector) {
+	if (integrator->driver != NULL)
+		return gsl_odeiv2_driver_apply(integrator->driver, curTime, nextTime, stateVector);
+	if (integrator->positiveWorkspace != NULL)
+		return applyPositiveStep(integrator->positiveWorkspace, curTime, nextTime, stateVector);
+	return applyFixedStep(integrator->workspace, curTime, nextTime, integrator->stepSize, stateVector);
+}
+
+/**
+ * Reset the adaptive state and the step counts of an integrator so that a subsequent integration does not depend on the
+ * previous one. Used when the same integrator repeatedly integrates over the same interval from different initial
+ * states. As gsl_odeiv2_driver_reset does for the GSL counts, the native step counts restart from zero.
+ *
+ * @param integrator  The integrator.
+ */
+void resetSimulationIntegrator(SimulationIntegrator integrator) {
+	if (integrator->driver != NULL)
+		gsl_odeiv2_driver_reset(integrator->driver);
+	if (integrator->positiveWorkspace != NULL) {
+		integrator->positiveWorkspace->stepSize = integrator->stepSize;
+		integrator->positiveWorkspace->acceptedSteps = 0;
+		integrator->positiveWorkspace->rejectedSteps = 0;
+	}
+	if (integrator->workspace != NULL)
+		integrator->workspace->stepCount = 0;
+}
+
+/**
+ * Collect the number of accepted and rejected steps taken by an integrator since it was allocated or last reset. The GSL
+ * counts are those kept by the evolve object of the driver; the native fixed-step integrator never rejects a step.
+ *
+ * @param integrator     The integrator.
+ * @param acceptedSteps  Output number of accepted steps.
+ * @param rejectedSteps  Output number of rejected steps.
+ */
+void getSimulationIntegratorStepCounts(const SimulationIntegrator integrator, unsigned long* acceptedSteps, unsigned long* rejectedSteps) {
+	if (integrator->driver != NULL) {
+		*acceptedSteps = integrator->driver->e->count;
+		*rejectedSteps = integrator->driver->e->failed_steps;
+	} else if (integrator->positiveWorkspace != NULL) {
+		*acceptedSteps = integrator->positiveWorkspace->acceptedSteps;
+		*rejectedSteps = integrator->positiveWorkspace->rejectedSteps;
+	} else {
+		*acceptedSteps = integrator->workspace->stepCount;
+		*rejectedSteps = 0;
+	}
+}
+
+/**
+ * Free an integrator allocated with allocateSimulationIntegrator.
+ *
+ * @param integrator  The integrator to free.
+ */
+void freeSimulationIntegrator(SimulationIntegrator integrator) {
+	if (integrator == NULL)
+		return;
+	if (integrator->driver != NULL)
+		gsl_odeiv2_driver_free(integrator->driver);
+	freeFixedStepWorkspace(integrator->workspace);
+	freePositiveStepWorkspace(integrator->positiveWorkspace);
+	free(integrator);
+}
+
+/**
+ * Write the sensitivities of the total population to the selected parameters at one time-point, preceded by the header
+ * on the first time-point.
+ *
+ * @param mParam         Model parameters for the simulation.
+ * @param sensitivities  The selected parameters and the output file.
+ * @param state          The model state followed by the sensitivity vectors.
+ * @param currentTime    The absolute temporal coordinate for the current state.
+ * @param counter        The number of time-points that have elapsed since the simulation started.
+ */
+static void writeSensitivitiesPerTick(const ModelParameters mParam, const SensitivitySelection sensitivities, const double* state,
+                                      const double currentTime, const int counter) {
+	const int dim = NUMBER_FREE_KINETIC_VARIABLES + mParam->targetMoleculeCount + 1;
+	int p, i;
+	
+	if (sensitivities->oHandle == NULL)
+		return;
+	if (counter == 0) {
+		fprintf(sensitivities->oHandle, "time");
+		for (p = 0; p < sensitivities->parameterCount; ++p)
+			fprintf(sensitivities->oHandle, " dP/d%c", getModelParameterOption(sensitivities->parameters[p]));
+		fprintf(sensitivities->oHandle, "\n");
+	}
+	fprintf(sensitivities->oHandle, "%lf", currentTime);
+	for (p = 0; p < sensitivities->parameterCount; ++p) {
+		const double* sensitivity = state + (size_t)(p + 1) * dim;
+		double populationSensitivity = 0.0;
+		
+		for (i = NUMBER_FREE_KINETIC_VARIABLES; i < dim; ++i)
+			populationSensitivity += sensitivity[i];
+		fprintf(sensitivities->oHandle, " %.10le", populationSensitivity);
+	}
+	fprintf(sensitivities->oHandle, "\n");
+}
+
+/**
+ * Number of time-points of a simulation, the start included, with the times accumulated as runSimulation does.
+ *
+ * @param startTime     The time of the first time-point.
+ * @param endTime       The time before which the last time-point lies.
  * @param timeInterval  The amount of time between data-points.
- * @param stateVector   Initial starting conditions as input and final conditions as output.
  *
- * @return              GSL_SUCCESS if everything went well otherwise the GSL error code. 
+ * @return              The number of time-points.
  */
-int runSimulation(const gsl_odeiv2_step_type* stepping, const ModelParameters mParam, const double endTime,
-                  const double timeInterval, double* stateVector, SimulationResults results, const char* output, FILE* oHandleM) {
+long countSimulationTicks(const double startTime, const double endTime, const double timeInterval) {
+	double nextTime;
+	long count = 1;
+
+	for (nextTime = startTime + timeInterval; nextTime < endTime; nextTime += timeInterval)
+		++count;
+	return count;
+}
+
+/**
+ * Integrate from the start to the end time with an allocated integrator, recording every time-point.
+ *
+ * @param integrator     The integrator of the system whose state is given.
+ * @param stepper        The integrator selection, for its verbosity.
+ * @param mParam         Model parameters for the simulation.
+ * @param startTime      The time at which the initial conditions are given.
+ * @param endTime        The time to run the simulation until.
+ * @param timeInterval   The amount of time between data-points.
+ * @param state          Initial conditions as input and final conditions as output, of the model or augmented system.
+ * @param results        Receives the time-points, populations, concentrations and step counts.
+ * @param trajectory     The trajectory file receiving the compartments at every time-point, or NULL for none.
+ * @param sensitivities  The parameters whose sensitivities the state is augmented with, or NULL for the model alone.
+ *
+ * @return               GSL_SUCCESS if everything went well otherwise the GSL error code.
+ */
+static int integrateSimulation(SimulationIntegrator integrator, const SimulationStepper stepper, const ModelParameters mParam,
+                               const double startTime, const double endTime, const double timeInterval, double* state,
+                               SimulationResults results, struct _TrajectoryWriter* trajectory, const SensitivitySelection sensitivities) {
 	int curTimePoint = 0;
-	int systemSize = NUMBER_FREE_KINETIC_VARIABLES + mParam->targetMoleculeCount + 1;
-	double nextTime = timeInterval;
-	double curTime = 0.0;
-	int measureRuntime = 0;
-	int totalTimePoints = ((int)floorl(endTime / timeInterval)) + 1.0;
-	
-    
-	results->timePoint = malloc(sizeof(double) * totalTimePoints);
-	results->totalPopulation = malloc(sizeof(double) * totalTimePoints);
-    results->unboundantibiotic = malloc(sizeof(double) * totalTimePoints);
+	double nextTime = startTime + timeInterval;
+	double curTime = startTime;
+	int status = GSL_SUCCESS;
+
+	if (reserveSimulationResults(results, countSimulationTicks(startTime, endTime, timeInterval)) != GSL_SUCCESS) {
+		fprintf(stderr, "Could not allocate the results\n");
+		return GSL_ENOMEM;
+	}
+	if (trajectory != NULL && expectTrajectoryRows(trajectory, countSimulationTicks(startTime, endTime, timeInterval)) != 0)
+		return GSL_ENOMEM;
 	
-	if (verbose)
+	if (stepper->verbose)
 		printf("\ncreating system with %d free variables\n", NUMBER_FREE_KINETIC_VARIABLES + mParam->targetMoleculeCount + 1);
 	
-	gsl_odeiv2_system sys = {(GSLDerivCalcFunc)calculateModelDerivative_BindingOnly, NULL, systemSize, mParam};
-	gsl_odeiv2_driver* driver = gsl_odeiv2_driver_alloc_y_new (&sys, stepping, timeInterval, 1e-5, 1e-5);
-	
-	updateSimulationResultsPerTick(mParam, (ModelVariables)stateVector, curTime, curTimePoint, results, output, oHandleM);
+	updateSimulationResultsPerTick(mParam, (ModelVariables)state, curTime, curTimePoint, results, trajectory, stepper->verbose);
+	if (sensitivities != NULL)
+		writeSensitivitiesPerTick(mParam, sensitivities, state, curTime, curTimePoint);
 	
 	while (nextTime < endTime) {
-		int i;
-		int status;
-		
 		++curTimePoint;
 		
-		if ((status = gsl_odeiv2_driver_apply (driver, &curTime, nextTime, stateVector)) != GSL_SUCCESS) {
-			fprintf (stderr, "error in  gsl_odeiv2_driver_apply: %d (%s)\n", status, gsl_strerror (status));
-			return status;
+		if ((status = advanceSimulationIntegrator(integrator, &curTime, nextTime, state)) != GSL_SUCCESS) {
+			fprintf(stderr, "error in the integrator: %d (%s)\n", status, gsl_strerror(status));
+			break;
 		}
-		updateSimulationResultsPerTick(mParam, (ModelVariables)stateVector, curTime, curTimePoint, results, output, oHandleM);
+		updateSimulationResultsPerTick(mParam, (ModelVariables)state, curTime, curTimePoint, results, trajectory, stepper->verbose);
+		if (sensitivities != NULL)
+			writeSensitivitiesPerTick(mParam, sensitivities, state, curTime, curTimePoint);
 		
 		nextTime += timeInterval;
 	}
-	if (verbose)
+	if (status == GSL_SUCCESS && stepper->verbose)
 		printf("\n\n");
 
-	return GSL_SUCCESS;
+	getSimulationIntegratorStepCounts(integrator, &results->acceptedSteps, &results->rejectedSteps);
+	return status;
+}
+
+/**
+ * The main simulation loop function. Will set up the ODE system with the selected integrator and run the simulation
+ * within the specified time bounds. Will dump the output to the specified file.
+ *
+ * @param stepper        The integrator selection, either a GSL stepping function or a native fixed-step method.
+ * @param mParam         Model parameters for the simulation.
+ * @param startTime      The time at which the initial conditions are given.
+ * @param endTime        The time to run the simulation until.
+ * @param timeInterval   The amount of time between data-points.
+ * @param stateVector    Initial starting conditions as input and final conditions as output.
+ * @param results        Receives the time-points, populations and concentrations; its vectors are reused when they are
+ *                       large enough, otherwise replaced.
+ * @param trajectory     The trajectory file receiving the compartments at every time-point, or NULL for none.
+ * @param sensitivities  Parameters whose forward sensitivities are integrated with the model and written per time-point,
+ *                       or NULL to integrate the model alone.
+ *
+ * @return               GSL_SUCCESS if everything went well otherwise the GSL error code. 
+ */
+int runSimulation(const SimulationStepper stepper, const ModelParameters mParam, const double startTime, const double endTime,
+                  const double timeInterval, double* stateVector, SimulationResults results, struct _TrajectoryWriter* trajectory,
+                  const SensitivitySelection sensitivities) {
+	const int dim = NUMBER_FREE_KINETIC_VARIABLES + mParam->targetMoleculeCount + 1;
+	struct _SensitivitySystem sensitivitySystem;
+	double* state = stateVector;
+	SimulationIntegrator integrator;
+	int status;
+	
+	if (sensitivities != NULL && sensitivities->parameterCount > 0) {
+		gsl_odeiv2_system system;
+		const size_t augmentedDimension = (size_t)dim * (sensitivities->parameterCount + 1);
+		
+		// The augmented system has no Jacobian for the implicit GSL steppers
+		if (simulationStepperNeedsJacobian(stepper)) {
+			fprintf(stderr, "Sensitivities need an explicit stepping function\n");
+			return GSL_EINVAL;
+		}
+		if ((state = (double*)calloc(augmentedDimension, sizeof(double))) == NULL)
+			return GSL_ENOMEM;
+		memcpy(state, stateVector, sizeof(double) * dim);
+		sensitivitySystem.mParam = mParam;
+		sensitivitySystem.selection = sensitivities;
+		sensitivitySystem.modelDimension = dim;
+		system.function = (GSLDerivCalcFunc)calculateSensitivityDerivative;
+		system.jacobian = NULL;
+		system.dimension = augmentedDimension;
+		system.params = &sensitivitySystem;
+		integrator = allocateSystemIntegrator(stepper, &system, dim, timeInterval);
+	} else
+		integrator = allocateSimulationIntegrator(stepper, mParam, timeInterval);
+	
+	if (integrator == NULL) {
+		fprintf(stderr, "Could not allocate the integrator\n");
+		if (state != stateVector)
+			free(state);
+		return GSL_ENOMEM;
+	}
+	
+	status = integrateSimulation(integrator, stepper, mParam, startTime, endTime, timeInterval, state, results, trajectory,
+	                             (state != stateVector) ? sensitivities : NULL);
+	freeSimulationIntegrator(integrator);
+	if (state != stateVector) {
+		memcpy(stateVector, state, sizeof(double) * dim);
+		free(state);
+	}
+	return status;
+}
+
+/**
+ * Make the parameters of a workspace hold a profile of the given number of time-points.
+ *
+ * @param workspace   The workspace.
+ * @param timepoints  The number of time-points of the run; the profile holds one more value.
+ *
+ * @return            The parameters, whose fields and profile the caller sets, or NULL if they could not be allocated.
+ */
+ModelParameters reserveWorkspaceParameters(SimulationWorkspace workspace, const int timepoints) {
+	ModelParameters mParam;
+
+	if (workspace->mParam != NULL && workspace->profileCapacity >= timepoints)
+		return workspace->mParam;
+	if ((mParam = (ModelParameters)realloc(workspace->mParam, sizeof(struct _ModelParameters) + sizeof(double) * (timepoints + 1))) == NULL)
+		return NULL;
+	workspace->mParam = mParam;
+	workspace->profileCapacity = timepoints;
+	++workspace->allocationCount;
+	return mParam;
+}
+
+/**
+ * The hypergeometric matrix of a number of targets and replication threshold, generated in the workspace unless it
+ * already holds it.
+ *
+ * @param workspace             The workspace.
+ * @param targetMoleculeCount   Total number of target molecules per cell.
+ * @param replicationThreshold  Threshold at which replication ceases.
+ *
+ * @return                      The matrix, owned by the workspace, or NULL if it could not be allocated.
+ */
+double* reserveWorkspaceMatrix(SimulationWorkspace workspace, const int targetMoleculeCount, const int replicationThreshold) {
+	const int matrixSize = (replicationThreshold + 1) * replicationThreshold / 2;
+	double* matrix;
+
+	if (workspace->matrix != NULL && workspace->matrixTargets == targetMoleculeCount && workspace->matrixThreshold == replicationThreshold)
+		return workspace->matrix;
+	if (workspace->matrix == NULL || workspace->matrixCapacity < matrixSize) {
+		// The coefficients are regenerated, so the old ones need not be kept
+		if ((matrix = (double*)malloc(sizeof(double) * ((matrixSize > 0) ? matrixSize : 1))) == NULL)
+			return NULL;
+		free(workspace->matrix);
+		workspace->matrix = matrix;
+		workspace->matrixCapacity = matrixSize;
+		++workspace->allocationCount;
+	}
+	fillHypergeometricMatrix(workspace->matrix, targetMoleculeCount, replicationThreshold);
+	workspace->matrixTargets = targetMoleculeCount;
+	workspace->matrixThreshold = replicationThreshold;
+	return workspace->matrix;
+}
+
+/**
+ * Set the state vector of a workspace to the initial state, a given population and quantity of antibiotic.
+ *
+ * @param workspace            The workspace.
+ * @param targetMoleculeCount  Number of target molecules per cell.
+ * @param startingAntibiotic   Starting dose of antibiotic in the extracellular medium.
+ * @param startingPopulation   Initial population of bacteria with no bound targets.
+ *
+ * @return                     The state vector, owned by the workspace, or NULL if it could not be allocated.
+ */
+double* resetWorkspaceState(SimulationWorkspace workspace, const int targetMoleculeCount, const double startingAntibiotic,
+                            const double startingPopulation) {
+	const int systemSize = NUMBER_FREE_KINETIC_VARIABLES + targetMoleculeCount + 1;
+	double* state;
+
+	if (workspace->state == NULL || workspace->stateCapacity < systemSize) {
+		if ((state = (double*)realloc(workspace->state, sizeof(double) * systemSize)) == NULL)
+			return NULL;
+		workspace->state = state;
+		workspace->stateCapacity = systemSize;
+		++workspace->allocationCount;
+	}
+	memset(workspace->state, 0, sizeof(double) * systemSize);
+	workspace->state[0] = startingAntibiotic;
+	workspace->state[NUMBER_FREE_KINETIC_VARIABLES] = startingPopulation;
+	return workspace->state;
+}
+
+/**
+ * The integrator of the workspace for the binding model with its parameters. The integrator of the previous run is
+ * restarted, as a newly allocated one would start, when it was allocated for the same integrator selection, time
+ * interval and system dimension; otherwise it is replaced.
+ *
+ * @return  The integrator, or NULL if it could not be allocated.
+ */
+static SimulationIntegrator reserveWorkspaceIntegrator(SimulationWorkspace workspace, const SimulationStepper stepper, const double timeInterval) {
+	SimulationIntegrator integrator = workspace->integrator;
+	const struct _SimulationStepper* previous = &workspace->integratorStepper;
+
+	if (integrator != NULL && previous->gslStepping == stepper->gslStepping && previous->nativeMethod == stepper->nativeMethod &&
+	    previous->positivityPreserving == stepper->positivityPreserving && previous->fixedStepSize == stepper->fixedStepSize &&
+	    workspace->integratorInterval == timeInterval &&
+	    integrator->system.dimension == (size_t)(NUMBER_FREE_KINETIC_VARIABLES + workspace->mParam->targetMoleculeCount + 1)) {
+		// The parameters may have moved when their profile grew
+		integrator->system.params = workspace->mParam;
+		resetSimulationIntegrator(integrator);
+		// A new driver also starts from the initial step rather than the last one taken
+		if (integrator->driver != NULL)
+			gsl_odeiv2_driver_reset_hstart(integrator->driver, timeInterval);
+		return integrator;
+	}
+
+	freeSimulationIntegrator(integrator);
+	workspace->integrator = allocateSimulationIntegrator(stepper, workspace->mParam, timeInterval);
+	workspace->integratorStepper = *stepper;
+	workspace->integratorInterval = timeInterval;
+	if (workspace->integrator != NULL)
+		++workspace->allocationCount;
+	return workspace->integrator;
+}
+
+/**
+ * Run a simulation from time zero, as runSimulation does, in the buffers of a workspace: its parameters, set with
+ * reserveWorkspaceParameters and holding their hypergeometric matrix, and its state, set with resetWorkspaceState and
+ * holding the final state on return. The time-points are recorded in the results of the workspace.
+ *
+ * @param workspace     The workspace.
+ * @param stepper       The integrator selection.
+ * @param endTime       The time to run the simulation until.
+ * @param timeInterval  The amount of time between data-points.
+ * @param trajectory    The trajectory file receiving the compartments at every time-point, or NULL for none.
+ *
+ * @return              GSL_SUCCESS if everything went well otherwise the GSL error code.
+ */
+int runWorkspaceSimulation(SimulationWorkspace workspace, const SimulationStepper stepper, const double endTime, const double timeInterval,
+                           struct _TrajectoryWriter* trajectory) {
+	const long capacity = workspace->results.capacity;
+	SimulationIntegrator integrator;
+	int status;
+
+	if ((integrator = reserveWorkspaceIntegrator(workspace, stepper, timeInterval)) == NULL) {
+		fprintf(stderr, "Could not allocate the integrator\n");
+		return GSL_ENOMEM;
+	}
+	status = integrateSimulation(integrator, stepper, workspace->mParam, 0.0, endTime, timeInterval, workspace->state, &workspace->results,
+	                             trajectory, NULL);
+	if (workspace->results.capacity != capacity)
+		++workspace->allocationCount;
+	return status;
+}
+
+/**
+ * Free the buffers of a workspace, leaving it empty for reuse.
+ *
+ * @param workspace  The workspace.
+ */
+void freeSimulationWorkspace(SimulationWorkspace workspace) {
+	freeSimulationIntegrator(workspace->integrator);
+	freeSimulationResults(&workspace->results);
+	free(workspace->matrix);
+	free(workspace->state);
+	free(workspace->mParam);
+	memset(workspace, 0, sizeof(struct _SimulationWorkspace));
+}
+
+/**
+ * Simulate from time zero with an allocated integrator and record only the log10 population at every time-point, for
+ * the modes which reduce many simulations to summary outputs. The time-points are those of runSimulation.
+ *
+ * @param integrator     An integrator of the model with mParam; it is reset before the simulation.
+ * @param mParam         Model parameters for the simulation.
+ * @param endTime        The time to run the simulation until.
+ * @param timeInterval   The amount of time between time-points.
+ * @param initialState   The initial state.
+ * @param state          State buffer of the model dimension, holding the final state on return.
+ * @param logPopulation  Receives log10 of the population, floored at POPULATION_FLOOR, at each of up to
+ *                       mParam->timepoints + 1 time-points.
+ * @param tickCount      Receives the number of time-points recorded.
+ *
+ * @return               GSL_SUCCESS if everything went well otherwise the GSL error code.
+ */
+int recordLogPopulation(SimulationIntegrator integrator, const ModelParameters mParam, const double endTime, const double timeInterval,
+                        const double* initialState, double* state, double* logPopulation, int* tickCount) {
+	const int dim = NUMBER_FREE_KINETIC_VARIABLES + mParam->targetMoleculeCount + 1;
+	double curTime = 0.0;
+	double nextTime = timeInterval;
+	int i;
+	int status;
+
+	memcpy(state, initialState, sizeof(double) * dim);
+	resetSimulationIntegrator(integrator);
+	*tickCount = 0;
+	for (;;) {
+		double population = 0.0;
+
+		for (i = NUMBER_FREE_KINETIC_VARIABLES; i < dim; ++i)
+			population += state[i];
+		logPopulation[(*tickCount)++] = log10(fmax(population, POPULATION_FLOOR));
+		if (nextTime >= endTime || *tickCount > mParam->timepoints)
+			return GSL_SUCCESS;
+		if ((status = advanceSimulationIntegrator(integrator, &curTime, nextTime, state)) != GSL_SUCCESS)
+			return status;
+		nextTime += timeInterval;
+	}
 }
 
 /**
@@ -137,9 +778,24 @@ int runSimulation(const gsl_odeiv2_step_type* stepping, const ModelParameters mP
  * @return                      One side of hypergeometric matrix (including diagonal) compressed into a linear vector.
  */
 double* generateHypergeometricMatrix(const int populationCount, const int replicationThreshold) {
-	int i,j;
 	int matrixSize = (replicationThreshold + 1) * replicationThreshold / 2;
 	double* matrix = (double*)malloc(matrixSize * sizeof(double));
+	
+	if (matrix != NULL)
+		fillHypergeometricMatrix(matrix, populationCount, replicationThreshold);
+	return matrix;
+}
+
+/**
+ * Compute the coefficients of generateHypergeometricMatrix into a vector of (replicationThreshold + 1) *
+ * replicationThreshold / 2 values.
+ *
+ * @param matrix                The vector receiving the coefficients.
+ * @param populationCount       Total number of target molecules per cell.
+ * @param replicationThreshold  Threshold at which replication ceases.
+ */
+void fillHypergeometricMatrix(double* matrix, const int populationCount, const int replicationThreshold) {
+	int i,j;
 	double* mPointer = matrix;
 	
 	double staticChoose = gsl_sf_lnchoose(2 * populationCount, populationCount);
@@ -155,8 +811,6 @@ double* generateHypergeometricMatrix(const int populationCount, const int replic
             //Vi changes back to Trevor version
             *mPointer++ = gsl_sf_exp(tmpChoose1 + tmpChoose2 - staticChoose);
 		}
-		
-	return matrix;
 }
 
 /**
@@ -10,6 +10,10 @@
 #define DEFAULT_STARTING_POPULATION 1e6    ///< From equationparserv2.R
 #define DEFAULT_SIMULATION_END_TIME 360000.0  ///< From equationparserv2.R
 #define DEFAULT_SIMULATION_STEP_SIZE 3600.0   ///< From equationparserv2.R
+#define POPULATION_FLOOR 1.0                  ///< Smallest population, one cell, whose logarithm is recorded
+#define SIMULATION_ABSOLUTE_TOLERANCE 1e-5    ///< Absolute error allowed per step by the adaptive integrators
+#define SIMULATION_RELATIVE_TOLERANCE 1e-5    ///< Relative error allowed per step by the adaptive integrators
+#define SIMULATION_MESSAGE_LENGTH 256         ///< Longest reason given for an option which cannot be set
 
 
 /**
@@ -22,6 +26,28 @@ typedef struct _SimulationParameters {
 	double stepSize;            ///< The time-delta between time-points
 } *SimulationParameters;
 
+/**
+ * Structure to select the integrator which advances the ODE system between time-points
+ */
+typedef struct _SimulationStepper {
+	const gsl_odeiv2_step_type* gslStepping; ///< GSL stepping function driven by gsl_odeiv2_driver, or NULL to use the native integrator.
+	FixedStepMethod nativeMethod;            ///< The native fixed-step method used when gslStepping is NULL.
+	int positivityPreserving;                ///< Use the adaptive positivity-preserving integrator instead of nativeMethod when gslStepping is NULL.
+	double fixedStepSize;                    ///< Step size of the native integrator. Zero or less uses the time interval.
+	int verbose;                             ///< Print the progress of the simulations to the standard output.
+} *SimulationStepper;
+
+/**
+ * Structure to hold an allocated integrator, either a GSL driver or a native fixed-step workspace, for one ODE system
+ */
+typedef struct _SimulationIntegrator {
+	gsl_odeiv2_system system;     ///< The ODE system being integrated. Referenced by the driver or the workspace.
+	gsl_odeiv2_driver* driver;    ///< The GSL driver, or NULL when the native integrator is used.
+	FixedStepWorkspace workspace; ///< The native fixed-step workspace, or NULL when another integrator is used.
+	PositiveStepWorkspace positiveWorkspace; ///< The positivity-preserving integrator workspace, or NULL when another integrator is used.
+	double stepSize;              ///< Step size of the native integrator.
+} *SimulationIntegrator;
+
 /**
  * Structure to hold the aggregated results of a simulation
  */
@@ -31,11 +57,90 @@ typedef struct _SimulationResults {
     double* unboundantibiotic; ///< Vector containing the list of free antibiotic concentartion for each time-point.
 	double finalTime;        ///< The final time-point of the system.
 	double finalPopulation;  ///< The final population count of the system.
+	unsigned long acceptedSteps; ///< Number of integration steps accepted during the simulation.
+	unsigned long rejectedSteps; ///< Number of integration steps rejected by the error control during the simulation.
+	long capacity;           ///< Number of time-points the vectors hold; a later simulation reuses them if they are large enough.
 } *SimulationResults;
 
-int runSimulation(const gsl_odeiv2_step_type* stepping, const ModelParameters mParam, const double endTime,
-                  const double timeInterval, double* stateVector, SimulationResults results, const char* output, FILE* oHandleM);
+/**
+ * Structure to hold the buffers of the simulations run one after another by one worker: the parameters with their
+ * profile, the state vector, the hypergeometric matrix, the integrator and the result vectors. Each is kept between
+ * runs and only reallocated when a run needs a larger one, so once a worker has run its largest simulation further runs
+ * allocate none of them. Zero-initialised before the first run.
+ */
+typedef struct _SimulationWorkspace {
+	ModelParameters mParam;              ///< Parameters of the run, followed by its profile in molecules, or NULL.
+	int profileCapacity;                 ///< Number of time-points, beyond the first, the profile of mParam holds.
+	double* state;                       ///< State vector of the run, or NULL.
+	int stateCapacity;                   ///< Number of components the state vector holds.
+	double* matrix;                      ///< Hypergeometric matrix generated in the workspace, or NULL.
+	int matrixCapacity;                  ///< Number of coefficients the matrix holds.
+	int matrixTargets;                   ///< Number of targets the matrix holds the coefficients of, zero for none.
+	int matrixThreshold;                 ///< Replication threshold the matrix holds the coefficients of.
+	SimulationIntegrator integrator;     ///< Integrator of the last run, or NULL.
+	struct _SimulationStepper integratorStepper; ///< Integrator selection the integrator was allocated for.
+	double integratorInterval;           ///< Time interval the integrator was allocated for.
+	struct _SimulationResults results;   ///< Result vectors of the last run.
+	unsigned long allocationCount;       ///< Number of buffers allocated, or reallocated, by the runs, as reported for a batch.
+} *SimulationWorkspace;
+
+struct _TrajectoryWriter;
+struct _TrajectoryOptions;
+struct _VcombatContext;
+
+int parseSimulationStepper(const char* name, SimulationStepper stepper);
+
+int parseSimulationOption(const char code, const char* value, SimulationStepper stepper, ModelParameters model,
+                          SimulationParameters simulation, struct _TrajectoryOptions* trajectoryOptions, char* message);
+
+void getVcombatSettings(const struct _VcombatContext* context, SimulationStepper stepper, ModelParameters model,
+                        SimulationParameters simulation, struct _TrajectoryOptions* trajectoryOptions);
+
+SimulationIntegrator allocateSimulationIntegrator(const SimulationStepper stepper, const ModelParameters mParam, const double timeInterval);
+
+SimulationIntegrator allocateSystemIntegrator(const SimulationStepper stepper, const gsl_odeiv2_system* system, const size_t clippedDimension,
+                                              const double timeInterval);
+
+int simulationStepperNeedsJacobian(const SimulationStepper stepper);
+
+int advanceSimulationIntegrator(SimulationIntegrator integrator, double* curTime, const double nextTime, double* stateVector);
+
+void resetSimulationIntegrator(SimulationIntegrator integrator);
+
+void getSimulationIntegratorStepCounts(const SimulationIntegrator integrator, unsigned long* acceptedSteps, unsigned long* rejectedSteps);
+
+void freeSimulationIntegrator(SimulationIntegrator integrator);
+
+void updateSimulationResultsPerTick(const ModelParameters mParam, const ModelVariables state, const double currentTime,
+                                    const int counter, SimulationResults results, struct _TrajectoryWriter* trajectory, const int verbose);
+
+int reserveSimulationResults(SimulationResults results, const long timePointCount);
+
+void freeSimulationResults(SimulationResults results);
+
+long countSimulationTicks(const double startTime, const double endTime, const double timeInterval);
+
+int runSimulation(const SimulationStepper stepper, const ModelParameters mParam, const double startTime, const double endTime,
+                  const double timeInterval, double* stateVector, SimulationResults results, struct _TrajectoryWriter* trajectory,
+                  const SensitivitySelection sensitivities);
+
+int recordLogPopulation(SimulationIntegrator integrator, const ModelParameters mParam, const double endTime, const double timeInterval,
+                        const double* initialState, double* state, double* logPopulation, int* tickCount);
+
+ModelParameters reserveWorkspaceParameters(SimulationWorkspace workspace, const int timepoints);
+
+double* reserveWorkspaceMatrix(SimulationWorkspace workspace, const int targetMoleculeCount, const int replicationThreshold);
+
+double* resetWorkspaceState(SimulationWorkspace workspace, const int targetMoleculeCount, const double startingAntibiotic,
+                            const double startingPopulation);
+
+int runWorkspaceSimulation(SimulationWorkspace workspace, const SimulationStepper stepper, const double endTime, const double timeInterval,
+                           struct _TrajectoryWriter* trajectory);
+
+void freeSimulationWorkspace(SimulationWorkspace workspace);
 
 double* generateHypergeometricMatrix(const int populationCount, const int replicationThreshold);
 
+void fillHypergeometricMatrix(double* matrix, const int populationCount, const int replicationThreshold);
+
 double* initializeStateVector(const int targetMoleculeCount, const double startingAntibiotic, const double startingPopulation);
@@ -0,0 +1,234 @@
+/**
+ * @file   equilibrium.c
+ * @version 5
+ * @updated  2026
+ * @brief  Direct equilibrium solver and concentration continuation for constant-concentration experiments
+ *
+ * With the drug concentration held constant the intracellular compartments form an autonomous system, and the state a
+ * long time-kill simulation settles into is a root of its derivative. The root is found by pseudo-transient
+ * continuation: each iteration solves $(\frac{1}{\delta}I - J)\Delta x = f(x)$ with the analytic model Jacobian, which
+ * for small $\delta$ is an implicit Euler step of the dynamics and for large $\delta$ is a Newton step. Growing
+ * $\delta$ follows the dynamics away from the initial state into the basin of the equilibrium they settle in (rather
+ * than the extinct state, which is always a root), then converges quadratically.
+ *
+ * The free target and free bound complex do not feed back into the compartments. They only settle if no cells are
+ * killed at equilibrium, in which case their ratio is the binding equilibrium; otherwise the rate at which killed cells
+ * release targets is reported.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <gsl/gsl_errno.h>
+#include <gsl/gsl_vector.h>
+#include <gsl/gsl_matrix.h>
+#include <gsl/gsl_linalg.h>
+#include "full_model.h"
+#include "equilibrium.h"
+
+#define EQUILIBRIUM_NEWTON_SCALE 1e8   ///< Pseudo time step, relative to the fastest rate, beyond which steps are taken as Newton steps
+#define EQUILIBRIUM_MAX_SCALE 1e15     ///< Largest pseudo time step relative to the fastest rate
+
+/**
+ * Fill the whole concentration profile with a constant concentration.
+ */
+static void setConstantConcentration(const ModelParameters mParam, const double concentration) {
+	double molecules = concentrationToMolecules(mParam, concentration);
+	int i;
+
+	for (i = 0; i < mParam->timepoints; ++i)
+		mParam->realantibioticconc[i] = molecules;
+}
+
+/**
+ * Find the equilibrium of the compartments at a constant drug concentration. The derivative and Jacobian are evaluated
+ * at time zero, so the concentration profile of the model parameters is overwritten with the constant concentration.
+ *
+ * @param mParam         Model parameters; the concentration profile must have at least two time-points.
+ * @param concentration  The constant drug concentration in mg/L.
+ * @param stateVector    The starting state as input, the equilibrium as output.
+ * @param tolerance      Relative size of the Newton correction at which the equilibrium is accepted.
+ * @param maxIterations  Maximum number of iterations.
+ * @param results        The results structure to fill.
+ *
+ * @return               GSL_SUCCESS, GSL_EMAXITER if the iteration did not converge or GSL_ESING for a singular system.
+ */
+int solveEquilibrium(const ModelParameters mParam, const double concentration, double* stateVector, const double tolerance,
+                     const int maxIterations, EquilibriumResults results) {
+	const int n = mParam->targetMoleculeCount;
+	const int dim = NUMBER_FREE_KINETIC_VARIABLES + n + 1;
+	const int offset = NUMBER_FREE_KINETIC_VARIABLES;
+	const int compartments = n + 1;
+	double* derivative = malloc(sizeof(double) * dim);
+	double* jacobian = malloc(sizeof(double) * dim * dim);
+	double* timeDerivative = malloc(sizeof(double) * dim);
+	gsl_matrix* system = gsl_matrix_alloc(compartments, compartments);
+	gsl_vector* correction = gsl_vector_alloc(compartments);
+	gsl_permutation* permutation = gsl_permutation_alloc(compartments);
+	double* compartmentBoundComplexState = stateVector + offset;
+	double fastestRate = 0.0;
+	double delta = 0.0;
+	double previousNorm = 0.0;
+	int status = GSL_EMAXITER;
+	int i, j;
+
+	setConstantConcentration(mParam, concentration);
+	results->converged = 0;
+	results->residual = 0.0;
+
+	for (results->iterations = 0; results->iterations < maxIterations; ++results->iterations) {
+		double derivativeNorm = 0.0;
+		double correctionNorm = 0.0;
+		double stateNorm = 0.0;
+		int signum;
+
+		calculateModelDerivative_BindingOnly(0.0, (ModelVariables)stateVector, (ModelVariables)derivative, mParam);
+		calculateModelJacobian_BindingOnly(0.0, (ModelVariables)stateVector, jacobian, timeDerivative, mParam);
+		for (i = 0; i < compartments; ++i)
+			derivativeNorm = fmax(derivativeNorm, fabs(derivative[offset + i]));
+		if (derivativeNorm == 0.0) {
+			results->converged = 1;
+			status = GSL_SUCCESS;
+			break;
+		}
+
+		// The pseudo time step starts on the fastest time scale and grows at least geometrically, faster as the
+		// derivative falls (switched evolution relaxation)
+		if (results->iterations == 0) {
+			for (i = 0; i < compartments; ++i)
+				fastestRate = fmax(fastestRate, fabs(jacobian[(offset + i) * dim + offset + i]));
+			if (fastestRate == 0.0)
+				fastestRate = 1.0;
+			delta = 1.0 / fastestRate;
+		} else {
+			delta *= fmin(fmax(previousNorm / derivativeNorm, 2.0), 1e3);
+			delta = fmin(delta, EQUILIBRIUM_MAX_SCALE / fastestRate);
+		}
+		previousNorm = derivativeNorm;
+
+		for (i = 0; i < compartments; ++i) {
+			for (j = 0; j < compartments; ++j)
+				gsl_matrix_set(system, i, j, -jacobian[(offset + i) * dim + offset + j]);
+			*gsl_matrix_ptr(system, i, i) += 1.0 / delta;
+			gsl_vector_set(correction, i, derivative[offset + i]);
+		}
+		gsl_linalg_LU_decomp(system, permutation, &signum);
+		for (i = 0; i < compartments; ++i)
+			if (gsl_matrix_get(system, i, i) == 0.0)
+				break;
+		if (i < compartments) {
+			status = GSL_ESING;
+			break;
+		}
+		gsl_linalg_LU_svx(system, permutation, correction);
+
+		for (i = 0; i < compartments; ++i) {
+			compartmentBoundComplexState[i] = fmax(compartmentBoundComplexState[i] + gsl_vector_get(correction, i), 0.0);
+			correctionNorm = fmax(correctionNorm, fabs(gsl_vector_get(correction, i)));
+			stateNorm = fmax(stateNorm, compartmentBoundComplexState[i]);
+		}
+		results->residual = correctionNorm / (1.0 + stateNorm);
+		if (delta * fastestRate >= EQUILIBRIUM_NEWTON_SCALE && results->residual <= tolerance) {
+			++results->iterations;
+			results->converged = 1;
+			status = GSL_SUCCESS;
+			break;
+		}
+	}
+
+	// Summaries of the equilibrium
+	calculateModelDerivative_BindingOnly(0.0, (ModelVariables)stateVector, (ModelVariables)derivative, mParam);
+	results->population = 0.0;
+	results->meanBoundTargets = 0.0;
+	for (i = 0; i < compartments; ++i) {
+		results->population += compartmentBoundComplexState[i];
+		results->meanBoundTargets += i * compartmentBoundComplexState[i];
+	}
+	if (results->population > 0.0)
+		results->meanBoundTargets /= results->population;
+	{
+		double forwardRate = mParam->targetAssociationRate / (AVOGADRO_CONSTANT * mParam->intracellularVolume) * mParam->realantibioticconc[0];
+		results->boundFraction = (forwardRate + mParam->targetDissociationRate > 0.0) ?
+		                         forwardRate / (forwardRate + mParam->targetDissociationRate) : 0.0;
+	}
+	results->targetReleaseRate = derivative[0] + derivative[1];
+
+	gsl_permutation_free(permutation);
+	gsl_vector_free(correction);
+	gsl_matrix_free(system);
+	free(timeDerivative);
+	free(jacobian);
+	free(derivative);
+
+	return status;
+}
+
+/**
+ * Trace the equilibrium along a range of constant concentrations, each solve starting from a secant prediction made
+ * from the previous equilibria. The concentrations are spaced logarithmically if the range is positive, otherwise
+ * linearly.
+ *
+ * @param mParam            Model parameters; the concentration profile is overwritten.
+ * @param minConcentration  The first concentration in mg/L.
+ * @param maxConcentration  The last concentration in mg/L.
+ * @param count             The number of concentrations.
+ * @param stateVector       The starting state for the first concentration as input, the last equilibrium as output.
+ * @param tolerance         Relative size of the Newton correction at which an equilibrium is accepted.
+ * @param oHandle           File to write one row per concentration with the summaries and the compartments, or NULL.
+ *
+ * @return                  GSL_SUCCESS if every equilibrium converged, otherwise the last failing status.
+ */
+int traceEquilibriumCurve(const ModelParameters mParam, const double minConcentration, const double maxConcentration, const int count,
+                          double* stateVector, const double tolerance, FILE* oHandle) {
+	const int dim = NUMBER_FREE_KINETIC_VARIABLES + mParam->targetMoleculeCount + 1;
+	const int logSpacing = (minConcentration > 0.0 && maxConcentration > 0.0);
+	double* previousState = malloc(sizeof(double) * dim);
+	double previousCoordinate = 0.0;
+	double coordinate = 0.0;
+	int overallStatus = GSL_SUCCESS;
+	int k, i;
+
+	printf("%-14s %-14s %-14s %-14s %-14s %s\n", "concentration", "population", "meanBound", "boundFraction", "releaseRate", "iterations");
+	if (oHandle != NULL)
+		fprintf(oHandle, "C BP Lm Fb Rr it L0..Ln\n");
+
+	for (k = 0; k < count; ++k) {
+		struct _EquilibriumResults equilibrium;
+		double fraction = (count > 1) ? (double)k / (count - 1) : 0.0;
+		double nextCoordinate = logSpacing ? log(minConcentration) + fraction * (log(maxConcentration) - log(minConcentration))
+		                                   : minConcentration + fraction * (maxConcentration - minConcentration);
+		double concentration = logSpacing ? exp(nextCoordinate) : nextCoordinate;
+		int status;
+
+		// Secant predictor along the curve
+		if (k >= 2 && coordinate != previousCoordinate) {
+			double ratio = (nextCoordinate - coordinate) / (coordinate - previousCoordinate);
+			for (i = NUMBER_FREE_KINETIC_VARIABLES; i < dim; ++i) {
+				double current = stateVector[i];
+				stateVector[i] = fmax(current + ratio * (current - previousState[i]), 0.0);
+				previousState[i] = current;
+			}
+		} else
+			memcpy(previousState, stateVector, sizeof(double) * dim);
+		previousCoordinate = coordinate;
+		coordinate = nextCoordinate;
+
+		status = solveEquilibrium(mParam, concentration, stateVector, tolerance, DEFAULT_EQUILIBRIUM_MAX_ITERATIONS, &equilibrium);
+		if (status != GSL_SUCCESS)
+			overallStatus = status;
+
+		printf("%-14lg %-14lg %-14lg %-14lg %-14lg %d%s\n", concentration, equilibrium.population, equilibrium.meanBoundTargets,
+		       equilibrium.boundFraction, equilibrium.targetReleaseRate, equilibrium.iterations, equilibrium.converged ? "" : " (not converged)");
+		if (oHandle != NULL) {
+			fprintf(oHandle, "%lf %lf %lf %lf %lf %d", concentration, equilibrium.population, equilibrium.meanBoundTargets,
+			        equilibrium.boundFraction, equilibrium.targetReleaseRate, equilibrium.iterations);
+			for (i = NUMBER_FREE_KINETIC_VARIABLES; i < dim; ++i)
+				fprintf(oHandle, " %lf", stateVector[i]);
+			fprintf(oHandle, "\n");
+		}
+	}
+
+	free(previousState);
+	return overallStatus;
+}
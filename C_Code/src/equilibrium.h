@@ -0,0 +1,28 @@
+/**
+ * @file   equilibrium.h
+ * @version 5
+ * @updated  2026
+ * @brief  Direct equilibrium solver and concentration continuation for constant-concentration experiments
+ */
+
+#define DEFAULT_EQUILIBRIUM_TOLERANCE 1e-10     ///< Relative size of the Newton correction at which the equilibrium is accepted
+#define DEFAULT_EQUILIBRIUM_MAX_ITERATIONS 200  ///< Maximum number of pseudo-transient Newton iterations per concentration
+
+/**
+ * Structure to hold the equilibrium reached at one constant drug concentration
+ */
+typedef struct _EquilibriumResults {
+	int converged;            ///< Non-zero if the Newton correction reached the tolerance.
+	int iterations;           ///< Number of pseudo-transient Newton iterations performed.
+	double residual;          ///< Relative size of the last Newton correction.
+	double population;        ///< Total number of cells at equilibrium.
+	double meanBoundTargets;  ///< Mean number of bound targets per cell at equilibrium.
+	double boundFraction;     ///< Fraction of the free targets in the bound complex at binding equilibrium.
+	double targetReleaseRate; ///< Rate at which killed cells release targets into the free target and bound complex.
+} *EquilibriumResults;
+
+int solveEquilibrium(const ModelParameters mParam, const double concentration, double* stateVector, const double tolerance,
+                     const int maxIterations, EquilibriumResults results);
+
+int traceEquilibriumCurve(const ModelParameters mParam, const double minConcentration, const double maxConcentration, const int count,
+                          double* stateVector, const double tolerance, FILE* oHandle);
@@ -0,0 +1,222 @@
+/**
+ * @file   fixed_step.c
+ * @version 5
+ * @updated  2026
+ * @brief  Native fixed-step Runge-Kutta integrators for the binding model
+ *
+ * The GSL driver path costs an indirect call through the system function pointer per stage, copies of the state into
+ * the evolve and step buffers, and an additional derivative evaluation per step for the output derivative. The
+ * integrators in this file evaluate the model derivative directly and combine each stage with the accumulation of the
+ * final weighted sum in a single pass over the state, using stage buffers which are allocated once per workspace.
+ */
+
+#include <stdlib.h>
+#include <gsl/gsl_odeiv2.h>
+#include <gsl/gsl_errno.h>
+#include "full_model.h"
+#include "fixed_step.h"
+
+/**
+ * Evaluate the derivative of the system. The binding model is called directly so that the compiler sees the callee,
+ * any other system goes through its function pointer.
+ *
+ * @param workspace  The workspace referencing the ODE system.
+ * @param t          The time at which to evaluate the derivative.
+ * @param y          The state at which to evaluate the derivative.
+ * @param dydt       The output derivative.
+ *
+ * @return           The status returned by the derivative function.
+ */
+static inline int evaluateDerivative(const FixedStepWorkspace workspace, const double t, const double* y, double* dydt) {
+	if (workspace->system->function == (GSLDerivCalcFunc)calculateModelDerivative_BindingOnly)
+		return calculateModelDerivative_BindingOnly(t, (ModelVariables)y, (ModelVariables)dydt, (ModelParameters)workspace->system->params);
+	return workspace->system->function(t, y, dydt, workspace->system->params);
+}
+
+/**
+ * One step of the gsl_odeiv2_step_rk2 tableau, $y + \frac{h}{6}(k_1 + 4k_2 + k_3)$, without its error estimate.
+ */
+static int stepRK2(FixedStepWorkspace workspace, const double t, const double h, double* y) {
+	const size_t dim = workspace->system->dimension;
+	double* k1 = workspace->stageAccumulator;
+	double* k2 = workspace->stageDerivative;
+	double* yTemp = workspace->stageState;
+	size_t i;
+	int status;
+
+	if ((status = evaluateDerivative(workspace, t, y, k1)) != GSL_SUCCESS)
+		return status;
+	for (i = 0; i < dim; ++i)
+		yTemp[i] = y[i] + 0.5 * h * k1[i];
+
+	if ((status = evaluateDerivative(workspace, t + 0.5 * h, yTemp, k2)) != GSL_SUCCESS)
+		return status;
+	// The third stage input and the partial sum $k_1 + 4k_2$ are formed in the same pass, the latter overwriting $k_1$
+	for (i = 0; i < dim; ++i) {
+		yTemp[i] = y[i] + h * (-k1[i] + 2.0 * k2[i]);
+		k1[i] = k1[i] + 4.0 * k2[i];
+	}
+
+	if ((status = evaluateDerivative(workspace, t + h, yTemp, k2)) != GSL_SUCCESS)
+		return status;
+	for (i = 0; i < dim; ++i)
+		y[i] += h * ((k1[i] + k2[i]) / 6.0);
+
+	return GSL_SUCCESS;
+}
+
+/**
+ * One step of the classical fourth-order Runge-Kutta method, accumulating $k_1 + 2k_2 + 2k_3$ while forming the next
+ * stage input so that only one derivative buffer is needed.
+ */
+static int stepRK4(FixedStepWorkspace workspace, const double t, const double h, double* y) {
+	const size_t dim = workspace->system->dimension;
+	double* k = workspace->stageDerivative;
+	double* kSum = workspace->stageAccumulator;
+	double* yTemp = workspace->stageState;
+	size_t i;
+	int status;
+
+	if ((status = evaluateDerivative(workspace, t, y, k)) != GSL_SUCCESS)
+		return status;
+	for (i = 0; i < dim; ++i) {
+		kSum[i] = k[i];
+		yTemp[i] = y[i] + 0.5 * h * k[i];
+	}
+
+	if ((status = evaluateDerivative(workspace, t + 0.5 * h, yTemp, k)) != GSL_SUCCESS)
+		return status;
+	for (i = 0; i < dim; ++i) {
+		kSum[i] += 2.0 * k[i];
+		yTemp[i] = y[i] + 0.5 * h * k[i];
+	}
+
+	if ((status = evaluateDerivative(workspace, t + 0.5 * h, yTemp, k)) != GSL_SUCCESS)
+		return status;
+	for (i = 0; i < dim; ++i) {
+		kSum[i] += 2.0 * k[i];
+		yTemp[i] = y[i] + h * k[i];
+	}
+
+	if ((status = evaluateDerivative(workspace, t + h, yTemp, k)) != GSL_SUCCESS)
+		return status;
+	for (i = 0; i < dim; ++i)
+		y[i] += h / 6.0 * (kSum[i] + k[i]);
+
+	return GSL_SUCCESS;
+}
+
+/**
+ * One step of the Shu-Osher SSPRK(3,3) method, written as convex combinations of forward Euler steps.
+ */
+static int stepSSPRK3(FixedStepWorkspace workspace, const double t, const double h, double* y) {
+	const size_t dim = workspace->system->dimension;
+	double* k = workspace->stageDerivative;
+	double* u = workspace->stageState;
+	size_t i;
+	int status;
+
+	if ((status = evaluateDerivative(workspace, t, y, k)) != GSL_SUCCESS)
+		return status;
+	for (i = 0; i < dim; ++i)
+		u[i] = y[i] + h * k[i];
+
+	if ((status = evaluateDerivative(workspace, t + h, u, k)) != GSL_SUCCESS)
+		return status;
+	for (i = 0; i < dim; ++i)
+		u[i] = 0.75 * y[i] + 0.25 * (u[i] + h * k[i]);
+
+	if ((status = evaluateDerivative(workspace, t + 0.5 * h, u, k)) != GSL_SUCCESS)
+		return status;
+	for (i = 0; i < dim; ++i)
+		y[i] = y[i] / 3.0 + 2.0 / 3.0 * (u[i] + h * k[i]);
+
+	return GSL_SUCCESS;
+}
+
+/**
+ * Allocate a native fixed-step workspace for the given system.
+ *
+ * @param method  The Runge-Kutta method to use.
+ * @param system  The ODE system to integrate. Must outlive the workspace.
+ *
+ * @return        The workspace, or NULL if the allocation failed.
+ */
+FixedStepWorkspace allocateFixedStepWorkspace(const FixedStepMethod method, const gsl_odeiv2_system* system) {
+	FixedStepWorkspace workspace = (FixedStepWorkspace)malloc(sizeof(struct _FixedStepWorkspace));
+
+	if (workspace == NULL)
+		return NULL;
+	workspace->method = method;
+	workspace->system = system;
+	// The three buffers share a single allocation
+	workspace->stageDerivative = (double*)malloc(sizeof(double) * 3 * system->dimension);
+	if (workspace->stageDerivative == NULL) {
+		free(workspace);
+		return NULL;
+	}
+	workspace->stageAccumulator = workspace->stageDerivative + system->dimension;
+	workspace->stageState = workspace->stageAccumulator + system->dimension;
+	workspace->stepCount = 0;
+
+	return workspace;
+}
+
+/**
+ * Advance the state from the current time to the next time with steps of the given size. The last step is shortened
+ * so that the integration ends exactly on the next time.
+ *
+ * @param workspace    The native integrator workspace.
+ * @param curTime      The current time as input, the next time as output.
+ * @param nextTime     The time to integrate until.
+ * @param stepSize     The size of each step.
+ * @param stateVector  The state at the current time as input, the state at the next time as output.
+ *
+ * @return             GSL_SUCCESS, or the error code returned by the derivative function.
+ */
+int applyFixedStep(FixedStepWorkspace workspace, double* curTime, const double nextTime, const double stepSize, double* stateVector) {
+	int status = GSL_SUCCESS;
+
+	while (*curTime < nextTime) {
+		double h = stepSize;
+		int lastStep = 0;
+
+		// Round-off in the accumulated time must not produce a spurious sliver of a step at the end
+		if (nextTime - *curTime <= stepSize * (1.0 + 1e-9)) {
+			h = nextTime - *curTime;
+			lastStep = 1;
+		}
+
+		switch (workspace->method) {
+		case FIXED_STEP_RK4:
+			status = stepRK4(workspace, *curTime, h, stateVector);
+			break;
+		case FIXED_STEP_SSPRK3:
+			status = stepSSPRK3(workspace, *curTime, h, stateVector);
+			break;
+		case FIXED_STEP_RK2:
+		default:
+			status = stepRK2(workspace, *curTime, h, stateVector);
+			break;
+		}
+		if (status != GSL_SUCCESS)
+			return status;
+
+		++workspace->stepCount;
+		*curTime = lastStep ? nextTime : *curTime + h;
+	}
+
+	return status;
+}
+
+/**
+ * Free a native fixed-step workspace. The referenced system is not freed.
+ *
+ * @param workspace  The workspace to free.
+ */
+void freeFixedStepWorkspace(FixedStepWorkspace workspace) {
+	if (workspace == NULL)
+		return;
+	free(workspace->stageDerivative);
+	free(workspace);
+}
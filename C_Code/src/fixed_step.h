@@ -0,0 +1,34 @@
+/**
+ * @file   fixed_step.h
+ * @version 5
+ * @updated  2026
+ * @brief  Native fixed-step Runge-Kutta integrators for the binding model, used instead of the GSL driver
+ */
+
+/**
+ * Enumeration of the native fixed-step methods.
+ */
+typedef enum _FixedStepMethod {
+	FIXED_STEP_RK2,   ///< The tableau of gsl_odeiv2_step_rk2 (third-order solution of the embedded (2, 3) pair), without error estimate.
+	FIXED_STEP_RK4,   ///< The classical fourth-order Runge-Kutta method.
+	FIXED_STEP_SSPRK3 ///< The three-stage, third-order strong-stability-preserving Runge-Kutta method of Shu and Osher.
+} FixedStepMethod;
+
+/**
+ * Workspace for a native fixed-step integrator. The stage buffers are allocated once for the system size and reused
+ * for every step.
+ */
+typedef struct _FixedStepWorkspace {
+	FixedStepMethod method;          ///< The Runge-Kutta method used by this workspace.
+	const gsl_odeiv2_system* system; ///< The ODE system being integrated. Only referenced, never owned.
+	double* stageDerivative;         ///< Stage derivative buffer.
+	double* stageAccumulator;        ///< Buffer for the running weighted sum of the stage derivatives.
+	double* stageState;              ///< Buffer for the state at which the next stage is evaluated.
+	unsigned long stepCount;         ///< Number of steps taken since allocation or the last reset.
+} *FixedStepWorkspace;
+
+FixedStepWorkspace allocateFixedStepWorkspace(const FixedStepMethod method, const gsl_odeiv2_system* system);
+
+int applyFixedStep(FixedStepWorkspace workspace, double* curTime, const double nextTime, const double stepSize, double* stateVector);
+
+void freeFixedStepWorkspace(FixedStepWorkspace workspace);
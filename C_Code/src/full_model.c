@@ -161,6 +161,340 @@ int calculateModelDerivative_BindingOnly (double curTime,
 	return GSL_SUCCESS;
 }
 
+/**
+ * gsl_odeiv2_system Jacobian function of the Bacteriostatic and Bactericidal action model, the exact derivative of
+ * calculateModelDerivative_BindingOnly with respect to the state and to time. Used by the implicit GSL steppers and by
+ * the solvers which need the Jacobian of the model.
+ *
+ * @param curTime  The current time-point.
+ * @param y        The input vector of state variables, interpreted as a structure for lexical ease.
+ * @param dfdy     The output Jacobian, a dense row-major matrix of the size of the state vector.
+ * @param dfdt     The output vector of the partial derivatives of the derivative with respect to time.
+ * @param param    The model parameters. These do not change throughout the simulation.
+ *
+ * @return         GSL_SUCCESS on success. Failure not currently detected.
+ */
+int calculateModelJacobian_BindingOnly (double curTime,
+                                        ModelVariables y,
+                                        double* dfdy,
+                                        double* dfdt,
+                                        ModelParameters param) {
+	int i,j;
+	const int n = param->targetMoleculeCount;
+	const int dim = NUMBER_FREE_KINETIC_VARIABLES + n + 1;
+	const int offset = NUMBER_FREE_KINETIC_VARIABLES;
+	double* compartmentBoundComplexState = &y->firstCompartmentBoundComplex;
+	double scratchVolumeModifiedK = param->targetAssociationRate / (AVOGADRO_CONSTANT * param->intracellularVolume);
+	double scratchReplicationSum = 0.0;
+	double forwardRate, forwardSlope;
+	double yfreeAntibiotic, antibioticSlope;
+	double* incPointer;
+	int timetocon;
+	
+	// The free antibiotic is interpolated from the input exactly as in the derivative
+	timetocon=((int)floorl(curTime/param->steptime));
+	antibioticSlope = (param->realantibioticconc[timetocon+1] - param->realantibioticconc[timetocon])/param->steptime;
+	yfreeAntibiotic = (curTime-timetocon*param->steptime)*antibioticSlope + param->realantibioticconc[timetocon];
+	forwardRate = scratchVolumeModifiedK * yfreeAntibiotic;
+	forwardSlope = scratchVolumeModifiedK * antibioticSlope;
+	
+	for (i = 0; i < dim * dim; ++i)
+		dfdy[i] = 0.0;
+	for (j = 0; j <= n; ++j)
+		scratchReplicationSum += compartmentBoundComplexState[j];
+	scratchReplicationSum = (param->carryingCapacity - scratchReplicationSum) / param->carryingCapacity;
+	
+	// Binding moves cells up one compartment, unbinding down one, killing removes them above the threshold
+	for (i = 0; i <= n; ++i) {
+		double* row = &dfdy[(offset + i) * dim + offset];
+		if (i > 0)
+			row[i - 1] += (n - i + 1) * forwardRate;
+		if (i < n) {
+			row[i] -= (n - i) * forwardRate;
+			row[i + 1] += param->targetDissociationRate * (i + 1);
+		}
+		if (i > 0)
+			row[i] -= param->targetDissociationRate * i;
+		if (i == n || (i > 0 && i >= param->killingThreshold) || (i == 0 && param->killingThreshold == 0))
+			row[i] -= param->maximumKillRate;
+	}
+	
+	// Replication, $R g_i L (2\sum_j H_{ij}B_j - B_i)$, where the logistic term $L$ depends on every compartment.
+	// Compartment zero always carries the term, as in the derivative.
+	incPointer = param->hyperGeometricMatrix;
+	for (i = 0; i < n && (i < param->replicationThreshold || i == 0); ++i) {
+		double* row = &dfdy[(offset + i) * dim + offset];
+		double growthFactor = param->baselineReplication * (1.0 - ((i == 0) ? param->replicationThreshold : i) / param->targetMoleculeCount);
+		double tmpSum = 0.0;
+		if (i < param->replicationThreshold)
+			for (j = i; j < param->replicationThreshold; ++j) {
+				tmpSum += *incPointer * compartmentBoundComplexState[j];
+				row[j] += 2.0 * growthFactor * scratchReplicationSum * *incPointer++;
+			}
+		row[i] -= growthFactor * scratchReplicationSum;
+		for (j = 0; j <= n; ++j)
+			row[j] -= growthFactor * (2.0 * tmpSum - compartmentBoundComplexState[i]) / param->carryingCapacity;
+	}
+	
+	// Free target and free bound complex, fed by the targets of killed cells
+	dfdy[0 * dim + 0] = -forwardRate;
+	dfdy[0 * dim + 1] = param->targetDissociationRate;
+	dfdy[1 * dim + 0] = forwardRate;
+	dfdy[1 * dim + 1] = -param->targetDissociationRate;
+	for (j = 0; j <= n; ++j) {
+		if (j >= 1 && j >= param->killingThreshold) {
+			dfdy[0 * dim + offset + j] = param->maximumKillRate * (n - j);
+			dfdy[1 * dim + offset + j] = param->maximumKillRate * j;
+		}
+	}
+	if (param->killingThreshold == 0)
+		dfdy[0 * dim + offset] = param->maximumKillRate * n;
+	
+	// Time dependence enters only through the interpolated free antibiotic
+	dfdt[0] = -forwardSlope * y->freeTarget;
+	dfdt[1] = forwardSlope * y->freeTarget;
+	for (i = 0; i <= n; ++i) {
+		dfdt[offset + i] = 0.0;
+		if (i > 0)
+			dfdt[offset + i] += (n - i + 1) * forwardSlope * compartmentBoundComplexState[i - 1];
+		if (i < n)
+			dfdt[offset + i] -= (n - i) * forwardSlope * compartmentBoundComplexState[i];
+	}
+	
+	return GSL_SUCCESS;
+}
+
+/**
+ * Product of the model Jacobian with a vector, $Jv$, computed from the structure of the Jacobian without forming it. Costs
+ * about as much as one evaluation of the derivative, against $O(n^2)$ for the dense Jacobian. Used to integrate forward
+ * sensitivities.
+ *
+ * @param curTime  The current time-point.
+ * @param y        The state at which the Jacobian is taken, interpreted as a structure for lexical ease.
+ * @param v        The vector to multiply, of the size of the state vector.
+ * @param jv       The output product, of the size of the state vector.
+ * @param param    The model parameters. These do not change throughout the simulation.
+ *
+ * @return         GSL_SUCCESS on success. Failure not currently detected.
+ */
+int calculateModelJacobianProduct_BindingOnly (double curTime,
+                                               ModelVariables y,
+                                               const double* v,
+                                               double* jv,
+                                               ModelParameters param) {
+	int i,j;
+	const int n = param->targetMoleculeCount;
+	const int offset = NUMBER_FREE_KINETIC_VARIABLES;
+	double* compartmentBoundComplexState = &y->firstCompartmentBoundComplex;
+	const double* compartmentV = v + offset;
+	double* compartmentJV = jv + offset;
+	double scratchVolumeModifiedK = param->targetAssociationRate / (AVOGADRO_CONSTANT * param->intracellularVolume);
+	double scratchReplicationSum = 0.0;
+	double sumV = 0.0;
+	double forwardRate;
+	double yfreeAntibiotic;
+	double* incPointer;
+	int timetocon;
+	
+	timetocon=((int)floorl(curTime/param->steptime));
+	yfreeAntibiotic = (curTime-timetocon*param->steptime)*(param->realantibioticconc[timetocon+1] - param->realantibioticconc[timetocon])/param->steptime +param->realantibioticconc[timetocon];
+	forwardRate = scratchVolumeModifiedK * yfreeAntibiotic;
+	
+	for (j = 0; j <= n; ++j) {
+		scratchReplicationSum += compartmentBoundComplexState[j];
+		sumV += compartmentV[j];
+	}
+	scratchReplicationSum = (param->carryingCapacity - scratchReplicationSum) / param->carryingCapacity;
+	
+	// Binding, unbinding and killing, as the rows of the Jacobian
+	jv[0] = -forwardRate * v[0] + param->targetDissociationRate * v[1];
+	jv[1] = forwardRate * v[0] - param->targetDissociationRate * v[1];
+	for (i = 0; i <= n; ++i) {
+		double sum = 0.0;
+		if (i > 0)
+			sum += (n - i + 1) * forwardRate * compartmentV[i - 1] - param->targetDissociationRate * i * compartmentV[i];
+		if (i < n)
+			sum += param->targetDissociationRate * (i + 1) * compartmentV[i + 1] - (n - i) * forwardRate * compartmentV[i];
+		if (i == n || (i > 0 && i >= param->killingThreshold) || (i == 0 && param->killingThreshold == 0)) {
+			sum -= param->maximumKillRate * compartmentV[i];
+			jv[0] += param->maximumKillRate * ((i == 0) ? n : n - i) * compartmentV[i];
+			if (i > 0)
+				jv[1] += param->maximumKillRate * i * compartmentV[i];
+		}
+		compartmentJV[i] = sum;
+	}
+	
+	// Replication, with the logistic term coupling every compartment
+	incPointer = param->hyperGeometricMatrix;
+	for (i = 0; i < n && (i < param->replicationThreshold || i == 0); ++i) {
+		double growthFactor = param->baselineReplication * (1.0 - ((i == 0) ? param->replicationThreshold : i) / param->targetMoleculeCount);
+		double tmpSum = 0.0;
+		double tmpSumV = 0.0;
+		if (i < param->replicationThreshold)
+			for (j = i; j < param->replicationThreshold; ++j) {
+				tmpSum += *incPointer * compartmentBoundComplexState[j];
+				tmpSumV += *incPointer++ * compartmentV[j];
+			}
+		compartmentJV[i] += growthFactor * scratchReplicationSum * (2.0 * tmpSumV - compartmentV[i])
+		                  - growthFactor * (2.0 * tmpSum - compartmentBoundComplexState[i]) / param->carryingCapacity * sumV;
+	}
+	
+	return GSL_SUCCESS;
+}
+
+/**
+ * Partial derivative of the model derivative with respect to one of the continuous model parameters, $\frac{\partial f}{\partial \theta}$.
+ * Used as the inhomogeneous term of the forward sensitivity equations.
+ *
+ * @param curTime    The current time-point.
+ * @param y          The state, interpreted as a structure for lexical ease.
+ * @param parameter  The parameter to differentiate with respect to.
+ * @param dfdp       The output partial derivative, of the size of the state vector.
+ * @param param      The model parameters. These do not change throughout the simulation.
+ *
+ * @return           GSL_SUCCESS on success, GSL_EINVAL for an unknown parameter.
+ */
+int calculateModelParameterDerivative_BindingOnly (double curTime,
+                                                   ModelVariables y,
+                                                   const ModelParameterIndex parameter,
+                                                   double* dfdp,
+                                                   ModelParameters param) {
+	int i,j;
+	const int n = param->targetMoleculeCount;
+	const int offset = NUMBER_FREE_KINETIC_VARIABLES;
+	const int dim = offset + n + 1;
+	double* compartmentBoundComplexState = &y->firstCompartmentBoundComplex;
+	double* compartmentDfdp = dfdp + offset;
+	double populationSum = 0.0;
+	double scratchReplicationSum;
+	double yfreeAntibiotic;
+	double* incPointer;
+	int timetocon;
+	
+	for (i = 0; i < dim; ++i)
+		dfdp[i] = 0.0;
+	
+	switch (parameter) {
+	case MODEL_PARAMETER_ASSOCIATION_RATE:
+		// $\frac{\partial}{\partial k_f}$ of the forward rate $\frac{k_f}{n_AV_i}A$
+		timetocon=((int)floorl(curTime/param->steptime));
+		yfreeAntibiotic = (curTime-timetocon*param->steptime)*(param->realantibioticconc[timetocon+1] - param->realantibioticconc[timetocon])/param->steptime +param->realantibioticconc[timetocon];
+		yfreeAntibiotic /= AVOGADRO_CONSTANT * param->intracellularVolume;
+		for (i = 0; i <= n; ++i) {
+			if (i > 0)
+				compartmentDfdp[i] += (n - i + 1) * yfreeAntibiotic * compartmentBoundComplexState[i - 1];
+			if (i < n)
+				compartmentDfdp[i] -= (n - i) * yfreeAntibiotic * compartmentBoundComplexState[i];
+		}
+		dfdp[0] = -yfreeAntibiotic * y->freeTarget;
+		dfdp[1] = yfreeAntibiotic * y->freeTarget;
+		break;
+	case MODEL_PARAMETER_DISSOCIATION_RATE:
+		for (i = 0; i <= n; ++i) {
+			if (i < n)
+				compartmentDfdp[i] += (i + 1) * compartmentBoundComplexState[i + 1];
+			if (i > 0)
+				compartmentDfdp[i] -= i * compartmentBoundComplexState[i];
+		}
+		dfdp[0] = y->freeBoundComplex;
+		dfdp[1] = -y->freeBoundComplex;
+		break;
+	case MODEL_PARAMETER_MAXIMUM_KILL_RATE:
+		for (i = 0; i <= n; ++i)
+			if (i == n || (i > 0 && i >= param->killingThreshold) || (i == 0 && param->killingThreshold == 0))
+				compartmentDfdp[i] = -compartmentBoundComplexState[i];
+		for (j = 1; j <= n; ++j)
+			if (j >= param->killingThreshold) {
+				dfdp[0] += compartmentBoundComplexState[j] * (n - j);
+				dfdp[1] += compartmentBoundComplexState[j] * j;
+			}
+		if (param->killingThreshold == 0)
+			dfdp[0] += compartmentBoundComplexState[0] * n;
+		break;
+	case MODEL_PARAMETER_BASELINE_REPLICATION:
+	case MODEL_PARAMETER_CARRYING_CAPACITY:
+		// Replication, $R g_i L (2\sum_j H_{ij}B_j - B_i)$ with $L = \frac{C - \sum_j B_j}{C}$, is linear in $R$ and
+		// $\frac{\partial L}{\partial C} = \frac{\sum_j B_j}{C^2}$
+		for (j = 0; j <= n; ++j)
+			populationSum += compartmentBoundComplexState[j];
+		scratchReplicationSum = (param->carryingCapacity - populationSum) / param->carryingCapacity;
+		incPointer = param->hyperGeometricMatrix;
+		for (i = 0; i < n && (i < param->replicationThreshold || i == 0); ++i) {
+			double growthFactor = 1.0 - ((i == 0) ? param->replicationThreshold : i) / param->targetMoleculeCount;
+			double tmpSum = 0.0;
+			if (i < param->replicationThreshold)
+				for (j = i; j < param->replicationThreshold; ++j)
+					tmpSum += *incPointer++ * compartmentBoundComplexState[j];
+			if (parameter == MODEL_PARAMETER_BASELINE_REPLICATION)
+				compartmentDfdp[i] = growthFactor * scratchReplicationSum * (2.0 * tmpSum - compartmentBoundComplexState[i]);
+			else
+				compartmentDfdp[i] = param->baselineReplication * growthFactor * (2.0 * tmpSum - compartmentBoundComplexState[i])
+				                   * populationSum / (param->carryingCapacity * param->carryingCapacity);
+		}
+		break;
+	default:
+		return GSL_EINVAL;
+	}
+	
+	return GSL_SUCCESS;
+}
+
+/**
+ * Address of one of the continuous model parameters within the parameter structure.
+ *
+ * @param param      The model parameters.
+ * @param parameter  The parameter.
+ *
+ * @return           The address of the parameter, or NULL for an unknown parameter.
+ */
+double* getModelParameterAddress(const ModelParameters param, const ModelParameterIndex parameter) {
+	switch (parameter) {
+	case MODEL_PARAMETER_ASSOCIATION_RATE:
+		return &param->targetAssociationRate;
+	case MODEL_PARAMETER_DISSOCIATION_RATE:
+		return &param->targetDissociationRate;
+	case MODEL_PARAMETER_MAXIMUM_KILL_RATE:
+		return &param->maximumKillRate;
+	case MODEL_PARAMETER_BASELINE_REPLICATION:
+		return &param->baselineReplication;
+	case MODEL_PARAMETER_CARRYING_CAPACITY:
+		return &param->carryingCapacity;
+	default:
+		return NULL;
+	}
+}
+
+/**
+ * Convert a drug concentration as given in the input files (mg/L) into the number of molecules per intracellular
+ * volume used by the model.
+ *
+ * @param param          The model parameters, providing the intracellular volume and molecular weight.
+ * @param concentration  The concentration in mg/L.
+ *
+ * @return               The number of molecules.
+ */
+double concentrationToMolecules(const ModelParameters param, const double concentration) {
+	// Old code: Changing nG/mL to number of molecules: A*1e3*1e-6*6.02e23/MW
+	return concentration*6.02e20*param->intracellularVolume/param->molecularweight;
+}
+
+/**
+ * Thresholds left at DEFAULT_DUMMY are set from the others: a killing threshold alone, as the webpage gives, puts the
+ * replication threshold just below it, and otherwise each is half the number of target molecules.
+ *
+ * @param param  The ModelParamerers structure to complete
+ */
+void applyDefaultThresholds(ModelParameters param) {
+	if ((param->killingThreshold != DEFAULT_DUMMY) && (param->replicationThreshold == DEFAULT_DUMMY))
+		param->replicationThreshold = param->killingThreshold - 1;
+	else {
+		if (param->replicationThreshold == DEFAULT_DUMMY)
+			param->replicationThreshold = param->targetMoleculeCount / 2;
+		if (param->killingThreshold == DEFAULT_DUMMY)
+			param->killingThreshold = param->targetMoleculeCount / 2;
+	}
+}
+
 /**
  * This function goes through all the parameters and checks whether any of them fall out of range.
  *
@@ -25,6 +25,7 @@
 #define DEFAULT_TIMEPOINTS 360000.0
 #define DEFAULT_STEPTIME 3600.0
 #define DEFAULT_THRESHOLD 60
+#define DEFAULT_DUMMY -12345 ///< Definition of dummy value for marking those defaults which must be dynamically calculated
   
 
 
@@ -68,6 +69,11 @@ typedef struct  _ModelParameters {
  */
 typedef int (*GSLDerivCalcFunc)(double, const double*, double*, void*);
 
+/**
+ * Used for type-casting the Jacobian function into the format expected by GSL.
+ */
+typedef int (*GSLJacobianCalcFunc)(double, const double*, double*, double*, void*);
+
 /**
  * Structure to hold all the within-simulation variables. This will be used both for the current-state and also in the calculation
  * of the derivatives in the GSL sub-function. This structure is for the deterministic model so uses concentrations of molecules.
@@ -84,9 +90,45 @@ typedef struct _ModelVariables {
 ///> Macro extracts the number of "free" compartments. I.e. those concentrations which are not in the array of cells-with-bound-targets
 #define NUMBER_FREE_KINETIC_VARIABLES ((int)((sizeof(struct _ModelVariables) - sizeof(double)) / sizeof(double)))
 
+/**
+ * Continuous model parameters which the model can be differentiated with respect to.
+ */
+typedef enum _ModelParameterIndex {
+	MODEL_PARAMETER_ASSOCIATION_RATE,     ///< targetAssociationRate (A)
+	MODEL_PARAMETER_DISSOCIATION_RATE,    ///< targetDissociationRate (D)
+	MODEL_PARAMETER_MAXIMUM_KILL_RATE,    ///< maximumKillRate (K)
+	MODEL_PARAMETER_BASELINE_REPLICATION, ///< baselineReplication (R)
+	MODEL_PARAMETER_CARRYING_CAPACITY,    ///< carryingCapacity (C)
+	MODEL_PARAMETER_COUNT
+} ModelParameterIndex;
+
 int calculateModelDerivative_BindingOnly (double curTime,
                                           ModelVariables y,
                                           ModelVariables dydt,
                                           ModelParameters param);
 
+int calculateModelJacobian_BindingOnly (double curTime,
+                                        ModelVariables y,
+                                        double* dfdy,
+                                        double* dfdt,
+                                        ModelParameters param);
+
+int calculateModelJacobianProduct_BindingOnly (double curTime,
+                                               ModelVariables y,
+                                               const double* v,
+                                               double* jv,
+                                               ModelParameters param);
+
+int calculateModelParameterDerivative_BindingOnly (double curTime,
+                                                   ModelVariables y,
+                                                   const ModelParameterIndex parameter,
+                                                   double* dfdp,
+                                                   ModelParameters param);
+
+double* getModelParameterAddress(const ModelParameters param, const ModelParameterIndex parameter);
+
+double concentrationToMolecules(const ModelParameters param, const double concentration);
+
+void applyDefaultThresholds(ModelParameters param);
+
 int sanityCheckModelParameters(ModelParameters param);
@@ -0,0 +1,559 @@
+/**
+ * @file   global_sensitivity.c
+ * @version 5
+ * @updated  2026
+ * @brief  Global sensitivity analysis of the model outputs by Morris screening and Sobol indices
+ *
+ * The varied parameters are mapped from the unit hypercube onto their ranges, linearly or in the logarithm. The design
+ * is generated up front as one batch of points which is simulated on the parallel runner, one task per point; each
+ * worker has its own copy of the model parameters, which embed the concentration profile, and its own integrator,
+ * while the hypergeometric matrix is shared read-only. The sensitivity measures are computed once the batch is done.
+ *
+ * The Morris design is made of one-at-a-time trajectories on a grid of the given number of levels, with the step
+ * levels / (2 (levels - 1)) and a random order and direction of the steps. The Sobol design is Saltelli's: the rows of
+ * two matrices A and B drawn from a Sobol sequence, and for every parameter the matrix A with that column taken from B,
+ * giving first-order indices by Saltelli's (2010) estimator and total-order indices by Jansen's.
+ *
+ * The configuration file holds one setting per line; '#' starts a comment:
+ *
+ *     method [morris|sobol]
+ *     parameter [A|D|K|R|C] [lower] [upper] [linear|log]
+ *     samples [Morris trajectories or Sobol base samples]
+ *     levels [Morris grid levels, even]
+ *     seed [seed of the Morris trajectories]
+ *     kill [reduction of the population in logs defining the time to kill]
+ *     regrowth [increase over the minimum in logs defining the regrowth time]
+ *     output [file receiving every sample and its outputs]
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <gsl/gsl_odeiv2.h>
+#include <gsl/gsl_errno.h>
+#include <gsl/gsl_rng.h>
+#include <gsl/gsl_randist.h>
+#include <gsl/gsl_qrng.h>
+#include "full_model.h"
+#include "fixed_step.h"
+#include "positive_step.h"
+#include "sensitivity.h"
+#include "base_simulation.h"
+#include "parallel_runner.h"
+#include "global_sensitivity.h"
+
+static const char* gsaOutputNames[GSA_OUTPUT_COUNT] = { "finalPopulation", "minimumPopulation", "killTime", "regrowthTime" };
+
+/**
+ * Private workspace of one worker
+ */
+typedef struct _GsaWorker {
+	ModelParameters mParam;           ///< The worker's copy of the model parameters.
+	SimulationIntegrator integrator;  ///< The worker's integrator.
+	double* state;                    ///< State buffer.
+	double* logPopulation;            ///< log10 population at every tick.
+} *GsaWorker;
+
+/**
+ * State shared by the tasks: everything is read-only except the outputs, of which each task writes its own row
+ */
+typedef struct _GsaRun {
+	GsaSettings settings;        ///< The design.
+	double endTime;              ///< End of the simulations.
+	double timeInterval;         ///< Interval between the ticks.
+	const double* initialState;  ///< The initial state of the simulations.
+	const double* points;        ///< Parameter values of every point, one row per point.
+	double* outputs;             ///< Outputs of every point, one row per point.
+	GsaWorker workers;           ///< The workspaces, one per worker.
+	int pointCount;              ///< Number of points.
+	int verbose;                 ///< Print the progress, from the first worker.
+} *GsaRun;
+
+/**
+ * Read the design of the analysis. Unset settings keep their defaults.
+ *
+ * @param fileName  The configuration file.
+ * @param settings  The settings to fill.
+ *
+ * @return          0 on success, -1 on failure.
+ */
+int readGsaSettings(const char* fileName, GsaSettings settings) {
+	FILE* iHandle;
+	char line[FILENAME_MAX + 64];
+	int lineNumber = 0;
+	int p;
+
+	memset(settings, 0, sizeof(struct _GsaSettings));
+	settings->method = GSA_METHOD_MORRIS;
+	settings->sampleCount = DEFAULT_GSA_SAMPLES;
+	settings->levels = DEFAULT_GSA_LEVELS;
+	settings->seed = 1;
+	settings->killLogReduction = DEFAULT_GSA_KILL_LOG_REDUCTION;
+	settings->regrowthLogIncrease = DEFAULT_GSA_REGROWTH_LOG_INCREASE;
+	if ((iHandle = fopen(fileName, "r")) == NULL) {
+		fprintf(stderr, "Could not open %s for reading\n", fileName);
+		return -1;
+	}
+	while (fgets(line, sizeof(line), iHandle) != NULL) {
+		char key[32], first[FILENAME_MAX];
+		char* comment = strchr(line, '#');
+		int fields;
+
+		++lineNumber;
+		if (comment != NULL)
+			*comment = '\0';
+		if ((fields = sscanf(line, "%31s %4095s", key, first)) < 1)
+			continue;
+		if (!strcmp(key, "parameter")) {
+			struct _SensitivitySelection selection;
+			const int index = settings->parameterCount;
+			char letter[2];
+			char scale[16] = "linear";
+
+			memset(&selection, 0, sizeof(selection));
+			if (index == MODEL_PARAMETER_COUNT ||
+			    sscanf(line, "%*s %1s %lg %lg %15s", letter, &settings->lower[index], &settings->upper[index], scale) < 3 ||
+			    parseSensitivitySelection(letter, &selection) != 0) {
+				fprintf(stderr, "%s:%d: expected parameter [letter] [lower] [upper] [linear|log]\n", fileName, lineNumber);
+				fclose(iHandle);
+				return -1;
+			}
+			for (p = 0; p < index; ++p)
+				if (settings->parameters[p] == selection.parameters[0]) {
+					fprintf(stderr, "%s:%d: parameter %s is varied twice\n", fileName, lineNumber, letter);
+					fclose(iHandle);
+					return -1;
+				}
+			settings->parameters[index] = selection.parameters[0];
+			if (!strcmp(scale, "log"))
+				settings->logScale[index] = 1;
+			else if (strcmp(scale, "linear")) {
+				fprintf(stderr, "%s:%d: unknown scale %s\n", fileName, lineNumber, scale);
+				fclose(iHandle);
+				return -1;
+			}
+			if (!(settings->upper[index] > settings->lower[index]) || (settings->logScale[index] && settings->lower[index] <= 0.0)) {
+				fprintf(stderr, "%s:%d: the range must be increasing, and positive on the log scale\n", fileName, lineNumber);
+				fclose(iHandle);
+				return -1;
+			}
+			++settings->parameterCount;
+		} else if (!strcmp(key, "method") && fields >= 2) {
+			if (!strcmp(first, "morris"))
+				settings->method = GSA_METHOD_MORRIS;
+			else if (!strcmp(first, "sobol"))
+				settings->method = GSA_METHOD_SOBOL;
+			else {
+				fprintf(stderr, "%s:%d: unknown method %s\n", fileName, lineNumber, first);
+				fclose(iHandle);
+				return -1;
+			}
+		} else if (!strcmp(key, "samples") && fields >= 2)
+			settings->sampleCount = atoi(first);
+		else if (!strcmp(key, "levels") && fields >= 2)
+			settings->levels = atoi(first);
+		else if (!strcmp(key, "seed") && fields >= 2)
+			settings->seed = strtoul(first, NULL, 10);
+		else if (!strcmp(key, "kill") && fields >= 2)
+			settings->killLogReduction = atof(first);
+		else if (!strcmp(key, "regrowth") && fields >= 2)
+			settings->regrowthLogIncrease = atof(first);
+		else if (!strcmp(key, "output") && fields >= 2)
+			strcpy(settings->samplesFile, first);
+		else {
+			fprintf(stderr, "%s:%d: unknown or incomplete setting %s\n", fileName, lineNumber, key);
+			fclose(iHandle);
+			return -1;
+		}
+	}
+	fclose(iHandle);
+
+	if (settings->parameterCount == 0 || settings->sampleCount < 2 || settings->levels < 2 || settings->levels % 2 != 0 ||
+	    settings->killLogReduction <= 0.0 || settings->regrowthLogIncrease <= 0.0) {
+		fprintf(stderr, "%s: the analysis needs at least one parameter, two samples, an even number of levels and positive event thresholds\n", fileName);
+		return -1;
+	}
+	return 0;
+}
+
+/**
+ * Map a coordinate of the unit hypercube onto the range of a parameter.
+ */
+static double scaleGsaCoordinate(const GsaSettings settings, const int p, const double u) {
+	if (settings->logScale[p])
+		return exp(log(settings->lower[p]) + u * (log(settings->upper[p]) - log(settings->lower[p])));
+	return settings->lower[p] + u * (settings->upper[p] - settings->lower[p]);
+}
+
+/**
+ * Generate the Morris trajectories. Trajectory t occupies the points t (k + 1) to t (k + 1) + k; its point j + 1
+ * differs from point j in the parameter order[t k + j] only, by the signed step direction[t k + j].
+ *
+ * @return  GSL_SUCCESS, or GSL_ENOMEM.
+ */
+static int generateMorrisDesign(const GsaSettings settings, double* points, int* order, double* direction) {
+	const int k = settings->parameterCount;
+	const int baseLevels = settings->levels / 2;
+	const double delta = settings->levels / (2.0 * (settings->levels - 1));
+	gsl_rng* rng = gsl_rng_alloc(gsl_rng_mt19937);
+	double unit[MODEL_PARAMETER_COUNT];
+	int t, j, p;
+
+	if (rng == NULL)
+		return GSL_ENOMEM;
+	gsl_rng_set(rng, settings->seed);
+	for (t = 0; t < settings->sampleCount; ++t) {
+		int* trajectoryOrder = order + t * k;
+		double* trajectoryDirection = direction + t * k;
+
+		// Start on a level from which the step stays inside the grid in the drawn direction
+		for (p = 0; p < k; ++p) {
+			unit[p] = (double)gsl_rng_uniform_int(rng, baseLevels) / (settings->levels - 1);
+			if (gsl_rng_uniform(rng) < 0.5) {
+				unit[p] += delta;
+				trajectoryDirection[p] = -delta;
+			} else
+				trajectoryDirection[p] = delta;
+			trajectoryOrder[p] = p;
+		}
+		gsl_ran_shuffle(rng, trajectoryOrder, k, sizeof(int));
+		for (j = 0; j <= k; ++j) {
+			double* point = points + (size_t)(t * (k + 1) + j) * k;
+
+			if (j > 0)
+				unit[trajectoryOrder[j - 1]] += trajectoryDirection[trajectoryOrder[j - 1]];
+			for (p = 0; p < k; ++p)
+				point[p] = scaleGsaCoordinate(settings, p, unit[p]);
+		}
+		// Store the steps in the order they are taken
+		for (j = 0; j < k; ++j)
+			unit[j] = trajectoryDirection[trajectoryOrder[j]];
+		memcpy(trajectoryDirection, unit, sizeof(double) * k);
+	}
+	gsl_rng_free(rng);
+	return GSL_SUCCESS;
+}
+
+/**
+ * Generate Saltelli's design from a Sobol sequence of dimension 2k: N rows of A, then N rows of B, then for every
+ * parameter i the N rows of A with column i taken from B.
+ *
+ * @return  GSL_SUCCESS, or GSL_ENOMEM.
+ */
+static int generateSaltelliDesign(const GsaSettings settings, double* points) {
+	const int k = settings->parameterCount;
+	const int N = settings->sampleCount;
+	gsl_qrng* sequence = gsl_qrng_alloc(gsl_qrng_sobol, 2 * k);
+	double unit[2 * MODEL_PARAMETER_COUNT];
+	int n, i, p;
+
+	if (sequence == NULL)
+		return GSL_ENOMEM;
+	for (n = 0; n < N; ++n) {
+		gsl_qrng_get(sequence, unit);
+		for (p = 0; p < k; ++p) {
+			points[(size_t)n * k + p] = scaleGsaCoordinate(settings, p, unit[p]);
+			points[(size_t)(N + n) * k + p] = scaleGsaCoordinate(settings, p, unit[k + p]);
+		}
+		for (i = 0; i < k; ++i)
+			for (p = 0; p < k; ++p)
+				points[(size_t)((2 + i) * N + n) * k + p] = scaleGsaCoordinate(settings, p, unit[(p == i) ? k + p : p]);
+	}
+	gsl_qrng_free(sequence);
+	return GSL_SUCCESS;
+}
+
+/**
+ * Time at which the log population first crosses a level between time-points a - 1 and a, interpolated linearly.
+ */
+static double interpolateCrossing(const double* logPopulation, const int a, const double level, const double timeInterval) {
+	const double span = logPopulation[a] - logPopulation[a - 1];
+
+	return (span != 0.0) ? (a - 1 + (level - logPopulation[a - 1]) / span) * timeInterval : a * timeInterval;
+}
+
+/**
+ * Task simulating one point of the design and reducing its population curve to the outputs.
+ */
+static int evaluateGsaPoint(const int taskIndex, const int workerIndex, void* context) {
+	GsaRun run = (GsaRun)context;
+	const GsaSettings settings = run->settings;
+	GsaWorker worker = &run->workers[workerIndex];
+	const double* point = run->points + (size_t)taskIndex * settings->parameterCount;
+	double* outputs = run->outputs + (size_t)taskIndex * GSA_OUTPUT_COUNT;
+	const double* logPopulation = worker->logPopulation;
+	double killLevel, regrowthLevel;
+	int tickCount, minimumTick = 0;
+	int a, p;
+	int status;
+
+	for (p = 0; p < settings->parameterCount; ++p)
+		*getModelParameterAddress(worker->mParam, settings->parameters[p]) = point[p];
+	if ((status = recordLogPopulation(worker->integrator, worker->mParam, run->endTime, run->timeInterval, run->initialState,
+	                                  worker->state, worker->logPopulation, &tickCount)) != GSL_SUCCESS) {
+		fprintf(stderr, "The simulation of sample %d failed: %s\n", taskIndex, gsl_strerror(status));
+		return status;
+	}
+	for (a = 1; a < tickCount; ++a)
+		if (logPopulation[a] < logPopulation[minimumTick])
+			minimumTick = a;
+
+	// Events which do not happen are censored at the last time-point
+	outputs[GSA_OUTPUT_FINAL_POPULATION] = logPopulation[tickCount - 1];
+	outputs[GSA_OUTPUT_MINIMUM_POPULATION] = logPopulation[minimumTick];
+	outputs[GSA_OUTPUT_KILL_TIME] = outputs[GSA_OUTPUT_REGROWTH_TIME] = (tickCount - 1) * run->timeInterval;
+	killLevel = logPopulation[0] - settings->killLogReduction;
+	for (a = 1; a < tickCount; ++a)
+		if (logPopulation[a] <= killLevel) {
+			outputs[GSA_OUTPUT_KILL_TIME] = interpolateCrossing(logPopulation, a, killLevel, run->timeInterval);
+			break;
+		}
+	regrowthLevel = logPopulation[minimumTick] + settings->regrowthLogIncrease;
+	for (a = minimumTick + 1; a < tickCount; ++a)
+		if (logPopulation[a] >= regrowthLevel) {
+			outputs[GSA_OUTPUT_REGROWTH_TIME] = interpolateCrossing(logPopulation, a, regrowthLevel, run->timeInterval);
+			break;
+		}
+
+	if (run->verbose && workerIndex == 0) {
+		printf("sample %d of %d          \r", taskIndex + 1, run->pointCount);
+		fflush(stdout);
+	}
+	return GSL_SUCCESS;
+}
+
+/**
+ * Compute the Morris measures from the outputs along the trajectories.
+ */
+static void calculateMorrisMeasures(const GsaSettings settings, const double* outputs, const int* order, const double* direction,
+                                    GsaResults results) {
+	const int k = settings->parameterCount;
+	const int r = settings->sampleCount;
+	double sumSquares[GSA_OUTPUT_COUNT][MODEL_PARAMETER_COUNT];
+	int t, j, o, p;
+
+	memset(sumSquares, 0, sizeof(sumSquares));
+	for (t = 0; t < r; ++t)
+		for (j = 0; j < k; ++j) {
+			const double* before = outputs + (size_t)(t * (k + 1) + j) * GSA_OUTPUT_COUNT;
+			const double* after = before + GSA_OUTPUT_COUNT;
+
+			p = order[t * k + j];
+			for (o = 0; o < GSA_OUTPUT_COUNT; ++o) {
+				const double effect = (after[o] - before[o]) / direction[t * k + j];
+
+				results->meanEffect[o][p] += effect / r;
+				results->meanAbsoluteEffect[o][p] += fabs(effect) / r;
+				sumSquares[o][p] += effect * effect;
+			}
+		}
+	for (o = 0; o < GSA_OUTPUT_COUNT; ++o)
+		for (p = 0; p < k; ++p)
+			results->effectDeviation[o][p] = sqrt(fmax(sumSquares[o][p] - r * pow(results->meanEffect[o][p], 2.0), 0.0) / (r - 1));
+}
+
+/**
+ * Compute the Sobol indices from the outputs of Saltelli's design. The first-order estimator centres f(B) on the output
+ * mean, which leaves it unbiased but removes the variance the mean adds at small sample counts. An output which does
+ * not vary has zero indices.
+ */
+static void calculateSobolIndices(const GsaSettings settings, const double* outputs, GsaResults results) {
+	const int k = settings->parameterCount;
+	const int N = settings->sampleCount;
+	int n, o, i;
+
+	for (o = 0; o < GSA_OUTPUT_COUNT; ++o) {
+		double mean = 0.0, variance = 0.0;
+
+		for (n = 0; n < 2 * N; ++n)
+			mean += outputs[(size_t)n * GSA_OUTPUT_COUNT + o] / (2 * N);
+		for (n = 0; n < 2 * N; ++n)
+			variance += pow(outputs[(size_t)n * GSA_OUTPUT_COUNT + o] - mean, 2.0) / (2 * N - 1);
+		results->outputVariance[o] = variance;
+		if (variance <= 0.0)
+			continue;
+		for (i = 0; i < k; ++i) {
+			double first = 0.0, total = 0.0;
+
+			for (n = 0; n < N; ++n) {
+				const double fA = outputs[(size_t)n * GSA_OUTPUT_COUNT + o];
+				const double fB = outputs[(size_t)(N + n) * GSA_OUTPUT_COUNT + o];
+				const double fAB = outputs[(size_t)((2 + i) * N + n) * GSA_OUTPUT_COUNT + o];
+
+				first += (fB - mean) * (fAB - fA);
+				total += (fA - fAB) * (fA - fAB);
+			}
+			results->firstOrder[o][i] = first / N / variance;
+			results->totalOrder[o][i] = total / (2.0 * N) / variance;
+		}
+	}
+}
+
+/**
+ * Write every point of the design and its outputs.
+ */
+static int writeGsaSamples(const GsaSettings settings, const double* points, const double* outputs, const int pointCount) {
+	FILE* oHandle;
+	int n, p, o;
+
+	if ((oHandle = fopen(settings->samplesFile, "w")) == NULL) {
+		fprintf(stderr, "Could not open %s for writing\n", settings->samplesFile);
+		return GSL_EFAILED;
+	}
+	fprintf(oHandle, "sample");
+	for (p = 0; p < settings->parameterCount; ++p)
+		fprintf(oHandle, " %c", getModelParameterOption(settings->parameters[p]));
+	for (o = 0; o < GSA_OUTPUT_COUNT; ++o)
+		fprintf(oHandle, " %s", gsaOutputNames[o]);
+	fprintf(oHandle, "\n");
+	for (n = 0; n < pointCount; ++n) {
+		fprintf(oHandle, "%d", n);
+		for (p = 0; p < settings->parameterCount; ++p)
+			fprintf(oHandle, " %.10lg", points[(size_t)n * settings->parameterCount + p]);
+		for (o = 0; o < GSA_OUTPUT_COUNT; ++o)
+			fprintf(oHandle, " %.10lg", outputs[(size_t)n * GSA_OUTPUT_COUNT + o]);
+		fprintf(oHandle, "\n");
+	}
+	if (fclose(oHandle) != 0) {
+		fprintf(stderr, "Could not write %s\n", settings->samplesFile);
+		return GSL_EFAILED;
+	}
+	return GSL_SUCCESS;
+}
+
+/**
+ * Generate the design, simulate all its points concurrently and compute the sensitivity measures of every output.
+ *
+ * @param stepper        The integrator selection.
+ * @param mParam         Model parameters for the simulation, with the concentration profile; the varied parameters are
+ *                       overwritten in per-worker copies only.
+ * @param settings       The design of the analysis.
+ * @param endTime        End of the simulations.
+ * @param timeInterval   Interval between the ticks at which the population is recorded.
+ * @param initialState   The initial state.
+ * @param threadCount    Number of threads simulating the points.
+ * @param results        The sensitivity measures.
+ *
+ * @return               GSL_SUCCESS, or the error of the first simulation which failed.
+ */
+int runGlobalSensitivityAnalysis(const SimulationStepper stepper, const ModelParameters mParam, const GsaSettings settings,
+                                 const double endTime, const double timeInterval, const double* initialState, const int threadCount,
+                                 GsaResults results) {
+	const int k = settings->parameterCount;
+	const int dim = NUMBER_FREE_KINETIC_VARIABLES + mParam->targetMoleculeCount + 1;
+	const size_t size = sizeof(struct _ModelParameters) + sizeof(double) * (mParam->timepoints + 1);
+	struct _GsaRun run;
+	double started = getWallClockTime();
+	double* points;
+	int* order = NULL;
+	double* direction = NULL;
+	int workerCount;
+	int status = GSL_SUCCESS;
+	int w;
+
+	memset(results, 0, sizeof(struct _GsaResults));
+	memset(&run, 0, sizeof(run));
+	run.settings = settings;
+	run.endTime = endTime;
+	run.verbose = stepper->verbose;
+	run.timeInterval = timeInterval;
+	run.initialState = initialState;
+	run.pointCount = settings->sampleCount * ((settings->method == GSA_METHOD_MORRIS) ? k + 1 : k + 2);
+	workerCount = (threadCount < run.pointCount) ? threadCount : run.pointCount;
+	if (workerCount < 1)
+		workerCount = 1;
+
+	points = (double*)malloc(sizeof(double) * run.pointCount * k);
+	run.outputs = (double*)malloc(sizeof(double) * run.pointCount * GSA_OUTPUT_COUNT);
+	run.workers = (GsaWorker)calloc(workerCount, sizeof(struct _GsaWorker));
+	if (settings->method == GSA_METHOD_MORRIS) {
+		order = (int*)malloc(sizeof(int) * settings->sampleCount * k);
+		direction = (double*)malloc(sizeof(double) * settings->sampleCount * k);
+	}
+	if (points == NULL || run.outputs == NULL || run.workers == NULL ||
+	    (settings->method == GSA_METHOD_MORRIS && (order == NULL || direction == NULL))) {
+		status = GSL_ENOMEM;
+		goto cleanup;
+	}
+	for (w = 0; w < workerCount; ++w) {
+		GsaWorker worker = &run.workers[w];
+
+		if ((worker->mParam = (ModelParameters)malloc(size)) == NULL) {
+			status = GSL_ENOMEM;
+			goto cleanup;
+		}
+		memcpy(worker->mParam, mParam, size);
+		worker->state = (double*)malloc(sizeof(double) * dim);
+		worker->logPopulation = (double*)malloc(sizeof(double) * (mParam->timepoints + 1));
+		worker->integrator = allocateSimulationIntegrator(stepper, worker->mParam, timeInterval);
+		if (worker->state == NULL || worker->logPopulation == NULL || worker->integrator == NULL) {
+			status = GSL_ENOMEM;
+			goto cleanup;
+		}
+	}
+
+	if (settings->method == GSA_METHOD_MORRIS)
+		status = generateMorrisDesign(settings, points, order, direction);
+	else
+		status = generateSaltelliDesign(settings, points);
+	if (status != GSL_SUCCESS)
+		goto cleanup;
+	run.points = points;
+
+	status = runParallelTasks(run.pointCount, workerCount, evaluateGsaPoint, &run);
+	if (run.verbose)
+		printf("\n");
+	if (status != GSL_SUCCESS)
+		goto cleanup;
+	results->evaluationCount = run.pointCount;
+	if (settings->method == GSA_METHOD_MORRIS)
+		calculateMorrisMeasures(settings, run.outputs, order, direction, results);
+	else
+		calculateSobolIndices(settings, run.outputs, results);
+	if (settings->samplesFile[0] != '\0')
+		status = writeGsaSamples(settings, points, run.outputs, run.pointCount);
+
+cleanup:
+	for (w = 0; run.workers != NULL && w < workerCount; ++w) {
+		freeSimulationIntegrator(run.workers[w].integrator);
+		free(run.workers[w].mParam);
+		free(run.workers[w].state);
+		free(run.workers[w].logPopulation);
+	}
+	free(run.workers);
+	free(run.outputs);
+	free(points);
+	free(order);
+	free(direction);
+	results->wallTime = getWallClockTime() - started;
+	return status;
+}
+
+/**
+ * Print the sensitivity measures of every output to every parameter.
+ *
+ * @param settings  The design of the analysis.
+ * @param results   The sensitivity measures.
+ * @param oHandle   The file to print to.
+ */
+void printGsaResults(const GsaSettings settings, const GsaResults results, FILE* oHandle) {
+	int o, p;
+
+	if (settings->method == GSA_METHOD_MORRIS)
+		fprintf(oHandle, "Morris screening with %d trajectories on %d levels; effects per unit of the scaled range\n",
+		        settings->sampleCount, settings->levels);
+	else
+		fprintf(oHandle, "Sobol indices from %d base samples\n", settings->sampleCount);
+	fprintf(oHandle, "output parameter %s\n", (settings->method == GSA_METHOD_MORRIS) ? "mu mu* sigma" : "firstOrder totalOrder");
+	for (o = 0; o < GSA_OUTPUT_COUNT; ++o)
+		for (p = 0; p < settings->parameterCount; ++p) {
+			if (settings->method == GSA_METHOD_MORRIS)
+				fprintf(oHandle, "%s %c %.4lg %.4lg %.4lg\n", gsaOutputNames[o], getModelParameterOption(settings->parameters[p]),
+				        results->meanEffect[o][p], results->meanAbsoluteEffect[o][p], results->effectDeviation[o][p]);
+			else
+				fprintf(oHandle, "%s %c %.4lf %.4lf\n", gsaOutputNames[o], getModelParameterOption(settings->parameters[p]),
+				        results->firstOrder[o][p], results->totalOrder[o][p]);
+		}
+	fprintf(oHandle, "%d simulations, %lg s elapsed\n", results->evaluationCount, results->wallTime);
+}
@@ -0,0 +1,70 @@
+/**
+ * @file   global_sensitivity.h
+ * @version 5
+ * @updated  2026
+ * @brief  Global sensitivity analysis of the model outputs by Morris screening and Sobol indices
+ */
+
+#define DEFAULT_GSA_SAMPLES 64             ///< Morris trajectories, or Sobol base samples
+#define DEFAULT_GSA_LEVELS 4               ///< Number of grid levels of the Morris design, even
+#define DEFAULT_GSA_KILL_LOG_REDUCTION 3.0 ///< Reduction of the population, in logs, which defines the time to kill
+#define DEFAULT_GSA_REGROWTH_LOG_INCREASE 1.0 ///< Increase of the population over its minimum, in logs, which defines the regrowth time
+
+/**
+ * Sampling designs of the analysis
+ */
+typedef enum _GsaMethod {
+	GSA_METHOD_MORRIS, ///< Morris elementary effects on a grid of one-at-a-time trajectories.
+	GSA_METHOD_SOBOL   ///< Saltelli sampling of first- and total-order Sobol indices.
+} GsaMethod;
+
+/**
+ * Outputs of a simulation whose sensitivities are analysed
+ */
+typedef enum _GsaOutputIndex {
+	GSA_OUTPUT_FINAL_POPULATION,   ///< log10 of the population at the last time-point.
+	GSA_OUTPUT_MINIMUM_POPULATION, ///< log10 of the smallest population.
+	GSA_OUTPUT_KILL_TIME,          ///< First time at which the population has fallen by the kill reduction, or the end time.
+	GSA_OUTPUT_REGROWTH_TIME,      ///< First time after the minimum at which the population has grown by the regrowth increase, or the end time.
+	GSA_OUTPUT_COUNT
+} GsaOutputIndex;
+
+/**
+ * Structure to hold the design of the analysis read from the configuration file
+ */
+typedef struct _GsaSettings {
+	GsaMethod method;                                ///< The sampling design.
+	int parameterCount;                              ///< Number of varied parameters.
+	ModelParameterIndex parameters[MODEL_PARAMETER_COUNT]; ///< The varied parameters.
+	double lower[MODEL_PARAMETER_COUNT];             ///< Lower bound of each parameter.
+	double upper[MODEL_PARAMETER_COUNT];             ///< Upper bound of each parameter.
+	int logScale[MODEL_PARAMETER_COUNT];             ///< Non-zero if the parameter is sampled uniformly in its logarithm.
+	int sampleCount;                                 ///< Morris trajectories, or Sobol base samples.
+	int levels;                                      ///< Number of grid levels of the Morris design.
+	unsigned long seed;                              ///< Seed of the Morris trajectories.
+	double killLogReduction;                         ///< Reduction of the population, in logs, which defines the time to kill.
+	double regrowthLogIncrease;                      ///< Increase over the minimum, in logs, which defines the regrowth time.
+	char samplesFile[FILENAME_MAX];                  ///< File receiving every sample and its outputs, or empty for none.
+} *GsaSettings;
+
+/**
+ * Structure to hold the sensitivity measures of every output to every parameter, indexed [output][parameter]
+ */
+typedef struct _GsaResults {
+	int evaluationCount;                                                 ///< Number of simulations.
+	double meanEffect[GSA_OUTPUT_COUNT][MODEL_PARAMETER_COUNT];          ///< Morris mean elementary effect, mu.
+	double meanAbsoluteEffect[GSA_OUTPUT_COUNT][MODEL_PARAMETER_COUNT];  ///< Morris mean absolute elementary effect, mu*.
+	double effectDeviation[GSA_OUTPUT_COUNT][MODEL_PARAMETER_COUNT];     ///< Morris standard deviation of the elementary effects, sigma.
+	double firstOrder[GSA_OUTPUT_COUNT][MODEL_PARAMETER_COUNT];          ///< First-order Sobol index.
+	double totalOrder[GSA_OUTPUT_COUNT][MODEL_PARAMETER_COUNT];          ///< Total-order Sobol index.
+	double outputVariance[GSA_OUTPUT_COUNT];                             ///< Variance of each output over the samples.
+	double wallTime;                                                     ///< Elapsed time of the analysis in seconds.
+} *GsaResults;
+
+int readGsaSettings(const char* fileName, GsaSettings settings);
+
+int runGlobalSensitivityAnalysis(const SimulationStepper stepper, const ModelParameters mParam, const GsaSettings settings,
+                                 const double endTime, const double timeInterval, const double* initialState, const int threadCount,
+                                 GsaResults results);
+
+void printGsaResults(const GsaSettings settings, const GsaResults results, FILE* oHandle);
@@ -16,23 +16,44 @@
 #include <libgen.h>
 #include <time.h>
 #include <math.h>
+#include <pthread.h>
 #include "carg_parser.h"
 #include "full_model.h"
+#include "fixed_step.h"
+#include "positive_step.h"
 #include "addon.h"
+#include "sensitivity.h"
 #include "base_simulation.h"
+#include "periodic_orbit.h"
+#include "equilibrium.h"
+#include "parallel_runner.h"
+#include "parareal.h"
+#include "parameter_fit.h"
+#include "mcmc.h"
+#include "global_sensitivity.h"
+#include "pharmacokinetics.h"
+#include "virtual_population.h"
+#include "trajectory_file.h"
+#include "multi_profile.h"
+#include "regimen_optimizer.h"
+#include "mic_search.h"
+#include "stochastic_simulation.h"
+#include "result_cache.h"
+#include "simulation_server.h"
+#include "vcombat.h"
 #include "tuberculosis_simulation_config.h"
 
 static const char* invocationName = NULL; ///< The full invocation text for the program including leading directories
 static char* programName; ///< The basename of the program invocation
-int verbose = 0; ///< Specifies whether the program should display verbose output
 
 static void argParserShowError(const char* const msg, const int errorCode, const char help);
 static void argParserInternalError(const char* const msg);
 static const char* optname(const int code, const struct ap_Option options[]);
 static void displayHelp(const char* programName);
 static int outputResultsToFile(SimulationParameters sParam, ModelParameters mParam, SimulationResults results, FILE* oHandle);
+static int readInputProfiles(VcombatContext context, const char** fileNames, const int fileCount, const ModelParameters mParam,
+                             ConcentrationProfiles profiles);
 
-#define DEFAULT_DUMMY -12345 ///< Definition of dummy value for marking those defaults which must be dynamically calculated
 #define STR_HELPER(x) #x
 #define STR(x) STR_HELPER(x)
 #define VERSION_STRING STR(TuberculosisSimulation_VERSION_MAJOR) "." STR(TuberculosisSimulation_VERSION_MINOR)
@@ -53,45 +74,51 @@ int main(const int argc, char** argv) {
 	double* stateVector = NULL;
 	const char* outputFile = NULL;
     const char* outputFileM = NULL;
+	struct _TrajectoryOptions trajectoryOptions;
+	TrajectoryWriter trajectory = NULL;
+	int streamTrajectory = 0;
     const char* inputFile = NULL;
-	const char* tmpStr = NULL;
-	int systemSize;
+	const char* inputFiles[argc];
+	int inputFileCount = 0;
+	double periodicPeriod = 0.0;
+	double periodicStart = 0.0;
+	double equilibriumMin = 0.0;
+	double equilibriumMax = 0.0;
+	int equilibriumCount = 0;
+	int pararealSlices = 0;
+	double pararealCoarseStep = 0.0;
+	int threadCount = getDefaultThreadCount();
+	const char* sensitivityFile = NULL;
+	struct _SensitivitySelection sensitivities = { .parameterCount = 0, .oHandle = NULL };
+	struct _SensitivitySelection fitParameters = { .parameterCount = 0, .oHandle = NULL };
+	const char* fitDataFiles[argc];
+	int fitDataCount = 0;
+	const char* mcmcConfigFile = NULL;
+	const char* gsaConfigFile = NULL;
+	const char* populationConfigFile = NULL;
+	const char* optimizerConfigFile = NULL;
+	struct _StochasticSettings stochastic = { .replicateCount = 0, .seed = DEFAULT_STOCHASTIC_SEED, .tauTolerance = DEFAULT_TAU_TOLERANCE,
+	                                         .hybridThreshold = 0.0 };
+	struct _MicSettings micSettings = { .time = 0.0, .killLogReduction = DEFAULT_MIC_KILL_LOG_REDUCTION, .tolerance = DEFAULT_MIC_TOLERANCE };
+	const char* combinedOutputFile = NULL;
+	const char* serverSocket = NULL;
+	const char* batchFile = NULL;
+	ResultCache resultCache = NULL;
+	struct _ResultKey resultKey;
+	struct _ResultSummary resultSummary;
+	ResultEntry resultEntry = NULL;
+	FILE* cachedResult = NULL;
+	VcombatContext context;
+	int libraryRun;
+	double populationSum = 0.0;
+	int verbose = 0; // Whether the program should display verbose output
     
-    //Vi changed the default to rk2
-	//const gsl_odeiv2_step_type* steppingFunction = gsl_odeiv2_step_rkck;
-    const gsl_odeiv2_step_type* steppingFunction = gsl_odeiv2_step_rk2;
-	
-	// Set-up model parameters with default arguments
-	struct _ModelParameters mParam = {
-		.transMembranePermeability = DEFAULT_TRANSMEMBRANE_PERMEABILITY,
-		.intracellularVolume = DEFAULT_INTRACELLULAR_VOLUME,
-		.targetMoleculeCount = DEFAULT_TARGET_MOLECULE_COUNT,
-		.replicationThreshold = DEFAULT_DUMMY, // This will get defaulted based on targetMoleculeCount
-		.killingThreshold = DEFAULT_THRESHOLD,   
-		.baselineReplication = DEFAULT_BASELINE_REPLICATION,
-		.maximumKillRate = DEFAULT_MAXIMUM_KILL_RATE,
-		.targetAssociationRate = DEFAULT_TARGET_ASSOCIATION_RATE,
-		.targetDissociationRate = DEFAULT_TARGET_DISSOCIATION_RATE,
-		.nonSpecificAssociationRate = DEFAULT_NONSPECIFIC_ASSOCIATION_RATE,
-		.nonSpecificDissociationRate = DEFAULT_NONSPECIFIC_DISSOCIATION_RATE,
-		.timepoints = DEFAULT_TIMEPOINTS,
-                .molecularweight= DEFAULT_MOLECULARWEIGHT,
-                .steptime = DEFAULT_STEPTIME,
-                .carryingCapacity = DEFAULT_CARRYING_CAPACITY,
-		.hyperGeometricMatrix = NULL,
-	};
-    
-    
-    
-	// Set-up simulation parameters with default arguments	
-	struct _SimulationParameters sParam = {
-		.startingAntibiotic = DEFAULT_STARTING_ANTIBIOTIC,
-		.startingPopulation = DEFAULT_STARTING_POPULATION,
-		.endTime = DEFAULT_SIMULATION_END_TIME,
-		.stepSize = DEFAULT_SIMULATION_STEP_SIZE
-	};
+	// The settings shared with the library are parsed into its context, and copied from it once the options are read
+	struct _SimulationStepper stepper;
+	struct _ModelParameters parsedParam;
+	struct _SimulationParameters sParam;
 	
-	struct _SimulationResults results;
+	struct _SimulationResults results = { .timePoint = NULL, .totalPopulation = NULL, .unboundantibiotic = NULL, .capacity = 0 };
 	
 	// Set-up command-line parameters for the carg_parse module
 	const struct ap_Option options[] = {
@@ -113,7 +140,29 @@ int main(const int argc, char** argv) {
 		{ 'o', "outputFile",              ap_yes },
                 { 'm', "outputFileM",             ap_yes },
                 { 'i', "inputFile",               ap_yes },
-		{ 'S', "steppingFunction",        ap_yes }
+		{ 'S', "steppingFunction",        ap_yes },
+		{ 'H', "fixedStepSize",           ap_yes },
+		{ 'P', "periodicOrbit",           ap_yes },
+		{ 'E', "equilibrium",             ap_yes },
+		{ 'L', "pararealSlices",          ap_yes },
+		{ 'j', "threads",                 ap_yes },
+		{ 'Y', "sensitivities",           ap_yes },
+		{ 'y', "sensitivityFile",         ap_yes },
+		{ 'F', "fit",                     ap_yes },
+		{ 'f', "fitData",                 ap_yes },
+		{ 'B', "mcmc",                    ap_yes },
+		{ 'G', "gsa",                     ap_yes },
+		{ 'U', "population",              ap_yes },
+		{ 'X', "optimize",                ap_yes },
+		{ 'I', "mic",                     ap_yes },
+		{ 'Q', "stochastic",              ap_yes },
+		{ 'W', "hybrid",                  ap_yes },
+		{ 'T', "trajectoryFormat",        ap_yes },
+		{ 'N', "plotPoints",              ap_yes },
+		{ 'O', "combinedOutput",          ap_yes },
+		{ 'Z', "server",                  ap_yes },
+		{ 'c', "resultCache",             ap_yes },
+		{ 'b', "batch",                   ap_yes }
 	};
 	
 	// Grab the invocation name from the command-line
@@ -132,6 +181,12 @@ int main(const int argc, char** argv) {
 		return EXIT_FAILURE;
 	}
 	
+	// The plain runs go through the library, whose context holds the options it shares with the command-line
+	if ((context = vcombatCreate()) == NULL) {
+		argParserShowError("Not enough memory.", 0, 0);
+		return EXIT_FAILURE;
+	}
+	
 	// Process options supplied on command-line, into machine variables
 	for(argIdx = 0; argIdx < ap_arguments(&parser); ++argIdx) {
 		const int code = ap_code(&parser, argIdx);
@@ -145,43 +200,26 @@ int main(const int argc, char** argv) {
 			displayHelp(programName);
 			return EXIT_SUCCESS;
 		case 'V':
-			sscanf(ap_argument(&parser, argIdx), "%lg", &mParam.intracellularVolume);
-			break;
 		case 'n':
-			sscanf(ap_argument(&parser, argIdx), "%d", &mParam.targetMoleculeCount);
-			break;
 		case 'r':
-			sscanf(ap_argument(&parser, argIdx), "%d", &mParam.replicationThreshold);
-			break;
 		case 'k':
-			sscanf(ap_argument(&parser, argIdx), "%d", &mParam.killingThreshold);
-			break;
 		case 'R':
-			sscanf(ap_argument(&parser, argIdx), "%lg", &mParam.baselineReplication);
-			break;
 		case 'K':
-			sscanf(ap_argument(&parser, argIdx), "%lg", &mParam.maximumKillRate);
-			break;
 		case 'A':
-			sscanf(ap_argument(&parser, argIdx), "%lg", &mParam.targetAssociationRate);
-			break;
 		case 'D':
-			sscanf(ap_argument(&parser, argIdx), "%lg", &mParam.targetDissociationRate);
-			break;
 		case 'C':
-			sscanf(ap_argument(&parser, argIdx), "%lg", &mParam.carryingCapacity);
-			break;
+		case 'M':
 		case 'd':
-			sscanf(ap_argument(&parser, argIdx), "%lg", &sParam.startingAntibiotic);
-			break;
-                case 'M':
-			sscanf(ap_argument(&parser, argIdx), "%lg", &mParam.molecularweight);
-			break;
 		case 'p':
-			sscanf(ap_argument(&parser, argIdx), "%lg", &sParam.startingPopulation);
-			break;
 		case 't':
-			sscanf(ap_argument(&parser, argIdx), "%lg:%lg", &sParam.endTime, &sParam.stepSize);
+		case 'S':
+		case 'H':
+		case 'T':
+		case 'N':
+			if (vcombatConfigure(context, (char)code, ap_argument(&parser, argIdx)) != GSL_SUCCESS) {
+				fprintf(stderr, "%s: %s\n", vcombatGetError(context), ap_argument(&parser, argIdx));
+				return EXIT_FAILURE;
+			}
 			break;
 		case 'o':
 			outputFile = ap_argument(&parser, argIdx);
@@ -190,53 +228,158 @@ int main(const int argc, char** argv) {
             outputFileM = ap_argument(&parser, argIdx);
             break;
         case 'i':
-            inputFile = ap_argument(&parser, argIdx);
+            inputFiles[inputFileCount++] = ap_argument(&parser, argIdx);
+            inputFile = inputFiles[0];
             break;
-        case 'S':
-			tmpStr = ap_argument(&parser, argIdx);
-			if (!strcmp(tmpStr, "rk4"))
-				steppingFunction = gsl_odeiv2_step_rk4;
-			else if (!strcmp(tmpStr, "rkf45"))
-				steppingFunction = gsl_odeiv2_step_rkf45;
-			else if (!strcmp(tmpStr, "rkck"))
-				steppingFunction = gsl_odeiv2_step_rkck;
-            else if (!strcmp(tmpStr, "msbdf"))//Vi added
-				steppingFunction = gsl_odeiv2_step_msbdf;
-            else if (!strcmp(tmpStr, "rk2"))
-				steppingFunction = gsl_odeiv2_step_rk2;
-            else if (!strcmp(tmpStr, "bsimp"))
-				steppingFunction = gsl_odeiv2_step_bsimp;
-            else if (!strcmp(tmpStr, "msadams"))
-				steppingFunction = gsl_odeiv2_step_msadams;
+		case 'P':
+			sscanf(ap_argument(&parser, argIdx), "%lg:%lg", &periodicPeriod, &periodicStart);
+			break;
+		case 'E':
+			equilibriumCount = 1;
+			if (sscanf(ap_argument(&parser, argIdx), "%lg:%lg:%d", &equilibriumMin, &equilibriumMax, &equilibriumCount) < 2)
+				equilibriumMax = equilibriumMin;
+			break;
+		case 'L':
+			sscanf(ap_argument(&parser, argIdx), "%d:%lg", &pararealSlices, &pararealCoarseStep);
+			break;
+		case 'j':
+			sscanf(ap_argument(&parser, argIdx), "%d", &threadCount);
+			break;
+		case 'Y':
+			if (parseSensitivitySelection(ap_argument(&parser, argIdx), &sensitivities) != 0)
+				return EXIT_FAILURE;
+			break;
+		case 'y':
+			sensitivityFile = ap_argument(&parser, argIdx);
+			break;
+		case 'F':
+			if (parseSensitivitySelection(ap_argument(&parser, argIdx), &fitParameters) != 0)
+				return EXIT_FAILURE;
+			break;
+		case 'f':
+			fitDataFiles[fitDataCount++] = ap_argument(&parser, argIdx);
+			break;
+		case 'B':
+			mcmcConfigFile = ap_argument(&parser, argIdx);
+			break;
+		case 'G':
+			gsaConfigFile = ap_argument(&parser, argIdx);
+			break;
+		case 'U':
+			populationConfigFile = ap_argument(&parser, argIdx);
+			break;
+		case 'X':
+			optimizerConfigFile = ap_argument(&parser, argIdx);
+			break;
+		case 'I':
+			if (sscanf(ap_argument(&parser, argIdx), "%lg:%lg:%lg:%lg:%lg", &micSettings.lowerConcentration, &micSettings.upperConcentration,
+			           &micSettings.time, &micSettings.killLogReduction, &micSettings.tolerance) < 3) {
+				fprintf(stderr, "The MIC search needs [low]:[high]:[time (h)]\n");
+				return EXIT_FAILURE;
+			}
+			break;
+		case 'Q':
+			sscanf(ap_argument(&parser, argIdx), "%d:%lu:%lg", &stochastic.replicateCount, &stochastic.seed, &stochastic.tauTolerance);
+			break;
+		case 'W':
+			sscanf(ap_argument(&parser, argIdx), "%lg", &stochastic.hybridThreshold);
+			break;
+		case 'O':
+			combinedOutputFile = ap_argument(&parser, argIdx);
+			break;
+		case 'Z':
+			serverSocket = ap_argument(&parser, argIdx);
+			break;
+		case 'b':
+			batchFile = ap_argument(&parser, argIdx);
+			break;
+		case 'c':
+			if ((resultCache = openResultCache(ap_argument(&parser, argIdx))) == NULL)
+				return EXIT_FAILURE;
 			break;
 		default:
 			argParserInternalError("uncaught option.");
 		}
 	}
+	if (verbose)
+		vcombatConfigure(context, 'v', "1");
+	getVcombatSettings(context, &stepper, &parsedParam, &sParam, &trajectoryOptions);
+	stochastic.verbose = verbose;
+    
+	if (serverSocket != NULL || batchFile != NULL) {
+		// Answer parameter sets sent to the socket, or the batch of the file, the options given here being their defaults
+		struct _ServerSettings server = {
+			.socketPath = serverSocket,
+			.inputFile = inputFile,
+			.threadCount = threadCount,
+			.stepper = &stepper,
+			.model = &parsedParam,
+			.simulation = &sParam,
+			.trajectoryOptions = &trajectoryOptions,
+			.resultCache = resultCache
+		};
+		
+		if (inputFile == NULL || inputFileCount > 1 || verbose || (serverSocket != NULL && batchFile != NULL)) {
+			fprintf(stderr, "The server and the batch mode take one input file, no verbose mode and not each other.\n");
+			return EXIT_FAILURE;
+		}
+		if (batchFile != NULL) {
+			FILE* iHandle = strcmp(batchFile, "-") ? fopen(batchFile, "r") : stdin;
+			int status;
+
+			if (iHandle == NULL) {
+				fprintf(stderr, "Could not open the batch file %s\n", batchFile);
+				return EXIT_FAILURE;
+			}
+			status = runSimulationBatch(&server, iHandle, stdout);
+			if (iHandle != stdin)
+				fclose(iHandle);
+			closeResultCache(resultCache);
+			return (status == GSL_SUCCESS) ? EXIT_SUCCESS : EXIT_FAILURE;
+		}
+		return (runSimulationServer(&server) == GSL_SUCCESS) ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
     
     //-------------------------------------------------------------------------
     // Define the total timepoint from the Simulation time and the interval
-    mParam.timepoints = ((int)floorl(sParam.endTime /sParam.stepSize));
-    //printf("%d\n",mParam.timepoints);
-    double realantibioticconc[mParam.timepoints];
+    parsedParam.timepoints = (int)countSimulationTicks(0.0, sParam.endTime, sParam.stepSize);
+    //printf("%d\n",parsedParam.timepoints);
+    parsedParam.steptime= sParam.stepSize; 
     
-    mParam.steptime= sParam.stepSize; 
+    // The concentration profile follows the parameters in one allocation. The extra entry repeats the last concentration
+    // for the interpolation in the final interval.
+    ModelParameters mParam = (ModelParameters)calloc(1, sizeof(struct _ModelParameters) + sizeof(double) * (parsedParam.timepoints + 1));
+    *mParam = parsedParam;
      
-     // Reading Antibiotic Concentartion from "input" file 
-    FILE* myFile;
-    myFile = fopen(inputFile, "r");
-    int x;
+     // Reading Antibiotic Concentartion from the "input" files; the equilibrium mode sets its own constant concentrations
+    struct _ConcentrationProfiles profiles = { .profileCount = 0, .concentrations = NULL };
     
-    for (x = 0; x<mParam.timepoints;x++){
-    fscanf(myFile, "%lg", &mParam.realantibioticconc[x]);  
-    // Old code: Changing nG/mL to number of molecules: A*1e3*1e-6*6.02e23/MW    //mParam.realantibioticconc[x]=mParam.realantibioticconc[x]*6.02e17*mParam.intracellularVolume/mParam.molecularweight;
-        
-    // Newcode by Vi 
-    mParam.realantibioticconc[x]=mParam.realantibioticconc[x]*6.02e20*mParam.intracellularVolume/mParam.molecularweight;
-
+    if (equilibriumCount > 0) {
+        if (mParam->timepoints < 2) {
+            fprintf(stderr, "The equilibrium mode needs at least two time-points.\n");
+            return EXIT_FAILURE;
+        }
+    } else if (inputFile == NULL && (fitParameters.parameterCount > 0 || mcmcConfigFile != NULL)) {
+        // Datasets at constant concentrations are fitted without an input profile
+    } else if (populationConfigFile != NULL) {
+        // Every patient of the population gets the profile of the regimen
+    } else if (optimizerConfigFile != NULL) {
+        // Every candidate regimen gets its own profile
+    } else if (micSettings.time > 0.0) {
+        // The MIC search sets its own constant concentrations
+    } else if (inputFile == NULL) {
+        fprintf(stderr, "Could not open the input file for reading\n");
+        return EXIT_FAILURE;
+    } else if (readInputProfiles(context, inputFiles, inputFileCount, mParam, &profiles) != 0) {
+        return EXIT_FAILURE;
+    } else if (profiles.profileCount == 1) {
+        memcpy(mParam->realantibioticconc, profiles.concentrations, sizeof(double) * (mParam->timepoints + 1));
+        freeConcentrationProfiles(&profiles);
+    } else if (periodicPeriod > 0.0 || pararealSlices > 0 || sensitivities.parameterCount > 0 || fitParameters.parameterCount > 0 ||
+               mcmcConfigFile != NULL || gsaConfigFile != NULL) {
+        fprintf(stderr, "Several concentration profiles can only be simulated, not combined with another mode.\n");
+        return EXIT_FAILURE;
     }
-    fclose(myFile);
-    myFile=NULL;
     
     //-------------------------------------------------------------------------
     
@@ -247,15 +390,7 @@ int main(const int argc, char** argv) {
 	if (mParam.killingThreshold == DEFAULT_DUMMY)
 		mParam.killingThreshold = mParam.targetMoleculeCount / 2;*/
     //Dec. 12, Vi changed to, the first case is for the webpage where only killingThreshold is determined.
-	if ((mParam.killingThreshold != DEFAULT_DUMMY)&&(mParam.replicationThreshold == DEFAULT_DUMMY))
-        mParam.replicationThreshold = mParam.killingThreshold -1;
-    else 
-    {
-        if (mParam.replicationThreshold == DEFAULT_DUMMY)
-        mParam.replicationThreshold = mParam.targetMoleculeCount / 2;
-	    if (mParam.killingThreshold == DEFAULT_DUMMY)
-		mParam.killingThreshold = mParam.targetMoleculeCount / 2;
-    }
+	applyDefaultThresholds(mParam);
 	
     
 	// Output the run parameters if verbose-mode is specified
@@ -269,84 +404,391 @@ int main(const int argc, char** argv) {
 		//printf("Antibiotic dose         \t%lg\n", sParam.startingAntibiotic);
 		printf("Time of simulation      \t%lg\n", sParam.endTime);
 		printf("Step size               \t%lg\n\n", sParam.stepSize);		
-		printf("Target molecules        \t%d\n", mParam.targetMoleculeCount);
-		printf("Maximum kill rate       \t%lg\n", mParam.maximumKillRate);
-		printf("Killing threshold       \t%d\n",  mParam.killingThreshold);
-        printf("Replication threshold   \t%d\n",  mParam.replicationThreshold);
-		printf("Baseline replication    \t%lg\n", mParam.baselineReplication);
-		printf("Target association rate \t%lg\n", mParam.targetAssociationRate);
-		printf("Target dissociation rate\t%lg\n", mParam.targetDissociationRate);
-                printf("Drug Molecular Weight    \t%lg\n", mParam.molecularweight);
-		printf("Carrying capacity       \t%lg\n", mParam.carryingCapacity);
-		printf("Intracellular volume    \t%lg\n", mParam.intracellularVolume);
+		printf("Target molecules        \t%d\n", mParam->targetMoleculeCount);
+		printf("Maximum kill rate       \t%lg\n", mParam->maximumKillRate);
+		printf("Killing threshold       \t%d\n",  mParam->killingThreshold);
+        printf("Replication threshold   \t%d\n",  mParam->replicationThreshold);
+		printf("Baseline replication    \t%lg\n", mParam->baselineReplication);
+		printf("Target association rate \t%lg\n", mParam->targetAssociationRate);
+		printf("Target dissociation rate\t%lg\n", mParam->targetDissociationRate);
+                printf("Drug Molecular Weight    \t%lg\n", mParam->molecularweight);
+		printf("Carrying capacity       \t%lg\n", mParam->carryingCapacity);
+		printf("Intracellular volume    \t%lg\n", mParam->intracellularVolume);
 	}
 	
 	// Make sure that no weird parameters have been supplied
-	if (sanityCheckModelParameters(&mParam) != 0) {
+	if (sanityCheckModelParameters(mParam) != 0) {
 		fprintf(stderr, "Failure: Bad parameters supplied\n");
 		return EXIT_FAILURE;
 	}
     
-    FILE* oHandleM;
-    if (outputFileM != NULL) {        
+    // Streaming the trajectory to the standard output leaves it to the records alone
+    streamTrajectory = (outputFileM != NULL && !strcmp(outputFileM, "-"));
+    if (streamTrajectory && verbose) {
+        fprintf(stderr, "The trajectory cannot be streamed to the standard output (-m -) in verbose mode.\n");
+        return EXIT_FAILURE;
+    }
+    if (outputFileM != NULL && !streamTrajectory) {
         if (verbose)
             printf("Outputing compartmentBoundComplexState matrix to %s\n", outputFileM);
-            printf("Output File order is as follows:\n");
-        if ((oHandleM = fopen(outputFileM, "wb")) == NULL) {
-            fprintf(stderr, "Could not open %s for writing\n", outputFileM);
-            return EXIT_FAILURE;
-        }
-    } else{
-        
+        printf("Output File order is as follows:\n");
     }
     
     // creating header for the output file
     
-    int leng=mParam.targetMoleculeCount+4;
-    const char *strs[leng];
-            for (i = 1; i <= mParam.targetMoleculeCount; ++i){
+    int leng=mParam->targetMoleculeCount+4;
+    const char *strs[leng + 1];
+            for (i = 1; i <= mParam->targetMoleculeCount; ++i){
             strs[i]="Li ";
         }
         strs[0]= "L0 ";
-        strs[mParam.targetMoleculeCount]= "Ln ";
-        strs[mParam.targetMoleculeCount+1]= "tm ";
-        strs[mParam.targetMoleculeCount+2]= "BP ";
-        strs[mParam.targetMoleculeCount+3]= "An ";
-        strs[mParam.targetMoleculeCount+4]= "AT ";
+        strs[mParam->targetMoleculeCount]= "Ln ";
+        strs[mParam->targetMoleculeCount+1]= "tm ";
+        strs[mParam->targetMoleculeCount+2]= "BP ";
+        strs[mParam->targetMoleculeCount+3]= "An ";
+        strs[mParam->targetMoleculeCount+4]= "AT ";
     
-    char headout[leng*3];
+    char headout[(leng + 1)*3 + 1];
         strcpy(headout, strs[0]);
    for (i = 1; i <= leng; ++i){
         strcat(headout, strs[i]);
         }
-   printf("%s\n",headout);
+   if (!streamTrajectory)
+       printf("%s\n",headout);
   
 	// Initialize the initial state to all bacteria without bound targets and the initial dose in the extracellular medium
-	stateVector = initializeStateVector(mParam.targetMoleculeCount, sParam.startingAntibiotic, sParam.startingPopulation);
+	stateVector = initializeStateVector(mParam->targetMoleculeCount, sParam.startingAntibiotic, sParam.startingPopulation);
 	
 	// Run the simulation itself, and measure its execution time
 	t = clock();
-	mParam.hyperGeometricMatrix = generateHypergeometricMatrix(mParam.targetMoleculeCount, mParam.replicationThreshold);
-	if (runSimulation(steppingFunction, &mParam,  sParam.endTime, sParam.stepSize, stateVector, &results, outputFileM, oHandleM) != GSL_SUCCESS) {
-		fprintf(stderr, "The simulation failed.\n");
+	mParam->hyperGeometricMatrix = generateHypergeometricMatrix(mParam->targetMoleculeCount, mParam->replicationThreshold);
+	if (equilibriumCount > 0) {
+		// Solve for the equilibria at constant concentrations directly instead of simulating until they are reached
+		FILE* oHandleM = NULL;
+		int status;
+		
+		if (outputFileM != NULL && (oHandleM = fopen(outputFileM, "wb")) == NULL) {
+			fprintf(stderr, "Could not open %s for writing\n", outputFileM);
+			return EXIT_FAILURE;
+		}
+		status = traceEquilibriumCurve(mParam, equilibriumMin, equilibriumMax, equilibriumCount, stateVector,
+		                               DEFAULT_EQUILIBRIUM_TOLERANCE, oHandleM);
+		t = clock() - t;
+		if (oHandleM != NULL)
+			fclose(oHandleM);
+		if (verbose)
+			printf("\nIt took me (%f milliseconds).\n\n",((float)t*1000.0)/CLOCKS_PER_SEC);
+		if (status != GSL_SUCCESS && status != GSL_EMAXITER) {
+			fprintf(stderr, "The equilibrium search failed: %s\n", gsl_strerror(status));
+			return EXIT_FAILURE;
+		}
+		return EXIT_SUCCESS;
+	}
+	if (fitParameters.parameterCount > 0 || mcmcConfigFile != NULL) {
+		// Fit or sample the parameters given the time-kill datasets instead of simulating
+		struct _FitDataset* datasets = (struct _FitDataset*)calloc(fitDataCount, sizeof(struct _FitDataset));
+		int status;
+		
+		if (fitDataCount == 0) {
+			fprintf(stderr, "Fitting and sampling need at least one dataset.\n");
+			return EXIT_FAILURE;
+		}
+		for (i = 0; i < fitDataCount; ++i)
+			if (readFitDataset(fitDataFiles[i], mParam, inputFile != NULL, sParam.startingPopulation, &datasets[i]) != 0)
+				return EXIT_FAILURE;
+		if (mcmcConfigFile != NULL) {
+			struct _McmcSettings mcmc;
+			struct _McmcResults posterior;
+			
+			if (readMcmcSettings(mcmcConfigFile, &mcmc) != 0)
+				return EXIT_FAILURE;
+			if ((status = runMcmcSampler(&stepper, mParam, &mcmc, datasets, fitDataCount, stateVector, threadCount, &posterior)) == GSL_SUCCESS)
+				printMcmcResults(&mcmc, &posterior, stdout);
+		} else {
+			struct _FitResults fit;
+			
+			status = fitModelParameters(&stepper, mParam, &fitParameters, datasets, fitDataCount, stateVector, threadCount,
+			                            DEFAULT_FIT_TOLERANCE, DEFAULT_FIT_MAX_ITERATIONS, &fit);
+			if (status == GSL_SUCCESS || status == GSL_EMAXITER || status == GSL_ENOPROG)
+				printFitResults(&fit, stdout);
+		}
+		for (i = 0; i < fitDataCount; ++i)
+			freeFitDataset(&datasets[i]);
+		free(datasets);
+		if (status != GSL_SUCCESS && status != GSL_EMAXITER && status != GSL_ENOPROG) {
+			fprintf(stderr, "The %s failed: %s\n", (mcmcConfigFile != NULL) ? "sampling" : "fit", gsl_strerror(status));
+			return EXIT_FAILURE;
+		}
+		return EXIT_SUCCESS;
+	}
+	if (gsaConfigFile != NULL) {
+		// Simulate the design of the sensitivity analysis concurrently instead of a single simulation
+		struct _GsaSettings gsa;
+		struct _GsaResults gsaResults;
+		int status;
+		
+		if (readGsaSettings(gsaConfigFile, &gsa) != 0)
+			return EXIT_FAILURE;
+		if ((status = runGlobalSensitivityAnalysis(&stepper, mParam, &gsa, sParam.endTime, sParam.stepSize, stateVector, threadCount,
+		                                           &gsaResults)) != GSL_SUCCESS) {
+			fprintf(stderr, "The sensitivity analysis failed: %s\n", gsl_strerror(status));
+			return EXIT_FAILURE;
+		}
+		printGsaResults(&gsa, &gsaResults, stdout);
+		return EXIT_SUCCESS;
+	}
+	if (populationConfigFile != NULL) {
+		// Simulate the patients of the virtual population concurrently and aggregate their outcomes
+		struct _VpopSettings population;
+		struct _VpopResults outcomes;
+		int status;
+		
+		if (readVpopSettings(populationConfigFile, &population) != 0)
+			return EXIT_FAILURE;
+		if ((status = runVirtualPopulation(&stepper, mParam, &population, sParam.endTime, sParam.stepSize, stateVector, threadCount,
+		                                   &outcomes)) != GSL_SUCCESS) {
+			fprintf(stderr, "The population simulation failed: %s\n", gsl_strerror(status));
+			return EXIT_FAILURE;
+		}
+		status = writeVpopResults(&population, &outcomes, sParam.stepSize);
+		freeVpopResults(&outcomes);
+		return (status == GSL_SUCCESS) ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+	if (optimizerConfigFile != NULL) {
+		// Search the regimen with the least drug which attains the kill target, evaluating the candidates concurrently
+		struct _OptimizerSettings optimizer;
+		struct _OptimizerResults search;
+		int status;
+		
+		if (readOptimizerSettings(optimizerConfigFile, &optimizer) != 0)
+			return EXIT_FAILURE;
+		status = optimizeRegimen(&stepper, mParam, &optimizer, sParam.endTime, sParam.stepSize, stateVector, threadCount, &search);
+		if (status == GSL_EMAXITER)
+			fprintf(stderr, "The search ran out of evaluations before the simplex converged\n");
+		else if (status != GSL_SUCCESS) {
+			fprintf(stderr, "The regimen search failed: %s\n", gsl_strerror(status));
+			freeOptimizerResults(&search);
+			return EXIT_FAILURE;
+		}
+		if (verbose)
+			printf("Simulated %lg of %lg h, the rest was cut by early stopping\n", search.simulatedTime / 3600.0,
+			       search.evaluationCount * sParam.endTime / 3600.0);
+		status = writeOptimizerResults(&optimizer, &search);
+		freeOptimizerResults(&search);
+		return (status == GSL_SUCCESS) ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+	if (micSettings.time > 0.0) {
+		// Bracket the minimum inhibitory and bactericidal concentrations, several concentrations per round
+		struct _MicResults thresholds;
+		
+		if (findThresholdConcentrations(&stepper, mParam, &micSettings, sParam.stepSize, stateVector, threadCount, &thresholds) != GSL_SUCCESS) {
+			fprintf(stderr, "The MIC search failed.\n");
+			return EXIT_FAILURE;
+		}
+		printMicResults(&micSettings, &thresholds, stdout);
+		return EXIT_SUCCESS;
+	}
+	if (stochastic.replicateCount > 0) {
+		// Simulate an ensemble of stochastic replicates of the input profile concurrently and count the extinctions
+		struct _StochasticResults ensemble;
+		
+		if (profiles.profileCount > 1 || stochastic.tauTolerance <= 0.0) {
+			fprintf(stderr, "The stochastic mode takes one input file and a positive tolerance.\n");
+			return EXIT_FAILURE;
+		}
+		if (runStochasticEnsemble(mParam, &stochastic, sParam.endTime, sParam.stepSize, stateVector, threadCount, &ensemble) != GSL_SUCCESS) {
+			fprintf(stderr, "The stochastic simulation failed.\n");
+			return EXIT_FAILURE;
+		}
+		writeStochasticResults(&ensemble, sParam.stepSize, stdout);
+		if (verbose)
+			printf("%d replicates in %lg s: %lu leaps or hybrid steps and %lu exact steps\n", ensemble.replicateCount, ensemble.wallTime, ensemble.leapCount,
+			       ensemble.exactStepCount);
+		freeStochasticResults(&ensemble);
+		return EXIT_SUCCESS;
+	}
+	if (profiles.profileCount > 1) {
+		// Simulate the profiles of the input files concurrently, sharing the hypergeometric matrix
+		struct _ProfileResults profileResults;
+		FILE* oHandle;
+		int status;
+		
+		if (streamTrajectory) {
+			fprintf(stderr, "The trajectories of several profiles cannot be streamed to the standard output.\n");
+			return EXIT_FAILURE;
+		}
+		status = runProfileSimulations(&stepper, mParam, &profiles, sParam.endTime, sParam.stepSize, stateVector, threadCount,
+		                               outputFileM, &trajectoryOptions, headout, &profileResults);
+		if (status != GSL_SUCCESS) {
+			fprintf(stderr, "The simulation failed.\n");
+			return EXIT_FAILURE;
+		}
+		if (combinedOutputFile != NULL) {
+			if ((oHandle = fopen(combinedOutputFile, "w")) == NULL) {
+				fprintf(stderr, "Could not open %s for writing\n", combinedOutputFile);
+				return EXIT_FAILURE;
+			}
+			if (writeCombinedProfileResults(&profileResults, oHandle) != 0 || fclose(oHandle) != 0) {
+				fprintf(stderr, "The was an error writing the output file\n");
+				return EXIT_FAILURE;
+			}
+		}
+		if (verbose || combinedOutputFile == NULL)
+			for (i = 0; i < profileResults.profileCount; ++i)
+				printf("Profile %d: final population %g\n", i, profileResults.runs[i].totalPopulation[profileResults.tickCount - 1]);
+		if (verbose)
+			printf("%d profiles simulated in %lg s\n", profileResults.profileCount, profileResults.wallTime);
+		freeProfileResults(&profileResults);
+		freeConcentrationProfiles(&profiles);
+		return EXIT_SUCCESS;
+	}
+	libraryRun = (periodicPeriod <= 0.0 && pararealSlices == 0 && sensitivities.parameterCount == 0);
+	if (resultCache != NULL && libraryRun && outputFile == NULL) {
+		// A run already in the result cache is copied from it instead of simulated; another is copied into it as it is written
+		makeResultKey(&resultKey, &stepper, mParam, &sParam, &trajectoryOptions);
+		if ((cachedResult = findCachedResult(resultCache, &resultKey, &resultSummary)) == NULL &&
+		    (resultEntry = beginCachedResult(resultCache, &resultKey)) != NULL)
+			vcombatSetTrajectoryCopy(context, resultEntry->oHandle);
+	}
+	if (outputFileM != NULL && cachedResult == NULL && !libraryRun &&
+	    (trajectory = openTrajectoryWriter(outputFileM, &trajectoryOptions, mParam, headout)) == NULL)
 		return EXIT_FAILURE;
+	if (cachedResult != NULL) {
+		FILE* oHandle = NULL;
+		
+		if (outputFileM != NULL && (oHandle = streamTrajectory ? stdout : fopen(outputFileM, "wb")) == NULL) {
+			fprintf(stderr, "Could not open %s for writing\n", outputFileM);
+			return EXIT_FAILURE;
+		}
+		if (copyCachedResult(cachedResult, oHandle) != 0 || (oHandle != NULL && oHandle != stdout && fclose(oHandle) != 0)) {
+			fprintf(stderr, "There was an error writing the trajectory file\n");
+			return EXIT_FAILURE;
+		}
+		populationSum = resultSummary.finalPopulation;
+		results.acceptedSteps = resultSummary.acceptedSteps;
+		results.rejectedSteps = resultSummary.rejectedSteps;
+	} else if (periodicPeriod > 0.0) {
+		// Solve for the state at the start of the dosing interval on the periodic orbit, then output one period of it
+		struct _PeriodicOrbitResults orbit;
+		int status;
+		
+		if (periodicStart < 0.0 || periodicStart + periodicPeriod > sParam.endTime) {
+			fprintf(stderr, "The periodic interval must lie within the simulation time.\n");
+			return EXIT_FAILURE;
+		}
+		status = findPeriodicOrbit(&stepper, mParam, periodicStart, periodicPeriod, sParam.stepSize, DEFAULT_PERIODIC_TOLERANCE,
+		                           DEFAULT_PERIODIC_MAX_ITERATIONS, stateVector, &orbit);
+		printf("Periodic orbit %s after %d Newton iterations (%d period integrations)", orbit.converged ? "converged" : "did not converge",
+		       orbit.iterations, orbit.periodIntegrations);
+		if (!isnan(orbit.residual))
+			printf(", relative residual %lg", orbit.residual);
+		printf("\n");
+		if (orbit.multiplierCount > 0) {
+			printf("Spectral radius of the monodromy matrix %lg: the orbit is %s\n", orbit.spectralRadius,
+			       orbit.spectralRadius < 1.0 ? "stable" : "not stable");
+			printf("Leading Floquet multipliers:");
+			for (i = 0; i < orbit.multiplierCount && i < 5; ++i)
+				printf(" %lg%+lgi", orbit.multipliers[2 * i], orbit.multipliers[2 * i + 1]);
+			printf("\n");
+			free(orbit.multipliers);
+		}
+		if (!isnan(orbit.freeTargetDrift))
+			printf("Drift per period of free target %lg and free bound complex %lg\n", orbit.freeTargetDrift, orbit.freeBoundComplexDrift);
+		printf("\n");
+		if (status != GSL_SUCCESS && status != GSL_EMAXITER && status != GSL_ENOPROG) {
+			fprintf(stderr, "The periodic orbit search failed: %s\n", gsl_strerror(status));
+			return EXIT_FAILURE;
+		}
+		if (runSimulation(&stepper, mParam, periodicStart, periodicStart + periodicPeriod, sParam.stepSize, stateVector, &results, trajectory,
+		                  NULL) != GSL_SUCCESS) {
+			fprintf(stderr, "The simulation failed.\n");
+			return EXIT_FAILURE;
+		}
+	} else if (pararealSlices > 0) {
+		// Integrate the time slices concurrently and iterate on their start states
+		struct _PararealResults parareal;
+		int status = runPararealSimulation(&stepper, mParam, 0.0, sParam.endTime, sParam.stepSize, pararealSlices, threadCount,
+		                                   pararealCoarseStep, DEFAULT_PARAREAL_TOLERANCE, DEFAULT_PARAREAL_MAX_ITERATIONS,
+		                                   stateVector, &results, &parareal, trajectory);
+		if (status != GSL_SUCCESS && status != GSL_EMAXITER) {
+			fprintf(stderr, "The simulation failed.\n");
+			return EXIT_FAILURE;
+		}
+		printf("Parareal %s after %d iterations over %d slices on %d threads, largest relative correction %lg\n",
+		       parareal.converged ? "converged" : "did not converge", parareal.iterations, parareal.sliceCount,
+		       parareal.threadCount, parareal.correction);
+		printf("%lu fine slice integrations, %lu coarse steps, %lg s elapsed against %lg s of serial fine integration (speedup %.2lf)\n",
+		       parareal.fineSliceIntegrations, parareal.coarseSteps, parareal.wallTime, parareal.serialFineTime, parareal.speedup);
+	} else if (sensitivities.parameterCount > 0) {
+		// Integrate the forward sensitivities of the selected parameters together with the model
+		if (sensitivityFile == NULL)
+			sensitivities.oHandle = stdout;
+		else if ((sensitivities.oHandle = fopen(sensitivityFile, "w")) == NULL) {
+			fprintf(stderr, "Could not open %s for writing\n", sensitivityFile);
+			return EXIT_FAILURE;
+		}
+		if (runSimulation(&stepper, mParam, 0.0, sParam.endTime, sParam.stepSize, stateVector, &results, trajectory,
+		                  &sensitivities) != GSL_SUCCESS) {
+			fprintf(stderr, "The simulation failed.\n");
+			return EXIT_FAILURE;
+		}
+		if (sensitivities.oHandle != stdout)
+			fclose(sensitivities.oHandle);
+	} else {
+		// A plain run, by the library with the profile of the input file, writing its trajectory straight to the file
+		struct _VcombatOutput output = { .time = NULL, .population = NULL, .unboundAntibiotic = NULL, .capacity = 0 };
+		FILE* oHandle = NULL;
+		int status;
+		
+		if (outputFileM != NULL && (oHandle = streamTrajectory ? stdout : fopen(outputFileM, "wb")) == NULL) {
+			fprintf(stderr, "Could not open %s for writing\n", outputFileM);
+			return EXIT_FAILURE;
+		}
+		if (oHandle != NULL && oHandle != stdout)
+			setvbuf(oHandle, NULL, _IOFBF, TRAJECTORY_BUFFER_SIZE);
+		status = vcombatRun(context, &output, oHandle);
+		if (oHandle != NULL && oHandle != stdout && fclose(oHandle) != 0 && status == GSL_SUCCESS) {
+			fprintf(stderr, "There was an error writing the trajectory file\n");
+			return EXIT_FAILURE;
+		}
+		if (status != GSL_SUCCESS) {
+			fprintf(stderr, "%s\n", vcombatGetError(context));
+			return EXIT_FAILURE;
+		}
+		populationSum = output.finalPopulation;
+		results.acceptedSteps = output.acceptedSteps;
+		results.rejectedSteps = output.rejectedSteps;
 	}
 	t = clock() - t;
     
-    // write the header to the output file
-    fprintf (oHandleM, "%s\n", headout);
-    fclose(oHandleM);
+    // Finish the trajectory file, with the header line of the text layout or the index of the binary one
+	if (closeTrajectoryWriter(trajectory) != 0) {
+		fprintf(stderr, "There was an error writing the trajectory file\n");
+		return EXIT_FAILURE;
+	}
+	
+	if (cachedResult == NULL && !libraryRun)
+		for (i = NUMBER_FREE_KINETIC_VARIABLES; i < mParam->targetMoleculeCount+NUMBER_FREE_KINETIC_VARIABLES + 1; ++i)
+			populationSum += stateVector[i];
+	if (resultEntry != NULL) {
+		resultSummary.finalPopulation = populationSum;
+		resultSummary.acceptedSteps = results.acceptedSteps;
+		resultSummary.rejectedSteps = results.rejectedSteps;
+		if (finishCachedResult(resultEntry, &resultSummary) != 0)
+			fprintf(stderr, "Could not add the run to the result cache\n");
+	}
 	
 	// Output a summary of results, if verbose-mode is specified
 	if (verbose) {
-		double populationSum = 0.0;
-		for (i = NUMBER_FREE_KINETIC_VARIABLES; i < mParam.targetMoleculeCount+NUMBER_FREE_KINETIC_VARIABLES + 1; ++i)
-			populationSum += stateVector[i];
 		printf("Results readout\n");
 		printf("---------------\n\n");
 		printf("Final population %g\n\n",populationSum);
+		printf("Accepted steps %lu, rejected steps %lu\n\n", results.acceptedSteps, results.rejectedSteps);
 		printf("It took me (%f milliseconds).\n\n",((float)t*1000.0)/CLOCKS_PER_SEC);
+		if (resultCache != NULL && (cachedResult != NULL || resultEntry != NULL))
+			printf("Result cache %s for run %016llx\n\n", (cachedResult != NULL) ? "hit" : "miss", resultKey.hash);
 	}
+	closeResultCache(resultCache);
 	
 	if (outputFile != NULL) {
 		FILE* oHandle;
@@ -357,11 +799,13 @@ int main(const int argc, char** argv) {
 			fprintf(stderr, "Could not open %s for writing\n", outputFile);
 			return EXIT_FAILURE;
 		}
-		if (outputResultsToFile(&sParam, &mParam, &results, oHandle) == -1) {
+		if (outputResultsToFile(&sParam, mParam, &results, oHandle) == -1) {
 			fprintf(stderr, "The was an error writing the output file\n");
 			return EXIT_FAILURE;
 		}
 	}
+	freeSimulationResults(&results);
+	vcombatDestroy(context);
     
 	return EXIT_SUCCESS;
 }
@@ -424,6 +868,42 @@ static const char* optname(const int code, const struct ap_Option options[]) {
 	return buf;
 }
 
+/**
+ * Read the concentration profiles of the input files, each file once. The profile of a single input file of one column,
+ * the one a plain run simulates, is also set as the profile of the library context.
+ *
+ * @param context    The library context.
+ * @param fileNames  The input files.
+ * @param fileCount  Number of input files.
+ * @param mParam     Model parameters for the conversion to molecules and the number of time-points.
+ * @param profiles   The profiles read; free them with freeConcentrationProfiles.
+ *
+ * @return           0 on success, -1 on failure.
+ */
+static int readInputProfiles(VcombatContext context, const char** fileNames, const int fileCount, const ModelParameters mParam,
+                             ConcentrationProfiles profiles) {
+	double* values;
+	int columnCount, rowCount;
+	int status = 0;
+
+	if (fileCount > 1)
+		return readConcentrationProfiles(fileNames, fileCount, mParam, profiles);
+	memset(profiles, 0, sizeof(struct _ConcentrationProfiles));
+	if (readProfileFile(fileNames[0], &columnCount, &rowCount, &values) != 0)
+		return -1;
+	if (rowCount == 0) {
+		fprintf(stderr, "The input files hold no concentrations\n");
+		status = -1;
+	} else if (addConcentrationProfiles(values, columnCount, rowCount, mParam, profiles) != 0 ||
+	           (columnCount == 1 && vcombatSetProfile(context, values, rowCount) != GSL_SUCCESS)) {
+		fprintf(stderr, "Could not allocate the concentration profiles\n");
+		freeConcentrationProfiles(profiles);
+		status = -1;
+	}
+	free(values);
+	return status;
+}
+
 //TODO ADD UNITS TODO
 /**
  * Display the help annotation for the --help command-line option.
@@ -446,11 +926,102 @@ static void displayHelp(const char* programName) {
 	       "   -p, --startingPopulation [population]    : Initial bacterial population.\n"
 	       "                                         default: %lg\n"
 	       "   -S, --steppingFunction [function] : Stepping function to use for the numerical integration.\n"
-	       "                                         where [function] is one of {rk4, rkf45, rkck}\n"
-	       "                                         default: rkck\n"
+	       "                                         where [function] is one of {rk2, rk4, rkf45, rkck, msbdf, bsimp, msadams}\n"
+	       "                                         driven by the adaptive GSL driver, or one of the native fixed-step\n"
+	       "                                         integrators {rk2-native, rk4-native, ssprk3}, or the adaptive\n"
+	       "                                         positivity-preserving integrator {positive}\n"
+	       "                                         default: rk2\n"
+	       "   -H, --fixedStepSize [step (s)]    : Step size of the native fixed-step integrators.\n"
+	       "                                         default: the interval between time-points\n"
+	       "   -P, --periodicOrbit [period (s)]:[start (s)] : Solve for the periodic steady state of a repeated dosing\n"
+	       "                                         regimen by shooting over the dosing interval [start, start + period]\n"
+	       "                                         of the input profile, then output one period of the orbit.\n"
+	       "                                         The state reached from the initial conditions is the first guess.\n"
+	       "   -E, --equilibrium [cmin (mg/L)]:[cmax (mg/L)]:[count] : Solve directly for the equilibria of the\n"
+	       "                                         compartments at [count] constant concentrations from [cmin] to [cmax],\n"
+	       "                                         spaced logarithmically if both are positive, continuing each solution\n"
+	       "                                         from the previous ones. A single concentration may be given alone.\n"
+	       "                                         The starting population is the first guess; no input file is read.\n"
+	       "   -L, --pararealSlices [slices]:[coarse step (s)] : Integrate [slices] time slices concurrently with the\n"
+	       "                                         Parareal method, iterating on the slice start states with a linearly\n"
+	       "                                         implicit Euler coarse propagator of step [coarse step].\n"
+	       "                                         default coarse step: %d steps per slice\n"
+	       "   -j, --threads [count]             : Number of threads for the concurrent modes.\n"
+	       "                                         default: the number of processors\n"
+	       "   -Y, --sensitivities [parameters]  : Integrate the forward sensitivities of the population to the model\n"
+	       "                                         parameters given by their option letters, any of A, D, K, R and C\n"
+	       "                                         (e.g. ADK), and write dP/dparameter at every time-point.\n"
+	       "   -y, --sensitivityFile [ofile]     : Write the sensitivities to [ofile].\n"
+	       "                                         default: the standard output\n"
+	       "   -F, --fit [parameters]            : Fit the model parameters given by their option letters, any of A, D,\n"
+	       "                                         K, R and C, to the time-kill datasets by nonlinear least squares on\n"
+	       "                                         log10 CFU, starting from their given values, and report the estimates\n"
+	       "                                         with their standard errors instead of simulating.\n"
+	       "   -f, --fitData [file]              : Time-kill dataset of lines [time (s)] [log10 CFU]; may be repeated.\n"
+	       "                                         A line \"# concentration [mg/L]\" simulates the dataset at that\n"
+	       "                                         constant concentration instead of the input file, and a line\n"
+	       "                                         \"# population [CFU]\" sets its starting population.\n"
+	       "   -B, --mcmc [config]               : Sample the posterior of the model parameters given the time-kill\n"
+	       "                                         datasets with concurrent adaptive Metropolis chains, starting from\n"
+	       "                                         the given parameter values. [config] holds the priors, the\n"
+	       "                                         likelihood and the sampler settings, one per line:\n"
+	       "                                           parameter [A|D|K|R|C] [uniform|loguniform|normal|lognormal] [a] [b]\n"
+	       "                                           likelihood [normal|student] [log10 CFU error] [degrees of freedom]\n"
+	       "                                           chains, iterations, burnin, thin, seed, step [value]\n"
+	       "                                           samples [file prefix], checkpoint [file prefix] [interval]\n"
+	       "                                         Running it again resumes the chains from their checkpoints.\n"
+	       "   -G, --gsa [config]                : Global sensitivity analysis of the final and minimum log10 population,\n"
+	       "                                         the time to kill and the regrowth time over the ranges of the model\n"
+	       "                                         parameters, simulating the whole design concurrently. [config] holds\n"
+	       "                                         the design, one setting per line:\n"
+	       "                                           method [morris|sobol]\n"
+	       "                                           parameter [A|D|K|R|C] [lower] [upper] [linear|log]\n"
+	       "                                           samples [Morris trajectories or Sobol base samples]\n"
+	       "                                           levels [even number of Morris grid levels], seed [value]\n"
+	       "                                           kill [log reduction], regrowth [log increase over the minimum]\n"
+	       "                                           output [file receiving every sample and its outputs]\n"
+	       "   -U, --population [config]         : Simulate a virtual patient population concurrently, each patient with\n"
+	       "                                         log-normal clearance, volume and absorption rate and the profile of a\n"
+	       "                                         one-compartment model of the regimen; no input file is read. Prints\n"
+	       "                                         the probability of attaining each log-kill target at the end time\n"
+	       "                                         and writes percentile bands of the log-kill over time. [config]\n"
+	       "                                         holds one setting per line:\n"
+	       "                                           patients [count], seed [value]\n"
+	       "                                           clearance [L/h], volume [L], absorption [1/h] [median] [omega]\n"
+	       "                                           bioavailability [fraction]\n"
+	       "                                           regimen [dose (mg)] [interval (h)] [doses]\n"
+	       "                                           target [log-kill], percentiles [percent ...]\n"
+	       "                                           resolution [log10 CFU], bands [file], summary [file]\n"
+	       "   -X, --optimize [config]           : Search the dose, interval and number of doses for the regimen with the\n"
+	       "                                         least total drug which reaches a log-kill target by a target time and\n"
+	       "                                         keeps it until the end time, by Nelder-Mead with the candidates of an\n"
+	       "                                         iteration simulated concurrently; no input file is read. Prints the\n"
+	       "                                         best regimen and writes the frontier of total dose against final\n"
+	       "                                         log-kill. [config] holds one setting per line:\n"
+	       "                                           clearance [L/h], volume [L], absorption [1/h]\n"
+	       "                                           bioavailability [fraction]\n"
+	       "                                           dose [min (mg)] [max], interval [min (h)] [max], doses [min] [max]\n"
+	       "                                           target [log-kill] [time (h)]\n"
+	       "                                           evaluations [max], tolerance [simplex size], frontier [file]\n"
+	       "   -I, --mic [low]:[high]:[time (h)][:[log-kill]:[tolerance]]\n"
+	       "                                     : Find the minimum inhibitory concentration, without net growth at [time],\n"
+	       "                                         and the minimum bactericidal concentration, reaching [log-kill]\n"
+	       "                                         (default 3) at [time], within [low] to [high] mg/L by bisection on\n"
+	       "                                         constant concentrations, one per thread and round, to a relative\n"
+	       "                                         [tolerance] (default 0.01); no input file is read.\n"
+	       "   -Q, --stochastic [replicates][:[seed]:[tolerance]]\n"
+	       "                                     : Simulate [replicates] independent stochastic replicates of the input\n"
+	       "                                         profile concurrently, with whole cells, by adaptive tau-leaping with\n"
+	       "                                         exact steps near extinction, and print the probability of extinction\n"
+	       "                                         at each time-point. [tolerance] bounds the relative change of a\n"
+	       "                                         compartment in one leap (default 0.03).\n"
+	       "   -W, --hybrid [cells]              : With --stochastic, integrate the compartments holding at least [cells]\n"
+	       "                                         as the differential equations and simulate only the others exactly,\n"
+	       "                                         repartitioning at every step.\n"
 	       "   -t, --time [etime (s)]:[intvl (s)]   : Specifies total simulation time [etime] and interval between time-points [intvl].\n"
 	       "                                         default: %lg:%lg\n\n",
-	       DEFAULT_STARTING_ANTIBIOTIC, DEFAULT_STARTING_POPULATION, DEFAULT_SIMULATION_END_TIME, DEFAULT_SIMULATION_STEP_SIZE);
+	       DEFAULT_STARTING_ANTIBIOTIC, DEFAULT_STARTING_POPULATION, DEFAULT_PARAREAL_COARSE_STEPS, DEFAULT_SIMULATION_END_TIME,
+	       DEFAULT_SIMULATION_STEP_SIZE);
 	
 	printf("                                 MODEL PARAMETERS\n\n"
 	       "   -n, --targetMoleculeCount [Integer Number]     : Number of target molecules in a cell.\n"
@@ -474,8 +1045,43 @@ static void displayHelp(const char* programName) {
 	       DEFAULT_TARGET_MOLECULE_COUNT, DEFAULT_BASELINE_REPLICATION, DEFAULT_MAXIMUM_KILL_RATE, DEFAULT_MOLECULARWEIGHT, DEFAULT_TARGET_ASSOCIATION_RATE, DEFAULT_TARGET_DISSOCIATION_RATE, DEFAULT_INTRACELLULAR_VOLUME, DEFAULT_CARRYING_CAPACITY);
 	
 	printf("                                DATA OUTPUT OPTIONS\n\n"
-           "   -i, --inputFile [ofile]   : Read Drug Concentration from [ofile].\n\n"
-           "   -m, --outputFileM [ofile] : Write intracellular compartment vectors to [ofile].\n\n");
+           "   -i, --inputFile [ofile]   : Read Drug Concentration from [ofile]. A file with one column per\n"
+           "                               profile, or a repeated -i, gives several profiles which are\n"
+           "                               simulated concurrently in one run.\n\n"
+           "   -m, --outputFileM [ofile] : Write intracellular compartment vectors to [ofile], or to\n"
+           "                               [ofile].[profile] for each of several profiles. With [ofile] -,\n"
+           "                               stream them to the standard output, e.g. with -T json.\n\n"
+           "   -T, --trajectoryFormat [text|double|float|json][:summary] : Layout of the -m files: text\n"
+           "                               lines with the header last (default), binary columns of doubles\n"
+           "                               or floats with a self-describing header and an index of the\n"
+           "                               time-points, converted to CSV by trajectory_to_csv, or JSON\n"
+           "                               records, one per line: the parameters and columns first, then\n"
+           "                               one per time-point as it is computed, then an end record. With\n"
+           "                               :summary, write the free variables, the mean and variance of the\n"
+           "                               bound targets per cell, the fractions at or above the killing and\n"
+           "                               replication thresholds and the 10/50/90%% quantiles instead of\n"
+           "                               every compartment.\n\n"
+           "   -N, --plotPoints [count] : Decimate the -m output to [count] time-points while it is\n"
+           "                               written, keeping the shape of the log population curve\n"
+           "                               (largest-triangle-three-buckets); the first and last are kept.\n\n"
+           "   -O, --combinedOutput [ofile] : Write the population of each of several profiles as one\n"
+           "                               column of [ofile], one row per time-point.\n\n"
+           "   -c, --resultCache [directory][:[size (MB)]] : Keep the -m output of simple runs in [directory]\n"
+           "                               (default size %d MB, least recently used dropped first), keyed by\n"
+           "                               the parameters, integrator, tolerances, output layout and input\n"
+           "                               profile, and copy it from there instead of simulating a repeated run.\n\n"
+           "   -Z, --server [socket]    : Stay up and answer the parameter sets sent to the Unix domain\n"
+           "                               socket [socket] by clients, one JSON object per connection keyed\n"
+           "                               by option letters (V n r k R K A D C M t d p S T N), with the\n"
+           "                               trajectory streamed back as with -m - -T json. The other options\n"
+           "                               given are the defaults of every request, -i names the input file\n"
+           "                               and -j the number of requests answered at once, with -c their\n"
+           "                               replies are cached. Stops on SIGTERM. A request may also be a JSON\n"
+           "                               array of such objects, a batch whose items are run concurrently\n"
+           "                               and answered in order, each after a status record.\n\n"
+           "   -b, --batch [file]       : Run the batch of parameter sets in [file], or in the standard\n"
+           "                               input with [file] -, as the server would answer it, writing the\n"
+           "                               records to the standard output.\n\n", DEFAULT_RESULT_CACHE_SIZE);
 
 }
 
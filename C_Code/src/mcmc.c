@@ -0,0 +1,670 @@
+/**
+ * @file   mcmc.c
+ * @version 5
+ * @updated  2026
+ * @brief  Parallel Markov chain Monte Carlo sampling of the model parameters
+ *
+ * Each chain is an adaptive random-walk Metropolis sampler in the logarithms of the sampled parameters and runs as one
+ * task on the parallel runner. During the burn-in the proposal takes the scale of each parameter from the samples so far
+ * and a common step size which is tuned towards an acceptance rate of 0.234; after the burn-in the proposal is fixed,
+ * so the retained samples come from a Markov chain with the posterior as its stationary distribution.
+ *
+ * The time-kill datasets are read once and shared read-only by the chains, as is the hypergeometric matrix. Every chain
+ * has its own copy of the model parameters, which embed the concentration profile, and its own integrators, RNG and
+ * sample file, so the chains never synchronise. A chain writes its retained samples as they are drawn and periodically
+ * checkpoints its complete state, RNG included, by atomically replacing its checkpoint file. Running the same
+ * configuration again resumes every chain from its checkpoint, truncating its sample file to the checkpointed length, so
+ * an interrupted run continues exactly as if it had not been interrupted. A checkpoint names the sampled parameters, and
+ * is refused by a configuration which samples others.
+ *
+ * The configuration file holds one setting per line; '#' starts a comment:
+ *
+ *     parameter [A|D|K|R|C] [uniform|loguniform|normal|lognormal] [first] [second]
+ *     likelihood [normal|student] [scale of the log10 CFU error] [degrees of freedom, student only]
+ *     chains [count]
+ *     iterations [count after the burn-in]
+ *     burnin [count]
+ *     thin [interval]
+ *     seed [seed]
+ *     step [initial proposal standard deviation of the log parameters]
+ *     samples [file prefix]
+ *     checkpoint [file prefix] [interval]
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <gsl/gsl_odeiv2.h>
+#include <gsl/gsl_errno.h>
+#include <gsl/gsl_rng.h>
+#include <gsl/gsl_randist.h>
+#include "full_model.h"
+#include "fixed_step.h"
+#include "positive_step.h"
+#include "sensitivity.h"
+#include "base_simulation.h"
+#include "parallel_runner.h"
+#include "parameter_fit.h"
+#include "mcmc.h"
+
+/**
+ * State of one chain, all of it private to the task running the chain
+ */
+typedef struct _McmcChain {
+	int status;                                   ///< GSL_SUCCESS, or the error which stopped the chain.
+	ModelParameters* mParams;                     ///< The chain's copy of the model parameters of each dataset.
+	SimulationIntegrator* integrators;            ///< The chain's integrator of each dataset.
+	double* state;                                ///< State buffer.
+	double* simulated;                            ///< Simulated log10 population of a dataset.
+	gsl_rng* rng;                                 ///< The chain's random number generator.
+	FILE* oHandle;                                ///< The chain's sample file, or NULL.
+	double position[MODEL_PARAMETER_COUNT];       ///< Logarithms of the parameters at the current sample.
+	double logPosterior;                          ///< Log posterior density at the current sample, up to a constant.
+	double stepSize;                              ///< Common factor of the proposal standard deviations.
+	double scale[MODEL_PARAMETER_COUNT];          ///< Proposal standard deviation of each log parameter before the step size.
+	long iteration;                               ///< Number of completed iterations, burn-in included.
+	long windowAccepted;                          ///< Accepted proposals in the current adaptation window.
+	unsigned long accepted;                       ///< Accepted proposals after the burn-in.
+	unsigned long proposed;                       ///< Proposals after the burn-in.
+	long adaptCount;                              ///< Number of burn-in samples in the adaptation statistics.
+	double adaptMean[MODEL_PARAMETER_COUNT];      ///< Running mean of the log parameters during the burn-in.
+	double adaptM2[MODEL_PARAMETER_COUNT];        ///< Running sum of squared deviations of the log parameters during the burn-in.
+	long sampleCount;                             ///< Number of retained samples.
+	double sampleMean[MODEL_PARAMETER_COUNT];     ///< Running mean of the retained parameter values.
+	double sampleM2[MODEL_PARAMETER_COUNT];       ///< Running sum of squared deviations of the retained parameter values.
+	unsigned long evaluations;                    ///< Likelihood evaluations in this run.
+} *McmcChain;
+
+/**
+ * State shared read-only by the chains
+ */
+typedef struct _McmcRun {
+	SimulationStepper stepper;   ///< The integrator selection.
+	ModelParameters mParam;      ///< Model parameters for the simulation.
+	McmcSettings settings;       ///< The sampler settings.
+	FitDataset datasets;         ///< The datasets.
+	int datasetCount;            ///< Number of datasets.
+	const double* initialState;  ///< The initial state of the simulations.
+	McmcChain chains;            ///< The chains, one per task.
+} *McmcRun;
+
+/**
+ * Read the priors, the likelihood and the sampler settings. Unset settings keep their defaults.
+ *
+ * @param fileName  The configuration file.
+ * @param settings  The settings to fill.
+ *
+ * @return          0 on success, -1 on failure.
+ */
+int readMcmcSettings(const char* fileName, McmcSettings settings) {
+	FILE* iHandle;
+	char line[FILENAME_MAX + 64];
+	int lineNumber = 0;
+	int i;
+
+	memset(settings, 0, sizeof(struct _McmcSettings));
+	settings->observationError = DEFAULT_MCMC_OBSERVATION_ERROR;
+	settings->chainCount = DEFAULT_MCMC_CHAINS;
+	settings->iterations = DEFAULT_MCMC_ITERATIONS;
+	settings->burnIn = DEFAULT_MCMC_BURN_IN;
+	settings->thin = 1;
+	settings->seed = 1;
+	settings->initialStep = DEFAULT_MCMC_INITIAL_STEP;
+	if ((iHandle = fopen(fileName, "r")) == NULL) {
+		fprintf(stderr, "Could not open %s for reading\n", fileName);
+		return -1;
+	}
+	while (fgets(line, sizeof(line), iHandle) != NULL) {
+		char key[32], first[FILENAME_MAX], second[32];
+		char* comment = strchr(line, '#');
+		int fields;
+
+		++lineNumber;
+		if (comment != NULL)
+			*comment = '\0';
+		if ((fields = sscanf(line, "%31s %4095s %31s", key, first, second)) < 1)
+			continue;
+		if (!strcmp(key, "parameter")) {
+			McmcPrior prior = &settings->priors[settings->parameterCount];
+			char letter[2];
+			char type[16];
+
+			if (settings->parameterCount == MODEL_PARAMETER_COUNT ||
+			    sscanf(line, "%*s %1s %15s %lg %lg", letter, type, &prior->first, &prior->second) != 4 ||
+			    parseSensitivitySelection(letter, &settings->parameters) != 0) {
+				fprintf(stderr, "%s:%d: expected parameter [letter] [prior] [first] [second]\n", fileName, lineNumber);
+				fclose(iHandle);
+				return -1;
+			}
+			prior->parameter = settings->parameters.parameters[0];
+			for (i = 0; i < settings->parameterCount && settings->priors[i].parameter != prior->parameter; ++i)
+				;
+			if (i < settings->parameterCount) {
+				fprintf(stderr, "%s:%d: the parameter %s already has a prior\n", fileName, lineNumber, letter);
+				fclose(iHandle);
+				return -1;
+			}
+			if (!strcmp(type, "uniform"))
+				prior->type = MCMC_PRIOR_UNIFORM;
+			else if (!strcmp(type, "loguniform"))
+				prior->type = MCMC_PRIOR_LOGUNIFORM;
+			else if (!strcmp(type, "normal"))
+				prior->type = MCMC_PRIOR_NORMAL;
+			else if (!strcmp(type, "lognormal"))
+				prior->type = MCMC_PRIOR_LOGNORMAL;
+			else {
+				fprintf(stderr, "%s:%d: unknown prior %s\n", fileName, lineNumber, type);
+				fclose(iHandle);
+				return -1;
+			}
+			++settings->parameterCount;
+		} else if (!strcmp(key, "likelihood") && fields >= 3) {
+			settings->observationError = atof(second);
+			settings->degreesOfFreedom = 0.0;
+			if (!strcmp(first, "student") &&
+			    (sscanf(line, "%*s %*s %*s %lg", &settings->degreesOfFreedom) != 1 || settings->degreesOfFreedom <= 0.0)) {
+				fprintf(stderr, "%s:%d: the Student-t likelihood needs positive degrees of freedom\n", fileName, lineNumber);
+				fclose(iHandle);
+				return -1;
+			}
+			if (strcmp(first, "student") && strcmp(first, "normal")) {
+				fprintf(stderr, "%s:%d: unknown likelihood %s\n", fileName, lineNumber, first);
+				fclose(iHandle);
+				return -1;
+			}
+		} else if (!strcmp(key, "chains") && fields >= 2)
+			settings->chainCount = atoi(first);
+		else if (!strcmp(key, "iterations") && fields >= 2)
+			settings->iterations = atol(first);
+		else if (!strcmp(key, "burnin") && fields >= 2)
+			settings->burnIn = atol(first);
+		else if (!strcmp(key, "thin") && fields >= 2)
+			settings->thin = atoi(first);
+		else if (!strcmp(key, "seed") && fields >= 2)
+			settings->seed = strtoul(first, NULL, 10);
+		else if (!strcmp(key, "step") && fields >= 2)
+			settings->initialStep = atof(first);
+		else if (!strcmp(key, "samples") && fields >= 2)
+			strcpy(settings->samplesFile, first);
+		else if (!strcmp(key, "checkpoint") && fields >= 3) {
+			strcpy(settings->checkpointFile, first);
+			settings->checkpointInterval = atol(second);
+		} else {
+			fprintf(stderr, "%s:%d: unknown or incomplete setting %s\n", fileName, lineNumber, key);
+			fclose(iHandle);
+			return -1;
+		}
+	}
+	fclose(iHandle);
+
+	// The selection lists the sampled parameters in the order of the priors
+	settings->parameters.parameterCount = settings->parameterCount;
+	for (i = 0; i < settings->parameterCount; ++i)
+		settings->parameters.parameters[i] = settings->priors[i].parameter;
+	if (settings->parameterCount == 0 || settings->chainCount < 1 || settings->iterations < 1 || settings->burnIn < 0 ||
+	    settings->thin < 1 || settings->observationError <= 0.0 || settings->initialStep <= 0.0 || settings->degreesOfFreedom < 0.0) {
+		fprintf(stderr, "%s: the sampler needs at least one parameter and positive counts and scales\n", fileName);
+		return -1;
+	}
+	return 0;
+}
+
+/**
+ * Log prior density of the logarithms of the parameters, including the Jacobian of the logarithm, up to a constant.
+ */
+static double calculateLogPrior(const McmcSettings settings, const double* position) {
+	double logPrior = 0.0;
+	int p;
+
+	for (p = 0; p < settings->parameterCount; ++p) {
+		const McmcPrior prior = &settings->priors[p];
+		const double x = position[p];
+		const double value = exp(x);
+
+		switch (prior->type) {
+		case MCMC_PRIOR_UNIFORM:
+			if (value < prior->first || value > prior->second)
+				return -INFINITY;
+			logPrior += x;
+			break;
+		case MCMC_PRIOR_LOGUNIFORM:
+			if (value < prior->first || value > prior->second)
+				return -INFINITY;
+			break;
+		case MCMC_PRIOR_NORMAL:
+			logPrior += -0.5 * pow((value - prior->first) / prior->second, 2.0) + x;
+			break;
+		case MCMC_PRIOR_LOGNORMAL:
+			logPrior += -0.5 * pow((x - log(prior->first)) / prior->second, 2.0);
+			break;
+		}
+	}
+	return logPrior;
+}
+
+/**
+ * Log posterior density of the logarithms of the parameters, up to a constant. A simulation which fails makes the
+ * density zero, so that the proposal is rejected.
+ */
+static double calculateLogPosterior(McmcRun run, McmcChain chain, const double* position) {
+	const McmcSettings settings = run->settings;
+	double logPosterior = calculateLogPrior(settings, position);
+	int d, k, p;
+
+	if (logPosterior == -INFINITY)
+		return logPosterior;
+	++chain->evaluations;
+	for (d = 0; d < run->datasetCount; ++d) {
+		const FitDataset dataset = &run->datasets[d];
+
+		for (p = 0; p < settings->parameterCount; ++p)
+			*getModelParameterAddress(chain->mParams[d], settings->priors[p].parameter) = exp(position[p]);
+		if (simulateFitDataset(dataset, chain->mParams[d], chain->integrators[d], NULL, run->initialState, chain->state,
+		                       chain->simulated, NULL) != GSL_SUCCESS)
+			return -INFINITY;
+		for (k = 0; k < dataset->pointCount; ++k) {
+			const double z = (chain->simulated[k] - dataset->logPopulation[k]) / settings->observationError;
+
+			if (settings->degreesOfFreedom > 0.0)
+				logPosterior -= 0.5 * (settings->degreesOfFreedom + 1.0) * log1p(z * z / settings->degreesOfFreedom);
+			else
+				logPosterior -= 0.5 * z * z;
+		}
+	}
+	return logPosterior;
+}
+
+/**
+ * Name of the per-chain file with the given prefix.
+ */
+static void getChainFileName(const char* prefix, const int chainIndex, const char* suffix, char* fileName) {
+	snprintf(fileName, FILENAME_MAX, "%s.%d%s", prefix, chainIndex, suffix);
+}
+
+/**
+ * The option letters of the sampled parameters in the order of the priors, which identify the layout of a checkpoint.
+ */
+static void getSampledParameterLetters(const McmcSettings settings, char* letters) {
+	int p;
+
+	for (p = 0; p < settings->parameterCount; ++p)
+		letters[p] = getModelParameterOption(settings->priors[p].parameter);
+	letters[p] = '\0';
+}
+
+/**
+ * Write the complete state of a chain to its checkpoint file, replacing the previous checkpoint atomically so that an
+ * interruption leaves either checkpoint intact. The samples are made durable first, so the sample file always holds at
+ * least the samples the checkpoint counts.
+ */
+static int writeMcmcCheckpoint(const McmcSettings settings, const int chainIndex, McmcChain chain) {
+	char fileName[FILENAME_MAX], temporaryName[FILENAME_MAX];
+	char letters[MODEL_PARAMETER_COUNT + 1];
+	long sampleOffset = 0;
+	FILE* oHandle;
+	int p;
+
+	getChainFileName(settings->checkpointFile, chainIndex, "", fileName);
+	if (chain->oHandle != NULL) {
+		if (fflush(chain->oHandle) != 0 || fsync(fileno(chain->oHandle)) != 0 || (sampleOffset = ftell(chain->oHandle)) < 0) {
+			fprintf(stderr, "Could not write the samples before the checkpoint %s\n", fileName);
+			return GSL_EFAILED;
+		}
+	}
+	getChainFileName(settings->checkpointFile, chainIndex, ".tmp", temporaryName);
+	if ((oHandle = fopen(temporaryName, "wb")) == NULL) {
+		fprintf(stderr, "Could not open %s for writing\n", temporaryName);
+		return GSL_EFAILED;
+	}
+	getSampledParameterLetters(settings, letters);
+	fprintf(oHandle, "%s\n", letters);
+	fprintf(oHandle, "%ld %.17g %.17g %ld %lu %lu %ld %ld %ld\n", chain->iteration, chain->logPosterior, chain->stepSize,
+	        chain->windowAccepted, chain->accepted, chain->proposed, chain->adaptCount, chain->sampleCount, sampleOffset);
+	for (p = 0; p < settings->parameterCount; ++p)
+		fprintf(oHandle, "%.17g %.17g %.17g %.17g %.17g %.17g\n", chain->position[p], chain->scale[p], chain->adaptMean[p],
+		        chain->adaptM2[p], chain->sampleMean[p], chain->sampleM2[p]);
+	gsl_rng_fwrite(oHandle, chain->rng);
+	if (fflush(oHandle) != 0 || fsync(fileno(oHandle)) != 0 || fclose(oHandle) != 0 || rename(temporaryName, fileName) != 0) {
+		fprintf(stderr, "Could not write the checkpoint %s\n", fileName);
+		return GSL_EFAILED;
+	}
+	return GSL_SUCCESS;
+}
+
+/**
+ * Restore the state of a chain from its checkpoint file.
+ *
+ * @return  1 if the chain was restored, 0 if there is no checkpoint, -1 if the checkpoint cannot be read or was written
+ *          for other sampled parameters.
+ */
+static int readMcmcCheckpoint(const McmcSettings settings, const int chainIndex, McmcChain chain, long* sampleOffset) {
+	char fileName[FILENAME_MAX];
+	char letters[MODEL_PARAMETER_COUNT + 1], checkpointLetters[MODEL_PARAMETER_COUNT + 1];
+	FILE* iHandle;
+	int p;
+
+	getChainFileName(settings->checkpointFile, chainIndex, "", fileName);
+	if ((iHandle = fopen(fileName, "rb")) == NULL)
+		return 0;
+	getSampledParameterLetters(settings, letters);
+	if (fscanf(iHandle, "%5s", checkpointLetters) != 1)
+		goto error;
+	if (strcmp(checkpointLetters, letters) != 0) {
+		fprintf(stderr, "The checkpoint %s samples the parameters %s, not %s\n", fileName, checkpointLetters, letters);
+		fclose(iHandle);
+		return -1;
+	}
+	if (fscanf(iHandle, "%ld %lg %lg %ld %lu %lu %ld %ld %ld", &chain->iteration, &chain->logPosterior, &chain->stepSize,
+	           &chain->windowAccepted, &chain->accepted, &chain->proposed, &chain->adaptCount, &chain->sampleCount, sampleOffset) != 9)
+		goto error;
+	for (p = 0; p < settings->parameterCount; ++p)
+		if (fscanf(iHandle, "%lg %lg %lg %lg %lg %lg", &chain->position[p], &chain->scale[p], &chain->adaptMean[p],
+		           &chain->adaptM2[p], &chain->sampleMean[p], &chain->sampleM2[p]) != 6)
+			goto error;
+	if (fgetc(iHandle) != '\n' || gsl_rng_fread(iHandle, chain->rng) != GSL_SUCCESS)
+		goto error;
+	fclose(iHandle);
+	return 1;
+
+error:
+	fprintf(stderr, "Could not read the checkpoint %s\n", fileName);
+	fclose(iHandle);
+	return -1;
+}
+
+/**
+ * Choose the starting point of a chain: the given parameter values, perturbed by the initial step so that the chains
+ * start apart, within the support of the prior.
+ */
+static int initializeMcmcChain(McmcRun run, McmcChain chain) {
+	const McmcSettings settings = run->settings;
+	int attempt, p;
+
+	for (attempt = 0; attempt < 100; ++attempt) {
+		for (p = 0; p < settings->parameterCount; ++p)
+			chain->position[p] = log(*getModelParameterAddress(run->mParam, settings->priors[p].parameter))
+			                     + gsl_ran_gaussian(chain->rng, settings->initialStep);
+		if ((chain->logPosterior = calculateLogPosterior(run, chain, chain->position)) > -INFINITY)
+			break;
+	}
+	if (chain->logPosterior == -INFINITY) {
+		fprintf(stderr, "The starting parameter values lie outside the prior or cannot be simulated\n");
+		return GSL_EDOM;
+	}
+	chain->stepSize = 1.0;
+	for (p = 0; p < settings->parameterCount; ++p)
+		chain->scale[p] = settings->initialStep;
+	return GSL_SUCCESS;
+}
+
+/**
+ * Run the iterations of one chain from its current state.
+ */
+static int iterateMcmcChain(McmcRun run, const int chainIndex, McmcChain chain) {
+	const McmcSettings settings = run->settings;
+	const int parameterCount = settings->parameterCount;
+	const long totalIterations = settings->burnIn + settings->iterations;
+	double proposal[MODEL_PARAMETER_COUNT];
+	int p;
+	int status;
+
+	while (chain->iteration < totalIterations) {
+		const int burningIn = (chain->iteration < settings->burnIn);
+		double logPosterior;
+
+		for (p = 0; p < parameterCount; ++p)
+			proposal[p] = chain->position[p] + gsl_ran_gaussian(chain->rng, chain->stepSize * chain->scale[p]);
+		logPosterior = calculateLogPosterior(run, chain, proposal);
+		if (logPosterior > -INFINITY && log(gsl_rng_uniform_pos(chain->rng)) < logPosterior - chain->logPosterior) {
+			memcpy(chain->position, proposal, sizeof(double) * parameterCount);
+			chain->logPosterior = logPosterior;
+			if (burningIn)
+				++chain->windowAccepted;
+			else
+				++chain->accepted;
+		}
+		++chain->iteration;
+
+		if (burningIn) {
+			// Running moments of the burn-in samples give the scales of the proposal; the step size tracks the acceptance
+			++chain->adaptCount;
+			for (p = 0; p < parameterCount; ++p) {
+				double delta = chain->position[p] - chain->adaptMean[p];
+				chain->adaptMean[p] += delta / chain->adaptCount;
+				chain->adaptM2[p] += delta * (chain->position[p] - chain->adaptMean[p]);
+			}
+			if (chain->iteration % MCMC_ADAPTATION_INTERVAL == 0) {
+				double acceptance = (double)chain->windowAccepted / MCMC_ADAPTATION_INTERVAL;
+
+				chain->stepSize *= exp(2.0 * (acceptance - MCMC_TARGET_ACCEPTANCE));
+				chain->windowAccepted = 0;
+				if (chain->adaptCount >= 2 * MCMC_ADAPTATION_INTERVAL)
+					for (p = 0; p < parameterCount; ++p)
+						chain->scale[p] = fmax(sqrt(chain->adaptM2[p] / (chain->adaptCount - 1)), 1e-3 * settings->initialStep);
+			}
+		} else {
+			++chain->proposed;
+			if ((chain->iteration - settings->burnIn) % settings->thin == 0) {
+				++chain->sampleCount;
+				for (p = 0; p < parameterCount; ++p) {
+					double value = exp(chain->position[p]);
+					double delta = value - chain->sampleMean[p];
+					chain->sampleMean[p] += delta / chain->sampleCount;
+					chain->sampleM2[p] += delta * (value - chain->sampleMean[p]);
+				}
+				if (chain->oHandle != NULL) {
+					fprintf(chain->oHandle, "%ld %.10lg", chain->iteration - settings->burnIn, chain->logPosterior);
+					for (p = 0; p < parameterCount; ++p)
+						fprintf(chain->oHandle, " %.10lg", exp(chain->position[p]));
+					fprintf(chain->oHandle, "\n");
+				}
+			}
+		}
+
+		if (settings->checkpointFile[0] != '\0' && settings->checkpointInterval > 0 &&
+		    (chain->iteration % settings->checkpointInterval == 0 || chain->iteration == totalIterations) &&
+		    (status = writeMcmcCheckpoint(settings, chainIndex, chain)) != GSL_SUCCESS)
+			return status;
+		if (run->stepper->verbose && chainIndex == 0 && chain->iteration % 100 == 0) {
+			printf("chain 0: iteration %ld of %ld, log posterior %lg          \r", chain->iteration, totalIterations, chain->logPosterior);
+			fflush(stdout);
+		}
+	}
+	return GSL_SUCCESS;
+}
+
+/**
+ * Task running one chain: allocate its private copies and integrators, start or resume it, and run it to the end.
+ */
+static int runMcmcChain(const int taskIndex, const int workerIndex, void* context) {
+	McmcRun run = (McmcRun)context;
+	const McmcSettings settings = run->settings;
+	McmcChain chain = &run->chains[taskIndex];
+	const int dim = NUMBER_FREE_KINETIC_VARIABLES + run->mParam->targetMoleculeCount + 1;
+	int maxPoints = 0;
+	long sampleOffset = 0;
+	int resumed = 0;
+	int d, p;
+
+	chain->mParams = (ModelParameters*)calloc(run->datasetCount, sizeof(ModelParameters));
+	chain->integrators = (SimulationIntegrator*)calloc(run->datasetCount, sizeof(SimulationIntegrator));
+	chain->state = (double*)malloc(sizeof(double) * dim);
+	chain->rng = gsl_rng_alloc(gsl_rng_mt19937);
+	if (chain->mParams == NULL || chain->integrators == NULL || chain->state == NULL || chain->rng == NULL)
+		return (chain->status = GSL_ENOMEM);
+	for (d = 0; d < run->datasetCount; ++d) {
+		const ModelParameters source = run->datasets[d].mParam;
+		const size_t size = sizeof(struct _ModelParameters) + sizeof(double) * (source->timepoints + 1);
+
+		if ((chain->mParams[d] = (ModelParameters)malloc(size)) == NULL)
+			return (chain->status = GSL_ENOMEM);
+		memcpy(chain->mParams[d], source, size);
+		chain->mParams[d]->hyperGeometricMatrix = run->mParam->hyperGeometricMatrix;
+		if ((chain->integrators[d] = allocateSimulationIntegrator(run->stepper, chain->mParams[d], source->steptime)) == NULL)
+			return (chain->status = GSL_ENOMEM);
+		if (run->datasets[d].pointCount > maxPoints)
+			maxPoints = run->datasets[d].pointCount;
+	}
+	if ((chain->simulated = (double*)malloc(sizeof(double) * maxPoints)) == NULL)
+		return (chain->status = GSL_ENOMEM);
+	gsl_rng_set(chain->rng, getTaskSeed(settings->seed, taskIndex));
+
+	if (settings->checkpointFile[0] != '\0' && (resumed = readMcmcCheckpoint(settings, taskIndex, chain, &sampleOffset)) < 0)
+		return (chain->status = GSL_EFAILED);
+	if (!resumed && (chain->status = initializeMcmcChain(run, chain)) != GSL_SUCCESS)
+		return chain->status;
+
+	if (settings->samplesFile[0] != '\0') {
+		char fileName[FILENAME_MAX];
+
+		getChainFileName(settings->samplesFile, taskIndex, "", fileName);
+		// A resumed chain drops the samples drawn after its checkpoint, which it is about to draw again
+		if (resumed && truncate(fileName, sampleOffset) != 0) {
+			fprintf(stderr, "Could not truncate %s to the checkpoint\n", fileName);
+			return (chain->status = GSL_EFAILED);
+		}
+		if ((chain->oHandle = fopen(fileName, resumed ? "a" : "w")) == NULL) {
+			fprintf(stderr, "Could not open %s for writing\n", fileName);
+			return (chain->status = GSL_EFAILED);
+		}
+		if (!resumed) {
+			fprintf(chain->oHandle, "iteration logPosterior");
+			for (p = 0; p < settings->parameterCount; ++p)
+				fprintf(chain->oHandle, " %c", getModelParameterOption(settings->priors[p].parameter));
+			fprintf(chain->oHandle, "\n");
+		}
+	}
+
+	chain->status = iterateMcmcChain(run, taskIndex, chain);
+	return chain->status;
+}
+
+/**
+ * Free the private resources of a chain.
+ */
+static void freeMcmcChain(const int datasetCount, McmcChain chain) {
+	int d;
+
+	for (d = 0; d < datasetCount; ++d) {
+		if (chain->integrators != NULL)
+			freeSimulationIntegrator(chain->integrators[d]);
+		if (chain->mParams != NULL)
+			free(chain->mParams[d]);
+	}
+	free(chain->integrators);
+	free(chain->mParams);
+	free(chain->state);
+	free(chain->simulated);
+	if (chain->rng != NULL)
+		gsl_rng_free(chain->rng);
+	if (chain->oHandle != NULL)
+		fclose(chain->oHandle);
+}
+
+/**
+ * Sample the posterior of the parameters given the datasets with concurrent chains, and summarise the retained samples.
+ *
+ * @param stepper        The integrator selection.
+ * @param mParam         Model parameters for the simulation, holding the values from which the chains start.
+ * @param settings       The priors, the likelihood and the sampler settings.
+ * @param datasets       The datasets, read with readFitDataset; shared read-only by the chains.
+ * @param datasetCount   Number of datasets.
+ * @param initialState   The initial state; the population is replaced by that of each dataset.
+ * @param threadCount    Number of threads running the chains.
+ * @param results        The posterior summary.
+ *
+ * @return               GSL_SUCCESS if every chain completed, otherwise the error of the first chain which failed.
+ */
+int runMcmcSampler(const SimulationStepper stepper, const ModelParameters mParam, const McmcSettings settings, const FitDataset datasets,
+                   const int datasetCount, const double* initialState, const int threadCount, McmcResults results) {
+	struct _McmcRun run;
+	double started = getWallClockTime();
+	double chainMeanVariance, withinVariance, pooledM2;
+	unsigned long accepted = 0, proposed = 0;
+	long totalSamples = 0;
+	int status, c, p;
+
+	memset(results, 0, sizeof(struct _McmcResults));
+	run.stepper = stepper;
+	run.mParam = mParam;
+	run.settings = settings;
+	run.datasets = datasets;
+	run.datasetCount = datasetCount;
+	run.initialState = initialState;
+	if ((run.chains = (McmcChain)calloc(settings->chainCount, sizeof(struct _McmcChain))) == NULL)
+		return GSL_ENOMEM;
+
+	status = runParallelTasks(settings->chainCount, threadCount, runMcmcChain, &run);
+	if (stepper->verbose)
+		printf("\n");
+
+	// Pool the running moments of the completed chains
+	for (c = 0; c < settings->chainCount; ++c) {
+		McmcChain chain = &run.chains[c];
+
+		results->likelihoodEvaluations += chain->evaluations;
+		if (chain->status != GSL_SUCCESS || chain->iteration < settings->burnIn + settings->iterations)
+			continue;
+		++results->completedChains;
+		results->samplesPerChain = chain->sampleCount;
+		totalSamples += chain->sampleCount;
+		accepted += chain->accepted;
+		proposed += chain->proposed;
+		for (p = 0; p < settings->parameterCount; ++p)
+			results->mean[p] += chain->sampleMean[p] * chain->sampleCount;
+	}
+	if (totalSamples > 0) {
+		results->acceptanceRate = (proposed > 0) ? (double)accepted / proposed : 0.0;
+		for (p = 0; p < settings->parameterCount; ++p) {
+			results->mean[p] /= totalSamples;
+			pooledM2 = chainMeanVariance = withinVariance = 0.0;
+			for (c = 0; c < settings->chainCount; ++c) {
+				McmcChain chain = &run.chains[c];
+				double delta = chain->sampleMean[p] - results->mean[p];
+
+				if (chain->status != GSL_SUCCESS || chain->sampleCount == 0 || chain->iteration < settings->burnIn + settings->iterations)
+					continue;
+				pooledM2 += chain->sampleM2[p] + chain->sampleCount * delta * delta;
+				chainMeanVariance += delta * delta;
+				withinVariance += (chain->sampleCount > 1) ? chain->sampleM2[p] / (chain->sampleCount - 1) : 0.0;
+			}
+			results->standardDeviation[p] = (totalSamples > 1) ? sqrt(pooledM2 / (totalSamples - 1)) : 0.0;
+			// Gelman-Rubin: compare the variance between the chain means with the variance within the chains
+			if (results->completedChains > 1 && withinVariance > 0.0 && results->samplesPerChain > 1) {
+				const double n = results->samplesPerChain;
+				const double m = results->completedChains;
+				const double W = withinVariance / m;
+				const double B = n * chainMeanVariance / (m - 1.0);
+
+				results->potentialScaleReduction[p] = sqrt(((n - 1.0) / n * W + B / n) / W);
+			}
+		}
+	}
+
+	for (c = 0; c < settings->chainCount; ++c)
+		freeMcmcChain(datasetCount, &run.chains[c]);
+	free(run.chains);
+	results->wallTime = getWallClockTime() - started;
+	return status;
+}
+
+/**
+ * Print the posterior summary of a sampling run.
+ *
+ * @param settings  The sampler settings.
+ * @param results   The posterior summary.
+ * @param oHandle   The file to print to.
+ */
+void printMcmcResults(const McmcSettings settings, const McmcResults results, FILE* oHandle) {
+	int p;
+
+	fprintf(oHandle, "%d of %d chains completed with %ld samples each, acceptance rate %.3lf after the burn-in\n",
+	        results->completedChains, settings->chainCount, results->samplesPerChain, results->acceptanceRate);
+	fprintf(oHandle, "parameter mean standardDeviation Rhat\n");
+	for (p = 0; p < settings->parameterCount; ++p)
+		fprintf(oHandle, "%c %.10lg %.4lg %.4lf\n", getModelParameterOption(settings->priors[p].parameter), results->mean[p],
+		        results->standardDeviation[p], results->potentialScaleReduction[p]);
+	fprintf(oHandle, "%lu likelihood evaluations, %lg s elapsed\n", results->likelihoodEvaluations, results->wallTime);
+}
@@ -0,0 +1,75 @@
+/**
+ * @file   mcmc.h
+ * @version 5
+ * @updated  2026
+ * @brief  Parallel Markov chain Monte Carlo sampling of the model parameters
+ */
+
+#define DEFAULT_MCMC_CHAINS 4                  ///< Number of chains
+#define DEFAULT_MCMC_ITERATIONS 10000          ///< Iterations per chain after the burn-in
+#define DEFAULT_MCMC_BURN_IN 1000              ///< Iterations per chain during which the proposal adapts
+#define DEFAULT_MCMC_INITIAL_STEP 0.05         ///< Standard deviation of the initial proposal of the logarithm of each parameter
+#define DEFAULT_MCMC_OBSERVATION_ERROR 0.2     ///< Standard deviation of the observed log10 CFU
+#define MCMC_TARGET_ACCEPTANCE 0.234           ///< Acceptance rate targeted by the adaptation during the burn-in
+#define MCMC_ADAPTATION_INTERVAL 50            ///< Iterations between adaptations of the proposal during the burn-in
+
+/**
+ * Prior distributions of the sampled parameters
+ */
+typedef enum _McmcPriorType {
+	MCMC_PRIOR_UNIFORM,     ///< Uniform on [first, second].
+	MCMC_PRIOR_LOGUNIFORM,  ///< Uniform in the logarithm on [first, second].
+	MCMC_PRIOR_NORMAL,      ///< Normal with mean first and standard deviation second, truncated to positive values.
+	MCMC_PRIOR_LOGNORMAL    ///< Log-normal with median first and standard deviation of the logarithm second.
+} McmcPriorType;
+
+/**
+ * Prior of one sampled parameter
+ */
+typedef struct _McmcPrior {
+	ModelParameterIndex parameter; ///< The parameter.
+	McmcPriorType type;            ///< The distribution.
+	double first;                  ///< First argument of the distribution.
+	double second;                 ///< Second argument of the distribution.
+} *McmcPrior;
+
+/**
+ * Structure to hold the priors, the likelihood and the sampler settings read from the configuration file
+ */
+typedef struct _McmcSettings {
+	int parameterCount;                            ///< Number of sampled parameters.
+	struct _McmcPrior priors[MODEL_PARAMETER_COUNT]; ///< Prior of each sampled parameter.
+	struct _SensitivitySelection parameters;       ///< The sampled parameters, in the order of the priors.
+	double observationError;                       ///< Scale of the observation error of the log10 CFU.
+	double degreesOfFreedom;                       ///< Degrees of freedom of a Student-t likelihood, or zero for a normal likelihood.
+	int chainCount;                                ///< Number of chains.
+	long iterations;                               ///< Iterations per chain after the burn-in.
+	long burnIn;                                   ///< Iterations per chain during which the proposal adapts.
+	int thin;                                      ///< Interval of the retained samples.
+	unsigned long seed;                            ///< Seed of the run; chain c uses getTaskSeed(seed, c).
+	double initialStep;                            ///< Initial proposal standard deviation of the logarithm of each parameter.
+	char samplesFile[FILENAME_MAX];                ///< Prefix of the per-chain sample files, or empty for none.
+	char checkpointFile[FILENAME_MAX];             ///< Prefix of the per-chain checkpoint files, or empty for none.
+	long checkpointInterval;                       ///< Iterations between checkpoints.
+} *McmcSettings;
+
+/**
+ * Structure to hold the posterior summary and the cost of a sampling run
+ */
+typedef struct _McmcResults {
+	int completedChains;                           ///< Number of chains which ran all their iterations.
+	long samplesPerChain;                          ///< Retained samples per chain.
+	double mean[MODEL_PARAMETER_COUNT];            ///< Posterior mean of each parameter over all chains.
+	double standardDeviation[MODEL_PARAMETER_COUNT]; ///< Posterior standard deviation of each parameter over all chains.
+	double potentialScaleReduction[MODEL_PARAMETER_COUNT]; ///< Gelman-Rubin statistic of each parameter, or zero for a single chain.
+	double acceptanceRate;                         ///< Acceptance rate after the burn-in over all chains.
+	unsigned long likelihoodEvaluations;           ///< Number of evaluations of the likelihood in this run.
+	double wallTime;                               ///< Elapsed time of the run in seconds.
+} *McmcResults;
+
+int readMcmcSettings(const char* fileName, McmcSettings settings);
+
+int runMcmcSampler(const SimulationStepper stepper, const ModelParameters mParam, const McmcSettings settings, const FitDataset datasets,
+                   const int datasetCount, const double* initialState, const int threadCount, McmcResults results);
+
+void printMcmcResults(const McmcSettings settings, const McmcResults results, FILE* oHandle);
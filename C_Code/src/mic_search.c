@@ -0,0 +1,262 @@
+/**
+ * @file   mic_search.c
+ * @version 5
+ * @updated  2026
+ * @brief  Minimum inhibitory and bactericidal concentrations by batched bisection on constant concentrations
+ *
+ * The minimum inhibitory concentration (MIC) is the lowest constant concentration without net growth at the given time,
+ * and the minimum bactericidal concentration (MBC) the lowest one reaching the given log-kill by then. Both are assumed
+ * monotone in the concentration and are bracketed by bisection in the logarithm of the concentration. A round simulates
+ * several concentrations concurrently, one per thread, spread evenly over the brackets still wider than the tolerance,
+ * so a bracket narrows by a factor of the number of its points plus one per round instead of two. Every simulation
+ * reads both criteria, so a point placed for one bracket may also narrow the other.
+ *
+ * The workers keep their copy of the model parameters, sharing the hypergeometric matrix, their integrator and their
+ * buffers for all rounds; only the constant profile is rewritten for each concentration. A simulation stops at the
+ * time of the criteria.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <gsl/gsl_odeiv2.h>
+#include <gsl/gsl_errno.h>
+#include "full_model.h"
+#include "fixed_step.h"
+#include "positive_step.h"
+#include "sensitivity.h"
+#include "base_simulation.h"
+#include "parallel_runner.h"
+#include "mic_search.h"
+
+/**
+ * Private workspace of one worker, kept for all rounds
+ */
+typedef struct _MicWorker {
+	ModelParameters mParam;           ///< The worker's copy of the model parameters, holding the constant profile.
+	SimulationIntegrator integrator;  ///< The worker's integrator.
+	double* state;                    ///< State buffer.
+	double* logPopulation;            ///< Log10 population at the time-points.
+} *MicWorker;
+
+/**
+ * Concentrations of one round and their outcomes; each task writes only its own entries
+ */
+typedef struct _MicRound {
+	MicSettings settings;         ///< The range, the criteria and the tolerance.
+	double endTime;               ///< End of the simulations, half an interval past the time of the criteria.
+	double timeInterval;          ///< Interval between the time-points.
+	const double* initialState;   ///< The initial state of the simulations.
+	MicWorker workers;            ///< The workspaces, one per worker.
+	int pointCount;               ///< Number of concentrations of the round.
+	double* concentrations;       ///< The concentrations of the round (mg/L).
+	double* logChanges;           ///< Change of the log10 population at the time of the criteria.
+} *MicRound;
+
+/**
+ * Task simulating one constant concentration up to the time of the criteria.
+ */
+static int simulateConcentration(const int taskIndex, const int workerIndex, void* context) {
+	MicRound round = (MicRound)context;
+	MicWorker worker = &round->workers[workerIndex];
+	const double molecules = concentrationToMolecules(worker->mParam, round->concentrations[taskIndex]);
+	int tickCount;
+	int x;
+	int status;
+
+	for (x = 0; x <= worker->mParam->timepoints; ++x)
+		worker->mParam->realantibioticconc[x] = molecules;
+	if ((status = recordLogPopulation(worker->integrator, worker->mParam, round->endTime, round->timeInterval, round->initialState,
+	                                  worker->state, worker->logPopulation, &tickCount)) != GSL_SUCCESS) {
+		fprintf(stderr, "The simulation at %lg mg/L failed\n", round->concentrations[taskIndex]);
+		return status;
+	}
+	round->logChanges[taskIndex] = worker->logPopulation[tickCount - 1] - worker->logPopulation[0];
+	return GSL_SUCCESS;
+}
+
+/**
+ * Narrow a bracket with the outcome of one concentration.
+ */
+static void updateBracket(ThresholdBracket bracket, const double concentration, const int met) {
+	if (met && concentration < bracket->upper)
+		bracket->upper = concentration;
+	else if (!met && concentration > bracket->lower)
+		bracket->lower = concentration;
+}
+
+/**
+ * Whether a bracket still needs points.
+ */
+static int isBracketOpen(const ThresholdBracket bracket, const double tolerance) {
+	return bracket->status == THRESHOLD_BRACKETED && bracket->upper > bracket->lower * (1.0 + tolerance);
+}
+
+/**
+ * Add points spaced evenly in the logarithm strictly inside a bracket, skipping concentrations already in the round.
+ */
+static void addBracketPoints(MicRound round, const ThresholdBracket bracket, const int count) {
+	const double logLower = log(bracket->lower);
+	const double logStep = (log(bracket->upper) - logLower) / (count + 1);
+	int p, q;
+
+	for (p = 1; p <= count; ++p) {
+		const double concentration = exp(logLower + p * logStep);
+
+		for (q = 0; q < round->pointCount && round->concentrations[q] != concentration; ++q)
+			;
+		if (q == round->pointCount)
+			round->concentrations[round->pointCount++] = concentration;
+	}
+}
+
+/**
+ * Bracket the minimum inhibitory and bactericidal concentrations to the tolerance.
+ *
+ * @param stepper        The integrator selection.
+ * @param mParam         Model parameters for the simulation; the profile is replaced by constants in per-worker copies.
+ * @param settings       The range, the criteria and the tolerance.
+ * @param timeInterval   Interval between the time-points.
+ * @param initialState   The initial state.
+ * @param threadCount    Number of concentrations simulated concurrently per round.
+ * @param results        The brackets of both thresholds.
+ *
+ * @return               GSL_SUCCESS, or the error of a simulation.
+ */
+int findThresholdConcentrations(const SimulationStepper stepper, const ModelParameters mParam, const MicSettings settings,
+                                const double timeInterval, const double* initialState, const int threadCount, MicResults results) {
+	const int dim = NUMBER_FREE_KINETIC_VARIABLES + mParam->targetMoleculeCount + 1;
+	const size_t size = sizeof(struct _ModelParameters) + sizeof(double) * (mParam->timepoints + 1);
+	const int pointsPerRound = (threadCount > 2) ? threadCount : 2;
+	struct _MicRound round;
+	double started = getWallClockTime();
+	int status = GSL_SUCCESS;
+	int p, w;
+
+	memset(results, 0, sizeof(struct _MicResults));
+	results->inhibitory.upper = results->bactericidal.upper = INFINITY;
+	if (settings->lowerConcentration <= 0.0 || settings->upperConcentration <= settings->lowerConcentration || settings->time <= 0.0) {
+		fprintf(stderr, "The MIC search needs a positive, ascending concentration range and a positive time\n");
+		return GSL_EINVAL;
+	}
+	// Integrating up to a time reads the profile at the following time-point, so the last one cannot be passed
+	if (settings->time * 3600.0 > (mParam->timepoints - 1) * timeInterval) {
+		fprintf(stderr, "The time of the MIC criteria must not pass the last time-point, %lg h\n",
+		        (mParam->timepoints - 1) * timeInterval / 3600.0);
+		return GSL_EINVAL;
+	}
+
+	memset(&round, 0, sizeof(round));
+	round.settings = settings;
+	round.endTime = settings->time * 3600.0 + 0.5 * timeInterval;
+	round.timeInterval = timeInterval;
+	round.initialState = initialState;
+	round.concentrations = (double*)malloc(sizeof(double) * pointsPerRound);
+	round.logChanges = (double*)malloc(sizeof(double) * pointsPerRound);
+	round.workers = (MicWorker)calloc(pointsPerRound, sizeof(struct _MicWorker));
+	if (round.concentrations == NULL || round.logChanges == NULL || round.workers == NULL) {
+		status = GSL_ENOMEM;
+		goto cleanup;
+	}
+	for (w = 0; w < pointsPerRound; ++w) {
+		MicWorker worker = &round.workers[w];
+
+		if ((worker->mParam = (ModelParameters)malloc(size)) == NULL) {
+			status = GSL_ENOMEM;
+			goto cleanup;
+		}
+		memcpy(worker->mParam, mParam, size);
+		worker->integrator = allocateSimulationIntegrator(stepper, worker->mParam, timeInterval);
+		worker->state = (double*)malloc(sizeof(double) * dim);
+		worker->logPopulation = (double*)malloc(sizeof(double) * (mParam->timepoints + 1));
+		if (worker->integrator == NULL || worker->state == NULL || worker->logPopulation == NULL) {
+			status = GSL_ENOMEM;
+			goto cleanup;
+		}
+	}
+
+	// The first round spans the range, bounds included
+	for (p = 0; p < pointsPerRound; ++p)
+		round.concentrations[p] = settings->lowerConcentration *
+		                          pow(settings->upperConcentration / settings->lowerConcentration, (double)p / (pointsPerRound - 1));
+	round.pointCount = pointsPerRound;
+	for (;;) {
+		int openCount;
+
+		if ((status = runParallelTasks(round.pointCount, threadCount, simulateConcentration, &round)) != GSL_SUCCESS)
+			break;
+		++results->rounds;
+		results->simulations += round.pointCount;
+		for (p = 0; p < round.pointCount; ++p) {
+			updateBracket(&results->inhibitory, round.concentrations[p], round.logChanges[p] <= 0.0);
+			updateBracket(&results->bactericidal, round.concentrations[p], -round.logChanges[p] >= settings->killLogReduction);
+		}
+		if (results->rounds == 1) {
+			ThresholdBracket brackets[2] = { &results->inhibitory, &results->bactericidal };
+
+			for (p = 0; p < 2; ++p)
+				if (brackets[p]->upper == INFINITY)
+					brackets[p]->status = THRESHOLD_ABOVE_RANGE;
+				else if (brackets[p]->lower == 0.0)
+					brackets[p]->status = THRESHOLD_BELOW_RANGE;
+		}
+		if (stepper->verbose)
+			printf("round %d: MIC in [%lg, %lg], MBC in [%lg, %lg] mg/L\n", results->rounds, results->inhibitory.lower,
+			       results->inhibitory.upper, results->bactericidal.lower, results->bactericidal.upper);
+
+		// Share the points of the next round between the brackets still open
+		openCount = isBracketOpen(&results->inhibitory, settings->tolerance) + isBracketOpen(&results->bactericidal, settings->tolerance);
+		if (openCount == 0)
+			break;
+		round.pointCount = 0;
+		if (isBracketOpen(&results->inhibitory, settings->tolerance))
+			addBracketPoints(&round, &results->inhibitory, (pointsPerRound + openCount - 1) / openCount);
+		if (isBracketOpen(&results->bactericidal, settings->tolerance))
+			addBracketPoints(&round, &results->bactericidal, pointsPerRound / openCount);
+	}
+
+cleanup:
+	if (round.workers != NULL)
+		for (w = 0; w < pointsPerRound; ++w) {
+			freeSimulationIntegrator(round.workers[w].integrator);
+			free(round.workers[w].mParam);
+			free(round.workers[w].state);
+			free(round.workers[w].logPopulation);
+		}
+	free(round.workers);
+	free(round.concentrations);
+	free(round.logChanges);
+	results->wallTime = getWallClockTime() - started;
+	return status;
+}
+
+/**
+ * Print one threshold concentration.
+ */
+static void printThreshold(const char* name, const MicSettings settings, const ThresholdBracket bracket, FILE* oHandle) {
+	switch (bracket->status) {
+	case THRESHOLD_BELOW_RANGE:
+		fprintf(oHandle, "%s: at most %lg mg/L, the lowest concentration searched\n", name, settings->lowerConcentration);
+		break;
+	case THRESHOLD_ABOVE_RANGE:
+		fprintf(oHandle, "%s: above %lg mg/L, the highest concentration searched\n", name, settings->upperConcentration);
+		break;
+	default:
+		fprintf(oHandle, "%s: %lg mg/L (between %lg and %lg mg/L)\n", name, bracket->upper, bracket->lower, bracket->upper);
+	}
+}
+
+/**
+ * Print the minimum inhibitory and bactericidal concentrations and the cost of the search.
+ *
+ * @param settings  The range, the criteria and the tolerance.
+ * @param results   The result of the search.
+ * @param oHandle   The output stream.
+ */
+void printMicResults(const MicSettings settings, const MicResults results, FILE* oHandle) {
+	printThreshold("MIC (no net growth at the time)", settings, &results->inhibitory, oHandle);
+	printThreshold("MBC (log-kill reached at the time)", settings, &results->bactericidal, oHandle);
+	fprintf(oHandle, "Criteria at %lg h, MBC log-kill %lg; %d simulations in %d rounds, %lg s elapsed\n", settings->time,
+	        settings->killLogReduction, results->simulations, results->rounds, results->wallTime);
+}
@@ -0,0 +1,54 @@
+/**
+ * @file   mic_search.h
+ * @version 5
+ * @updated  2026
+ * @brief  Minimum inhibitory and bactericidal concentrations by batched bisection on constant concentrations
+ */
+
+#define DEFAULT_MIC_KILL_LOG_REDUCTION 3.0  ///< Log-kill defining the bactericidal concentration (99.9 % kill)
+#define DEFAULT_MIC_TOLERANCE 0.01          ///< Relative width of the bracket at which the bisection stops
+
+/**
+ * Position of a threshold concentration relative to the searched range
+ */
+typedef enum {
+	THRESHOLD_BRACKETED,    ///< The threshold lies between the bounds of the bracket.
+	THRESHOLD_BELOW_RANGE,  ///< The lowest concentration of the range already meets the criterion.
+	THRESHOLD_ABOVE_RANGE   ///< The highest concentration of the range does not meet the criterion.
+} ThresholdStatus;
+
+/**
+ * Structure to hold the bracket of one threshold concentration
+ */
+typedef struct _ThresholdBracket {
+	ThresholdStatus status;  ///< Position of the threshold relative to the range.
+	double lower;            ///< Highest concentration (mg/L) simulated which does not meet the criterion.
+	double upper;            ///< Lowest concentration (mg/L) simulated which meets the criterion.
+} *ThresholdBracket;
+
+/**
+ * Structure to hold the range, the criteria and the tolerance of the search
+ */
+typedef struct _MicSettings {
+	double lowerConcentration;  ///< Lowest concentration of the range (mg/L).
+	double upperConcentration;  ///< Highest concentration of the range (mg/L).
+	double time;                ///< Time (h) at which the criteria are read.
+	double killLogReduction;    ///< Log-kill at the time defining the bactericidal concentration.
+	double tolerance;           ///< Relative width of the bracket at which the bisection stops.
+} *MicSettings;
+
+/**
+ * Structure to hold the result of the search
+ */
+typedef struct _MicResults {
+	struct _ThresholdBracket inhibitory;    ///< Bracket of the lowest concentration without net growth at the time.
+	struct _ThresholdBracket bactericidal;  ///< Bracket of the lowest concentration reaching the log-kill at the time.
+	int rounds;                             ///< Number of concurrent rounds.
+	int simulations;                        ///< Number of constant-concentration simulations.
+	double wallTime;                        ///< Elapsed time of the search in seconds.
+} *MicResults;
+
+int findThresholdConcentrations(const SimulationStepper stepper, const ModelParameters mParam, const MicSettings settings,
+                                const double timeInterval, const double* initialState, const int threadCount, MicResults results);
+
+void printMicResults(const MicSettings settings, const MicResults results, FILE* oHandle);
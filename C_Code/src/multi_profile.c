@@ -0,0 +1,363 @@
+/**
+ * @file   multi_profile.c
+ * @version 5
+ * @updated  2026
+ * @brief  Reading of several concentration profiles and their concurrent simulation
+ *
+ * An input file holds one profile as a single column, or all its values on one line, or several profiles as a matrix
+ * with one column per profile and one row per time-point; lines starting with '#' are skipped, and lines may end in
+ * CR, LF or both. Several input files give the profiles of all of them in order. The files are read once into one
+ * array of profiles in molecules.
+ *
+ * The profiles are simulated as tasks on the parallel runner with runSimulation, so each gives exactly the results of
+ * a separate run. Every worker has its own copy of the model parameters into which it copies the profile of its task;
+ * the hypergeometric matrix is shared read-only.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <gsl/gsl_odeiv2.h>
+#include <gsl/gsl_errno.h>
+#include "full_model.h"
+#include "fixed_step.h"
+#include "positive_step.h"
+#include "sensitivity.h"
+#include "base_simulation.h"
+#include "parallel_runner.h"
+#include "trajectory_file.h"
+#include "multi_profile.h"
+
+/**
+ * State shared by the tasks: everything is read-only except the results, of which each task writes its own
+ */
+typedef struct _ProfileRun {
+	SimulationStepper stepper;       ///< The integrator selection.
+	ConcentrationProfiles profiles;  ///< The profiles.
+	double endTime;                  ///< End of the simulations.
+	double timeInterval;             ///< Interval between the time-points.
+	const double* initialState;      ///< The initial state of the simulations.
+	const char* outputFileM;         ///< Prefix of the per-profile compartment files, or NULL for none.
+	TrajectoryOptions trajectoryOptions; ///< Layout, columns and decimation of the compartment files.
+	const char* matrixHeader;        ///< Header line appended to each compartment file.
+	size_t parameterSize;            ///< Size of the model parameters with their profile.
+	ModelParameters* mParams;        ///< The copy of the model parameters of each worker.
+	double** states;                 ///< The state buffer of each worker.
+	ProfileResults results;          ///< The results of every profile.
+} *ProfileRun;
+
+/**
+ * Read the values of one input file as a row-major matrix, one column per profile and one row per time-point, in the
+ * units of the file.
+ *
+ * @param fileName     The input file.
+ * @param columnCount  Receives the number of columns.
+ * @param rowCount     Receives the number of rows.
+ * @param values       Receives the values; free them with free. Left NULL on failure.
+ *
+ * @return             0 on success, -1 on failure.
+ */
+int readProfileFile(const char* fileName, int* columnCount, int* rowCount, double** values) {
+	FILE* iHandle;
+	char* text;
+	char* row;
+	char* saved;
+	long length;
+	int capacity = 0, count = 0, lineNumber = 0;
+
+	*columnCount = *rowCount = 0;
+	*values = NULL;
+	if ((iHandle = fopen(fileName, "rb")) == NULL) {
+		fprintf(stderr, "Could not open %s for reading\n", fileName);
+		return -1;
+	}
+	fseek(iHandle, 0, SEEK_END);
+	length = ftell(iHandle);
+	rewind(iHandle);
+	if (length < 0 || (text = (char*)malloc(length + 1)) == NULL) {
+		fclose(iHandle);
+		return -1;
+	}
+	length = fread(text, 1, length, iHandle);
+	text[length] = '\0';
+	fclose(iHandle);
+
+	for (row = strtok_r(text, "\r\n", &saved); row != NULL; row = strtok_r(NULL, "\r\n", &saved)) {
+		char* cursor = row;
+		char* end;
+		int columns = 0;
+		double value;
+
+		++lineNumber;
+		if (row[strspn(row, " \t")] == '#')
+			continue;
+		while ((value = strtod(cursor, &end)), end != cursor) {
+			if (count == capacity) {
+				double* grown = (double*)realloc(*values, sizeof(double) * (capacity = 2 * capacity + 1024));
+
+				if (grown == NULL) {
+					fprintf(stderr, "Could not allocate the values of %s\n", fileName);
+					goto error;
+				}
+				*values = grown;
+			}
+			(*values)[count++] = value;
+			++columns;
+			cursor = end;
+		}
+		if (columns == 0)
+			continue;
+		if (*rowCount > 0 && columns != *columnCount) {
+			fprintf(stderr, "%s: row %d has %d values where the first row has %d\n", fileName, lineNumber, columns, *columnCount);
+			goto error;
+		}
+		*columnCount = columns;
+		++*rowCount;
+	}
+	free(text);
+
+	// All the values on one line are a single profile
+	if (*rowCount == 1) {
+		*rowCount = *columnCount;
+		*columnCount = 1;
+	}
+	return 0;
+
+error:
+	free(text);
+	free(*values);
+	*values = NULL;
+	*columnCount = *rowCount = 0;
+	return -1;
+}
+
+/**
+ * Add the columns of the values of an input file to the profiles, each converted to molecules on the time-points. As
+ * for a single input file, time-points beyond the end of a column have zero concentration and the extra entry repeats
+ * the last concentration.
+ *
+ * @param values       The values of the file, row by row, as read by readProfileFile.
+ * @param columnCount  Number of columns, each a profile.
+ * @param rowCount     Number of rows.
+ * @param mParam       Model parameters for the conversion to molecules and the number of time-points.
+ * @param profiles     The profiles, empty or holding those of the files before.
+ *
+ * @return             0 on success, -1 if the profiles could not be grown.
+ */
+int addConcentrationProfiles(const double* values, const int columnCount, const int rowCount, const ModelParameters mParam,
+                             ConcentrationProfiles profiles) {
+	const int stride = mParam->timepoints + 1;
+	double* grown;
+	int c, x;
+
+	grown = (double*)realloc(profiles->concentrations, sizeof(double) * stride * (profiles->profileCount + columnCount));
+	if (grown == NULL)
+		return -1;
+	profiles->concentrations = grown;
+	profiles->timepoints = mParam->timepoints;
+	for (c = 0; c < columnCount; ++c) {
+		double* profile = profiles->concentrations + (size_t)(profiles->profileCount + c) * stride;
+
+		for (x = 0; x < mParam->timepoints; ++x)
+			profile[x] = concentrationToMolecules(mParam, (x < rowCount) ? values[(size_t)x * columnCount + c] : 0.0);
+		if (mParam->timepoints > 0)
+			profile[mParam->timepoints] = profile[mParam->timepoints - 1];
+	}
+	profiles->profileCount += columnCount;
+	return 0;
+}
+
+/**
+ * Read the concentration profiles of the input files, every column of each a profile.
+ *
+ * @param fileNames  The input files.
+ * @param fileCount  Number of input files.
+ * @param mParam     Model parameters for the conversion to molecules and the number of time-points.
+ * @param profiles   The profiles read; free them with freeConcentrationProfiles.
+ *
+ * @return           0 on success, -1 on failure.
+ */
+int readConcentrationProfiles(const char** fileNames, const int fileCount, const ModelParameters mParam, ConcentrationProfiles profiles) {
+	int f;
+
+	memset(profiles, 0, sizeof(struct _ConcentrationProfiles));
+	profiles->timepoints = mParam->timepoints;
+	for (f = 0; f < fileCount; ++f) {
+		double* values;
+		int columnCount, rowCount;
+
+		if (readProfileFile(fileNames[f], &columnCount, &rowCount, &values) != 0) {
+			freeConcentrationProfiles(profiles);
+			return -1;
+		}
+		if (addConcentrationProfiles(values, columnCount, rowCount, mParam, profiles) != 0) {
+			free(values);
+			freeConcentrationProfiles(profiles);
+			return -1;
+		}
+		free(values);
+	}
+	if (profiles->profileCount == 0) {
+		fprintf(stderr, "The input files hold no concentrations\n");
+		return -1;
+	}
+	return 0;
+}
+
+/**
+ * Free the concentration profiles.
+ *
+ * @param profiles  The profiles.
+ */
+void freeConcentrationProfiles(ConcentrationProfiles profiles) {
+	free(profiles->concentrations);
+	profiles->concentrations = NULL;
+	profiles->profileCount = 0;
+}
+
+/**
+ * Task simulating one profile with runSimulation, writing its compartments to its own file if requested.
+ */
+static int simulateProfile(const int taskIndex, const int workerIndex, void* context) {
+	ProfileRun run = (ProfileRun)context;
+	ModelParameters mParam = run->mParams[workerIndex];
+	double* state = run->states[workerIndex];
+	const int dim = NUMBER_FREE_KINETIC_VARIABLES + mParam->targetMoleculeCount + 1;
+	TrajectoryWriter trajectory = NULL;
+	int status;
+
+	memcpy(mParam->realantibioticconc, run->profiles->concentrations + (size_t)taskIndex * (run->profiles->timepoints + 1),
+	       sizeof(double) * (run->profiles->timepoints + 1));
+	memcpy(state, run->initialState, sizeof(double) * dim);
+	if (run->outputFileM != NULL) {
+		char fileName[FILENAME_MAX];
+
+		snprintf(fileName, FILENAME_MAX, "%s.%d", run->outputFileM, taskIndex);
+		if ((trajectory = openTrajectoryWriter(fileName, run->trajectoryOptions, mParam, run->matrixHeader)) == NULL)
+			return GSL_EFAILED;
+	}
+	status = runSimulation(run->stepper, mParam, 0.0, run->endTime, run->timeInterval, state, &run->results->runs[taskIndex],
+	                       trajectory, NULL);
+	if (closeTrajectoryWriter(trajectory) != 0 && status == GSL_SUCCESS)
+		status = GSL_EFAILED;
+	if (status != GSL_SUCCESS)
+		fprintf(stderr, "The simulation of profile %d failed\n", taskIndex);
+	return status;
+}
+
+/**
+ * Simulate every profile concurrently.
+ *
+ * @param stepper        The integrator selection.
+ * @param mParam         Model parameters for the simulation; the profile is replaced in per-worker copies.
+ * @param profiles       The profiles.
+ * @param endTime        End of the simulations.
+ * @param timeInterval   Interval between the time-points.
+ * @param initialState   The initial state.
+ * @param threadCount    Number of threads simulating the profiles.
+ * @param outputFileM    Prefix of the compartment files, one per profile suffixed with its index, or NULL for none.
+ * @param trajectoryOptions  Layout, columns and decimation of the compartment files.
+ * @param matrixHeader   Header line appended to each text compartment file, as for a single simulation.
+ * @param results        The results of every profile; free them with freeProfileResults.
+ *
+ * @return               GSL_SUCCESS, or the error of the first simulation which failed.
+ */
+int runProfileSimulations(const SimulationStepper stepper, const ModelParameters mParam, const ConcentrationProfiles profiles,
+                          const double endTime, const double timeInterval, const double* initialState, const int threadCount,
+                          const char* outputFileM, const TrajectoryOptions trajectoryOptions, const char* matrixHeader,
+                          ProfileResults results) {
+	const int dim = NUMBER_FREE_KINETIC_VARIABLES + mParam->targetMoleculeCount + 1;
+	struct _ProfileRun run;
+	double started = getWallClockTime();
+	int workerCount = (threadCount < profiles->profileCount) ? threadCount : profiles->profileCount;
+	int status = GSL_SUCCESS;
+	int w;
+
+	memset(results, 0, sizeof(struct _ProfileResults));
+	memset(&run, 0, sizeof(run));
+	if (workerCount < 1)
+		workerCount = 1;
+	run.stepper = stepper;
+	run.profiles = profiles;
+	run.endTime = endTime;
+	run.timeInterval = timeInterval;
+	run.initialState = initialState;
+	run.outputFileM = outputFileM;
+	run.trajectoryOptions = trajectoryOptions;
+	run.matrixHeader = matrixHeader;
+	run.parameterSize = sizeof(struct _ModelParameters) + sizeof(double) * (mParam->timepoints + 1);
+	run.results = results;
+
+	results->tickCount = countSimulationTicks(0.0, endTime, timeInterval);
+	results->profileCount = profiles->profileCount;
+	results->runs = (struct _SimulationResults*)calloc(profiles->profileCount, sizeof(struct _SimulationResults));
+	run.mParams = (ModelParameters*)calloc(workerCount, sizeof(ModelParameters));
+	run.states = (double**)calloc(workerCount, sizeof(double*));
+	if (results->runs == NULL || run.mParams == NULL || run.states == NULL) {
+		status = GSL_ENOMEM;
+		goto cleanup;
+	}
+	for (w = 0; w < workerCount; ++w) {
+		run.mParams[w] = (ModelParameters)malloc(run.parameterSize);
+		run.states[w] = (double*)malloc(sizeof(double) * dim);
+		if (run.mParams[w] == NULL || run.states[w] == NULL) {
+			status = GSL_ENOMEM;
+			goto cleanup;
+		}
+		memcpy(run.mParams[w], mParam, run.parameterSize);
+	}
+
+	status = runParallelTasks(profiles->profileCount, workerCount, simulateProfile, &run);
+
+cleanup:
+	for (w = 0; w < workerCount; ++w) {
+		if (run.mParams != NULL)
+			free(run.mParams[w]);
+		if (run.states != NULL)
+			free(run.states[w]);
+	}
+	free(run.mParams);
+	free(run.states);
+	results->wallTime = getWallClockTime() - started;
+	return status;
+}
+
+/**
+ * Write the population of every profile as one column of a file with a row per time-point.
+ *
+ * @param results  The results of every profile.
+ * @param oHandle  The file to write to.
+ *
+ * @return         0 on success, -1 on failure.
+ */
+int writeCombinedProfileResults(const ProfileResults results, FILE* oHandle) {
+	int a, p;
+
+	fprintf(oHandle, "time");
+	for (p = 0; p < results->profileCount; ++p)
+		fprintf(oHandle, " population.%d", p);
+	fprintf(oHandle, "\n");
+	for (a = 0; a < results->tickCount; ++a) {
+		fprintf(oHandle, "%lf", results->runs[0].timePoint[a]);
+		for (p = 0; p < results->profileCount; ++p)
+			fprintf(oHandle, " %lf", results->runs[p].totalPopulation[a]);
+		if (fprintf(oHandle, "\n") < 0)
+			return -1;
+	}
+	return 0;
+}
+
+/**
+ * Free the results of every profile.
+ *
+ * @param results  The results.
+ */
+void freeProfileResults(ProfileResults results) {
+	int p;
+
+	for (p = 0; results->runs != NULL && p < results->profileCount; ++p)
+		freeSimulationResults(&results->runs[p]);
+	free(results->runs);
+	results->runs = NULL;
+}
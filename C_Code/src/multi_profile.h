@@ -0,0 +1,43 @@
+/**
+ * @file   multi_profile.h
+ * @version 5
+ * @updated  2026
+ * @brief  Reading of several concentration profiles and their concurrent simulation
+ */
+
+/**
+ * Structure to hold concentration profiles sampled on the time-points of the simulation
+ */
+typedef struct _ConcentrationProfiles {
+	int profileCount;        ///< Number of profiles.
+	int timepoints;          ///< Number of time-points of each profile.
+	double* concentrations;  ///< Concentrations in molecules, timepoints + 1 per profile, the last repeating the one before.
+} *ConcentrationProfiles;
+
+/**
+ * Structure to hold the results of the concurrent simulation of the profiles
+ */
+typedef struct _ProfileResults {
+	int profileCount;                 ///< Number of profiles.
+	int tickCount;                    ///< Number of time-points of the results of each profile.
+	struct _SimulationResults* runs;  ///< The results of the simulation of each profile.
+	double wallTime;                  ///< Elapsed time of the simulations in seconds.
+} *ProfileResults;
+
+int readProfileFile(const char* fileName, int* columnCount, int* rowCount, double** values);
+
+int addConcentrationProfiles(const double* values, const int columnCount, const int rowCount, const ModelParameters mParam,
+                             ConcentrationProfiles profiles);
+
+int readConcentrationProfiles(const char** fileNames, const int fileCount, const ModelParameters mParam, ConcentrationProfiles profiles);
+
+void freeConcentrationProfiles(ConcentrationProfiles profiles);
+
+int runProfileSimulations(const SimulationStepper stepper, const ModelParameters mParam, const ConcentrationProfiles profiles,
+                          const double endTime, const double timeInterval, const double* initialState, const int threadCount,
+                          const char* outputFileM, const TrajectoryOptions trajectoryOptions, const char* matrixHeader,
+                          ProfileResults results);
+
+int writeCombinedProfileResults(const ProfileResults results, FILE* oHandle);
+
+void freeProfileResults(ProfileResults results);
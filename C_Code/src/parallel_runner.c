@@ -0,0 +1,150 @@
+/**
+ * @file   parallel_runner.c
+ * @version 5
+ * @updated  2026
+ * @brief  Thread pool for running independent tasks concurrently
+ *
+ * Tasks are handed out one at a time from a shared counter, so that workers which finish early pick up the remaining
+ * tasks. The calling thread works as worker zero, so a single thread runs every task inline without creating a thread.
+ */
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+#include "parallel_runner.h"
+
+/**
+ * State shared by the workers of one parallel run
+ */
+typedef struct _ParallelRun {
+	pthread_mutex_t lock;  ///< Protects the task counter and the status.
+	int nextTask;          ///< The next task to hand out.
+	int taskCount;         ///< The number of tasks.
+	int status;            ///< The first non-zero status returned by a task.
+	ParallelTaskFunc task; ///< The task function.
+	void* context;         ///< The context passed to every task.
+} *ParallelRun;
+
+/**
+ * Arguments of one worker thread
+ */
+typedef struct _ParallelWorker {
+	ParallelRun run;   ///< The shared run state.
+	int workerIndex;   ///< The index of this worker.
+	pthread_t thread;  ///< The thread running this worker.
+} *ParallelWorker;
+
+/**
+ * Worker loop: take tasks from the shared counter until none remain or a task has failed.
+ */
+static void* runParallelWorker(void* argument) {
+	ParallelWorker worker = (ParallelWorker)argument;
+	ParallelRun run = worker->run;
+
+	for (;;) {
+		int taskIndex;
+		int status;
+
+		pthread_mutex_lock(&run->lock);
+		taskIndex = (run->status == 0 && run->nextTask < run->taskCount) ? run->nextTask++ : -1;
+		pthread_mutex_unlock(&run->lock);
+		if (taskIndex < 0)
+			break;
+
+		if ((status = run->task(taskIndex, worker->workerIndex, run->context)) != 0) {
+			pthread_mutex_lock(&run->lock);
+			if (run->status == 0)
+				run->status = status;
+			pthread_mutex_unlock(&run->lock);
+		}
+	}
+	return NULL;
+}
+
+/**
+ * The number of threads to use when none is given, i.e. the number of online processors.
+ *
+ * @return  The number of online processors, at least one.
+ */
+int getDefaultThreadCount(void) {
+	long processors = sysconf(_SC_NPROCESSORS_ONLN);
+
+	return (processors > 0) ? (int)processors : 1;
+}
+
+/**
+ * Elapsed time in seconds on a monotonic clock, for timing the concurrent modes; clock() would add up the processor time
+ * of all threads.
+ *
+ * @return  The time in seconds since an arbitrary fixed point.
+ */
+double getWallClockTime(void) {
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec + 1e-9 * now.tv_nsec;
+}
+
+/**
+ * Seed of the random stream of one task. The seed and the task index are mixed (SplitMix64) so that the streams of
+ * neighbouring tasks, and of the same task under neighbouring seeds, are unrelated, and a task draws the same numbers
+ * whichever worker runs it.
+ *
+ * @param seed       The seed of the whole run.
+ * @param taskIndex  The index of the task.
+ *
+ * @return           The seed of the stream of the task.
+ */
+unsigned long getTaskSeed(const unsigned long seed, const int taskIndex) {
+	unsigned long long z = (unsigned long long)seed * 0x9E3779B97F4A7C15ULL + (unsigned long long)taskIndex + 1;
+
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	return (unsigned long)(z ^ (z >> 31));
+}
+
+/**
+ * Run independent tasks on a pool of threads and wait for all of them to finish.
+ *
+ * @param taskCount    The number of tasks.
+ * @param threadCount  The number of workers, including the calling thread. Capped at the number of tasks.
+ * @param task         The task function.
+ * @param context      The context passed to every task.
+ *
+ * @return             Zero if every task succeeded, otherwise the first non-zero status returned by a task. Tasks not
+ *                     yet started when a task fails are skipped.
+ */
+int runParallelTasks(const int taskCount, const int threadCount, ParallelTaskFunc task, void* context) {
+	struct _ParallelRun run;
+	struct _ParallelWorker* workers;
+	int workerCount = (threadCount < taskCount) ? threadCount : taskCount;
+	int i;
+
+	if (workerCount < 1)
+		workerCount = 1;
+	run.nextTask = 0;
+	run.taskCount = taskCount;
+	run.status = 0;
+	run.task = task;
+	run.context = context;
+	pthread_mutex_init(&run.lock, NULL);
+
+	workers = (struct _ParallelWorker*)malloc(sizeof(struct _ParallelWorker) * workerCount);
+	for (i = 0; i < workerCount; ++i) {
+		workers[i].run = &run;
+		workers[i].workerIndex = i;
+	}
+	// Worker zero is the calling thread; a worker whose thread cannot be created leaves its share to the others
+	for (i = 1; i < workerCount; ++i)
+		if (pthread_create(&workers[i].thread, NULL, runParallelWorker, &workers[i]) != 0)
+			workers[i].workerIndex = -1;
+	runParallelWorker(&workers[0]);
+	for (i = 1; i < workerCount; ++i)
+		if (workers[i].workerIndex >= 0)
+			pthread_join(workers[i].thread, NULL);
+
+	free(workers);
+	pthread_mutex_destroy(&run.lock);
+	return run.status;
+}
@@ -0,0 +1,26 @@
+/**
+ * @file   parallel_runner.h
+ * @version 5
+ * @updated  2026
+ * @brief  Thread pool for running independent tasks concurrently
+ */
+
+/**
+ * Task run by the parallel runner. Tasks are independent; each is run exactly once, on one worker.
+ *
+ * @param taskIndex    The index of the task, from zero to the task count.
+ * @param workerIndex  The index of the worker running the task, from zero to the thread count, for selecting per-worker
+ *                     workspaces.
+ * @param context      The context shared by all tasks.
+ *
+ * @return             Zero on success, otherwise an error code which stops the remaining tasks from being started.
+ */
+typedef int (*ParallelTaskFunc)(const int taskIndex, const int workerIndex, void* context);
+
+int getDefaultThreadCount(void);
+
+double getWallClockTime(void);
+
+unsigned long getTaskSeed(const unsigned long seed, const int taskIndex);
+
+int runParallelTasks(const int taskCount, const int threadCount, ParallelTaskFunc task, void* context);
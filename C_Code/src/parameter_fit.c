@@ -0,0 +1,455 @@
+/**
+ * @file   parameter_fit.c
+ * @version 5
+ * @updated  2026
+ * @brief  Nonlinear least-squares fitting of the model parameters to time-kill data
+ *
+ * The selected parameters are fitted to observed log10 CFU counts with the Levenberg-Marquardt method of
+ * gsl_multifit_nlinear. The parameters are fitted as logarithms, which keeps them positive and puts rates spanning
+ * orders of magnitude on the same footing. The residuals of the datasets are simulated in-process and concurrently,
+ * one task per dataset, each with integrators allocated once for the whole fit. The Jacobian comes from the forward
+ * sensitivities integrated with the model rather than from finite differences, except with the implicit GSL steppers,
+ * for which the augmented system has no Jacobian of its own.
+ *
+ * A dataset file holds one observation per line, the time (s) followed by the log10 CFU count. Lines starting with '#'
+ * are comments, except "# concentration [mg/L]", which simulates the dataset at that constant drug concentration
+ * instead of the input profile, and "# population [CFU]", which sets its starting population.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <gsl/gsl_odeiv2.h>
+#include <gsl/gsl_errno.h>
+#include <gsl/gsl_vector.h>
+#include <gsl/gsl_matrix.h>
+#include <gsl/gsl_blas.h>
+#include <gsl/gsl_multifit_nlinear.h>
+#include "full_model.h"
+#include "fixed_step.h"
+#include "positive_step.h"
+#include "sensitivity.h"
+#include "base_simulation.h"
+#include "parallel_runner.h"
+#include "parameter_fit.h"
+
+/**
+ * State shared by the residual and Jacobian evaluations of one fit
+ */
+typedef struct _FitContext {
+	FitDataset datasets;          ///< The datasets.
+	int datasetCount;             ///< Number of datasets.
+	const int* offsets;           ///< Index of the first residual of each dataset.
+	SensitivitySelection parameters; ///< The fitted parameters.
+	const double* initialState;   ///< The initial state, whose population each dataset replaces.
+	int threadCount;              ///< Number of threads evaluating the datasets.
+	gsl_vector* residuals;        ///< The residuals being evaluated.
+	gsl_matrix* jacobian;         ///< The Jacobian being evaluated, or NULL when only the residuals are.
+	unsigned long residualEvaluations; ///< Number of residual evaluations.
+	unsigned long jacobianEvaluations; ///< Number of Jacobian evaluations.
+} *FitContext;
+
+/**
+ * Read a time-kill dataset.
+ *
+ * @param fileName            The dataset file.
+ * @param mParam              Model parameters for the simulation, holding the input concentration profile.
+ * @param hasProfile          Non-zero if an input concentration profile was read into the model parameters.
+ * @param startingPopulation  The starting population unless the file gives one.
+ * @param dataset             The dataset to fill.
+ *
+ * @return                    0 on success, -1 on failure.
+ */
+int readFitDataset(const char* fileName, const ModelParameters mParam, const int hasProfile, const double startingPopulation,
+                   FitDataset dataset) {
+	FILE* iHandle;
+	char line[256];
+	int capacity = 64;
+	int i;
+
+	memset(dataset, 0, sizeof(struct _FitDataset));
+	dataset->fileName = fileName;
+	dataset->startingPopulation = startingPopulation;
+	dataset->concentration = -1.0;
+	if ((iHandle = fopen(fileName, "r")) == NULL) {
+		fprintf(stderr, "Could not open %s for reading\n", fileName);
+		return -1;
+	}
+	dataset->time = (double*)malloc(sizeof(double) * capacity);
+	dataset->logPopulation = (double*)malloc(sizeof(double) * capacity);
+	while (fgets(line, sizeof(line), iHandle) != NULL) {
+		double time, logPopulation;
+
+		if (line[0] == '#') {
+			if (sscanf(line, "# concentration %lg", &dataset->concentration) != 1)
+				sscanf(line, "# population %lg", &dataset->startingPopulation);
+			continue;
+		}
+		if (sscanf(line, "%lg %lg", &time, &logPopulation) != 2)
+			continue;
+		if (dataset->pointCount == capacity) {
+			capacity *= 2;
+			dataset->time = (double*)realloc(dataset->time, sizeof(double) * capacity);
+			dataset->logPopulation = (double*)realloc(dataset->logPopulation, sizeof(double) * capacity);
+		}
+		dataset->time[dataset->pointCount] = time;
+		dataset->logPopulation[dataset->pointCount++] = logPopulation;
+	}
+	fclose(iHandle);
+
+	if (dataset->pointCount == 0) {
+		fprintf(stderr, "%s holds no observations\n", fileName);
+		return -1;
+	}
+	for (i = 0; i < dataset->pointCount; ++i)
+		if (dataset->time[i] < 0.0 || (i > 0 && dataset->time[i] < dataset->time[i - 1])) {
+			fprintf(stderr, "The observation times in %s must be non-negative and ascending\n", fileName);
+			return -1;
+		}
+	if (dataset->time[dataset->pointCount - 1] > mParam->timepoints * mParam->steptime) {
+		fprintf(stderr, "The observations in %s extend beyond the simulation time\n", fileName);
+		return -1;
+	}
+
+	if (dataset->concentration < 0.0) {
+		if (!hasProfile) {
+			fprintf(stderr, "%s gives no concentration and no input file was read\n", fileName);
+			return -1;
+		}
+		dataset->mParam = mParam;
+	} else {
+		// A constant-concentration experiment has its own copy of the parameters and profile
+		double molecules = concentrationToMolecules(mParam, dataset->concentration);
+
+		dataset->mParam = (ModelParameters)malloc(sizeof(struct _ModelParameters) + sizeof(double) * (mParam->timepoints + 1));
+		*dataset->mParam = *mParam;
+		for (i = 0; i <= mParam->timepoints; ++i)
+			dataset->mParam->realantibioticconc[i] = molecules;
+	}
+	return 0;
+}
+
+/**
+ * Free the observations, parameters and integrators of a dataset.
+ *
+ * @param dataset  The dataset.
+ */
+void freeFitDataset(FitDataset dataset) {
+	free(dataset->time);
+	free(dataset->logPopulation);
+	if (dataset->concentration >= 0.0)
+		free(dataset->mParam);
+	freeSimulationIntegrator(dataset->integrator);
+	freeSimulationIntegrator(dataset->sensitivityIntegrator);
+	free(dataset->state);
+	free(dataset->simulated);
+	memset(dataset, 0, sizeof(struct _FitDataset));
+}
+
+/**
+ * Set the fitted parameters of every dataset from their logarithms. Done before the datasets are evaluated
+ * concurrently, so that the evaluations only read the parameters.
+ */
+static void setFittedParameters(FitContext context, const gsl_vector* x) {
+	int d, p;
+
+	for (d = 0; d < context->datasetCount; ++d)
+		for (p = 0; p < context->parameters->parameterCount; ++p)
+			*getModelParameterAddress(context->datasets[d].mParam, context->parameters->parameters[p]) = exp(gsl_vector_get(x, p));
+}
+
+/**
+ * Simulate a dataset and collect the log10 population at its observation times and, optionally, its derivatives with
+ * respect to the logarithms of the parameters whose sensitivities the integrator carries. The population is floored at
+ * FIT_POPULATION_FLOOR, below which the derivatives are zero.
+ *
+ * @param dataset                The dataset.
+ * @param mParam                 Model parameters for the simulation, with the concentration profile of the dataset.
+ * @param integrator             An integrator of the model, or of the model with the sensitivities if requested.
+ * @param sensitivities          The parameters whose sensitivities the integrator carries, or NULL.
+ * @param initialState           The initial state; the population is replaced by that of the dataset.
+ * @param state                  State buffer, with room for the sensitivities if requested.
+ * @param logPopulation          The simulated log10 population at every observation.
+ * @param logPopulationGradient  The derivatives of the log10 population, one row per observation, or NULL.
+ *
+ * @return                       GSL_SUCCESS, or the error code of the integrator.
+ */
+int simulateFitDataset(const FitDataset dataset, const ModelParameters mParam, SimulationIntegrator integrator,
+                       const SensitivitySelection sensitivities, const double* initialState, double* state, double* logPopulation,
+                       double* logPopulationGradient) {
+	const int dim = NUMBER_FREE_KINETIC_VARIABLES + mParam->targetMoleculeCount + 1;
+	const int parameterCount = (sensitivities != NULL) ? sensitivities->parameterCount : 0;
+	double curTime = 0.0;
+	int k, i, p;
+	int status;
+
+	memset(state, 0, sizeof(double) * dim * (parameterCount + 1));
+	memcpy(state, initialState, sizeof(double) * dim);
+	state[NUMBER_FREE_KINETIC_VARIABLES] = dataset->startingPopulation;
+	resetSimulationIntegrator(integrator);
+
+	for (k = 0; k < dataset->pointCount; ++k) {
+		double population = 0.0;
+
+		if (dataset->time[k] > curTime && (status = advanceSimulationIntegrator(integrator, &curTime, dataset->time[k], state)) != GSL_SUCCESS)
+			return status;
+		for (i = NUMBER_FREE_KINETIC_VARIABLES; i < dim; ++i)
+			population += state[i];
+		logPopulation[k] = log10(fmax(population, FIT_POPULATION_FLOOR));
+
+		// d log10(P) / d log(theta) = theta dP/dtheta / (P ln 10)
+		for (p = 0; logPopulationGradient != NULL && p < parameterCount; ++p) {
+			const double* sensitivity = state + (size_t)(p + 1) * dim;
+			double populationSensitivity = 0.0;
+
+			for (i = NUMBER_FREE_KINETIC_VARIABLES; i < dim; ++i)
+				populationSensitivity += sensitivity[i];
+			logPopulationGradient[k * parameterCount + p] = (population > FIT_POPULATION_FLOOR) ?
+				*getModelParameterAddress(mParam, sensitivities->parameters[p]) * populationSensitivity / (population * M_LN10) : 0.0;
+		}
+	}
+	return GSL_SUCCESS;
+}
+
+/**
+ * Task simulating one dataset and filling its residuals and, if requested, its rows of the Jacobian. Each dataset has
+ * its own integrators and buffers, so the tasks share only read-only data.
+ */
+static int evaluateFitDataset(const int taskIndex, const int workerIndex, void* contextPointer) {
+	FitContext context = (FitContext)contextPointer;
+	FitDataset dataset = &context->datasets[taskIndex];
+	const int parameterCount = context->parameters->parameterCount;
+	const int withJacobian = (context->jacobian != NULL);
+	int k, p;
+	int status;
+
+	if ((status = simulateFitDataset(dataset, dataset->mParam, withJacobian ? dataset->sensitivityIntegrator : dataset->integrator,
+	                                 withJacobian ? context->parameters : NULL, context->initialState, dataset->state,
+	                                 dataset->simulated, withJacobian ? dataset->simulatedGradient : NULL)) != GSL_SUCCESS)
+		return status;
+	for (k = 0; k < dataset->pointCount; ++k) {
+		const int row = context->offsets[taskIndex] + k;
+
+		gsl_vector_set(context->residuals, row, dataset->simulated[k] - dataset->logPopulation[k]);
+		for (p = 0; withJacobian && p < parameterCount; ++p)
+			gsl_matrix_set(context->jacobian, row, p, dataset->simulatedGradient[k * parameterCount + p]);
+	}
+	return GSL_SUCCESS;
+}
+
+/**
+ * gsl_multifit_nlinear residual function: the simulated minus the observed log10 CFU of every dataset.
+ */
+static int calculateFitResiduals(const gsl_vector* x, void* contextPointer, gsl_vector* f) {
+	FitContext context = (FitContext)contextPointer;
+
+	setFittedParameters(context, x);
+	context->residuals = f;
+	context->jacobian = NULL;
+	context->residualEvaluations += context->datasetCount;
+	return runParallelTasks(context->datasetCount, context->threadCount, evaluateFitDataset, context) == GSL_SUCCESS ? GSL_SUCCESS : GSL_EBADFUNC;
+}
+
+/**
+ * gsl_multifit_nlinear Jacobian function, from the forward sensitivities of the population.
+ */
+static int calculateFitJacobian(const gsl_vector* x, void* contextPointer, gsl_matrix* J) {
+	FitContext context = (FitContext)contextPointer;
+	gsl_vector* residuals = gsl_vector_alloc(J->size1);
+	int status;
+
+	setFittedParameters(context, x);
+	context->residuals = residuals;
+	context->jacobian = J;
+	context->jacobianEvaluations += context->datasetCount;
+	status = runParallelTasks(context->datasetCount, context->threadCount, evaluateFitDataset, context);
+	context->jacobian = NULL;
+	gsl_vector_free(residuals);
+	return (status == GSL_SUCCESS) ? GSL_SUCCESS : GSL_EBADFUNC;
+}
+
+/**
+ * Progress report of the iteration, printed in verbose mode.
+ */
+static void reportFitIteration(const size_t iteration, void* contextPointer, const gsl_multifit_nlinear_workspace* workspace) {
+	gsl_vector* f = gsl_multifit_nlinear_residual(workspace);
+	gsl_vector* x = gsl_multifit_nlinear_position(workspace);
+	size_t p;
+
+	printf("iteration %zu: |f| = %lg, parameters", iteration, gsl_blas_dnrm2(f));
+	for (p = 0; p < x->size; ++p)
+		printf(" %lg", exp(gsl_vector_get(x, p)));
+	printf("\n");
+}
+
+/**
+ * Fit the selected parameters to the datasets by nonlinear least squares on the log10 CFU counts. The starting values
+ * are those of the model parameters, which hold the estimates on return.
+ *
+ * @param stepper        The integrator selection.
+ * @param mParam         Model parameters for the simulation, holding the starting values.
+ * @param parameters     The parameters to fit.
+ * @param datasets       The datasets, read with readFitDataset.
+ * @param datasetCount   Number of datasets.
+ * @param initialState   The initial state; the population is replaced by that of each dataset.
+ * @param threadCount    Number of threads evaluating the datasets concurrently.
+ * @param tolerance      Relative step and gradient size at which the iteration stops.
+ * @param maxIterations  Maximum number of iterations.
+ * @param results        The estimates, their standard errors and the cost of the fit.
+ *
+ * @return               GSL_SUCCESS on convergence, GSL_EMAXITER or the error code of the solver otherwise.
+ */
+int fitModelParameters(const SimulationStepper stepper, const ModelParameters mParam, const SensitivitySelection parameters,
+                       FitDataset datasets, const int datasetCount, const double* initialState, const int threadCount,
+                       const double tolerance, const int maxIterations, FitResults results) {
+	const int dim = NUMBER_FREE_KINETIC_VARIABLES + mParam->targetMoleculeCount + 1;
+	const int parameterCount = parameters->parameterCount;
+	const int analyticJacobian = !simulationStepperNeedsJacobian(stepper);
+	struct _FitContext context;
+	gsl_multifit_nlinear_fdf fdf;
+	gsl_multifit_nlinear_parameters fdfParameters = gsl_multifit_nlinear_default_parameters();
+	gsl_multifit_nlinear_workspace* workspace = NULL;
+	gsl_vector* x = NULL;
+	gsl_matrix* covariance = NULL;
+	int* offsets = (int*)malloc(sizeof(int) * datasetCount);
+	double started = getWallClockTime();
+	int observationCount = 0;
+	int info;
+	int status = GSL_SUCCESS;
+	int d, p;
+
+	memset(results, 0, sizeof(struct _FitResults));
+	for (d = 0; d < datasetCount; ++d) {
+		offsets[d] = observationCount;
+		observationCount += datasets[d].pointCount;
+	}
+	results->observationCount = observationCount;
+	results->parameterCount = parameterCount;
+	if (parameterCount == 0 || observationCount < parameterCount) {
+		fprintf(stderr, "Fitting %d parameters needs at least as many observations, not %d\n", parameterCount, observationCount);
+		free(offsets);
+		return GSL_EINVAL;
+	}
+
+	x = gsl_vector_alloc(parameterCount);
+	for (p = 0; p < parameterCount; ++p) {
+		double value = *getModelParameterAddress(mParam, parameters->parameters[p]);
+
+		results->parameters[p] = parameters->parameters[p];
+		if (value <= 0.0) {
+			fprintf(stderr, "The starting value of parameter %c must be positive\n", getModelParameterOption(parameters->parameters[p]));
+			status = GSL_EINVAL;
+			goto cleanup;
+		}
+		gsl_vector_set(x, p, log(value));
+	}
+
+	// Integrators and state buffers are allocated once and reused by every evaluation
+	for (d = 0; d < datasetCount; ++d) {
+		FitDataset dataset = &datasets[d];
+
+		dataset->mParam->hyperGeometricMatrix = mParam->hyperGeometricMatrix;
+		dataset->state = (double*)malloc(sizeof(double) * dim * (parameterCount + 1));
+		dataset->simulated = (double*)malloc(sizeof(double) * dataset->pointCount * (parameterCount + 1));
+		dataset->simulatedGradient = dataset->simulated + dataset->pointCount;
+		dataset->integrator = allocateSimulationIntegrator(stepper, dataset->mParam, mParam->steptime);
+		if (analyticJacobian) {
+			gsl_odeiv2_system system;
+
+			dataset->sensitivitySystem.mParam = dataset->mParam;
+			dataset->sensitivitySystem.selection = parameters;
+			dataset->sensitivitySystem.modelDimension = dim;
+			system.function = (GSLDerivCalcFunc)calculateSensitivityDerivative;
+			system.jacobian = NULL;
+			system.dimension = (size_t)dim * (parameterCount + 1);
+			system.params = &dataset->sensitivitySystem;
+			dataset->sensitivityIntegrator = allocateSystemIntegrator(stepper, &system, dim, mParam->steptime);
+		}
+		if (dataset->state == NULL || dataset->simulated == NULL || dataset->integrator == NULL || (analyticJacobian && dataset->sensitivityIntegrator == NULL)) {
+			fprintf(stderr, "Could not allocate the integrators\n");
+			status = GSL_ENOMEM;
+			goto cleanup;
+		}
+	}
+
+	context.datasets = datasets;
+	context.datasetCount = datasetCount;
+	context.offsets = offsets;
+	context.parameters = parameters;
+	context.initialState = initialState;
+	context.threadCount = threadCount;
+	context.residuals = NULL;
+	context.jacobian = NULL;
+	context.residualEvaluations = 0;
+	context.jacobianEvaluations = 0;
+
+	fdf.f = calculateFitResiduals;
+	fdf.df = analyticJacobian ? calculateFitJacobian : NULL;
+	fdf.fvv = NULL;
+	fdf.n = observationCount;
+	fdf.p = parameterCount;
+	fdf.params = &context;
+
+	if ((workspace = gsl_multifit_nlinear_alloc(gsl_multifit_nlinear_trust, &fdfParameters, observationCount, parameterCount)) == NULL) {
+		status = GSL_ENOMEM;
+		goto cleanup;
+	}
+	if ((status = gsl_multifit_nlinear_init(x, &fdf, workspace)) != GSL_SUCCESS)
+		goto cleanup;
+	status = gsl_multifit_nlinear_driver(maxIterations, tolerance, tolerance, 0.0, stepper->verbose ? reportFitIteration : NULL, NULL,
+	                                     &info, workspace);
+	results->converged = (status == GSL_SUCCESS);
+	results->iterations = gsl_multifit_nlinear_niter(workspace);
+
+	// Asymptotic standard errors from the Jacobian at the estimate, carried over from the logarithms of the parameters
+	covariance = gsl_matrix_alloc(parameterCount, parameterCount);
+	gsl_multifit_nlinear_covar(gsl_multifit_nlinear_jac(workspace), 0.0, covariance);
+	results->residualSumOfSquares = pow(gsl_blas_dnrm2(gsl_multifit_nlinear_residual(workspace)), 2.0);
+	results->residualStandardDeviation = (observationCount > parameterCount) ?
+	                                     sqrt(results->residualSumOfSquares / (observationCount - parameterCount)) : 0.0;
+	for (p = 0; p < parameterCount; ++p) {
+		results->estimate[p] = exp(gsl_vector_get(gsl_multifit_nlinear_position(workspace), p));
+		results->standardError[p] = results->estimate[p] * results->residualStandardDeviation * sqrt(gsl_matrix_get(covariance, p, p));
+		*getModelParameterAddress(mParam, parameters->parameters[p]) = results->estimate[p];
+	}
+	setFittedParameters(&context, gsl_multifit_nlinear_position(workspace));
+	results->residualEvaluations = context.residualEvaluations;
+	results->jacobianEvaluations = context.jacobianEvaluations;
+
+cleanup:
+	results->wallTime = getWallClockTime() - started;
+	for (d = 0; d < datasetCount; ++d) {
+		freeSimulationIntegrator(datasets[d].integrator);
+		freeSimulationIntegrator(datasets[d].sensitivityIntegrator);
+		free(datasets[d].state);
+		free(datasets[d].simulated);
+		datasets[d].integrator = datasets[d].sensitivityIntegrator = NULL;
+		datasets[d].state = datasets[d].simulated = datasets[d].simulatedGradient = NULL;
+	}
+	if (workspace != NULL)
+		gsl_multifit_nlinear_free(workspace);
+	gsl_matrix_free(covariance);
+	gsl_vector_free(x);
+	free(offsets);
+	return status;
+}
+
+/**
+ * Print the estimates and standard errors of a fit.
+ *
+ * @param results  The outcome of the fit.
+ * @param oHandle  The file to print to.
+ */
+void printFitResults(const FitResults results, FILE* oHandle) {
+	int p;
+
+	fprintf(oHandle, "Fit %s after %d iterations, %d observations, residual standard deviation %lg log10 CFU\n",
+	        results->converged ? "converged" : "did not converge", results->iterations, results->observationCount,
+	        results->residualStandardDeviation);
+	fprintf(oHandle, "parameter estimate standardError\n");
+	for (p = 0; p < results->parameterCount; ++p)
+		fprintf(oHandle, "%c %.10lg %.4lg\n", getModelParameterOption(results->parameters[p]), results->estimate[p], results->standardError[p]);
+	fprintf(oHandle, "%lu dataset simulations, %lu with sensitivities, %lg s elapsed\n", results->residualEvaluations,
+	        results->jacobianEvaluations, results->wallTime);
+}
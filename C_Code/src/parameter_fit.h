@@ -0,0 +1,62 @@
+/**
+ * @file   parameter_fit.h
+ * @version 5
+ * @updated  2026
+ * @brief  Nonlinear least-squares fitting of the model parameters to time-kill data
+ */
+
+#define DEFAULT_FIT_TOLERANCE 1e-8      ///< Relative step and gradient size at which the Levenberg-Marquardt iteration stops
+#define DEFAULT_FIT_MAX_ITERATIONS 100  ///< Maximum number of Levenberg-Marquardt iterations
+#define FIT_POPULATION_FLOOR 1.0        ///< Smallest population, one cell, whose logarithm is compared with the data
+
+/**
+ * Structure to hold one time-kill dataset together with the integrators which simulate it
+ */
+typedef struct _FitDataset {
+	const char* fileName;         ///< The file the dataset was read from.
+	int pointCount;               ///< Number of observations.
+	double* time;                 ///< Observation times (s), ascending.
+	double* logPopulation;        ///< Observed population, log10 CFU.
+	double startingPopulation;    ///< Population at time zero.
+	double concentration;         ///< Constant drug concentration (mg/L) of the experiment, or negative to use the input profile.
+	ModelParameters mParam;       ///< Model parameters with the concentration profile of the dataset.
+	SimulationIntegrator integrator;            ///< Integrator of the model alone.
+	SimulationIntegrator sensitivityIntegrator; ///< Integrator of the model with the sensitivities of the fitted parameters.
+	struct _SensitivitySystem sensitivitySystem; ///< The augmented system of the sensitivity integrator.
+	double* state;                ///< State buffer with room for the sensitivities.
+	double* simulated;            ///< The simulated log10 population at every observation.
+	double* simulatedGradient;    ///< Its derivatives with respect to the logarithms of the fitted parameters, one row per observation.
+} *FitDataset;
+
+/**
+ * Structure to hold the outcome of a fit
+ */
+typedef struct _FitResults {
+	int converged;                                  ///< Non-zero if the iteration met the tolerance.
+	int iterations;                                 ///< Number of Levenberg-Marquardt iterations.
+	int observationCount;                           ///< Number of observations over all datasets.
+	int parameterCount;                             ///< Number of fitted parameters.
+	ModelParameterIndex parameters[MODEL_PARAMETER_COUNT]; ///< The fitted parameters.
+	double estimate[MODEL_PARAMETER_COUNT];         ///< The estimates of the fitted parameters.
+	double standardError[MODEL_PARAMETER_COUNT];    ///< Asymptotic standard errors of the estimates.
+	double residualSumOfSquares;                    ///< Sum of squared residuals, (log10 CFU)^2.
+	double residualStandardDeviation;               ///< Standard deviation of the residuals, log10 CFU.
+	unsigned long residualEvaluations;              ///< Number of evaluations of the residuals over all datasets.
+	unsigned long jacobianEvaluations;              ///< Number of evaluations of the Jacobian over all datasets.
+	double wallTime;                                ///< Elapsed time of the fit in seconds.
+} *FitResults;
+
+int readFitDataset(const char* fileName, const ModelParameters mParam, const int hasProfile, const double startingPopulation,
+                   FitDataset dataset);
+
+void freeFitDataset(FitDataset dataset);
+
+int simulateFitDataset(const FitDataset dataset, const ModelParameters mParam, SimulationIntegrator integrator,
+                       const SensitivitySelection sensitivities, const double* initialState, double* state, double* logPopulation,
+                       double* logPopulationGradient);
+
+int fitModelParameters(const SimulationStepper stepper, const ModelParameters mParam, const SensitivitySelection parameters,
+                       FitDataset datasets, const int datasetCount, const double* initialState, const int threadCount,
+                       const double tolerance, const int maxIterations, FitResults results);
+
+void printFitResults(const FitResults results, FILE* oHandle);
@@ -0,0 +1,447 @@
+/**
+ * @file   parareal.c
+ * @version 5
+ * @updated  2026
+ * @brief  Parallel-in-time (Parareal) integration of long simulations
+ *
+ * The simulated time is split into slices of whole output intervals. A cheap coarse propagator $G$ sweeps sequentially
+ * over the slices to guess the state at the start of each, then the selected integrator, the fine propagator $F$, runs
+ * over all slices concurrently from those guesses. Each iteration corrects the start states with
+ * $U_{s+1} = G(U_s^{new}) + F(U_s^{old}) - G(U_s^{old})$ and repeats the concurrent fine sweep until the start states stop
+ * changing. After $k$ iterations the first $k$ slices are exact, so the iteration never takes more than one fine sweep
+ * per slice; the gain comes from converging in a few iterations.
+ *
+ * The coarse propagator is the linearly implicit Euler method with the analytic model Jacobian and large steps, which
+ * is stable on the fast binding time scale that limits the explicit integrators.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <gsl/gsl_odeiv2.h>
+#include <gsl/gsl_errno.h>
+#include "full_model.h"
+#include "fixed_step.h"
+#include "positive_step.h"
+#include "sensitivity.h"
+#include "base_simulation.h"
+#include "parallel_runner.h"
+#include "trajectory_file.h"
+#include "parareal.h"
+
+/**
+ * Workspace of the coarse propagator
+ */
+typedef struct _CoarsePropagator {
+	ModelParameters mParam; ///< Model parameters of the system.
+	int dim;                ///< Size of the state vector.
+	double stepSize;        ///< Largest coarse step.
+	double* derivative;     ///< The derivative at the start of a step.
+	double* jacobian;       ///< The dense Jacobian at the start of a step.
+	double* timeDerivative; ///< The time derivative of the Jacobian function, unused.
+	double* system;         ///< The compartment block of $I - hJ$, reduced to upper triangular form.
+	double* increment;      ///< The right-hand side $hf$ and the solved increment.
+	unsigned long stepCount; ///< Number of coarse steps taken.
+} *CoarsePropagator;
+
+/**
+ * State shared by the fine propagator tasks of one sweep
+ */
+typedef struct _PararealSweep {
+	SimulationIntegrator* integrators; ///< One integrator per worker.
+	const double* tickTimes;  ///< The output times.
+	const int* sliceTicks;    ///< The first tick of each slice, and the last tick after the last slice.
+	double* tickStates;       ///< The fine state at every tick, one row per tick.
+	const double* starts;     ///< The start state of each slice.
+	double* fineEnds;         ///< The fine state at the end of each slice.
+	double* sliceTimes;       ///< Processor time of the fine propagation of each slice.
+	unsigned long* acceptedSteps; ///< Steps accepted by the integrator of each worker over its slices.
+	unsigned long* rejectedSteps; ///< Steps rejected by the integrator of each worker over its slices.
+	int firstSlice;           ///< The first slice which is not yet exact.
+	int dim;                  ///< Size of the state vector.
+} *PararealSweep;
+
+/**
+ * Processor time of the calling thread in seconds, which unlike the elapsed time does not grow when the threads
+ * outnumber the processors.
+ */
+static double threadClock(void) {
+	struct timespec now;
+
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+	return now.tv_sec + 1e-9 * now.tv_nsec;
+}
+
+static CoarsePropagator allocateCoarsePropagator(const ModelParameters mParam, const double stepSize) {
+	CoarsePropagator coarse = (CoarsePropagator)malloc(sizeof(struct _CoarsePropagator));
+	int dim = NUMBER_FREE_KINETIC_VARIABLES + mParam->targetMoleculeCount + 1;
+	int compartments = mParam->targetMoleculeCount + 1;
+
+	coarse->mParam = mParam;
+	coarse->dim = dim;
+	coarse->stepSize = stepSize;
+	coarse->derivative = malloc(sizeof(double) * dim);
+	coarse->jacobian = malloc(sizeof(double) * dim * dim);
+	coarse->timeDerivative = malloc(sizeof(double) * dim);
+	coarse->system = malloc(sizeof(double) * compartments * compartments);
+	coarse->increment = malloc(sizeof(double) * dim);
+	coarse->stepCount = 0;
+	return coarse;
+}
+
+static void freeCoarsePropagator(CoarsePropagator coarse) {
+	free(coarse->increment);
+	free(coarse->system);
+	free(coarse->timeDerivative);
+	free(coarse->jacobian);
+	free(coarse->derivative);
+	free(coarse);
+}
+
+/**
+ * Apply the coarse propagator over one slice with equal linearly implicit Euler steps $(I - hW)\Delta y = hf(y)$, keeping
+ * the state non-negative.
+ *
+ * $W$ is the model Jacobian without the rank-one coupling of the slow logistic term, which leaves the compartment block
+ * upper Hessenberg: binding only moves cells up one compartment and replication only moves them down. The free target
+ * and free bound complex do not feed back into the compartments, so after the compartments are solved by elimination
+ * without pivoting (the matrix is an M-matrix) they follow from a 2x2 system. A step costs $O(n^2)$ rather than the
+ * $O(n^3)$ of a dense solve, which keeps the sequential coarse sweeps cheap next to the fine slices.
+ *
+ * @param coarse     The coarse propagator.
+ * @param startTime  The start of the slice.
+ * @param endTime    The end of the slice.
+ * @param initial    The state at the start of the slice.
+ * @param final      Output state at the end of the slice.
+ *
+ * @return           GSL_SUCCESS, or GSL_ESING if a step matrix was singular.
+ */
+static int applyCoarsePropagator(CoarsePropagator coarse, const double startTime, const double endTime, const double* initial, double* final) {
+	const int dim = coarse->dim;
+	const int offset = NUMBER_FREE_KINETIC_VARIABLES;
+	const int compartments = dim - offset;
+	const double* jacobian = coarse->jacobian;
+	double* system = coarse->system;
+	double* increment = coarse->increment;
+	int stepCount = (int)ceil((endTime - startTime) / coarse->stepSize - 1e-9);
+	double h;
+	int step, i, j;
+
+	if (stepCount < 1)
+		stepCount = 1;
+	h = (endTime - startTime) / stepCount;
+	memcpy(final, initial, sizeof(double) * dim);
+
+	for (step = 0; step < stepCount; ++step) {
+		double t = startTime + step * h;
+		double a00, a01, a10, a11, b0, b1, determinant;
+
+		calculateModelDerivative_BindingOnly(t, (ModelVariables)final, (ModelVariables)coarse->derivative, coarse->mParam);
+		calculateModelJacobian_BindingOnly(t, (ModelVariables)final, coarse->jacobian, coarse->timeDerivative, coarse->mParam);
+		for (i = 0; i < dim; ++i)
+			increment[i] = h * coarse->derivative[i];
+
+		// Compartments: the upper Hessenberg part of $I - hJ$, reduced row by row
+		for (i = 0; i < compartments; ++i) {
+			const double* row = jacobian + (offset + i) * dim + offset;
+			double* systemRow = system + i * compartments;
+			for (j = (i > 0) ? i - 1 : 0; j < compartments; ++j)
+				systemRow[j] = -h * row[j];
+			systemRow[i] += 1.0;
+			if (i > 0) {
+				const double* pivotRow = systemRow - compartments;
+				double factor;
+				if (pivotRow[i - 1] == 0.0)
+					return GSL_ESING;
+				factor = systemRow[i - 1] / pivotRow[i - 1];
+				for (j = i; j < compartments; ++j)
+					systemRow[j] -= factor * pivotRow[j];
+				increment[offset + i] -= factor * increment[offset + i - 1];
+			}
+		}
+		for (i = compartments - 1; i >= 0; --i) {
+			const double* systemRow = system + i * compartments;
+			double sum = increment[offset + i];
+			if (systemRow[i] == 0.0)
+				return GSL_ESING;
+			for (j = i + 1; j < compartments; ++j)
+				sum -= systemRow[j] * increment[offset + j];
+			increment[offset + i] = sum / systemRow[i];
+		}
+
+		// Free target and free bound complex, given the compartment increment
+		a00 = 1.0 - h * jacobian[0];
+		a01 = -h * jacobian[1];
+		a10 = -h * jacobian[dim];
+		a11 = 1.0 - h * jacobian[dim + 1];
+		b0 = increment[0];
+		b1 = increment[1];
+		for (j = 0; j < compartments; ++j) {
+			b0 += h * jacobian[offset + j] * increment[offset + j];
+			b1 += h * jacobian[dim + offset + j] * increment[offset + j];
+		}
+		determinant = a00 * a11 - a01 * a10;
+		if (determinant == 0.0)
+			return GSL_ESING;
+		increment[0] = (a11 * b0 - a01 * b1) / determinant;
+		increment[1] = (a00 * b1 - a10 * b0) / determinant;
+
+		for (i = 0; i < dim; ++i)
+			final[i] = fmax(final[i] + increment[i], 0.0);
+		++coarse->stepCount;
+	}
+	return GSL_SUCCESS;
+}
+
+/**
+ * Parallel task: apply the fine propagator over one slice, keeping the state at every tick for the output.
+ */
+static int applyFinePropagator(const int taskIndex, const int workerIndex, void* context) {
+	PararealSweep sweep = (PararealSweep)context;
+	const int slice = sweep->firstSlice + taskIndex;
+	const int dim = sweep->dim;
+	SimulationIntegrator integrator = sweep->integrators[workerIndex];
+	double* state = sweep->fineEnds + (size_t)slice * dim;
+	double curTime = sweep->tickTimes[sweep->sliceTicks[slice]];
+	double started = threadClock();
+	unsigned long accepted, rejected;
+	int tick;
+	int status = GSL_SUCCESS;
+
+	memcpy(state, sweep->starts + (size_t)slice * dim, sizeof(double) * dim);
+	resetSimulationIntegrator(integrator);
+	for (tick = sweep->sliceTicks[slice] + 1; tick <= sweep->sliceTicks[slice + 1]; ++tick) {
+		if ((status = advanceSimulationIntegrator(integrator, &curTime, sweep->tickTimes[tick], state)) != GSL_SUCCESS)
+			break;
+		memcpy(sweep->tickStates + (size_t)tick * dim, state, sizeof(double) * dim);
+	}
+	// The reset of the next slice clears the step counts of the integrator
+	getSimulationIntegratorStepCounts(integrator, &accepted, &rejected);
+	sweep->acceptedSteps[workerIndex] += accepted;
+	sweep->rejectedSteps[workerIndex] += rejected;
+	sweep->sliceTimes[slice] = threadClock() - started;
+	return status;
+}
+
+/**
+ * Relative change between two states, $\frac{\|a - b\|_\infty}{1 + \|b\|_\infty}$.
+ */
+static double relativeChange(const double* a, const double* b, const int dim) {
+	double maxChange = 0.0;
+	double maxState = 0.0;
+	int i;
+
+	for (i = 0; i < dim; ++i) {
+		maxChange = fmax(maxChange, fabs(a[i] - b[i]));
+		maxState = fmax(maxState, fabs(b[i]));
+	}
+	return maxChange / (1.0 + maxState);
+}
+
+/**
+ * Run the simulation with Parareal over the same output times as runSimulation, and output the trajectory in the same
+ * format once the iteration has converged.
+ *
+ * @param stepper          The integrator selection for the fine propagator.
+ * @param mParam           Model parameters for the simulation, shared read-only by all threads.
+ * @param startTime        The time at which the initial conditions are given.
+ * @param endTime          The time to run the simulation until.
+ * @param timeInterval     The amount of time between data-points.
+ * @param sliceCount       The number of time slices; capped at the number of output intervals.
+ * @param threadCount      The number of threads running fine propagators.
+ * @param coarseStepSize   The largest step of the coarse propagator, or zero for DEFAULT_PARAREAL_COARSE_STEPS per slice.
+ * @param tolerance        The relative change of the slice start states at which the iteration stops.
+ * @param maxIterations    The maximum number of iterations.
+ * @param stateVector      Initial starting conditions as input and final conditions as output.
+ * @param results          The simulation results to fill, as by runSimulation.
+ * @param pararealResults  The iteration counts and timings to fill.
+ * @param trajectory       The trajectory file, or NULL for no trajectory output.
+ *
+ * @return                 GSL_SUCCESS if everything went well, GSL_EMAXITER if the iteration did not converge (the output
+ *                         is then that of the last iteration), otherwise the GSL error code.
+ */
+int runPararealSimulation(const SimulationStepper stepper, const ModelParameters mParam, const double startTime, const double endTime,
+                          const double timeInterval, const int sliceCount, const int threadCount, const double coarseStepSize,
+                          const double tolerance, const int maxIterations, double* stateVector, SimulationResults results,
+                          PararealResults pararealResults, struct _TrajectoryWriter* trajectory) {
+	const int dim = NUMBER_FREE_KINETIC_VARIABLES + mParam->targetMoleculeCount + 1;
+	const long totalTimePoints = countSimulationTicks(startTime, endTime, timeInterval);
+	double* tickTimes = malloc(sizeof(double) * totalTimePoints);
+	double* tickStates = NULL;
+	double* starts = NULL;
+	double* coarseEnds = NULL;
+	double* fineEnds = NULL;
+	double* sliceTimes = NULL;
+	double* coarse = malloc(sizeof(double) * dim);
+	int* sliceTicks = NULL;
+	SimulationIntegrator* integrators = NULL;
+	unsigned long* acceptedSteps = NULL;
+	unsigned long* rejectedSteps = NULL;
+	CoarsePropagator coarsePropagator = NULL;
+	struct _PararealSweep sweep;
+	double nextTime = startTime + timeInterval;
+	double started = getWallClockTime();
+	int lastTick = 0;
+	int slices;
+	int workers;
+	int status = GSL_SUCCESS;
+	int s, i;
+
+	// The output times, accumulated exactly as in runSimulation
+	tickTimes[0] = startTime;
+	while (nextTime < endTime) {
+		tickTimes[++lastTick] = nextTime;
+		nextTime += timeInterval;
+	}
+	slices = (sliceCount < lastTick) ? sliceCount : lastTick;
+	if (slices < 1)
+		slices = 1;
+	workers = (threadCount < slices) ? threadCount : slices;
+	if (workers < 1)
+		workers = 1;
+
+	pararealResults->converged = 0;
+	pararealResults->iterations = 0;
+	pararealResults->sliceCount = slices;
+	pararealResults->threadCount = workers;
+	pararealResults->correction = 0.0;
+	pararealResults->fineSliceIntegrations = 0;
+	pararealResults->coarseSteps = 0;
+	pararealResults->serialFineTime = 0.0;
+
+	results->acceptedSteps = 0;
+	results->rejectedSteps = 0;
+	if (reserveSimulationResults(results, totalTimePoints) != GSL_SUCCESS) {
+		status = GSL_ENOMEM;
+		goto cleanup;
+	}
+
+	// Slices of whole output intervals, as equal as possible
+	sliceTicks = malloc(sizeof(int) * (slices + 1));
+	for (s = 0; s <= slices; ++s)
+		sliceTicks[s] = (int)((long)s * lastTick / slices);
+
+	tickStates = malloc(sizeof(double) * (size_t)(lastTick + 1) * dim);
+	starts = malloc(sizeof(double) * (size_t)(slices + 1) * dim);
+	coarseEnds = malloc(sizeof(double) * (size_t)slices * dim);
+	fineEnds = malloc(sizeof(double) * (size_t)slices * dim);
+	sliceTimes = calloc(slices, sizeof(double));
+	integrators = calloc(workers, sizeof(SimulationIntegrator));
+	acceptedSteps = calloc(workers, sizeof(unsigned long));
+	rejectedSteps = calloc(workers, sizeof(unsigned long));
+	for (i = 0; i < workers; ++i)
+		if ((integrators[i] = allocateSimulationIntegrator(stepper, mParam, timeInterval)) == NULL) {
+			fprintf(stderr, "Could not allocate the integrator\n");
+			status = GSL_ENOMEM;
+			goto cleanup;
+		}
+	coarsePropagator = allocateCoarsePropagator(mParam, (coarseStepSize > 0.0) ? coarseStepSize :
+	                                            (tickTimes[lastTick] - startTime) / slices / DEFAULT_PARAREAL_COARSE_STEPS);
+
+	memcpy(tickStates, stateVector, sizeof(double) * dim);
+	memcpy(starts, stateVector, sizeof(double) * dim);
+
+	// Initial coarse sweep
+	for (s = 0; s < slices; ++s) {
+		if ((status = applyCoarsePropagator(coarsePropagator, tickTimes[sliceTicks[s]], tickTimes[sliceTicks[s + 1]],
+		                                    starts + (size_t)s * dim, coarseEnds + (size_t)s * dim)) != GSL_SUCCESS)
+			goto cleanup;
+		memcpy(starts + (size_t)(s + 1) * dim, coarseEnds + (size_t)s * dim, sizeof(double) * dim);
+	}
+
+	sweep.integrators = integrators;
+	sweep.tickTimes = tickTimes;
+	sweep.sliceTicks = sliceTicks;
+	sweep.tickStates = tickStates;
+	sweep.starts = starts;
+	sweep.fineEnds = fineEnds;
+	sweep.sliceTimes = sliceTimes;
+	sweep.acceptedSteps = acceptedSteps;
+	sweep.rejectedSteps = rejectedSteps;
+	sweep.dim = dim;
+
+	for (sweep.firstSlice = 0; sweep.firstSlice < slices; ++sweep.firstSlice) {
+		// Fine propagation of the slices which are not yet exact, concurrently
+		if ((status = runParallelTasks(slices - sweep.firstSlice, workers, applyFinePropagator, &sweep)) != GSL_SUCCESS)
+			goto cleanup;
+		pararealResults->fineSliceIntegrations += slices - sweep.firstSlice;
+		if (sweep.firstSlice == 0)
+			for (s = 0; s < slices; ++s)
+				pararealResults->serialFineTime += sliceTimes[s];
+		++pararealResults->iterations;
+
+		// Sequential correction of the start states; the first slice started from an exact state, so its end is exact
+		pararealResults->correction = relativeChange(fineEnds + (size_t)sweep.firstSlice * dim, starts + (size_t)(sweep.firstSlice + 1) * dim, dim);
+		memcpy(starts + (size_t)(sweep.firstSlice + 1) * dim, fineEnds + (size_t)sweep.firstSlice * dim, sizeof(double) * dim);
+		for (s = sweep.firstSlice + 1; s < slices; ++s) {
+			double* next = starts + (size_t)(s + 1) * dim;
+			double* coarseEnd = coarseEnds + (size_t)s * dim;
+			double* fineEnd = fineEnds + (size_t)s * dim;
+
+			if ((status = applyCoarsePropagator(coarsePropagator, tickTimes[sliceTicks[s]], tickTimes[sliceTicks[s + 1]],
+			                                    starts + (size_t)s * dim, coarse)) != GSL_SUCCESS)
+				goto cleanup;
+			for (i = 0; i < dim; ++i) {
+				double corrected = coarse[i] + fineEnd[i] - coarseEnd[i];
+				coarseEnd[i] = coarse[i];
+				fineEnd[i] = next[i];
+				next[i] = corrected;
+			}
+			pararealResults->correction = fmax(pararealResults->correction, relativeChange(next, fineEnd, dim));
+		}
+		if (stepper->verbose)
+			printf("Parareal iteration %d: largest relative correction %lg\n", pararealResults->iterations, pararealResults->correction);
+		if (pararealResults->correction <= tolerance) {
+			pararealResults->converged = 1;
+			break;
+		}
+		if (pararealResults->iterations >= maxIterations) {
+			status = GSL_EMAXITER;
+			break;
+		}
+	}
+	if (sweep.firstSlice >= slices)
+		pararealResults->converged = 1;
+
+	// The trajectory of the last fine sweep, in the output format of runSimulation
+	if (trajectory != NULL && expectTrajectoryRows(trajectory, lastTick + 1) != 0) {
+		status = GSL_ENOMEM;
+		goto cleanup;
+	}
+	for (i = 0; i <= lastTick; ++i)
+		updateSimulationResultsPerTick(mParam, (ModelVariables)(tickStates + (size_t)i * dim), tickTimes[i], i, results, trajectory, stepper->verbose);
+	if (stepper->verbose)
+		printf("\n\n");
+	memcpy(stateVector, tickStates + (size_t)lastTick * dim, sizeof(double) * dim);
+
+cleanup:
+	for (i = 0; integrators != NULL && i < workers; ++i)
+		if (integrators[i] != NULL) {
+			if (acceptedSteps != NULL && rejectedSteps != NULL) {
+				results->acceptedSteps += acceptedSteps[i];
+				results->rejectedSteps += rejectedSteps[i];
+			}
+			freeSimulationIntegrator(integrators[i]);
+		}
+	if (coarsePropagator != NULL) {
+		pararealResults->coarseSteps = coarsePropagator->stepCount;
+		freeCoarsePropagator(coarsePropagator);
+	}
+	pararealResults->wallTime = getWallClockTime() - started;
+	pararealResults->speedup = (pararealResults->wallTime > 0.0) ? pararealResults->serialFineTime / pararealResults->wallTime : 0.0;
+	free(integrators);
+	free(rejectedSteps);
+	free(acceptedSteps);
+	free(sliceTimes);
+	free(fineEnds);
+	free(coarseEnds);
+	free(starts);
+	free(tickStates);
+	free(sliceTicks);
+	free(coarse);
+	free(tickTimes);
+
+	return status;
+}
@@ -0,0 +1,31 @@
+/**
+ * @file   parareal.h
+ * @version 5
+ * @updated  2026
+ * @brief  Parallel-in-time (Parareal) integration of long simulations
+ */
+
+#define DEFAULT_PARAREAL_TOLERANCE 1e-6      ///< Relative change of the slice start states at which the iteration stops
+#define DEFAULT_PARAREAL_MAX_ITERATIONS 10   ///< Maximum number of Parareal iterations
+#define DEFAULT_PARAREAL_COARSE_STEPS 16     ///< Number of coarse steps per slice when no coarse step size is given
+
+/**
+ * Structure to hold the outcome and cost of a Parareal integration
+ */
+typedef struct _PararealResults {
+	int converged;                       ///< Non-zero if the slice start states stopped changing within the tolerance.
+	int iterations;                      ///< Number of Parareal iterations, each one concurrent sweep of fine propagators.
+	int sliceCount;                      ///< Number of time slices.
+	int threadCount;                     ///< Number of threads running the fine propagators.
+	double correction;                   ///< Largest relative change of a slice start state in the last iteration.
+	unsigned long fineSliceIntegrations; ///< Number of fine propagations of one slice.
+	unsigned long coarseSteps;           ///< Number of steps of the coarse propagator.
+	double wallTime;                     ///< Elapsed time of the whole integration in seconds.
+	double serialFineTime;               ///< Processor time of the fine propagations over all slices in the first sweep, i.e. the cost of a serial fine run.
+	double speedup;                      ///< Ratio of the serial fine time to the elapsed time.
+} *PararealResults;
+
+int runPararealSimulation(const SimulationStepper stepper, const ModelParameters mParam, const double startTime, const double endTime,
+                          const double timeInterval, const int sliceCount, const int threadCount, const double coarseStepSize,
+                          const double tolerance, const int maxIterations, double* stateVector, SimulationResults results,
+                          PararealResults pararealResults, struct _TrajectoryWriter* trajectory);
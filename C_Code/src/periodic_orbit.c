@@ -0,0 +1,348 @@
+/**
+ * @file   periodic_orbit.c
+ * @version 5
+ * @updated  2026
+ * @brief  Shooting-Newton solver for the periodic steady state of repeated dosing regimens
+ *
+ * For a dosing regimen with period $T$ the state at the start of a dosing interval on the periodic orbit is a fixed
+ * point of the period map $P$, which integrates the model from $t_0$ to $t_0 + T$. The fixed point is found with a
+ * damped Newton iteration on $P(x) - x = 0$. The Jacobian of the period map, the monodromy matrix, is the fundamental
+ * matrix of the variational equations $\dot\Phi = J(t, y)\Phi$, $\Phi(t_0) = I$, integrated over the period together
+ * with the model through the Jacobian-vector product of the model. Unlike finite differences of perturbed integrations,
+ * it carries no noise from the step control of an adaptive integrator. The eigenvalues of the monodromy matrix at the
+ * fixed point are the Floquet multipliers of the orbit, which is stable if they all lie inside the unit circle.
+ *
+ * Only the intracellular compartments take part in the fixed point. The free target and free bound complex are fed by
+ * dead cells and never feed back into the compartments, so with any killing they drift by a constant amount every
+ * period and have no periodic state; their drift over one period is reported instead.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <gsl/gsl_odeiv2.h>
+#include <gsl/gsl_errno.h>
+#include <gsl/gsl_math.h>
+#include <gsl/gsl_vector.h>
+#include <gsl/gsl_matrix.h>
+#include <gsl/gsl_linalg.h>
+#include <gsl/gsl_eigen.h>
+#include "full_model.h"
+#include "fixed_step.h"
+#include "positive_step.h"
+#include "sensitivity.h"
+#include "base_simulation.h"
+#include "periodic_orbit.h"
+
+#define PERIODIC_MAX_BACKTRACKS 10 ///< Maximum number of step halvings in the Newton line search
+
+/**
+ * The model augmented with the columns of its fundamental matrix, one per compartment, passed to the integrator as the
+ * system parameters. The state holds the model state followed by the columns.
+ */
+typedef struct _VariationalSystem {
+	ModelParameters mParam;   ///< Model parameters for the simulation.
+	int modelDimension;       ///< Size of the model state vector.
+	int columnCount;          ///< Number of columns of the fundamental matrix.
+} *VariationalSystem;
+
+/**
+ * gsl_odeiv2_system function of the model and its variational equations, $\dot\Phi = J(t, y)\Phi$.
+ *
+ * @param curTime  The current time-point.
+ * @param y        The model state followed by the columns of the fundamental matrix.
+ * @param dydt     The output derivative of the model state and of the columns.
+ * @param system   The augmented system.
+ *
+ * @return         GSL_SUCCESS, or the error code of the model functions.
+ */
+static int calculateVariationalDerivative(double curTime, const double* y, double* dydt, VariationalSystem system) {
+	const int dim = system->modelDimension;
+	int c;
+	int status;
+
+	if ((status = calculateModelDerivative_BindingOnly(curTime, (ModelVariables)y, (ModelVariables)dydt, system->mParam)) != GSL_SUCCESS)
+		return status;
+	for (c = 0; c < system->columnCount; ++c)
+		if ((status = calculateModelJacobianProduct_BindingOnly(curTime, (ModelVariables)y, y + (size_t)(c + 1) * dim,
+		                                                        dydt + (size_t)(c + 1) * dim, system->mParam)) != GSL_SUCCESS)
+			return status;
+	return GSL_SUCCESS;
+}
+
+/**
+ * Apply the period map to a full state vector.
+ *
+ * @param integrator  The integrator, which is reset before the integration.
+ * @param startTime   The start of the dosing interval.
+ * @param period      The length of the dosing interval.
+ * @param initial     The state at the start of the interval.
+ * @param final       Output state at the end of the interval.
+ * @param systemSize  The length of the state vectors.
+ *
+ * @return            GSL_SUCCESS or the error code of the integrator.
+ */
+static int applyPeriodMap(SimulationIntegrator integrator, const double startTime, const double period, const double* initial,
+                          double* final, const int systemSize) {
+	double curTime = startTime;
+
+	memcpy(final, initial, sizeof(double) * systemSize);
+	resetSimulationIntegrator(integrator);
+	return advanceSimulationIntegrator(integrator, &curTime, startTime + period, final);
+}
+
+/**
+ * Integrate the model and its variational equations over one period, giving the monodromy matrix of the compartments:
+ * column $j$ is the derivative of the compartments at the end of the period with respect to compartment $j$ at its start.
+ *
+ * @param integrator    The integrator of the augmented system, which is reset before the integration.
+ * @param startTime     The start of the dosing interval.
+ * @param period        The length of the dosing interval.
+ * @param initial       The state at the start of the interval.
+ * @param augmented     Buffer of the augmented state, of systemSize times (compartments + 1) values.
+ * @param monodromy     Output monodromy matrix, compartments by compartments.
+ * @param systemSize    The length of the model state vector.
+ *
+ * @return              GSL_SUCCESS or the error code of the integrator.
+ */
+static int applyVariationalPeriodMap(SimulationIntegrator integrator, const double startTime, const double period, const double* initial,
+                                     double* augmented, gsl_matrix* monodromy, const int systemSize) {
+	const int offset = NUMBER_FREE_KINETIC_VARIABLES;
+	const int compartments = (int)monodromy->size1;
+	double curTime = startTime;
+	int i, j;
+	int status;
+
+	memset(augmented, 0, sizeof(double) * systemSize * (compartments + 1));
+	memcpy(augmented, initial, sizeof(double) * systemSize);
+	for (j = 0; j < compartments; ++j)
+		augmented[(size_t)(j + 1) * systemSize + offset + j] = 1.0;
+	resetSimulationIntegrator(integrator);
+	if ((status = advanceSimulationIntegrator(integrator, &curTime, startTime + period, augmented)) != GSL_SUCCESS)
+		return status;
+	for (j = 0; j < compartments; ++j)
+		for (i = 0; i < compartments; ++i)
+			gsl_matrix_set(monodromy, i, j, augmented[(size_t)(j + 1) * systemSize + offset + i]);
+	return GSL_SUCCESS;
+}
+
+/**
+ * Calculate the relative residual of the compartments over one period, i.e. $\frac{\|P(x) - x\|_\infty}{1 + \|x\|_\infty}$.
+ */
+static double periodResidual(const double* initial, const double* final, const int offset, const int compartments, double* residual) {
+	double maxResidual = 0.0;
+	double maxState = 0.0;
+	int i;
+
+	for (i = 0; i < compartments; ++i) {
+		residual[i] = final[offset + i] - initial[offset + i];
+		maxResidual = fmax(maxResidual, fabs(residual[i]));
+		maxState = fmax(maxState, fabs(initial[offset + i]));
+	}
+	return maxResidual / (1.0 + maxState);
+}
+
+/**
+ * Ordering of complex multipliers by decreasing modulus, for qsort.
+ */
+static int compareMultipliers(const void* a, const void* b) {
+	const double* za = (const double*)a;
+	const double* zb = (const double*)b;
+	double moduli = hypot(zb[0], zb[1]) - hypot(za[0], za[1]);
+
+	return (moduli > 0.0) - (moduli < 0.0);
+}
+
+/**
+ * Find the state at the start of a dosing interval which reproduces itself after one period.
+ *
+ * @param stepper        The integrator selection, an explicit one as the variational equations have no Jacobian.
+ * @param mParam         Model parameters for the simulation; the concentration profile must cover the interval.
+ * @param startTime      The start of the dosing interval used as the period.
+ * @param period         The length of the dosing interval.
+ * @param timeInterval   The amount of time between data-points, used for the initial step of the integrator.
+ * @param tolerance      The relative residual at which the orbit is accepted.
+ * @param maxIterations  The maximum number of Newton iterations.
+ * @param stateVector    The initial conditions at time zero as input, which integrated to the start of the interval are
+ *                       the first guess, and the state on the orbit at the start of the interval as output.
+ * @param results        The results structure to fill. The multipliers are allocated and owned by the caller.
+ *
+ * @return               GSL_SUCCESS if the orbit was found, GSL_EMAXITER if Newton did not converge, GSL_ENOPROG if the
+ *                       line search could not reduce the residual, GSL_ESING if the Newton system was singular,
+ *                       GSL_EINVAL for an implicit stepper, otherwise the error code of the integrator. On GSL_EMAXITER
+ *                       and GSL_ENOPROG the state vector holds the best iterate.
+ */
+int findPeriodicOrbit(const SimulationStepper stepper, const ModelParameters mParam, const double startTime, const double period,
+                      const double timeInterval, const double tolerance, const int maxIterations, double* stateVector,
+                      PeriodicOrbitResults results) {
+	const int systemSize = NUMBER_FREE_KINETIC_VARIABLES + mParam->targetMoleculeCount + 1;
+	const int offset = NUMBER_FREE_KINETIC_VARIABLES;
+	const int compartments = mParam->targetMoleculeCount + 1;
+	double* mapped = malloc(sizeof(double) * systemSize);
+	double* perturbed = malloc(sizeof(double) * systemSize);
+	double* perturbedMapped = malloc(sizeof(double) * systemSize);
+	double* trial = malloc(sizeof(double) * systemSize);
+	double* augmented = malloc(sizeof(double) * systemSize * (compartments + 1));
+	gsl_vector* residual = gsl_vector_alloc(compartments);
+	gsl_vector* newtonStep = gsl_vector_alloc(compartments);
+	gsl_matrix* monodromy = gsl_matrix_alloc(compartments, compartments);
+	gsl_matrix* newtonMatrix = gsl_matrix_alloc(compartments, compartments);
+	gsl_permutation* permutation = gsl_permutation_alloc(compartments);
+	SimulationIntegrator integrator = allocateSimulationIntegrator(stepper, mParam, timeInterval);
+	SimulationIntegrator variationalIntegrator = NULL;
+	struct _VariationalSystem variational = { .mParam = mParam, .modelDimension = systemSize, .columnCount = compartments };
+	gsl_odeiv2_system variationalSystem;
+	double relativeResidual;
+	int status = GSL_SUCCESS;
+	int i;
+
+	results->converged = 0;
+	results->iterations = 0;
+	results->residual = NAN;
+	results->freeTargetDrift = NAN;
+	results->freeBoundComplexDrift = NAN;
+	results->periodIntegrations = 0;
+	results->multiplierCount = 0;
+	results->multipliers = NULL;
+	results->spectralRadius = 0.0;
+
+	// The augmented system has no Jacobian for the implicit GSL steppers
+	if (simulationStepperNeedsJacobian(stepper)) {
+		fprintf(stderr, "The periodic orbit needs an explicit stepping function\n");
+		status = GSL_EINVAL;
+		goto cleanup;
+	}
+	variationalSystem.function = (GSLDerivCalcFunc)calculateVariationalDerivative;
+	variationalSystem.jacobian = NULL;
+	variationalSystem.dimension = (size_t)systemSize * (compartments + 1);
+	variationalSystem.params = &variational;
+	// Only the model state is kept non-negative by the positivity-preserving integrator
+	variationalIntegrator = allocateSystemIntegrator(stepper, &variationalSystem, systemSize, timeInterval);
+	if (integrator == NULL || variationalIntegrator == NULL || augmented == NULL) {
+		status = GSL_ENOMEM;
+		goto cleanup;
+	}
+
+	// The first guess is the state reached from the initial conditions at the start of the interval
+	if (startTime > 0.0) {
+		double curTime = 0.0;
+		if ((status = advanceSimulationIntegrator(integrator, &curTime, startTime, stateVector)) != GSL_SUCCESS)
+			goto cleanup;
+	}
+
+	for (;;) {
+		int signum;
+		int backtracks;
+		double lambda;
+
+		// Residual of the period map at the current iterate
+		if ((status = applyPeriodMap(integrator, startTime, period, stateVector, mapped, systemSize)) != GSL_SUCCESS)
+			goto cleanup;
+		++results->periodIntegrations;
+		relativeResidual = periodResidual(stateVector, mapped, offset, compartments, residual->data);
+
+		// Monodromy matrix from the variational equations over the same period
+		if ((status = applyVariationalPeriodMap(variationalIntegrator, startTime, period, stateVector, augmented, monodromy,
+		                                        systemSize)) != GSL_SUCCESS)
+			goto cleanup;
+		++results->periodIntegrations;
+
+		if (stepper->verbose)
+			printf("Periodic orbit iteration %d: relative residual %lg\n", results->iterations, relativeResidual);
+		if (relativeResidual <= tolerance) {
+			results->converged = 1;
+			break;
+		}
+		if (results->iterations >= maxIterations) {
+			status = GSL_EMAXITER;
+			break;
+		}
+		++results->iterations;
+
+		// Newton step from $(M - I)\Delta x = -(P(x) - x)$
+		gsl_matrix_memcpy(newtonMatrix, monodromy);
+		gsl_matrix_add_diagonal(newtonMatrix, -1.0);
+		gsl_vector_memcpy(newtonStep, residual);
+		gsl_vector_scale(newtonStep, -1.0);
+		gsl_linalg_LU_decomp(newtonMatrix, permutation, &signum);
+		for (i = 0; i < compartments; ++i)
+			if (gsl_matrix_get(newtonMatrix, i, i) == 0.0)
+				break;
+		if (i < compartments) {
+			status = GSL_ESING;
+			break;
+		}
+		gsl_linalg_LU_svx(newtonMatrix, permutation, newtonStep);
+
+		// Fraction-to-the-boundary rule: a populated compartment loses at most 90% per iteration, so that Newton cannot
+		// jump onto the trivial orbit of an empty population in one step. Empty compartments stay clipped at zero.
+		lambda = 1.0;
+		for (i = 0; i < compartments; ++i) {
+			double step = gsl_vector_get(newtonStep, i);
+			if (stateVector[offset + i] > 0.0 && stateVector[offset + i] + step < 0.1 * stateVector[offset + i])
+				lambda = fmin(lambda, -0.9 * stateVector[offset + i] / step);
+		}
+
+		// Backtracking line search on the residual, keeping the compartments non-negative
+		for (backtracks = 0; backtracks <= PERIODIC_MAX_BACKTRACKS; ++backtracks, lambda *= 0.5) {
+			double trialResidual;
+
+			memcpy(trial, stateVector, sizeof(double) * systemSize);
+			for (i = 0; i < compartments; ++i)
+				trial[offset + i] = fmax(trial[offset + i] + lambda * gsl_vector_get(newtonStep, i), 0.0);
+			if ((status = applyPeriodMap(integrator, startTime, period, trial, perturbedMapped, systemSize)) != GSL_SUCCESS)
+				goto cleanup;
+			++results->periodIntegrations;
+			trialResidual = periodResidual(trial, perturbedMapped, offset, compartments, perturbed);
+			if (trialResidual < (1.0 - 1e-4 * lambda) * relativeResidual)
+				break;
+		}
+		// Newton makes no progress from here, typically because the guess is outside the basin of the orbit
+		if (backtracks > PERIODIC_MAX_BACKTRACKS) {
+			status = GSL_ENOPROG;
+			break;
+		}
+		memcpy(stateVector, trial, sizeof(double) * systemSize);
+	}
+
+	results->residual = relativeResidual;
+	results->freeTargetDrift = ((ModelVariables)mapped)->freeTarget - ((ModelVariables)stateVector)->freeTarget;
+	results->freeBoundComplexDrift = ((ModelVariables)mapped)->freeBoundComplex - ((ModelVariables)stateVector)->freeBoundComplex;
+
+	// Floquet multipliers from the monodromy matrix at the last iterate
+	{
+		gsl_vector_complex* eigenvalues = gsl_vector_complex_alloc(compartments);
+		gsl_eigen_nonsymm_workspace* eigenWorkspace = gsl_eigen_nonsymm_alloc(compartments);
+
+		if (gsl_eigen_nonsymm(monodromy, eigenvalues, eigenWorkspace) == GSL_SUCCESS) {
+			results->multiplierCount = compartments;
+			results->multipliers = malloc(sizeof(double) * 2 * compartments);
+			for (i = 0; i < compartments; ++i) {
+				gsl_complex z = gsl_vector_complex_get(eigenvalues, i);
+				results->multipliers[2 * i] = GSL_REAL(z);
+				results->multipliers[2 * i + 1] = GSL_IMAG(z);
+			}
+			qsort(results->multipliers, compartments, 2 * sizeof(double), compareMultipliers);
+			results->spectralRadius = hypot(results->multipliers[0], results->multipliers[1]);
+		}
+		gsl_eigen_nonsymm_free(eigenWorkspace);
+		gsl_vector_complex_free(eigenvalues);
+	}
+
+cleanup:
+	freeSimulationIntegrator(variationalIntegrator);
+	freeSimulationIntegrator(integrator);
+	gsl_permutation_free(permutation);
+	gsl_matrix_free(newtonMatrix);
+	gsl_matrix_free(monodromy);
+	gsl_vector_free(newtonStep);
+	gsl_vector_free(residual);
+	free(augmented);
+	free(trial);
+	free(perturbedMapped);
+	free(perturbed);
+	free(mapped);
+
+	return status;
+}
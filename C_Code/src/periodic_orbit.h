@@ -0,0 +1,28 @@
+/**
+ * @file   periodic_orbit.h
+ * @version 5
+ * @updated  2026
+ * @brief  Shooting-Newton solver for the periodic steady state of repeated dosing regimens
+ */
+
+#define DEFAULT_PERIODIC_TOLERANCE 1e-6      ///< Relative residual of the period map at which the orbit is accepted
+#define DEFAULT_PERIODIC_MAX_ITERATIONS 50   ///< Maximum number of Newton iterations
+
+/**
+ * Structure to hold the outcome of the periodic orbit search
+ */
+typedef struct _PeriodicOrbitResults {
+	int converged;                ///< Non-zero if the residual reached the tolerance.
+	int iterations;               ///< Number of Newton iterations performed.
+	int periodIntegrations;       ///< Number of one-period integrations performed, including those with the variational equations.
+	double residual;              ///< Final relative residual of the compartments over one period, or NaN if the search failed before one.
+	int multiplierCount;          ///< Number of Floquet multipliers (one per compartment).
+	double* multipliers;          ///< Floquet multipliers as (real, imaginary) pairs, sorted by decreasing modulus.
+	double spectralRadius;        ///< Largest modulus of the Floquet multipliers. The orbit is stable if below one.
+	double freeTargetDrift;       ///< Change of the free target over one period on the orbit, or NaN as the residual.
+	double freeBoundComplexDrift; ///< Change of the free bound complex over one period on the orbit, or NaN as the residual.
+} *PeriodicOrbitResults;
+
+int findPeriodicOrbit(const SimulationStepper stepper, const ModelParameters mParam, const double startTime, const double period,
+                      const double timeInterval, const double tolerance, const int maxIterations, double* stateVector,
+                      PeriodicOrbitResults results);
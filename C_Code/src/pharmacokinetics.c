@@ -0,0 +1,63 @@
+/**
+ * @file   pharmacokinetics.c
+ * @version 5
+ * @updated  2026
+ * @brief  One-compartment pharmacokinetic model generating the concentration profile of a dosing regimen
+ *
+ * The concentration is the superposition of the closed-form response to each dose given so far, with first-order
+ * absorption and first-order elimination at the rate clearance / volume. The profile replaces the one read from the
+ * input file, so a concentration is produced for every time-point of the simulation without an input file.
+ */
+
+#include <stdlib.h>
+#include <math.h>
+#include <gsl/gsl_odeiv2.h>
+#include "full_model.h"
+#include "pharmacokinetics.h"
+
+/**
+ * Plasma concentration of a regimen at a given time.
+ *
+ * @param pk       The pharmacokinetic parameters.
+ * @param regimen  The dosing regimen.
+ * @param time     Time since the first dose (s).
+ *
+ * @return         The concentration (mg/L).
+ */
+double calculatePkConcentration(const PkParameters pk, const DosingRegimen regimen, const double time) {
+	const double hours = time / 3600.0;
+	const double ke = pk->clearance / pk->volume;
+	const double ka = pk->absorptionRate;
+	const double scale = pk->bioavailability * regimen->dose / pk->volume;
+	double concentration = 0.0;
+	int d;
+
+	for (d = 0; d < regimen->doseCount && d * regimen->interval <= hours; ++d) {
+		const double elapsed = hours - d * regimen->interval;
+
+		if (ka <= 0.0)
+			concentration += scale * exp(-ke * elapsed);
+		else if (fabs(ka - ke) < 1e-9 * ka)
+			concentration += scale * ke * elapsed * exp(-ke * elapsed);
+		else
+			concentration += scale * ka / (ka - ke) * (exp(-ke * elapsed) - exp(-ka * elapsed));
+	}
+	return concentration;
+}
+
+/**
+ * Fill the concentration profile of the model parameters with a regimen, converted to molecules. The extra entry
+ * repeats the last concentration, as for a profile read from the input file.
+ *
+ * @param pk       The pharmacokinetic parameters.
+ * @param regimen  The dosing regimen.
+ * @param mParam   Model parameters whose profile is replaced.
+ */
+void fillConcentrationProfile(const PkParameters pk, const DosingRegimen regimen, ModelParameters mParam) {
+	int x;
+
+	for (x = 0; x < mParam->timepoints; ++x)
+		mParam->realantibioticconc[x] = concentrationToMolecules(mParam, calculatePkConcentration(pk, regimen, x * mParam->steptime));
+	if (mParam->timepoints > 0)
+		mParam->realantibioticconc[mParam->timepoints] = mParam->realantibioticconc[mParam->timepoints - 1];
+}
@@ -0,0 +1,29 @@
+/**
+ * @file   pharmacokinetics.h
+ * @version 5
+ * @updated  2026
+ * @brief  One-compartment pharmacokinetic model generating the concentration profile of a dosing regimen
+ */
+
+/**
+ * Structure to hold the pharmacokinetic parameters of one patient
+ */
+typedef struct _PkParameters {
+	double clearance;       ///< Clearance (L/h).
+	double volume;          ///< Volume of distribution (L).
+	double absorptionRate;  ///< First-order absorption rate constant (1/h), or zero for intravenous boluses.
+	double bioavailability; ///< Fraction of the dose reaching the circulation.
+} *PkParameters;
+
+/**
+ * Structure to hold a regimen of equal doses at a fixed interval, the first at time zero
+ */
+typedef struct _DosingRegimen {
+	double dose;     ///< Amount of each dose (mg).
+	double interval; ///< Time between doses (h).
+	int doseCount;   ///< Number of doses.
+} *DosingRegimen;
+
+double calculatePkConcentration(const PkParameters pk, const DosingRegimen regimen, const double time);
+
+void fillConcentrationProfile(const PkParameters pk, const DosingRegimen regimen, ModelParameters mParam);
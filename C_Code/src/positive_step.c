@@ -0,0 +1,182 @@
+/**
+ * @file   positive_step.c
+ * @version 5
+ * @updated  2026
+ * @brief  Adaptive positivity-preserving Runge-Kutta integrator for the binding model
+ *
+ * Every component of the binding model state counts cells or molecules and cannot be negative. Explicit adaptive
+ * steppers drive nearly empty compartments slightly negative around extinction, and the error controller then rejects
+ * and shrinks steps to chase an undershoot which carries no information. This integrator uses the Bogacki-Shampine
+ * (3, 2) pair, evaluates every stage at the state projected onto the non-negative orthant, projects the accepted
+ * solution as well, and measures the local error between the projected third- and second-order solutions. A
+ * compartment which both solutions drive below zero therefore contributes no error, and the step size is governed by
+ * the populated compartments only.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <gsl/gsl_odeiv2.h>
+#include <gsl/gsl_errno.h>
+#include "full_model.h"
+#include "positive_step.h"
+
+#define POSITIVE_STEP_SAFETY 0.9      ///< Safety factor applied to the optimal step size estimate
+#define POSITIVE_STEP_MIN_FACTOR 0.2  ///< Largest reduction of the step size after a rejected step
+#define POSITIVE_STEP_MAX_FACTOR 5.0  ///< Largest increase of the step size after an accepted step
+
+/**
+ * Evaluate the derivative of the system, calling the binding model directly.
+ */
+static inline int evaluateDerivative(const PositiveStepWorkspace workspace, const double t, const double* y, double* dydt) {
+	if (workspace->system->function == (GSLDerivCalcFunc)calculateModelDerivative_BindingOnly)
+		return calculateModelDerivative_BindingOnly(t, (ModelVariables)y, (ModelVariables)dydt, (ModelParameters)workspace->system->params);
+	return workspace->system->function(t, y, dydt, workspace->system->params);
+}
+
+/**
+ * Project a component onto the non-negative orthant if it is one of the clipped components. The trailing components of
+ * an augmented system, such as forward sensitivities, can take either sign and are left unchanged.
+ */
+static inline double projectComponent(const PositiveStepWorkspace workspace, const size_t i, const double value) {
+	return (i < workspace->clippedDimension && value < 0.0) ? 0.0 : value;
+}
+
+/**
+ * Allocate a workspace for the positivity-preserving integrator.
+ *
+ * @param system       The ODE system to integrate. Must outlive the workspace.
+ * @param initialStep  The step size of the first attempted step.
+ * @param epsAbs       Absolute error tolerance per component.
+ * @param epsRel       Relative error tolerance per component.
+ *
+ * @return             The workspace, or NULL if the allocation failed.
+ */
+PositiveStepWorkspace allocatePositiveStepWorkspace(const gsl_odeiv2_system* system, const double initialStep, const double epsAbs, const double epsRel) {
+	const size_t dim = system->dimension;
+	PositiveStepWorkspace workspace = (PositiveStepWorkspace)malloc(sizeof(struct _PositiveStepWorkspace));
+
+	if (workspace == NULL)
+		return NULL;
+	if ((workspace->k1 = (double*)malloc(sizeof(double) * 6 * dim)) == NULL) {
+		free(workspace);
+		return NULL;
+	}
+	workspace->k2 = workspace->k1 + dim;
+	workspace->k3 = workspace->k2 + dim;
+	workspace->k4 = workspace->k3 + dim;
+	workspace->stageState = workspace->k4 + dim;
+	workspace->highOrderState = workspace->stageState + dim;
+	workspace->system = system;
+	workspace->clippedDimension = dim;
+	workspace->epsAbs = epsAbs;
+	workspace->epsRel = epsRel;
+	workspace->stepSize = initialStep;
+	workspace->acceptedSteps = 0;
+	workspace->rejectedSteps = 0;
+
+	return workspace;
+}
+
+/**
+ * Advance the state from the current time to the next time with adaptive steps, keeping every component non-negative.
+ *
+ * @param workspace    The integrator workspace.
+ * @param curTime      The current time as input, the next time as output.
+ * @param nextTime     The time to integrate until.
+ * @param stateVector  The state at the current time as input, the state at the next time as output.
+ *
+ * @return             GSL_SUCCESS, GSL_EFAILED if the step size underflows, or the error code of the derivative function.
+ */
+int applyPositiveStep(PositiveStepWorkspace workspace, double* curTime, const double nextTime, double* stateVector) {
+	const size_t dim = workspace->system->dimension;
+	double* y = stateVector;
+	double* k1 = workspace->k1;
+	double* k2 = workspace->k2;
+	double* k3 = workspace->k3;
+	double* k4 = workspace->k4;
+	double* yStage = workspace->stageState;
+	double* yHigh = workspace->highOrderState;
+	size_t i;
+	int status;
+
+	// The state handed in may have been changed by the caller since the last call
+	for (i = 0; i < workspace->clippedDimension; ++i)
+		if (y[i] < 0.0)
+			y[i] = 0.0;
+	if ((status = evaluateDerivative(workspace, *curTime, y, k1)) != GSL_SUCCESS)
+		return status;
+
+	while (*curTime < nextTime) {
+		const double t = *curTime;
+		double h = workspace->stepSize;
+		double errorRatio = 0.0;
+		int lastStep = 0;
+
+		if (nextTime - t <= h * (1.0 + 1e-9)) {
+			h = nextTime - t;
+			lastStep = 1;
+		}
+		if (h <= fabs(t) * 1e-14 + 1e-300) {
+			fprintf(stderr, "Step size underflow in the positivity-preserving integrator at t = %lg\n", t);
+			return GSL_EFAILED;
+		}
+
+		for (i = 0; i < dim; ++i)
+			yStage[i] = projectComponent(workspace, i, y[i] + 0.5 * h * k1[i]);
+		if ((status = evaluateDerivative(workspace, t + 0.5 * h, yStage, k2)) != GSL_SUCCESS)
+			return status;
+
+		for (i = 0; i < dim; ++i)
+			yStage[i] = projectComponent(workspace, i, y[i] + 0.75 * h * k2[i]);
+		if ((status = evaluateDerivative(workspace, t + 0.75 * h, yStage, k3)) != GSL_SUCCESS)
+			return status;
+
+		for (i = 0; i < dim; ++i)
+			yHigh[i] = projectComponent(workspace, i, y[i] + h * (2.0 / 9.0 * k1[i] + 1.0 / 3.0 * k2[i] + 4.0 / 9.0 * k3[i]));
+		if ((status = evaluateDerivative(workspace, t + h, yHigh, k4)) != GSL_SUCCESS)
+			return status;
+
+		// Error between the projected third- and second-order solutions, scaled as the GSL standard control does
+		for (i = 0; i < dim; ++i) {
+			double yLow = projectComponent(workspace, i, y[i] + h * (7.0 / 24.0 * k1[i] + 0.25 * k2[i] + 1.0 / 3.0 * k3[i] + 0.125 * k4[i]));
+			double scale = workspace->epsAbs + workspace->epsRel * fabs(yHigh[i]);
+			double ratio = fabs(yHigh[i] - yLow) / scale;
+			if (ratio > errorRatio)
+				errorRatio = ratio;
+		}
+
+		if (errorRatio > 1.0) {
+			++workspace->rejectedSteps;
+			workspace->stepSize = h * fmax(POSITIVE_STEP_SAFETY * pow(errorRatio, -1.0 / 3.0), POSITIVE_STEP_MIN_FACTOR);
+			continue;
+		}
+
+		++workspace->acceptedSteps;
+		memcpy(y, yHigh, sizeof(double) * dim);
+		// First same as last: the fourth stage was evaluated at the accepted state
+		memcpy(k1, k4, sizeof(double) * dim);
+		*curTime = lastStep ? nextTime : t + h;
+
+		// A step shortened to land on the next time does not limit the following step
+		if (!lastStep || h >= workspace->stepSize) {
+			double factor = (errorRatio > 0.0) ? POSITIVE_STEP_SAFETY * pow(errorRatio, -1.0 / 3.0) : POSITIVE_STEP_MAX_FACTOR;
+			workspace->stepSize = h * fmin(factor, POSITIVE_STEP_MAX_FACTOR);
+		}
+	}
+
+	return GSL_SUCCESS;
+}
+
+/**
+ * Free a workspace of the positivity-preserving integrator. The referenced system is not freed.
+ *
+ * @param workspace  The workspace to free.
+ */
+void freePositiveStepWorkspace(PositiveStepWorkspace workspace) {
+	if (workspace == NULL)
+		return;
+	free(workspace->k1);
+	free(workspace);
+}
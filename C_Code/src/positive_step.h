@@ -0,0 +1,32 @@
+/**
+ * @file   positive_step.h
+ * @version 5
+ * @updated  2026
+ * @brief  Adaptive positivity-preserving Runge-Kutta integrator for the binding model
+ */
+
+/**
+ * Workspace for the adaptive positivity-preserving integrator. Holds the stage buffers, the step size carried between
+ * calls and the step statistics.
+ */
+typedef struct _PositiveStepWorkspace {
+	const gsl_odeiv2_system* system; ///< The ODE system being integrated. Only referenced, never owned.
+	size_t clippedDimension;         ///< Number of leading components kept non-negative, the whole system by default.
+	double epsAbs;                   ///< Absolute error tolerance per component.
+	double epsRel;                   ///< Relative error tolerance per component.
+	double stepSize;                 ///< The step size to attempt next.
+	double* k1;                      ///< Stage derivative buffers, k1 to k4 consecutively.
+	double* k2;
+	double* k3;
+	double* k4;
+	double* stageState;              ///< Buffer for the (clipped) state at which the next stage is evaluated.
+	double* highOrderState;          ///< Buffer for the third-order solution of the step.
+	unsigned long acceptedSteps;     ///< Number of accepted steps since allocation or the last reset.
+	unsigned long rejectedSteps;     ///< Number of rejected steps since allocation or the last reset.
+} *PositiveStepWorkspace;
+
+PositiveStepWorkspace allocatePositiveStepWorkspace(const gsl_odeiv2_system* system, const double initialStep, const double epsAbs, const double epsRel);
+
+int applyPositiveStep(PositiveStepWorkspace workspace, double* curTime, const double nextTime, double* stateVector);
+
+void freePositiveStepWorkspace(PositiveStepWorkspace workspace);
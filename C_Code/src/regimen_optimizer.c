@@ -0,0 +1,534 @@
+/**
+ * @file   regimen_optimizer.c
+ * @version 5
+ * @updated  2026
+ * @brief  Derivative-free search for the dosing regimen with the least drug which attains a kill target
+ *
+ * The search minimises the total dose over the dose, the interval and the number of doses, which is rounded, within
+ * their ranges. A regimen is feasible if the log-kill reaches the target by the target time and stays at or above it
+ * until the end time. An infeasible regimen costs its total dose plus a penalty of the largest total dose in the
+ * ranges times its violation: one plus the shortfall of the log-kill at the target time, or the fraction of the time
+ * after the target time for which the target was lost. Each simulation stops as soon as its outcome is decided, at the
+ * target time if the target was missed or when the kill falls back below the target.
+ *
+ * The optimiser is Nelder-Mead on the ranges scaled to the unit cube. Every iteration evaluates the reflection, the
+ * expansion and both contractions together as one batch on the parallel runner, and a shrink evaluates its new
+ * vertices together, so the speculative candidates cost evaluations but not elapsed time on enough cores. A candidate
+ * equal to one already simulated, as rounding the number of doses often makes it, reuses its outcome.
+ *
+ * The configuration file holds one setting per line; '#' starts a comment:
+ *
+ *     clearance [L/h]
+ *     volume [L]
+ *     absorption [1/h, zero for intravenous boluses]
+ *     bioavailability [fraction]
+ *     dose [smallest (mg)] [largest (mg)]
+ *     interval [shortest (h)] [longest (h)]
+ *     doses [fewest] [most]
+ *     target [log-kill] [time (h)]
+ *     evaluations [largest number of candidates]
+ *     tolerance [simplex size relative to the ranges]
+ *     frontier [file]
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <gsl/gsl_odeiv2.h>
+#include <gsl/gsl_errno.h>
+#include "full_model.h"
+#include "fixed_step.h"
+#include "positive_step.h"
+#include "sensitivity.h"
+#include "base_simulation.h"
+#include "parallel_runner.h"
+#include "pharmacokinetics.h"
+#include "regimen_optimizer.h"
+
+#define OPTIMIZER_BATCH_SIZE (OPTIMIZER_VARIABLE_COUNT + 1) ///< Largest number of candidates evaluated together
+
+/**
+ * Private workspace of one worker
+ */
+typedef struct _OptimizerWorker {
+	ModelParameters mParam;           ///< The worker's copy of the model parameters, holding the profile of its candidate.
+	SimulationIntegrator integrator;  ///< The worker's integrator.
+	double* state;                    ///< State buffer.
+} *OptimizerWorker;
+
+/**
+ * State of the search; the tasks read the settings and write only their own candidate of the batch
+ */
+typedef struct _OptimizerRun {
+	OptimizerSettings settings;       ///< The ranges, the target and the patient.
+	double endTime;                   ///< End of the simulations.
+	double timeInterval;              ///< Interval between the time-points.
+	const double* initialState;       ///< The initial state of the simulations.
+	double penalty;                   ///< Cost of a unit violation of the target (mg).
+	int variableCount;                ///< Number of variables with a range.
+	int variables[OPTIMIZER_VARIABLE_COUNT]; ///< The variables with a range.
+	OptimizerWorker workers;          ///< The workspaces, one per worker.
+	int workerCount;                  ///< Number of workers.
+	struct _RegimenEvaluation batch[OPTIMIZER_BATCH_SIZE]; ///< The candidates being evaluated.
+	OptimizerResults results;         ///< Every candidate evaluated so far.
+	int capacity;                     ///< Allocated length of the evaluations of the results.
+} *OptimizerRun;
+
+/**
+ * Read the search ranges, the target and the patient. Unset settings keep their defaults.
+ *
+ * @param fileName  The configuration file.
+ * @param settings  The settings to fill.
+ *
+ * @return          0 on success, -1 on failure.
+ */
+int readOptimizerSettings(const char* fileName, OptimizerSettings settings) {
+	static const char* rangeNames[OPTIMIZER_VARIABLE_COUNT] = { "dose", "interval", "doses" };
+	FILE* iHandle;
+	char line[FILENAME_MAX + 64];
+	int lineNumber = 0;
+	int hasRange[OPTIMIZER_VARIABLE_COUNT] = { 0, 0, 0 };
+	int v;
+
+	memset(settings, 0, sizeof(struct _OptimizerSettings));
+	settings->pk.bioavailability = 1.0;
+	settings->maxEvaluations = DEFAULT_OPTIMIZER_EVALUATIONS;
+	settings->tolerance = DEFAULT_OPTIMIZER_TOLERANCE;
+	if ((iHandle = fopen(fileName, "r")) == NULL) {
+		fprintf(stderr, "Could not open %s for reading\n", fileName);
+		return -1;
+	}
+	while (fgets(line, sizeof(line), iHandle) != NULL) {
+		char key[32], first[FILENAME_MAX];
+		char* comment = strchr(line, '#');
+		int fields;
+
+		++lineNumber;
+		if (comment != NULL)
+			*comment = '\0';
+		if ((fields = sscanf(line, "%31s %4095s", key, first)) < 1)
+			continue;
+		for (v = 0; v < OPTIMIZER_VARIABLE_COUNT && strcmp(key, rangeNames[v]); ++v)
+			;
+		if (v < OPTIMIZER_VARIABLE_COUNT) {
+			if (sscanf(line, "%*s %lg %lg", &settings->lower[v], &settings->upper[v]) != 2 ||
+			    settings->upper[v] < settings->lower[v] || settings->lower[v] <= 0.0) {
+				fprintf(stderr, "%s:%d: expected %s [smallest] [largest], positive and ascending\n", fileName, lineNumber, key);
+				fclose(iHandle);
+				return -1;
+			}
+			hasRange[v] = 1;
+		} else if (!strcmp(key, "target")) {
+			if (sscanf(line, "%*s %lg %lg", &settings->targetLogKill, &settings->targetTime) != 2) {
+				fprintf(stderr, "%s:%d: expected target [log-kill] [time (h)]\n", fileName, lineNumber);
+				fclose(iHandle);
+				return -1;
+			}
+		} else if (!strcmp(key, "clearance") && fields >= 2)
+			settings->pk.clearance = atof(first);
+		else if (!strcmp(key, "volume") && fields >= 2)
+			settings->pk.volume = atof(first);
+		else if (!strcmp(key, "absorption") && fields >= 2)
+			settings->pk.absorptionRate = atof(first);
+		else if (!strcmp(key, "bioavailability") && fields >= 2)
+			settings->pk.bioavailability = atof(first);
+		else if (!strcmp(key, "evaluations") && fields >= 2)
+			settings->maxEvaluations = atoi(first);
+		else if (!strcmp(key, "tolerance") && fields >= 2)
+			settings->tolerance = atof(first);
+		else if (!strcmp(key, "frontier") && fields >= 2)
+			strcpy(settings->frontierFile, first);
+		else {
+			fprintf(stderr, "%s:%d: unknown or incomplete setting %s\n", fileName, lineNumber, key);
+			fclose(iHandle);
+			return -1;
+		}
+	}
+	fclose(iHandle);
+
+	for (v = 0; v < OPTIMIZER_VARIABLE_COUNT; ++v)
+		if (!hasRange[v]) {
+			fprintf(stderr, "%s: the search needs the range of the %s\n", fileName, rangeNames[v]);
+			return -1;
+		}
+	if (settings->pk.clearance <= 0.0 || settings->pk.volume <= 0.0 || settings->pk.absorptionRate < 0.0 ||
+	    settings->pk.bioavailability <= 0.0 || settings->targetLogKill <= 0.0 || settings->targetTime <= 0.0 ||
+	    settings->maxEvaluations < OPTIMIZER_BATCH_SIZE || settings->tolerance <= 0.0) {
+		fprintf(stderr, "%s: the search needs positive clearance, volume, target and tolerance and at least %d evaluations\n",
+		        fileName, OPTIMIZER_BATCH_SIZE);
+		return -1;
+	}
+	return 0;
+}
+
+/**
+ * Regimen at a point of the unit cube of the variables with a range.
+ */
+static void getCandidateRegimen(const OptimizerRun run, const double* unit, DosingRegimen regimen) {
+	const OptimizerSettings settings = run->settings;
+	double value[OPTIMIZER_VARIABLE_COUNT];
+	int v;
+
+	memcpy(value, settings->lower, sizeof(value));
+	for (v = 0; v < run->variableCount; ++v) {
+		const int variable = run->variables[v];
+
+		value[variable] += fmin(fmax(unit[v], 0.0), 1.0) * (settings->upper[variable] - settings->lower[variable]);
+	}
+	regimen->dose = value[0];
+	regimen->interval = value[1];
+	regimen->doseCount = (int)lround(value[2]);
+}
+
+/**
+ * Whether two regimens are the same candidate, compared field by field as the structure has padding.
+ */
+static int isSameRegimen(const DosingRegimen first, const DosingRegimen second) {
+	return first->dose == second->dose && first->interval == second->interval && first->doseCount == second->doseCount;
+}
+
+/**
+ * Task simulating one candidate until its outcome is decided.
+ */
+static int simulateCandidate(const int taskIndex, const int workerIndex, void* context) {
+	OptimizerRun run = (OptimizerRun)context;
+	const OptimizerSettings settings = run->settings;
+	OptimizerWorker worker = &run->workers[workerIndex];
+	RegimenEvaluation evaluation = &run->batch[taskIndex];
+	const int dim = NUMBER_FREE_KINETIC_VARIABLES + worker->mParam->targetMoleculeCount + 1;
+	const double targetTime = settings->targetTime * 3600.0;
+	double curTime = 0.0;
+	double nextTime = run->timeInterval;
+	double initialLogPopulation = 0.0;
+	double violation = 0.0;
+	int reached = 0, passedTarget = 0;
+	int tickCount = 0;
+	int i;
+	int status;
+
+	fillConcentrationProfile(&settings->pk, &evaluation->regimen, worker->mParam);
+	memcpy(worker->state, run->initialState, sizeof(double) * dim);
+	resetSimulationIntegrator(worker->integrator);
+	for (;;) {
+		double population = 0.0;
+		double logKill;
+
+		for (i = NUMBER_FREE_KINETIC_VARIABLES; i < dim; ++i)
+			population += worker->state[i];
+		if (curTime == 0.0)
+			initialLogPopulation = log10(fmax(population, POPULATION_FLOOR));
+		logKill = initialLogPopulation - log10(fmax(population, POPULATION_FLOOR));
+		evaluation->finalLogKill = logKill;
+		evaluation->stopTime = curTime;
+
+		if (!passedTarget && curTime >= targetTime) {
+			passedTarget = 1;
+			evaluation->targetLogKill = logKill;
+		}
+		if (!reached && logKill >= settings->targetLogKill)
+			reached = 1;
+		if (!reached && passedTarget) {
+			// Missed the target: decided at the target time
+			violation = 1.0 + settings->targetLogKill - logKill;
+			break;
+		}
+		if (reached && passedTarget && logKill < settings->targetLogKill) {
+			// Lost the target: decided when the kill falls back
+			violation = (run->endTime - curTime) / (run->endTime - targetTime);
+			break;
+		}
+		if (nextTime >= run->endTime || ++tickCount > worker->mParam->timepoints)
+			break;
+		if ((status = advanceSimulationIntegrator(worker->integrator, &curTime, nextTime, worker->state)) != GSL_SUCCESS) {
+			fprintf(stderr, "The simulation of a candidate regimen failed at time %lg\n", curTime);
+			return status;
+		}
+		nextTime += run->timeInterval;
+	}
+	evaluation->totalDose = evaluation->regimen.dose * evaluation->regimen.doseCount;
+	evaluation->feasible = (violation == 0.0);
+	evaluation->objective = evaluation->totalDose + run->penalty * violation;
+	return GSL_SUCCESS;
+}
+
+/**
+ * Evaluate a batch of points of the unit cube concurrently, reusing the outcome of any regimen already simulated, and
+ * record the new candidates. The points are rows of OPTIMIZER_VARIABLE_COUNT values, of which the first variableCount
+ * are used, as in the simplex and candidate arrays.
+ *
+ * @return  GSL_SUCCESS, GSL_EMAXITER if the evaluation budget does not allow the batch, or a simulation error.
+ */
+static int evaluateCandidates(OptimizerRun run, const double* units, const int count, double* objectives) {
+	OptimizerResults results = run->results;
+	int index[OPTIMIZER_BATCH_SIZE];
+	int newCount = 0;
+	int c, k, e;
+	int status;
+
+	for (c = 0; c < count; ++c) {
+		struct _DosingRegimen regimen;
+
+		getCandidateRegimen(run, units + (size_t)c * OPTIMIZER_VARIABLE_COUNT, &regimen);
+		index[c] = -1;
+		for (e = 0; e < results->evaluationCount && index[c] < 0; ++e)
+			if (isSameRegimen(&results->evaluations[e].regimen, &regimen))
+				index[c] = e;
+		for (k = 0; k < newCount && index[c] < 0; ++k)
+			if (isSameRegimen(&run->batch[k].regimen, &regimen))
+				index[c] = results->evaluationCount + k;
+		if (index[c] < 0) {
+			memset(&run->batch[newCount], 0, sizeof(struct _RegimenEvaluation));
+			run->batch[newCount].regimen = regimen;
+			index[c] = results->evaluationCount + newCount++;
+		}
+	}
+	if (results->evaluationCount + newCount > run->settings->maxEvaluations)
+		return GSL_EMAXITER;
+	if (newCount > 0) {
+		if (results->evaluationCount + newCount > run->capacity) {
+			RegimenEvaluation grown;
+
+			run->capacity = 2 * (results->evaluationCount + newCount);
+			if ((grown = (RegimenEvaluation)realloc(results->evaluations, sizeof(struct _RegimenEvaluation) * run->capacity)) == NULL)
+				return GSL_ENOMEM;
+			results->evaluations = grown;
+		}
+		if ((status = runParallelTasks(newCount, run->workerCount, simulateCandidate, run)) != GSL_SUCCESS)
+			return status;
+		for (k = 0; k < newCount; ++k) {
+			RegimenEvaluation evaluation = &run->batch[k];
+
+			results->simulatedTime += evaluation->stopTime;
+			if (evaluation->feasible && (!results->found || evaluation->objective < results->best.objective)) {
+				results->found = 1;
+				results->best = *evaluation;
+			}
+		}
+		memcpy(results->evaluations + results->evaluationCount, run->batch, sizeof(struct _RegimenEvaluation) * newCount);
+		results->evaluationCount += newCount;
+	}
+	for (c = 0; c < count; ++c)
+		objectives[c] = results->evaluations[index[c]].objective;
+	return GSL_SUCCESS;
+}
+
+/**
+ * Search for the feasible regimen with the least total dose.
+ *
+ * @param stepper        The integrator selection.
+ * @param mParam         Model parameters for the simulation; the profile is replaced in per-worker copies.
+ * @param settings       The ranges, the target and the patient.
+ * @param endTime        End of the simulations; the target must be kept until then.
+ * @param timeInterval   Interval between the time-points.
+ * @param initialState   The initial state.
+ * @param threadCount    Number of threads simulating the candidates of a batch.
+ * @param results        The best regimen and every candidate; free them with freeOptimizerResults.
+ *
+ * @return               GSL_SUCCESS if the simplex converged, GSL_EMAXITER if the evaluation budget ran out first, or
+ *                       the error of a simulation.
+ */
+int optimizeRegimen(const SimulationStepper stepper, const ModelParameters mParam, const OptimizerSettings settings, const double endTime,
+                    const double timeInterval, const double* initialState, const int threadCount, OptimizerResults results) {
+	const int dim = NUMBER_FREE_KINETIC_VARIABLES + mParam->targetMoleculeCount + 1;
+	const size_t size = sizeof(struct _ModelParameters) + sizeof(double) * (mParam->timepoints + 1);
+	struct _OptimizerRun run;
+	double started = getWallClockTime();
+	double simplex[OPTIMIZER_BATCH_SIZE][OPTIMIZER_VARIABLE_COUNT];
+	double values[OPTIMIZER_BATCH_SIZE];
+	double candidates[OPTIMIZER_BATCH_SIZE][OPTIMIZER_VARIABLE_COUNT];
+	double candidateValues[OPTIMIZER_BATCH_SIZE];
+	int status = GSL_SUCCESS;
+	int n, i, j, v, w;
+
+	memset(results, 0, sizeof(struct _OptimizerResults));
+	memset(&run, 0, sizeof(run));
+	run.settings = settings;
+	run.endTime = endTime;
+	run.timeInterval = timeInterval;
+	run.initialState = initialState;
+	run.results = results;
+	run.penalty = settings->upper[0] * settings->upper[2];
+	for (v = 0; v < OPTIMIZER_VARIABLE_COUNT; ++v)
+		if (settings->upper[v] > settings->lower[v])
+			run.variables[run.variableCount++] = v;
+	n = run.variableCount;
+	if (settings->targetTime * 3600.0 >= endTime) {
+		fprintf(stderr, "The target time must lie before the end of the simulation\n");
+		return GSL_EINVAL;
+	}
+
+	run.workerCount = (threadCount < OPTIMIZER_BATCH_SIZE) ? threadCount : OPTIMIZER_BATCH_SIZE;
+	if (run.workerCount < 1)
+		run.workerCount = 1;
+	if ((run.workers = (OptimizerWorker)calloc(run.workerCount, sizeof(struct _OptimizerWorker))) == NULL)
+		return GSL_ENOMEM;
+	for (w = 0; w < run.workerCount; ++w) {
+		OptimizerWorker worker = &run.workers[w];
+
+		if ((worker->mParam = (ModelParameters)malloc(size)) == NULL) {
+			status = GSL_ENOMEM;
+			goto cleanup;
+		}
+		memcpy(worker->mParam, mParam, size);
+		worker->integrator = allocateSimulationIntegrator(stepper, worker->mParam, timeInterval);
+		worker->state = (double*)malloc(sizeof(double) * dim);
+		if (worker->integrator == NULL || worker->state == NULL) {
+			status = GSL_ENOMEM;
+			goto cleanup;
+		}
+	}
+
+	// The initial simplex steps a quarter of each range from the middle
+	for (i = 0; i <= n; ++i)
+		for (v = 0; v < n; ++v)
+			simplex[i][v] = 0.5 + ((i == v + 1) ? 0.25 : 0.0);
+	if ((status = evaluateCandidates(&run, &simplex[0][0], n + 1, values)) != GSL_SUCCESS)
+		goto cleanup;
+
+	for (;;) {
+		double centroid[OPTIMIZER_VARIABLE_COUNT];
+		double spread = 0.0;
+
+		// Order the vertices from best to worst
+		for (i = 1; i <= n; ++i)
+			for (j = i; j > 0 && values[j] < values[j - 1]; --j) {
+				double swap[OPTIMIZER_VARIABLE_COUNT];
+				double value = values[j];
+
+				memcpy(swap, simplex[j], sizeof(swap));
+				memcpy(simplex[j], simplex[j - 1], sizeof(swap));
+				memcpy(simplex[j - 1], swap, sizeof(swap));
+				values[j] = values[j - 1];
+				values[j - 1] = value;
+			}
+		for (i = 1; i <= n; ++i)
+			for (v = 0; v < n; ++v)
+				spread = fmax(spread, fabs(simplex[i][v] - simplex[0][v]));
+		if (spread < settings->tolerance)
+			break;
+		if (stepper->verbose) {
+			printf("iteration %d: %d evaluations, best objective %lg          \r", results->iterations, results->evaluationCount, values[0]);
+			fflush(stdout);
+		}
+		++results->iterations;
+
+		// Reflection, expansion, outside and inside contraction of the worst vertex through the centroid of the others
+		for (v = 0; v < n; ++v) {
+			centroid[v] = 0.0;
+			for (i = 0; i < n; ++i)
+				centroid[v] += simplex[i][v] / n;
+			candidates[0][v] = fmin(fmax(centroid[v] + (centroid[v] - simplex[n][v]), 0.0), 1.0);
+			candidates[1][v] = fmin(fmax(centroid[v] + 2.0 * (centroid[v] - simplex[n][v]), 0.0), 1.0);
+			candidates[2][v] = centroid[v] + 0.5 * (centroid[v] - simplex[n][v]);
+			candidates[3][v] = centroid[v] - 0.5 * (centroid[v] - simplex[n][v]);
+		}
+		if ((status = evaluateCandidates(&run, &candidates[0][0], 4, candidateValues)) != GSL_SUCCESS)
+			break;
+		if (candidateValues[0] < values[0])
+			j = (candidateValues[1] < candidateValues[0]) ? 1 : 0;
+		else if (candidateValues[0] < values[n - 1])
+			j = 0;
+		else if (candidateValues[0] < values[n])
+			j = (candidateValues[2] <= candidateValues[0]) ? 2 : -1;
+		else
+			j = (candidateValues[3] < values[n]) ? 3 : -1;
+		if (j >= 0) {
+			memcpy(simplex[n], candidates[j], sizeof(double) * n);
+			values[n] = candidateValues[j];
+			continue;
+		}
+
+		// Shrink towards the best vertex
+		for (i = 1; i <= n; ++i)
+			for (v = 0; v < n; ++v)
+				simplex[i][v] = simplex[0][v] + 0.5 * (simplex[i][v] - simplex[0][v]);
+		if ((status = evaluateCandidates(&run, &simplex[1][0], n, values + 1)) != GSL_SUCCESS)
+			break;
+	}
+	if (stepper->verbose)
+		printf("\n");
+
+cleanup:
+	for (w = 0; w < run.workerCount; ++w) {
+		freeSimulationIntegrator(run.workers[w].integrator);
+		free(run.workers[w].mParam);
+		free(run.workers[w].state);
+	}
+	free(run.workers);
+	results->wallTime = getWallClockTime() - started;
+	return status;
+}
+
+/**
+ * Order candidates by ascending total dose, then descending final log-kill.
+ */
+static int compareEvaluations(const void* first, const void* second) {
+	const struct _RegimenEvaluation* a = (const struct _RegimenEvaluation*)first;
+	const struct _RegimenEvaluation* b = (const struct _RegimenEvaluation*)second;
+
+	if (a->totalDose != b->totalDose)
+		return (a->totalDose < b->totalDose) ? -1 : 1;
+	return (a->finalLogKill > b->finalLogKill) ? -1 : (a->finalLogKill < b->finalLogKill);
+}
+
+/**
+ * Print the best regimen and the cost of the search, and write the frontier: the feasible candidates for which no
+ * other feasible candidate gives as much kill at the end time with less drug.
+ *
+ * @param settings  The ranges, the target and the patient.
+ * @param results   The result of the search.
+ *
+ * @return          GSL_SUCCESS, or GSL_EFAILED if the frontier cannot be written.
+ */
+int writeOptimizerResults(const OptimizerSettings settings, const OptimizerResults results) {
+	RegimenEvaluation feasible;
+	FILE* oHandle = stdout;
+	double bestKill = -INFINITY;
+	int feasibleCount = 0;
+	int e;
+
+	if (results->found)
+		printf("Best regimen: %lg mg every %lg h for %d doses, total %lg mg, log-kill %.3lf at %lg h and %.3lf at the end\n",
+		       results->best.regimen.dose, results->best.regimen.interval, results->best.regimen.doseCount, results->best.totalDose,
+		       results->best.targetLogKill, settings->targetTime, results->best.finalLogKill);
+	else
+		printf("No evaluated regimen reached a log-kill of %lg by %lg h and kept it\n", settings->targetLogKill, settings->targetTime);
+	printf("%d evaluations in %d iterations, %lg s elapsed\n", results->evaluationCount, results->iterations, results->wallTime);
+
+	if ((feasible = (RegimenEvaluation)malloc(sizeof(struct _RegimenEvaluation) * (results->evaluationCount + 1))) == NULL)
+		return GSL_ENOMEM;
+	for (e = 0; e < results->evaluationCount; ++e)
+		if (results->evaluations[e].feasible)
+			feasible[feasibleCount++] = results->evaluations[e];
+	qsort(feasible, feasibleCount, sizeof(struct _RegimenEvaluation), compareEvaluations);
+
+	if (settings->frontierFile[0] != '\0' && (oHandle = fopen(settings->frontierFile, "w")) == NULL) {
+		fprintf(stderr, "Could not open %s for writing\n", settings->frontierFile);
+		free(feasible);
+		return GSL_EFAILED;
+	}
+	fprintf(oHandle, "dose interval doses totalDose finalLogKill\n");
+	for (e = 0; e < feasibleCount; ++e)
+		if (feasible[e].finalLogKill > bestKill) {
+			bestKill = feasible[e].finalLogKill;
+			fprintf(oHandle, "%lg %lg %d %lg %.4lf\n", feasible[e].regimen.dose, feasible[e].regimen.interval, feasible[e].regimen.doseCount,
+			        feasible[e].totalDose, feasible[e].finalLogKill);
+		}
+	free(feasible);
+	if (oHandle != stdout && fclose(oHandle) != 0) {
+		fprintf(stderr, "Could not write %s\n", settings->frontierFile);
+		return GSL_EFAILED;
+	}
+	return GSL_SUCCESS;
+}
+
+/**
+ * Free the candidates of a search.
+ *
+ * @param results  The result of the search.
+ */
+void freeOptimizerResults(OptimizerResults results) {
+	free(results->evaluations);
+	results->evaluations = NULL;
+}
@@ -0,0 +1,59 @@
+/**
+ * @file   regimen_optimizer.h
+ * @version 5
+ * @updated  2026
+ * @brief  Derivative-free search for the dosing regimen with the least drug which attains a kill target
+ */
+
+#define DEFAULT_OPTIMIZER_EVALUATIONS 200  ///< Largest number of candidate regimens simulated
+#define DEFAULT_OPTIMIZER_TOLERANCE 1e-3   ///< Size of the simplex, relative to the search ranges, at which the search stops
+#define OPTIMIZER_VARIABLE_COUNT 3         ///< Dose, interval and number of doses
+
+/**
+ * Structure to hold the search ranges, the target and the patient read from the configuration file
+ */
+typedef struct _OptimizerSettings {
+	struct _PkParameters pk;                      ///< Pharmacokinetics of the patient.
+	double lower[OPTIMIZER_VARIABLE_COUNT];       ///< Smallest dose (mg), interval (h) and number of doses.
+	double upper[OPTIMIZER_VARIABLE_COUNT];       ///< Largest dose (mg), interval (h) and number of doses.
+	double targetLogKill;                         ///< Log-kill to be reached.
+	double targetTime;                            ///< Time (h) by which it must be reached and after which it must be kept.
+	int maxEvaluations;                           ///< Largest number of candidate regimens simulated.
+	double tolerance;                             ///< Size of the simplex, relative to the ranges, at which the search stops.
+	char frontierFile[FILENAME_MAX];              ///< File receiving the frontier, or empty for the standard output.
+} *OptimizerSettings;
+
+/**
+ * Outcome of one candidate regimen
+ */
+typedef struct _RegimenEvaluation {
+	struct _DosingRegimen regimen; ///< The candidate.
+	double totalDose;              ///< Dose times number of doses (mg).
+	double objective;              ///< Total dose plus the penalty of a missed target.
+	int feasible;                  ///< Non-zero if the target was reached in time and kept until the end.
+	double targetLogKill;          ///< Log-kill at the target time.
+	double finalLogKill;           ///< Log-kill at the end time, or at the time the simulation was stopped.
+	double stopTime;               ///< Time (s) at which the outcome was decided and the simulation stopped.
+} *RegimenEvaluation;
+
+/**
+ * Structure to hold the result of a search
+ */
+typedef struct _OptimizerResults {
+	int found;                             ///< Non-zero if a feasible regimen was found.
+	struct _RegimenEvaluation best;        ///< The feasible regimen with the least drug.
+	int evaluationCount;                   ///< Number of candidates simulated.
+	RegimenEvaluation evaluations;         ///< Every candidate, in the order simulated.
+	int iterations;                        ///< Number of Nelder-Mead iterations.
+	double simulatedTime;                  ///< Simulated time over all candidates (s), less than evaluations times the end time when stopped early.
+	double wallTime;                       ///< Elapsed time of the search in seconds.
+} *OptimizerResults;
+
+int readOptimizerSettings(const char* fileName, OptimizerSettings settings);
+
+int optimizeRegimen(const SimulationStepper stepper, const ModelParameters mParam, const OptimizerSettings settings, const double endTime,
+                    const double timeInterval, const double* initialState, const int threadCount, OptimizerResults results);
+
+int writeOptimizerResults(const OptimizerSettings settings, const OptimizerResults results);
+
+void freeOptimizerResults(OptimizerResults results);
@@ -0,0 +1,386 @@
+/**
+ * @file   result_cache.c
+ * @version 5
+ * @updated  2026
+ * @brief  On-disk cache of the outputs of simulations, keyed by everything which decides them
+ *
+ * The key of a run holds, as doubles, the model parameters once the defaults are applied, the dose, the population and
+ * the time-points, the integrator, the tolerances of the adaptive integrators, the layout of the output and a hash of
+ * the concentration profile in molecules, which stands for the contents of the input file. Values parsed from
+ * different spellings of the same number give the same key. Its 64-bit FNV-1a hash names the entry, and the whole key
+ * is stored in the entry and compared on a hit, so two runs only share an entry if their profiles collide in a 64-bit
+ * hash.
+ *
+ * An entry holds RESULT_CACHE_MAGIC, the version, the key, the summary of the run and the length of the output, then
+ * the output byte for byte. A run which is not in the cache copies its output into a temporary file in the cache
+ * directory as it is written; once the run has succeeded the summary is filled in and the file is renamed to the
+ * entry, so readers, other threads or other processes, see a complete entry or none. An entry whose length does not
+ * match is a miss and is removed.
+ *
+ * A hit sets the modification time of the entry, which orders the entries for eviction: after an entry is added, the
+ * least recently used entries are removed until the entries fit in the size of the cache. Temporary files older than
+ * RESULT_CACHE_STALE_TIME, left by runs which did not finish, are removed at the same time.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <errno.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <gsl/gsl_odeiv2.h>
+#include "full_model.h"
+#include "fixed_step.h"
+#include "positive_step.h"
+#include "sensitivity.h"
+#include "base_simulation.h"
+#include "trajectory_file.h"
+#include "result_cache.h"
+
+/**
+ * Header of an entry, followed by the output
+ */
+typedef struct _ResultHeader {
+	char magic[8];                     ///< RESULT_CACHE_MAGIC.
+	uint64_t version;                  ///< RESULT_CACHE_VERSION.
+	double key[RESULT_KEY_LENGTH];     ///< The key of the run.
+	double finalPopulation;            ///< Population at the end of the run.
+	uint64_t acceptedSteps;            ///< Integration steps accepted.
+	uint64_t rejectedSteps;            ///< Integration steps rejected.
+	uint64_t outputLength;             ///< Bytes of the output following the header.
+} ResultHeader;
+
+/**
+ * Entry of the cache directory considered for eviction
+ */
+typedef struct _ResultFile {
+	char* name;                        ///< Name within the directory.
+	time_t lastUse;                    ///< Modification time.
+	unsigned long long size;           ///< Bytes of the file.
+} ResultFile;
+
+/**
+ * Continue a 64-bit FNV-1a hash over bytes.
+ */
+static uint64_t hashBytes(uint64_t hash, const void* data, const size_t length) {
+	const unsigned char* bytes = (const unsigned char*)data;
+	size_t i;
+
+	for (i = 0; i < length; ++i)
+		hash = (hash ^ bytes[i]) * RESULT_HASH_PRIME;
+	return hash;
+}
+
+/**
+ * Open the cache in a directory, creating the directory if needed.
+ *
+ * @param specification  [directory] or [directory]:[size (MB)].
+ *
+ * @return               The cache, or NULL if the directory cannot be used.
+ */
+ResultCache openResultCache(const char* specification) {
+	ResultCache cache = (ResultCache)calloc(1, sizeof(struct _ResultCache));
+	const char* separator = strrchr(specification, ':');
+	double megabytes = DEFAULT_RESULT_CACHE_SIZE;
+	struct stat existing;
+
+	if (cache == NULL)
+		return NULL;
+	if (separator != NULL && (sscanf(separator + 1, "%lg", &megabytes) != 1 || megabytes <= 0.0)) {
+		fprintf(stderr, "The result cache takes [directory]:[size (MB)]\n");
+		free(cache);
+		return NULL;
+	}
+	cache->directory = (separator != NULL) ? strndup(specification, separator - specification) : strdup(specification);
+	cache->maxBytes = (unsigned long long)(megabytes * 1024.0 * 1024.0);
+	if (cache->directory == NULL || ((mkdir(cache->directory, 0777) != 0 && errno != EEXIST) ||
+	                                 stat(cache->directory, &existing) != 0 || !S_ISDIR(existing.st_mode))) {
+		fprintf(stderr, "Could not use %s as the result cache\n", specification);
+		free(cache->directory);
+		free(cache);
+		return NULL;
+	}
+	pthread_mutex_init(&cache->lock, NULL);
+	return cache;
+}
+
+/**
+ * Build the canonical key of a run.
+ *
+ * @param key                The key.
+ * @param stepper            The integrator selection.
+ * @param mParam             Model parameters of the run, with the thresholds defaulted and the profile read.
+ * @param sParam             The dose, population and time-points.
+ * @param trajectoryOptions  The layout of the output.
+ */
+void makeResultKey(ResultKey key, const SimulationStepper stepper, const ModelParameters mParam, const SimulationParameters sParam,
+                   const TrajectoryOptions trajectoryOptions) {
+	const uint64_t profileHash = hashBytes(RESULT_HASH_BASIS, mParam->realantibioticconc, sizeof(double) * (mParam->timepoints + 1));
+	double* value = key->values;
+
+	memset(key, 0, sizeof(struct _ResultKey));
+	*value++ = RESULT_CACHE_VERSION;
+	*value++ = mParam->transMembranePermeability;
+	*value++ = mParam->intracellularVolume;
+	*value++ = mParam->targetMoleculeCount;
+	*value++ = mParam->replicationThreshold;
+	*value++ = mParam->killingThreshold;
+	*value++ = mParam->timepoints;
+	*value++ = mParam->steptime;
+	*value++ = mParam->baselineReplication;
+	*value++ = mParam->maximumKillRate;
+	*value++ = mParam->molecularweight;
+	*value++ = mParam->nonSpecificAssociationRate;
+	*value++ = mParam->nonSpecificDissociationRate;
+	*value++ = mParam->targetAssociationRate;
+	*value++ = mParam->targetDissociationRate;
+	*value++ = mParam->carryingCapacity;
+	*value++ = sParam->startingAntibiotic;
+	*value++ = sParam->startingPopulation;
+	*value++ = sParam->endTime;
+	*value++ = sParam->stepSize;
+	// The GSL stepping function by its name, which unlike its address is the same in every build
+	*value++ = (stepper->gslStepping != NULL) ? (double)(hashBytes(RESULT_HASH_BASIS, stepper->gslStepping->name,
+	                                                               strlen(stepper->gslStepping->name)) >> 32) : -1.0;
+	*value++ = stepper->nativeMethod;
+	*value++ = stepper->positivityPreserving;
+	*value++ = stepper->fixedStepSize;
+	*value++ = SIMULATION_ABSOLUTE_TOLERANCE;
+	*value++ = SIMULATION_RELATIVE_TOLERANCE;
+	*value++ = trajectoryOptions->format;
+	*value++ = trajectoryOptions->content;
+	*value++ = trajectoryOptions->plotPoints;
+	*value++ = (double)(profileHash >> 32);
+	*value++ = (double)(profileHash & 0xffffffffULL);
+	key->hash = hashBytes(RESULT_HASH_BASIS, key->values, sizeof(key->values));
+}
+
+/**
+ * Name of the entry of a key.
+ */
+static void getEntryName(const ResultCache cache, const ResultKey key, char* name) {
+	snprintf(name, FILENAME_MAX, "%s/%016llx" RESULT_CACHE_SUFFIX, cache->directory, key->hash);
+}
+
+/**
+ * Look a run up in the cache, counting the hit or the miss.
+ *
+ * @param cache    The cache.
+ * @param key      The key of the run.
+ * @param summary  The summary of the run, on a hit.
+ *
+ * @return         The entry positioned at the output, for copyCachedResult, or NULL on a miss.
+ */
+FILE* findCachedResult(ResultCache cache, const ResultKey key, ResultSummary summary) {
+	char name[FILENAME_MAX];
+	ResultHeader header;
+	struct stat status;
+	FILE* entry;
+	int hit;
+
+	getEntryName(cache, key, name);
+	entry = fopen(name, "rb");
+	hit = (entry != NULL && fread(&header, sizeof(header), 1, entry) == 1 && !memcmp(header.magic, RESULT_CACHE_MAGIC, 8) &&
+	       header.version == RESULT_CACHE_VERSION && !memcmp(header.key, key->values, sizeof(header.key)) &&
+	       fstat(fileno(entry), &status) == 0 && (unsigned long long)status.st_size == sizeof(header) + header.outputLength);
+	if (entry != NULL && !hit) {
+		// A damaged entry, or another key with the same hash, makes way for this run
+		fclose(entry);
+		unlink(name);
+		entry = NULL;
+	}
+	pthread_mutex_lock(&cache->lock);
+	if (hit)
+		++cache->hitCount;
+	else
+		++cache->missCount;
+	pthread_mutex_unlock(&cache->lock);
+	if (!hit)
+		return NULL;
+	// The use orders the entries for eviction
+	utimes(name, NULL);
+	summary->finalPopulation = header.finalPopulation;
+	summary->acceptedSteps = header.acceptedSteps;
+	summary->rejectedSteps = header.rejectedSteps;
+	return entry;
+}
+
+/**
+ * Copy the output of an entry found in the cache and close the entry.
+ *
+ * @param entry    The entry from findCachedResult.
+ * @param oHandle  The output, or NULL to only close the entry.
+ *
+ * @return         0 on success, -1 if the output could not be written.
+ */
+int copyCachedResult(FILE* entry, FILE* oHandle) {
+	char* buffer = (oHandle != NULL) ? (char*)malloc(RESULT_CACHE_COPY_SIZE) : NULL;
+	size_t length;
+	int failed = (oHandle != NULL && buffer == NULL);
+
+	while (buffer != NULL && !failed && (length = fread(buffer, 1, RESULT_CACHE_COPY_SIZE, entry)) > 0)
+		failed = fwrite(buffer, 1, length, oHandle) != length;
+	failed = failed || ferror(entry) || (oHandle != NULL && fflush(oHandle) != 0);
+	free(buffer);
+	fclose(entry);
+	return failed ? -1 : 0;
+}
+
+/**
+ * Start the entry of a run which was not in the cache; its output is copied into the stream of the entry.
+ *
+ * @param cache  The cache.
+ * @param key    The key of the run.
+ *
+ * @return       The unfinished entry, or NULL if it cannot be created, the run then going uncached.
+ */
+ResultEntry beginCachedResult(ResultCache cache, const ResultKey key) {
+	ResultEntry entry = (ResultEntry)calloc(1, sizeof(struct _ResultEntry));
+	ResultHeader header;
+	int descriptor;
+
+	if (entry == NULL)
+		return NULL;
+	entry->cache = cache;
+	entry->key = *key;
+	snprintf(entry->temporaryName, FILENAME_MAX, "%s/%016llx" RESULT_CACHE_SUFFIX ".XXXXXX", cache->directory, key->hash);
+	if ((descriptor = mkstemp(entry->temporaryName)) < 0) {
+		free(entry);
+		return NULL;
+	}
+	if ((entry->oHandle = fdopen(descriptor, "wb")) == NULL) {
+		close(descriptor);
+		unlink(entry->temporaryName);
+		free(entry);
+		return NULL;
+	}
+	setvbuf(entry->oHandle, NULL, _IOFBF, RESULT_CACHE_COPY_SIZE);
+	// The summary and the length are filled in when the run is done
+	memset(&header, 0, sizeof(header));
+	fwrite(&header, sizeof(header), 1, entry->oHandle);
+	return entry;
+}
+
+/**
+ * Order files by their last use, oldest first.
+ */
+static int compareLastUse(const void* a, const void* b) {
+	const time_t first = ((const ResultFile*)a)->lastUse, second = ((const ResultFile*)b)->lastUse;
+
+	return (first > second) - (first < second);
+}
+
+/**
+ * Remove the least recently used entries until the entries fit in the size of the cache, and the stale unfinished ones.
+ */
+static void evictCachedResults(ResultCache cache) {
+	const size_t suffixLength = strlen(RESULT_CACHE_SUFFIX);
+	const time_t now = time(NULL);
+	ResultFile* files = NULL;
+	unsigned long long total = 0;
+	size_t count = 0, capacity = 0, i;
+	struct dirent* item;
+	DIR* directory;
+
+	if ((directory = opendir(cache->directory)) == NULL)
+		return;
+	while ((item = readdir(directory)) != NULL) {
+		const size_t length = strlen(item->d_name);
+		char name[FILENAME_MAX];
+		struct stat status;
+
+		if (strstr(item->d_name, RESULT_CACHE_SUFFIX) == NULL)
+			continue;
+		snprintf(name, FILENAME_MAX, "%s/%s", cache->directory, item->d_name);
+		if (stat(name, &status) != 0)
+			continue;
+		if (length < suffixLength || strcmp(item->d_name + length - suffixLength, RESULT_CACHE_SUFFIX) != 0) {
+			if (now - status.st_mtime > RESULT_CACHE_STALE_TIME)
+				unlink(name);
+			continue;
+		}
+		if (count == capacity) {
+			ResultFile* grown = (ResultFile*)realloc(files, sizeof(ResultFile) * (capacity = 2 * capacity + 64));
+
+			if (grown == NULL)
+				break;
+			files = grown;
+		}
+		if ((files[count].name = strdup(name)) == NULL)
+			break;
+		files[count].lastUse = status.st_mtime;
+		files[count].size = (unsigned long long)status.st_size;
+		total += files[count++].size;
+	}
+	closedir(directory);
+	if (total > cache->maxBytes) {
+		qsort(files, count, sizeof(ResultFile), compareLastUse);
+		for (i = 0; i < count && total > cache->maxBytes; ++i)
+			if (unlink(files[i].name) == 0)
+				total -= files[i].size;
+	}
+	for (i = 0; i < count; ++i)
+		free(files[i].name);
+	free(files);
+}
+
+/**
+ * Finish the entry of a run: with a summary the entry is completed and renamed into place, without one, as for a run
+ * which failed, it is dropped.
+ *
+ * @param entry    The unfinished entry, or NULL.
+ * @param summary  The summary of the run, or NULL to drop the entry.
+ *
+ * @return         0 if the entry was kept or dropped as asked, -1 if it could not be completed.
+ */
+int finishCachedResult(ResultEntry entry, const ResultSummary summary) {
+	ResultHeader header;
+	char name[FILENAME_MAX];
+	long end = 0;
+	int failed;
+
+	if (entry == NULL)
+		return 0;
+	failed = (summary == NULL || fflush(entry->oHandle) != 0 || ferror(entry->oHandle) || (end = ftell(entry->oHandle)) < (long)sizeof(header));
+	if (!failed) {
+		memset(&header, 0, sizeof(header));
+		memcpy(header.magic, RESULT_CACHE_MAGIC, 8);
+		header.version = RESULT_CACHE_VERSION;
+		memcpy(header.key, entry->key.values, sizeof(header.key));
+		header.finalPopulation = summary->finalPopulation;
+		header.acceptedSteps = summary->acceptedSteps;
+		header.rejectedSteps = summary->rejectedSteps;
+		header.outputLength = (uint64_t)end - sizeof(header);
+		failed = fseek(entry->oHandle, 0, SEEK_SET) != 0 || fwrite(&header, sizeof(header), 1, entry->oHandle) != 1;
+	}
+	failed = fclose(entry->oHandle) != 0 || failed;
+	getEntryName(entry->cache, &entry->key, name);
+	if (failed || rename(entry->temporaryName, name) != 0) {
+		unlink(entry->temporaryName);
+		failed = (summary != NULL);
+	} else {
+		pthread_mutex_lock(&entry->cache->lock);
+		evictCachedResults(entry->cache);
+		pthread_mutex_unlock(&entry->cache->lock);
+	}
+	free(entry);
+	return failed ? -1 : 0;
+}
+
+/**
+ * Free the cache; the entries stay in the directory.
+ *
+ * @param cache  The cache, or NULL.
+ */
+void closeResultCache(ResultCache cache) {
+	if (cache == NULL)
+		return;
+	pthread_mutex_destroy(&cache->lock);
+	free(cache->directory);
+	free(cache);
+}
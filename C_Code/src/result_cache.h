@@ -0,0 +1,69 @@
+/**
+ * @file   result_cache.h
+ * @version 5
+ * @updated  2026
+ * @brief  On-disk cache of the outputs of simulations, keyed by everything which decides them
+ */
+
+#define RESULT_CACHE_MAGIC "TBRESULT"          ///< First bytes of a cache entry
+#define RESULT_CACHE_VERSION 1                 ///< Version of the entries and of their key; entries of other versions are misses
+#define RESULT_CACHE_SUFFIX ".result"          ///< Suffix of the entries in the cache directory
+#define RESULT_KEY_LENGTH 31                   ///< Values of the canonical key of a run
+#define RESULT_HASH_BASIS 0xcbf29ce484222325ULL ///< Start of the 64-bit FNV-1a hashes of the keys and profiles
+#define RESULT_HASH_PRIME 0x100000001b3ULL     ///< Multiplier of the 64-bit FNV-1a hashes
+#define DEFAULT_RESULT_CACHE_SIZE 256          ///< Megabytes kept in the cache when no size is given
+#define RESULT_CACHE_STALE_TIME 3600           ///< Seconds after which an unfinished entry left by a crash is removed
+#define RESULT_CACHE_COPY_SIZE (1 << 20)       ///< Bytes copied at once from an entry to the output
+
+/**
+ * Structure to hold the canonical key of a run
+ */
+typedef struct _ResultKey {
+	unsigned long long hash;           ///< Hash of the values, naming the entry.
+	double values[RESULT_KEY_LENGTH];  ///< The parameters, integrator, tolerances, output layout and profile hash, compared on a hit.
+} *ResultKey;
+
+/**
+ * Structure to hold what a run reports besides its output, kept with the output
+ */
+typedef struct _ResultSummary {
+	double finalPopulation;        ///< Population at the end of the run.
+	unsigned long acceptedSteps;   ///< Integration steps accepted.
+	unsigned long rejectedSteps;   ///< Integration steps rejected by the error control.
+} *ResultSummary;
+
+/**
+ * Structure to hold the cache directory and its counts
+ */
+typedef struct _ResultCache {
+	char* directory;               ///< The directory holding the entries.
+	unsigned long long maxBytes;   ///< Size of the entries beyond which the least recently used are removed.
+	unsigned long hitCount;        ///< Number of runs read from the cache.
+	unsigned long missCount;       ///< Number of runs which were not in the cache.
+	pthread_mutex_t lock;          ///< Protects the counts and the eviction.
+} *ResultCache;
+
+/**
+ * Structure to hold an entry being written while its run is simulated
+ */
+typedef struct _ResultEntry {
+	ResultCache cache;                 ///< The cache.
+	struct _ResultKey key;             ///< The key of the run.
+	FILE* oHandle;                     ///< The unfinished entry, receiving a copy of the output.
+	char temporaryName[FILENAME_MAX];  ///< Name of the unfinished entry, renamed into place when it is complete.
+} *ResultEntry;
+
+ResultCache openResultCache(const char* specification);
+
+void makeResultKey(ResultKey key, const SimulationStepper stepper, const ModelParameters mParam, const SimulationParameters sParam,
+                   const TrajectoryOptions trajectoryOptions);
+
+FILE* findCachedResult(ResultCache cache, const ResultKey key, ResultSummary summary);
+
+int copyCachedResult(FILE* entry, FILE* oHandle);
+
+ResultEntry beginCachedResult(ResultCache cache, const ResultKey key);
+
+int finishCachedResult(ResultEntry entry, const ResultSummary summary);
+
+void closeResultCache(ResultCache cache);
@@ -0,0 +1,94 @@
+/**
+ * @file   sensitivity.c
+ * @version 5
+ * @updated  2026
+ * @brief  Forward parameter sensitivities integrated alongside the model
+ *
+ * The sensitivity $s_p = \frac{\partial y}{\partial \theta_p}$ of the state to a parameter obeys
+ * $\dot{s}_p = J s_p + \frac{\partial f}{\partial \theta_p}$ with $s_p(0) = 0$, since the initial state does not depend on
+ * the parameters. Integrating these equations together with the model gives the exact derivative of the discrete
+ * trajectory up to the integration error, without the step size trade-off of finite differences. The Jacobian is
+ * applied as a structured product, so each sensitivity costs about two evaluations of the model derivative.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <gsl/gsl_errno.h>
+#include "full_model.h"
+#include "sensitivity.h"
+
+/**
+ * The command-line option letters of the model parameters, in the order of ModelParameterIndex.
+ */
+static const char modelParameterOptions[MODEL_PARAMETER_COUNT] = { 'A', 'D', 'K', 'R', 'C' };
+
+/**
+ * Parse a list of parameters given by their command-line option letters, e.g. "ADK".
+ *
+ * @param list       The option letters of the parameters, optionally separated by commas.
+ * @param selection  The selection to fill; the output file is left unchanged.
+ *
+ * @return           0 on success, -1 if a letter does not name a differentiable parameter or repeats one.
+ */
+int parseSensitivitySelection(const char* list, SensitivitySelection selection) {
+	int i, j;
+
+	selection->parameterCount = 0;
+	for (; *list != '\0'; ++list) {
+		if (*list == ',')
+			continue;
+		for (i = 0; i < MODEL_PARAMETER_COUNT && modelParameterOptions[i] != *list; ++i)
+			;
+		if (i == MODEL_PARAMETER_COUNT) {
+			fprintf(stderr, "Sensitivities are available for the parameters A, D, K, R and C, not '%c'\n", *list);
+			return -1;
+		}
+		for (j = 0; j < selection->parameterCount && selection->parameters[j] != (ModelParameterIndex)i; ++j)
+			;
+		if (j < selection->parameterCount) {
+			fprintf(stderr, "The parameter '%c' is selected twice for sensitivities\n", *list);
+			return -1;
+		}
+		selection->parameters[selection->parameterCount++] = (ModelParameterIndex)i;
+	}
+	return 0;
+}
+
+/**
+ * The command-line option letter of a model parameter, for output headers.
+ */
+char getModelParameterOption(const ModelParameterIndex parameter) {
+	return (parameter >= 0 && parameter < MODEL_PARAMETER_COUNT) ? modelParameterOptions[parameter] : '?';
+}
+
+/**
+ * gsl_odeiv2_system function of the augmented system of the model and its forward sensitivities.
+ *
+ * @param curTime  The current time-point.
+ * @param y        The model state followed by the sensitivity vectors.
+ * @param dydt     The output derivative of the model state and of the sensitivity vectors.
+ * @param system   The augmented system.
+ *
+ * @return         GSL_SUCCESS, or the error code of the model functions.
+ */
+int calculateSensitivityDerivative(double curTime, const double* y, double* dydt, SensitivitySystem system) {
+	const int dim = system->modelDimension;
+	double parameterDerivative[dim];
+	int p, i;
+	int status;
+
+	if ((status = calculateModelDerivative_BindingOnly(curTime, (ModelVariables)y, (ModelVariables)dydt, system->mParam)) != GSL_SUCCESS)
+		return status;
+	for (p = 0; p < system->selection->parameterCount; ++p) {
+		const double* sensitivity = y + (size_t)(p + 1) * dim;
+		double* sensitivityDeriv = dydt + (size_t)(p + 1) * dim;
+
+		calculateModelJacobianProduct_BindingOnly(curTime, (ModelVariables)y, sensitivity, sensitivityDeriv, system->mParam);
+		if ((status = calculateModelParameterDerivative_BindingOnly(curTime, (ModelVariables)y, system->selection->parameters[p],
+		                                                            parameterDerivative, system->mParam)) != GSL_SUCCESS)
+			return status;
+		for (i = 0; i < dim; ++i)
+			sensitivityDeriv[i] += parameterDerivative[i];
+	}
+	return GSL_SUCCESS;
+}
@@ -0,0 +1,31 @@
+/**
+ * @file   sensitivity.h
+ * @version 5
+ * @updated  2026
+ * @brief  Forward parameter sensitivities integrated alongside the model
+ */
+
+/**
+ * Selection of the model parameters whose sensitivities are integrated with the simulation
+ */
+typedef struct _SensitivitySelection {
+	int parameterCount;                                  ///< Number of selected parameters.
+	ModelParameterIndex parameters[MODEL_PARAMETER_COUNT]; ///< The selected parameters, in output order.
+	FILE* oHandle;                                       ///< File receiving the population sensitivities per time-point.
+} *SensitivitySelection;
+
+/**
+ * The augmented system of the model and its forward sensitivities, passed to the integrator as the system parameters.
+ * The state holds the model state followed by one sensitivity vector $s_p = \frac{\partial y}{\partial \theta_p}$ per parameter.
+ */
+typedef struct _SensitivitySystem {
+	ModelParameters mParam;          ///< Model parameters for the simulation.
+	SensitivitySelection selection;  ///< The selected parameters.
+	int modelDimension;              ///< Size of the model state vector.
+} *SensitivitySystem;
+
+int parseSensitivitySelection(const char* list, SensitivitySelection selection);
+
+char getModelParameterOption(const ModelParameterIndex parameter);
+
+int calculateSensitivityDerivative(double curTime, const double* y, double* dydt, SensitivitySystem system);
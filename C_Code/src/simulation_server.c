@@ -0,0 +1,816 @@
+/**
+ * @file   simulation_server.c
+ * @version 5
+ * @updated  2026
+ * @brief  Long-running simulation server answering parameter sets over a Unix domain socket
+ *
+ * A client connects to the socket and sends one JSON object whose keys are the option letters of the command-line and
+ * whose values are their arguments, as strings or numbers, e.g. {"n":100,"k":50,"t":"604800:60","S":"positive"},
+ * ended by a newline or by closing its side of the connection. The letters V, n, r, k, R, K, A, D, C, M, t, d, p, S,
+ * T and N are accepted; the options the server was started with are the defaults of the others. The reply is the
+ * trajectory as the JSON records of -m - -T json, streamed while it is computed, after which the server closes the
+ * connection. A request which cannot be run gets a single record {"type":"error","message":"..."} instead; one whose
+ * simulation fails after it started is followed by that record after its end record.
+ *
+ * The process stays up between requests, so each only pays for its integration. The concentration profile, the first
+ * of the input file, is read once for each number of time-points, intracellular volume and molecular weight, and the
+ * hypergeometric matrix is generated once for each number of targets and replication threshold; up to
+ * SERVER_CACHE_SIZE of each are kept, the least recently used being dropped first, and are shared read-only by the
+ * requests using them. Requests are answered by a pool of worker threads which all wait in accept on the socket, so a
+ * request is taken by the first idle worker; further connections queue in the socket backlog. Each worker keeps the
+ * parameters, state, integrator and result vectors of its runs in its own workspace, so after its largest request a
+ * worker answers others without allocating them again.
+ *
+ * With a result cache, a request whose run is in it is answered by copying the reply from it, and the reply of another
+ * is copied into it as it is streamed.
+ *
+ * A request may instead be a JSON array of such objects, a batch, e.g. from a parameter sweep. Its items are run
+ * concurrently by the worker's own pool of -j threads, sharing the cached profiles and matrices, each thread reusing
+ * one workspace for the items it runs, the worker's own for the first thread. Each item is answered
+ * by a record {"type":"item","index":i,"status":"ok"} followed by its trajectory, or by a single record
+ * {"type":"item","index":i,"status":"error","message":"..."}; an item's records are buffered until those of the items
+ * before it are written, so the items come back in order. A record {"type":"batch","items":n,"failed":f,"allocations":a}
+ * ends the reply, a being the number of workspace buffers the batch allocated or grew. runSimulationBatch runs a batch
+ * read from a file the same way, without the socket.
+ *
+ * The server stops on SIGINT or SIGTERM: the workers finish the requests they are answering, the socket is removed and
+ * the cache counts are printed.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <gsl/gsl_odeiv2.h>
+#include <gsl/gsl_errno.h>
+#include "full_model.h"
+#include "fixed_step.h"
+#include "positive_step.h"
+#include "sensitivity.h"
+#include "base_simulation.h"
+#include "parallel_runner.h"
+#include "trajectory_file.h"
+#include "multi_profile.h"
+#include "result_cache.h"
+#include "simulation_server.h"
+
+/**
+ * Structure to hold one cached matrix or profile
+ */
+typedef struct _ServerCacheEntry {
+	double key[SERVER_CACHE_KEY_LENGTH];  ///< The values the entry was built from.
+	double* values;                       ///< The matrix or profile, or NULL for a free entry.
+	int users;                            ///< Requests using the values; an entry in use is not dropped.
+	unsigned long lastUse;                ///< Use count of the cache at the last use of the entry.
+} *ServerCacheEntry;
+
+/**
+ * Builder of the values of a cache entry from its key.
+ */
+typedef double* (*ServerCacheBuilder)(const double* key, const ServerSettings settings);
+
+/**
+ * Structure to hold the entries of one kind shared by the workers
+ */
+typedef struct _ServerCache {
+	struct _ServerCacheEntry entries[SERVER_CACHE_SIZE]; ///< The entries.
+	ServerCacheBuilder build;   ///< Builds the values of a missing entry.
+	unsigned long useCount;     ///< Number of lookups, ordering the uses of the entries.
+	unsigned long missCount;    ///< Number of lookups which had to build the values.
+	pthread_mutex_t lock;       ///< Protects the entries and the counts.
+} *ServerCache;
+
+/**
+ * State shared by the workers
+ */
+typedef struct _SimulationServer {
+	ServerSettings settings;          ///< The settings and the defaults of the requests.
+	int listener;                     ///< The listening socket.
+	volatile int stopping;            ///< Set when the server stops, so the workers leave once accept fails.
+	struct _ServerCache matrices;     ///< Hypergeometric matrices by number of targets and replication threshold.
+	struct _ServerCache profiles;     ///< Concentration profiles by time-points, intracellular volume and molecular weight.
+	unsigned long requestCount;       ///< Number of requests answered.
+	pthread_mutex_t lock;             ///< Protects the request count.
+} *SimulationServer;
+
+/**
+ * Structure to hold one item of a batch and its reply, buffered until the replies of the items before it are written
+ */
+typedef struct _BatchItem {
+	char* request;                        ///< The parameter set of the item, a flat JSON object.
+	char* reply;                          ///< The records of the item, or NULL.
+	size_t replyLength;                   ///< Length of the records.
+	int status;                           ///< GSL_SUCCESS, or the error of the item.
+	int finished;                         ///< Set once the item was run.
+	char message[SERVER_MESSAGE_LENGTH];  ///< The reason the item failed.
+} *BatchItem;
+
+/**
+ * Structure to hold a batch while its items are run
+ */
+typedef struct _SimulationBatch {
+	SimulationServer server;    ///< The server whose caches and defaults the items use.
+	SimulationWorkspace workspace; ///< Workspace of the first thread, that of the worker answering the batch.
+	struct _SimulationWorkspace* workspaces; ///< Workspaces of the other threads, by thread index less one.
+	struct _BatchItem* items;   ///< The items.
+	int itemCount;              ///< Number of items.
+	int writtenCount;           ///< Number of items written, the first ones.
+	int failedCount;            ///< Number of items which failed.
+	FILE* oHandle;              ///< Receives the reply.
+	pthread_mutex_t lock;       ///< Protects the written items and the reply.
+} *SimulationBatch;
+
+/**
+ * Cache builder of the hypergeometric matrix of key { targets, replication threshold }.
+ */
+static double* buildMatrix(const double* key, const ServerSettings settings) {
+	(void)settings;
+	return generateHypergeometricMatrix((int)key[0], (int)key[1]);
+}
+
+/**
+ * Cache builder of the concentration profile of key { time-points, intracellular volume, molecular weight }, read from
+ * the input file of the server.
+ */
+static double* buildProfile(const double* key, const ServerSettings settings) {
+	struct _ModelParameters model = *settings->model;
+	struct _ConcentrationProfiles profiles;
+
+	model.timepoints = (int)key[0];
+	model.intracellularVolume = key[1];
+	model.molecularweight = key[2];
+	if (readConcentrationProfiles(&settings->inputFile, 1, &model, &profiles) != 0)
+		return NULL;
+	return profiles.concentrations;
+}
+
+/**
+ * The values of a key, built on a miss, for use until they are released.
+ *
+ * @return  The values, or NULL if they could not be built.
+ */
+static double* acquireCachedValues(ServerCache cache, const double* key, const ServerSettings settings) {
+	ServerCacheEntry chosen = NULL;
+	double* values;
+	int i;
+
+	pthread_mutex_lock(&cache->lock);
+	++cache->useCount;
+	for (i = 0; i < SERVER_CACHE_SIZE; ++i) {
+		ServerCacheEntry entry = &cache->entries[i];
+
+		if (entry->values != NULL && !memcmp(entry->key, key, sizeof(entry->key))) {
+			++entry->users;
+			entry->lastUse = cache->useCount;
+			pthread_mutex_unlock(&cache->lock);
+			return entry->values;
+		}
+	}
+	++cache->missCount;
+	pthread_mutex_unlock(&cache->lock);
+
+	// Built outside the lock, so the other requests go on meanwhile; a request which built the same values first wins
+	if ((values = cache->build(key, settings)) == NULL)
+		return NULL;
+	pthread_mutex_lock(&cache->lock);
+	for (i = 0; i < SERVER_CACHE_SIZE; ++i) {
+		ServerCacheEntry entry = &cache->entries[i];
+
+		if (entry->values != NULL && !memcmp(entry->key, key, sizeof(entry->key))) {
+			++entry->users;
+			pthread_mutex_unlock(&cache->lock);
+			free(values);
+			return entry->values;
+		}
+		if (entry->users == 0 && (chosen == NULL || (chosen->values != NULL && (entry->values == NULL || entry->lastUse < chosen->lastUse))))
+			chosen = entry;
+	}
+	// With every entry in use the values are only kept for this request
+	if (chosen != NULL) {
+		free(chosen->values);
+		memcpy(chosen->key, key, sizeof(chosen->key));
+		chosen->values = values;
+		chosen->users = 1;
+		chosen->lastUse = cache->useCount;
+	}
+	pthread_mutex_unlock(&cache->lock);
+	return values;
+}
+
+/**
+ * Release values acquired from the cache, freeing them if they were not kept.
+ */
+static void releaseCachedValues(ServerCache cache, double* values) {
+	int i;
+
+	if (values == NULL)
+		return;
+	pthread_mutex_lock(&cache->lock);
+	for (i = 0; i < SERVER_CACHE_SIZE; ++i)
+		if (cache->entries[i].values == values) {
+			--cache->entries[i].users;
+			pthread_mutex_unlock(&cache->lock);
+			return;
+		}
+	pthread_mutex_unlock(&cache->lock);
+	free(values);
+}
+
+/**
+ * Skip white space.
+ */
+static char* skipJsonSpace(char* cursor) {
+	while (*cursor == ' ' || *cursor == '\t' || *cursor == '\r' || *cursor == '\n')
+		++cursor;
+	return cursor;
+}
+
+/**
+ * Read a JSON string, or the text of a number or literal.
+ *
+ * @param cursor  The start of the value.
+ * @param value   Buffer of SERVER_VALUE_LENGTH bytes receiving the text of the value.
+ *
+ * @return        The text following the value, or NULL if it is not a string, a number or a literal, or too long.
+ */
+static char* readJsonValue(char* cursor, char* value) {
+	size_t length = 0;
+
+	if (*cursor == '"') {
+		for (++cursor; *cursor != '"'; ++cursor) {
+			if (*cursor == '\0' || length + 1 >= SERVER_VALUE_LENGTH)
+				return NULL;
+			if (*cursor == '\\' && *++cursor != '"' && *cursor != '\\' && *cursor != '/')
+				return NULL;
+			value[length++] = *cursor;
+		}
+		value[length] = '\0';
+		return cursor + 1;
+	}
+	while (*cursor != '\0' && strchr(",} \t\r\n", *cursor) == NULL) {
+		if (length + 1 >= SERVER_VALUE_LENGTH)
+			return NULL;
+		value[length++] = *cursor++;
+	}
+	value[length] = '\0';
+	return (length > 0) ? cursor : NULL;
+}
+
+/**
+ * Write a string as a quoted JSON string, escaping the quotes, backslashes and control characters it holds.
+ */
+static void writeJsonString(FILE* oHandle, const char* text) {
+	fputc('"', oHandle);
+	for (; *text != '\0'; ++text) {
+		if (*text == '"' || *text == '\\')
+			fprintf(oHandle, "\\%c", *text);
+		else if ((unsigned char)*text < 0x20)
+			fprintf(oHandle, "\\u%04x", (unsigned char)*text);
+		else
+			fputc(*text, oHandle);
+	}
+	fputc('"', oHandle);
+}
+
+/**
+ * Set the option of a request as its command-line letter would; the server only answers with JSON records.
+ *
+ * @return  0 on success, -1 with the reason in the message otherwise.
+ */
+static int applyRequestOption(const char code, const char* value, SimulationStepper stepper, ModelParameters model,
+                              SimulationParameters simulation, TrajectoryOptions trajectoryOptions, char* message) {
+	if (parseSimulationOption(code, value, stepper, model, simulation, trajectoryOptions, message) != 0)
+		return -1;
+	if (code == 'T' && trajectoryOptions->format != TRAJECTORY_JSON) {
+		snprintf(message, SERVER_MESSAGE_LENGTH, "The server only answers with json or json:summary trajectories");
+		return -1;
+	}
+	return 0;
+}
+
+/**
+ * Apply the options of a request, a flat JSON object keyed by option letters.
+ *
+ * @return  0 on success, -1 with the reason in the message otherwise.
+ */
+static int parseRequest(char* request, SimulationStepper stepper, ModelParameters model, SimulationParameters simulation,
+                        TrajectoryOptions trajectoryOptions, char* message) {
+	char* cursor = skipJsonSpace(request);
+
+	if (*cursor++ != '{') {
+		snprintf(message, SERVER_MESSAGE_LENGTH, "The request must be a JSON object");
+		return -1;
+	}
+	cursor = skipJsonSpace(cursor);
+	if (*cursor == '}')
+		return 0;
+	for (;;) {
+		char name[SERVER_VALUE_LENGTH];
+		char value[SERVER_VALUE_LENGTH];
+
+		if (*cursor != '"' || (cursor = readJsonValue(cursor, name)) == NULL || *(cursor = skipJsonSpace(cursor)) != ':' ||
+		    (cursor = readJsonValue(skipJsonSpace(cursor + 1), value)) == NULL) {
+			snprintf(message, SERVER_MESSAGE_LENGTH, "The request must be a flat JSON object of strings and numbers");
+			return -1;
+		}
+		if (strlen(name) != 1) {
+			snprintf(message, SERVER_MESSAGE_LENGTH, "The keys of the request are option letters");
+			return -1;
+		}
+		if (applyRequestOption(name[0], value, stepper, model, simulation, trajectoryOptions, message) != 0)
+			return -1;
+		cursor = skipJsonSpace(cursor);
+		if (*cursor == '}')
+			return 0;
+		if (*cursor++ != ',') {
+			snprintf(message, SERVER_MESSAGE_LENGTH, "The request must be a flat JSON object of strings and numbers");
+			return -1;
+		}
+		cursor = skipJsonSpace(cursor);
+	}
+}
+
+/**
+ * Read a request up to its newline or the end of the client's side of the connection.
+ *
+ * @return  0 on success, -1 with the reason in the message otherwise.
+ */
+static int readRequest(const int connection, char* request, char* message) {
+	size_t length = 0;
+
+	while (length < SERVER_REQUEST_MAX_LENGTH) {
+		const ssize_t count = read(connection, request + length, SERVER_REQUEST_MAX_LENGTH - length);
+
+		if (count < 0 && errno == EINTR)
+			continue;
+		if (count < 0) {
+			snprintf(message, SERVER_MESSAGE_LENGTH, "The request could not be read");
+			return -1;
+		}
+		if (count == 0 || memchr(request + length, '\n', count) != NULL) {
+			request[length + count] = '\0';
+			return 0;
+		}
+		length += count;
+	}
+	snprintf(message, SERVER_MESSAGE_LENGTH, "The request is longer than %d bytes", SERVER_REQUEST_MAX_LENGTH);
+	return -1;
+}
+
+/**
+ * Run the simulation of a request, streaming its trajectory to the client.
+ *
+ * @return  GSL_SUCCESS, or an error with the reason in the message.
+ */
+static int simulateRequest(SimulationServer server, SimulationWorkspace workspace, char* request, FILE* oHandle, char* message) {
+	struct _SimulationStepper stepper = *server->settings->stepper;
+	struct _ModelParameters model = *server->settings->model;
+	struct _SimulationParameters simulation = *server->settings->simulation;
+	struct _TrajectoryOptions trajectoryOptions = *server->settings->trajectoryOptions;
+	struct _ResultKey resultKey;
+	struct _ResultSummary resultSummary;
+	ResultEntry resultEntry = NULL;
+	FILE* cachedResult;
+	ModelParameters mParam = NULL;
+	TrajectoryWriter trajectory = NULL;
+	double* profile;
+	double* state;
+	int status = GSL_SUCCESS;
+
+	trajectoryOptions.format = TRAJECTORY_JSON;
+	if (parseRequest(request, &stepper, &model, &simulation, &trajectoryOptions, message) != 0)
+		return GSL_EINVAL;
+	if (!(simulation.stepSize > 0.0) || !(simulation.endTime >= simulation.stepSize)) {
+		snprintf(message, SERVER_MESSAGE_LENGTH, "The time needs [end (s)]:[interval (s)] with 0 < interval <= end");
+		return GSL_EINVAL;
+	}
+	model.timepoints = (int)countSimulationTicks(0.0, simulation.endTime, simulation.stepSize);
+	model.steptime = simulation.stepSize;
+	applyDefaultThresholds(&model);
+	if (sanityCheckModelParameters(&model) != 0) {
+		snprintf(message, SERVER_MESSAGE_LENGTH, "Bad parameters supplied");
+		return GSL_EINVAL;
+	}
+
+	if ((mParam = reserveWorkspaceParameters(workspace, model.timepoints)) == NULL) {
+		snprintf(message, SERVER_MESSAGE_LENGTH, "Out of memory");
+		return GSL_ENOMEM;
+	}
+	*mParam = model;
+	mParam->hyperGeometricMatrix = NULL;
+	{
+		const double key[SERVER_CACHE_KEY_LENGTH] = { model.timepoints, model.intracellularVolume, model.molecularweight };
+
+		if ((profile = acquireCachedValues(&server->profiles, key, server->settings)) == NULL) {
+			snprintf(message, SERVER_MESSAGE_LENGTH, "The input file could not be read");
+			status = GSL_EFAILED;
+			goto cleanup;
+		}
+		memcpy(mParam->realantibioticconc, profile, sizeof(double) * (model.timepoints + 1));
+		releaseCachedValues(&server->profiles, profile);
+	}
+	if (server->settings->resultCache != NULL) {
+		// A request already answered is copied from the result cache; another is copied into it as it is streamed
+		makeResultKey(&resultKey, &stepper, mParam, &simulation, &trajectoryOptions);
+		if ((cachedResult = findCachedResult(server->settings->resultCache, &resultKey, &resultSummary)) != NULL) {
+			if (copyCachedResult(cachedResult, oHandle) != 0) {
+				snprintf(message, SERVER_MESSAGE_LENGTH, "The reply could not be written");
+				status = GSL_EFAILED;
+			}
+			goto cleanup;
+		}
+		if ((resultEntry = beginCachedResult(server->settings->resultCache, &resultKey)) != NULL)
+			trajectoryOptions.copyHandle = resultEntry->oHandle;
+	}
+	{
+		const double key[SERVER_CACHE_KEY_LENGTH] = { model.targetMoleculeCount, model.replicationThreshold, 0.0 };
+
+		if ((mParam->hyperGeometricMatrix = acquireCachedValues(&server->matrices, key, server->settings)) == NULL) {
+			snprintf(message, SERVER_MESSAGE_LENGTH, "Out of memory");
+			status = GSL_ENOMEM;
+			goto cleanup;
+		}
+	}
+	if ((state = resetWorkspaceState(workspace, model.targetMoleculeCount, simulation.startingAntibiotic, simulation.startingPopulation)) == NULL ||
+	    (trajectory = openTrajectoryStream(oHandle, &trajectoryOptions, mParam, "")) == NULL) {
+		snprintf(message, SERVER_MESSAGE_LENGTH, "Out of memory");
+		status = GSL_ENOMEM;
+		goto cleanup;
+	}
+	status = runWorkspaceSimulation(workspace, &stepper, simulation.endTime, simulation.stepSize, trajectory);
+	if (closeTrajectoryWriter(trajectory) != 0 && status == GSL_SUCCESS)
+		status = GSL_EFAILED;
+	if (status != GSL_SUCCESS)
+		snprintf(message, SERVER_MESSAGE_LENGTH, "The simulation failed: %s", gsl_strerror(status));
+	else if (resultEntry != NULL) {
+		int i;
+
+		resultSummary.finalPopulation = 0.0;
+		for (i = NUMBER_FREE_KINETIC_VARIABLES; i < model.targetMoleculeCount + NUMBER_FREE_KINETIC_VARIABLES + 1; ++i)
+			resultSummary.finalPopulation += state[i];
+		resultSummary.acceptedSteps = workspace->results.acceptedSteps;
+		resultSummary.rejectedSteps = workspace->results.rejectedSteps;
+		finishCachedResult(resultEntry, &resultSummary);
+		resultEntry = NULL;
+	}
+
+cleanup:
+	finishCachedResult(resultEntry, NULL);
+	releaseCachedValues(&server->matrices, mParam->hyperGeometricMatrix);
+	mParam->hyperGeometricMatrix = NULL;
+	return status;
+}
+
+/**
+ * Split a batch into its items, ending each in place.
+ *
+ * @param request  The batch, a JSON array of flat objects.
+ * @param items    Array of SERVER_BATCH_MAX_ITEMS items receiving the requests.
+ *
+ * @return         The number of items, or -1 with the reason in the message.
+ */
+static int splitBatch(char* request, struct _BatchItem* items, char* message) {
+	char* cursor = skipJsonSpace(skipJsonSpace(request) + 1);
+	int count = 0;
+
+	if (*cursor == ']')
+		return 0;
+	for (;;) {
+		char* end;
+		char separator;
+		int quoted = 0;
+
+		if (*cursor != '{') {
+			snprintf(message, SERVER_MESSAGE_LENGTH, "The batch must be a JSON array of flat objects");
+			return -1;
+		}
+		// Items are flat, so an item ends at its first closing brace outside a string
+		for (end = cursor + 1; *end != '\0' && (quoted || *end != '}'); ++end) {
+			if (quoted && *end == '\\' && end[1] != '\0')
+				++end;
+			else if (*end == '"')
+				quoted = !quoted;
+		}
+		if (*end == '\0') {
+			snprintf(message, SERVER_MESSAGE_LENGTH, "The batch must be a JSON array of flat objects");
+			return -1;
+		}
+		if (count == SERVER_BATCH_MAX_ITEMS) {
+			snprintf(message, SERVER_MESSAGE_LENGTH, "The batch has more than %d items", SERVER_BATCH_MAX_ITEMS);
+			return -1;
+		}
+		items[count++].request = cursor;
+		cursor = skipJsonSpace(end + 1);
+		separator = *cursor;
+		end[1] = '\0';
+		if (separator == ']')
+			return count;
+		if (separator != ',') {
+			snprintf(message, SERVER_MESSAGE_LENGTH, "The batch must be a JSON array of flat objects");
+			return -1;
+		}
+		cursor = skipJsonSpace(cursor + 1);
+	}
+}
+
+/**
+ * Write the status and records of an item, and free its records.
+ */
+static void writeBatchItem(SimulationBatch batch, BatchItem item) {
+	const int index = (int)(item - batch->items);
+
+	if (item->status == GSL_SUCCESS) {
+		fprintf(batch->oHandle, "{\"type\":\"item\",\"index\":%d,\"status\":\"ok\"}\n", index);
+		fwrite(item->reply, 1, item->replyLength, batch->oHandle);
+	} else {
+		fprintf(batch->oHandle, "{\"type\":\"item\",\"index\":%d,\"status\":\"error\",\"message\":", index);
+		writeJsonString(batch->oHandle, item->message);
+		fputs("}\n", batch->oHandle);
+		++batch->failedCount;
+	}
+	fflush(batch->oHandle);
+	free(item->reply);
+	item->reply = NULL;
+}
+
+/**
+ * Parallel task: run one item of a batch into its buffer, then write the items which are next in order.
+ */
+static int runBatchItem(const int taskIndex, const int workerIndex, void* context) {
+	SimulationBatch batch = (SimulationBatch)context;
+	BatchItem item = &batch->items[taskIndex];
+	SimulationWorkspace workspace = (workerIndex == 0) ? batch->workspace : &batch->workspaces[workerIndex - 1];
+	FILE* oHandle;
+
+	if ((oHandle = open_memstream(&item->reply, &item->replyLength)) == NULL) {
+		snprintf(item->message, SERVER_MESSAGE_LENGTH, "Out of memory");
+		item->status = GSL_ENOMEM;
+	} else {
+		item->status = simulateRequest(batch->server, workspace, item->request, oHandle, item->message);
+		if (fclose(oHandle) != 0 && item->status == GSL_SUCCESS) {
+			snprintf(item->message, SERVER_MESSAGE_LENGTH, "Out of memory");
+			item->status = GSL_ENOMEM;
+		}
+	}
+
+	pthread_mutex_lock(&batch->lock);
+	item->finished = 1;
+	while (batch->writtenCount < batch->itemCount && batch->items[batch->writtenCount].finished)
+		writeBatchItem(batch, &batch->items[batch->writtenCount++]);
+	pthread_mutex_unlock(&batch->lock);
+	// A failed item does not stop the others
+	return 0;
+}
+
+/**
+ * Run the items of a batch concurrently, writing their replies in order and then the batch record.
+ *
+ * @return  0 on success, -1 with the reason in the message if the batch could not be run.
+ */
+static int answerBatch(SimulationServer server, SimulationWorkspace workspace, char* request, FILE* oHandle, char* message) {
+	const int threadCount = (server->settings->threadCount < 1) ? 1 : server->settings->threadCount;
+	const unsigned long previousAllocations = workspace->allocationCount;
+	struct _SimulationBatch batch;
+	unsigned long allocationCount;
+	int w;
+
+	memset(&batch, 0, sizeof(batch));
+	if ((batch.items = (struct _BatchItem*)calloc(SERVER_BATCH_MAX_ITEMS, sizeof(struct _BatchItem))) == NULL ||
+	    (batch.workspaces = (struct _SimulationWorkspace*)calloc(threadCount, sizeof(struct _SimulationWorkspace))) == NULL) {
+		snprintf(message, SERVER_MESSAGE_LENGTH, "Out of memory");
+		free(batch.items);
+		return -1;
+	}
+	if ((batch.itemCount = splitBatch(request, batch.items, message)) < 0) {
+		free(batch.workspaces);
+		free(batch.items);
+		return -1;
+	}
+	batch.server = server;
+	batch.workspace = workspace;
+	batch.oHandle = oHandle;
+	pthread_mutex_init(&batch.lock, NULL);
+	runParallelTasks(batch.itemCount, threadCount, runBatchItem, &batch);
+	// The worker's own workspace counts the buffers of its earlier requests too
+	allocationCount = workspace->allocationCount - previousAllocations;
+	for (w = 0; w < threadCount - 1; ++w)
+		allocationCount += batch.workspaces[w].allocationCount;
+	fprintf(oHandle, "{\"type\":\"batch\",\"items\":%d,\"failed\":%d,\"allocations\":%lu}\n", batch.itemCount, batch.failedCount,
+	        allocationCount);
+	pthread_mutex_destroy(&batch.lock);
+	for (w = 0; w < threadCount - 1; ++w)
+		freeSimulationWorkspace(&batch.workspaces[w]);
+	free(batch.workspaces);
+	free(batch.items);
+	return 0;
+}
+
+/**
+ * Answer the request of one connection and close it.
+ */
+static void answerRequest(SimulationServer server, SimulationWorkspace workspace, const int connection, char* request) {
+	const struct timeval timeout = { SERVER_REQUEST_TIMEOUT, 0 };
+	char message[SERVER_MESSAGE_LENGTH];
+	FILE* oHandle;
+
+	setsockopt(connection, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+	if ((oHandle = fdopen(connection, "w")) == NULL) {
+		close(connection);
+		return;
+	}
+	if (readRequest(connection, request, message) != 0 ||
+	    ((*skipJsonSpace(request) == '[') ? answerBatch(server, workspace, request, oHandle, message)
+	                                      : simulateRequest(server, workspace, request, oHandle, message)) != 0) {
+		fputs("{\"type\":\"error\",\"message\":", oHandle);
+		writeJsonString(oHandle, message);
+		fputs("}\n", oHandle);
+	}
+	fclose(oHandle);
+	pthread_mutex_lock(&server->lock);
+	++server->requestCount;
+	pthread_mutex_unlock(&server->lock);
+}
+
+/**
+ * Worker: answer the connections it accepts until the server stops.
+ */
+static void* runServerWorker(void* argument) {
+	SimulationServer server = (SimulationServer)argument;
+	struct _SimulationWorkspace workspace;
+	char* request = (char*)malloc(SERVER_REQUEST_MAX_LENGTH + 1);
+
+	if (request == NULL)
+		return NULL;
+	memset(&workspace, 0, sizeof(workspace));
+	for (;;) {
+		const int connection = accept(server->listener, NULL, NULL);
+
+		if (connection >= 0)
+			answerRequest(server, &workspace, connection, request);
+		else if (server->stopping)
+			break;
+		else if (errno != EINTR && errno != ECONNABORTED)
+			fprintf(stderr, "Could not accept a connection: %s\n", strerror(errno));
+	}
+	freeSimulationWorkspace(&workspace);
+	free(request);
+	return NULL;
+}
+
+/**
+ * Free the entries of a cache.
+ */
+static void freeServerCache(ServerCache cache) {
+	int i;
+
+	for (i = 0; i < SERVER_CACHE_SIZE; ++i)
+		free(cache->entries[i].values);
+	pthread_mutex_destroy(&cache->lock);
+}
+
+/**
+ * Set up the caches and counts of a server, without its socket.
+ */
+static void initSimulationServer(SimulationServer server, const ServerSettings settings) {
+	memset(server, 0, sizeof(struct _SimulationServer));
+	server->settings = settings;
+	server->listener = -1;
+	server->matrices.build = buildMatrix;
+	server->profiles.build = buildProfile;
+	pthread_mutex_init(&server->matrices.lock, NULL);
+	pthread_mutex_init(&server->profiles.lock, NULL);
+	pthread_mutex_init(&server->lock, NULL);
+}
+
+/**
+ * Free the caches of a server.
+ */
+static void freeSimulationServer(SimulationServer server) {
+	freeServerCache(&server->matrices);
+	freeServerCache(&server->profiles);
+	pthread_mutex_destroy(&server->lock);
+}
+
+/**
+ * Run a batch read from a file as the server would answer it, without a socket.
+ *
+ * @param settings  The input file, the number of items run at once and the defaults of the items; the socket is unused.
+ * @param iHandle   The batch, a JSON array of flat objects keyed by option letters.
+ * @param oHandle   Receives the records of the items, in order, and the batch record.
+ *
+ * @return          GSL_SUCCESS once the items were run, whether or not each succeeded, or GSL_EINVAL if the batch could
+ *                  not be read.
+ */
+int runSimulationBatch(const ServerSettings settings, FILE* iHandle, FILE* oHandle) {
+	struct _SimulationServer server;
+	struct _SimulationWorkspace workspace;
+	char message[SERVER_MESSAGE_LENGTH];
+	char* request = (char*)malloc(SERVER_REQUEST_MAX_LENGTH + 1);
+	size_t length;
+	int status = GSL_SUCCESS;
+
+	if (request == NULL) {
+		fprintf(stderr, "Could not allocate the batch\n");
+		return GSL_ENOMEM;
+	}
+	length = fread(request, 1, SERVER_REQUEST_MAX_LENGTH + 1, iHandle);
+	request[(length > SERVER_REQUEST_MAX_LENGTH) ? SERVER_REQUEST_MAX_LENGTH : length] = '\0';
+	if (ferror(iHandle) || length > SERVER_REQUEST_MAX_LENGTH || *skipJsonSpace(request) != '[') {
+		fprintf(stderr, "The batch must be a JSON array of at most %d bytes\n", SERVER_REQUEST_MAX_LENGTH);
+		free(request);
+		return GSL_EINVAL;
+	}
+
+	// As in the server, a failing item is reported in its record rather than aborting the batch
+	gsl_set_error_handler_off();
+	initSimulationServer(&server, settings);
+	memset(&workspace, 0, sizeof(workspace));
+	if (answerBatch(&server, &workspace, request, oHandle, message) != 0) {
+		fprintf(stderr, "%s\n", message);
+		status = GSL_EINVAL;
+	}
+	freeSimulationWorkspace(&workspace);
+	freeSimulationServer(&server);
+	free(request);
+	return status;
+}
+
+/**
+ * Answer the requests sent to the socket until SIGINT or SIGTERM.
+ *
+ * @param settings  The socket, the input file, the number of workers and the defaults of the requests.
+ *
+ * @return          GSL_SUCCESS once stopped, or GSL_EFAILED if the socket could not be set up.
+ */
+int runSimulationServer(const ServerSettings settings) {
+	struct _SimulationServer server;
+	struct sockaddr_un address;
+	struct stat existing;
+	pthread_t* workers;
+	sigset_t signals;
+	int workerCount = (settings->threadCount < 1) ? 1 : settings->threadCount;
+	int started = 0, received, w;
+
+	memset(&address, 0, sizeof(address));
+	if (strlen(settings->socketPath) >= sizeof(address.sun_path)) {
+		fprintf(stderr, "The socket path %s is too long\n", settings->socketPath);
+		return GSL_EFAILED;
+	}
+	address.sun_family = AF_UNIX;
+	strcpy(address.sun_path, settings->socketPath);
+	initSimulationServer(&server, settings);
+
+	// Errors are reported to the client rather than aborting the server, and a client leaving early only ends its own reply
+	gsl_set_error_handler_off();
+	signal(SIGPIPE, SIG_IGN);
+	// The workers inherit the blocked signals, so only the main thread takes the stop request
+	sigemptyset(&signals);
+	sigaddset(&signals, SIGINT);
+	sigaddset(&signals, SIGTERM);
+	pthread_sigmask(SIG_BLOCK, &signals, NULL);
+
+	// The socket of a previous server which did not stop cleanly is replaced
+	if (stat(settings->socketPath, &existing) == 0 && S_ISSOCK(existing.st_mode))
+		unlink(settings->socketPath);
+	if ((server.listener = socket(AF_UNIX, SOCK_STREAM, 0)) < 0 || bind(server.listener, (struct sockaddr*)&address, sizeof(address)) != 0 ||
+	    listen(server.listener, SERVER_LISTEN_BACKLOG) != 0) {
+		fprintf(stderr, "Could not listen on %s: %s\n", settings->socketPath, strerror(errno));
+		if (server.listener >= 0)
+			close(server.listener);
+		freeSimulationServer(&server);
+		return GSL_EFAILED;
+	}
+	if ((workers = (pthread_t*)malloc(sizeof(pthread_t) * workerCount)) != NULL)
+		for (started = 0; started < workerCount; ++started)
+			if (pthread_create(&workers[started], NULL, runServerWorker, &server) != 0)
+				break;
+	if (started > 0) {
+		printf("Listening on %s with %d workers\n", settings->socketPath, started);
+		fflush(stdout);
+		sigwait(&signals, &received);
+	} else
+		fprintf(stderr, "Could not start the workers\n");
+
+	server.stopping = 1;
+	shutdown(server.listener, SHUT_RDWR);
+	for (w = 0; w < started; ++w)
+		pthread_join(workers[w], NULL);
+	free(workers);
+	close(server.listener);
+	unlink(settings->socketPath);
+	printf("%lu requests answered; %lu of %lu profiles and %lu of %lu matrices were read from the cache\n", server.requestCount,
+	       server.profiles.useCount - server.profiles.missCount, server.profiles.useCount,
+	       server.matrices.useCount - server.matrices.missCount, server.matrices.useCount);
+	if (settings->resultCache != NULL)
+		printf("Result cache: %lu hits, %lu misses\n", settings->resultCache->hitCount, settings->resultCache->missCount);
+	freeSimulationServer(&server);
+	return (started > 0) ? GSL_SUCCESS : GSL_EFAILED;
+}
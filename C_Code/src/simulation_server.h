@@ -0,0 +1,34 @@
+/**
+ * @file   simulation_server.h
+ * @version 5
+ * @updated  2026
+ * @brief  Long-running simulation server answering parameter sets over a Unix domain socket
+ */
+
+#define SERVER_REQUEST_MAX_LENGTH 65536  ///< Longest request accepted, in bytes
+#define SERVER_REQUEST_TIMEOUT 10        ///< Seconds a client has to send its request
+#define SERVER_MESSAGE_LENGTH SIMULATION_MESSAGE_LENGTH ///< Longest error message sent back
+#define SERVER_VALUE_LENGTH 64           ///< Longest key or value in a request
+#define SERVER_LISTEN_BACKLOG 64         ///< Connections queued while every worker is busy
+#define SERVER_CACHE_SIZE 16             ///< Hypergeometric matrices, and concentration profiles, kept between requests
+#define SERVER_CACHE_KEY_LENGTH 3        ///< Values identifying a cached matrix or profile
+#define SERVER_BATCH_MAX_ITEMS 1024      ///< Most parameter sets in one batch request
+
+/**
+ * Structure to hold the settings of the server; the options given with it on the command-line are the defaults of
+ * every request
+ */
+typedef struct _ServerSettings {
+	const char* socketPath;                ///< Path of the Unix domain socket listened on.
+	const char* inputFile;                 ///< Input file of the concentration profile of every request.
+	int threadCount;                       ///< Number of workers, each answering one request at a time.
+	SimulationStepper stepper;             ///< Default integrator.
+	ModelParameters model;                 ///< Default model parameters, the thresholds possibly still DEFAULT_DUMMY.
+	SimulationParameters simulation;       ///< Default dose, population and time-points.
+	TrajectoryOptions trajectoryOptions;   ///< Default columns and decimation of the replies.
+	struct _ResultCache* resultCache;      ///< Cache of the replies, or NULL.
+} *ServerSettings;
+
+int runSimulationServer(const ServerSettings settings);
+
+int runSimulationBatch(const ServerSettings settings, FILE* iHandle, FILE* oHandle);
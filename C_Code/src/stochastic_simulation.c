@@ -0,0 +1,652 @@
+/**
+ * @file   stochastic_simulation.c
+ * @version 5
+ * @updated  2026
+ * @brief  Stochastic simulation of the bacterial compartments by adaptive tau-leaping, run as parallel ensembles
+ *
+ * The cells of compartment i, those with i bound targets, are whole numbers and change through the reactions of the
+ * deterministic model in full_model.c, each consuming one cell of the compartment:
+ *
+ *     binding      B_i -> B_i+1           propensity k_f / (N_A V_i) A(t) (n - i) B_i     (i < n)
+ *     unbinding    B_i -> B_i-1           propensity k_r i B_i                            (i > 0)
+ *     division     B_i -> B_j + B_i-j     propensity r (1 - N / K) B_i                    (i below the replication threshold)
+ *     death        B_i -> 0               propensity k_max B_i                            (i from the killing threshold)
+ *
+ * A dividing cell with i bound targets splits them between its daughters as the hypergeometric matrix of the
+ * deterministic model gives, so the expected rates are those of the differential equations. The extracellular
+ * targets and complexes are not tracked, since they do not act on the cells, and the drug concentration is read from
+ * the profile at the start of each step.
+ *
+ * Steps follow the adaptive tau-leaping of Cao, Gillespie and Petzold (J. Chem. Phys. 124, 044109, 2006): the leap is
+ * the longest over which no compartment is expected to change by more than the tolerance, the reactions of the
+ * compartments with fewer than STOCHASTIC_CRITICAL_COUNT cells fire at most once per leap, and a leap which would drive a
+ * compartment negative is halved and redrawn. When the leap would cover only a few reactions, as near extinction, exact
+ * steps of the stochastic simulation algorithm are taken instead.
+ *
+ * With a hybrid threshold, the compartments holding at least that many cells are integrated as the differential
+ * equations instead, and only the sparse compartments, which decide eradication, are simulated exactly. The partition
+ * is renewed at every step as compartments cross the threshold.
+ *
+ * Each replicate is one task on the parallel runner with its own random stream, seeded from the seed and its index, so
+ * the ensemble is the same whatever the number of threads. Extinction is absorbing, so a replicate only records the
+ * time-point from which it has no cells; the workers count extinctions in integers which are summed at the end.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <limits.h>
+#include <gsl/gsl_odeiv2.h>
+#include <gsl/gsl_errno.h>
+#include <gsl/gsl_linalg.h>
+#include <gsl/gsl_rng.h>
+#include <gsl/gsl_randist.h>
+#include "full_model.h"
+#include "fixed_step.h"
+#include "positive_step.h"
+#include "sensitivity.h"
+#include "base_simulation.h"
+#include "parallel_runner.h"
+#include "stochastic_simulation.h"
+
+/**
+ * Reactions of one compartment
+ */
+enum {
+	CHANNEL_BINDING,
+	CHANNEL_UNBINDING,
+	CHANNEL_DIVISION,
+	CHANNEL_DEATH,
+	CHANNEL_COUNT
+};
+
+/**
+ * Private workspace of one worker
+ */
+typedef struct _StochasticWorker {
+	gsl_rng* rng;               ///< Random number generator, reseeded for each replicate.
+	double* counts;             ///< Cells in each compartment.
+	double* trial;              ///< Cells in each compartment after a trial leap.
+	double* propensities;       ///< Propensity of every reaction, CHANNEL_COUNT per compartment.
+	double* drift;              ///< Expected change of each compartment per unit time.
+	double* spread;             ///< Variance of the change of each compartment per unit time.
+	unsigned int* daughters;    ///< Number of divisions giving each split of the bound targets.
+	int* bulk;                  ///< Non-zero for the compartments whose reactions are leaped or integrated in the current step.
+	gsl_matrix* system;         ///< Implicit Euler system of the hybrid step.
+	gsl_permutation* permutation; ///< Row permutation of its LU decomposition.
+	gsl_vector* solution;       ///< Cells at the end of the hybrid step.
+	unsigned int* extinctCount; ///< Number of the worker's replicates without a cell at each time-point.
+	unsigned long leapCount;    ///< Number of the worker's leaps or hybrid steps.
+	unsigned long exactStepCount; ///< Number of the worker's exact steps.
+	int replicateCount;         ///< Number of the worker's replicates.
+} *StochasticWorker;
+
+/**
+ * Context of the ensemble shared by all tasks
+ */
+typedef struct _StochasticRun {
+	ModelParameters mParam;       ///< The model parameters, read only.
+	StochasticSettings settings;  ///< The size and the accuracy of the ensemble.
+	double timeInterval;          ///< Interval between the time-points.
+	int tickCount;                ///< Number of time-points.
+	const double* initialState;   ///< The initial state; the compartments are rounded to whole cells.
+	int divisionCount;            ///< Number of compartments whose cells divide.
+	double* splitProbability;     ///< Probability of each split of the bound targets, one row per dividing compartment.
+	StochasticWorker workers;     ///< The workspaces, one per worker.
+} *StochasticRun;
+
+/**
+ * Fill the propensities of every reaction at the current state.
+ *
+ * @return  The total propensity.
+ */
+static double calculatePropensities(const StochasticRun run, StochasticWorker worker, const double curTime) {
+	const ModelParameters mParam = run->mParam;
+	const int n = mParam->targetMoleculeCount;
+	const int timetocon = (int)floor(curTime / mParam->steptime);
+	const double antibiotic = (curTime - timetocon * mParam->steptime) * (mParam->realantibioticconc[timetocon + 1] - mParam->realantibioticconc[timetocon])
+	                        / mParam->steptime + mParam->realantibioticconc[timetocon];
+	const double bindingRate = mParam->targetAssociationRate / (AVOGADRO_CONSTANT * mParam->intracellularVolume) * antibiotic;
+	double population = 0.0;
+	double replicationRate;
+	double total = 0.0;
+	int i;
+
+	for (i = 0; i <= n; ++i)
+		population += worker->counts[i];
+	replicationRate = mParam->baselineReplication * fmax((mParam->carryingCapacity - population) / mParam->carryingCapacity, 0.0);
+	for (i = 0; i <= n; ++i) {
+		double* propensity = worker->propensities + i * CHANNEL_COUNT;
+
+		propensity[CHANNEL_BINDING] = (i < n) ? bindingRate * (n - i) * worker->counts[i] : 0.0;
+		propensity[CHANNEL_UNBINDING] = mParam->targetDissociationRate * i * worker->counts[i];
+		propensity[CHANNEL_DIVISION] = (i < run->divisionCount) ? replicationRate * worker->counts[i] : 0.0;
+		propensity[CHANNEL_DEATH] = (i >= mParam->killingThreshold) ? mParam->maximumKillRate * worker->counts[i] : 0.0;
+		total += propensity[CHANNEL_BINDING] + propensity[CHANNEL_UNBINDING] + propensity[CHANNEL_DIVISION] + propensity[CHANNEL_DEATH];
+	}
+	return total;
+}
+
+/**
+ * Fire a reaction of a compartment a number of times.
+ */
+static void fireReaction(const StochasticRun run, StochasticWorker worker, double* counts, const int compartment, const int channel,
+                         const unsigned int times) {
+	int j;
+
+	counts[compartment] -= times;
+	switch (channel) {
+	case CHANNEL_BINDING:
+		counts[compartment + 1] += times;
+		break;
+	case CHANNEL_UNBINDING:
+		counts[compartment - 1] += times;
+		break;
+	case CHANNEL_DIVISION:
+		gsl_ran_multinomial(worker->rng, compartment + 1, times, run->splitProbability + (size_t)compartment * run->divisionCount,
+		                    worker->daughters);
+		for (j = 0; j <= compartment; ++j) {
+			counts[j] += worker->daughters[j];
+			counts[compartment - j] += worker->daughters[j];
+		}
+		break;
+	}
+}
+
+/**
+ * Longest leap over which no compartment is expected to change by more than the tolerance through the reactions of the
+ * compartments holding at least the given number of cells. The variance of the change bounds the leap only when the
+ * reactions are leaped, not when they are integrated.
+ */
+static double calculateLeapTime(const StochasticRun run, StochasticWorker worker, const double minimumCount, const int boundSpread) {
+	const int n = run->mParam->targetMoleculeCount;
+	double leap = INFINITY;
+	int i, j;
+
+	memset(worker->drift, 0, sizeof(double) * (n + 1));
+	memset(worker->spread, 0, sizeof(double) * (n + 1));
+	for (i = 0; i <= n; ++i) {
+		const double* propensity = worker->propensities + i * CHANNEL_COUNT;
+		const double* split = run->splitProbability + (size_t)i * run->divisionCount;
+
+		if (worker->counts[i] < minimumCount)
+			continue;
+		worker->drift[i] -= propensity[CHANNEL_BINDING] + propensity[CHANNEL_UNBINDING] + propensity[CHANNEL_DIVISION] + propensity[CHANNEL_DEATH];
+		worker->spread[i] += propensity[CHANNEL_BINDING] + propensity[CHANNEL_UNBINDING] + propensity[CHANNEL_DIVISION] + propensity[CHANNEL_DEATH];
+		if (i < n) {
+			worker->drift[i + 1] += propensity[CHANNEL_BINDING];
+			worker->spread[i + 1] += propensity[CHANNEL_BINDING];
+		}
+		if (i > 0) {
+			worker->drift[i - 1] += propensity[CHANNEL_UNBINDING];
+			worker->spread[i - 1] += propensity[CHANNEL_UNBINDING];
+		}
+		if (propensity[CHANNEL_DIVISION] > 0.0)
+			for (j = 0; j <= i; ++j) {
+				worker->drift[j] += 2.0 * split[j] * propensity[CHANNEL_DIVISION];
+				worker->spread[j] += 4.0 * split[j] * propensity[CHANNEL_DIVISION];
+			}
+	}
+	// Only the reactant compartments of the leaped reactions bound the leap, as in Cao, Gillespie and Petzold
+	for (i = 0; i <= n; ++i) {
+		const double bound = fmax(run->settings->tauTolerance * worker->counts[i], 1.0);
+
+		if (worker->counts[i] < minimumCount)
+			continue;
+		if (worker->drift[i] != 0.0)
+			leap = fmin(leap, bound / fabs(worker->drift[i]));
+		if (boundSpread && worker->spread[i] > 0.0)
+			leap = fmin(leap, bound * bound / worker->spread[i]);
+	}
+	return leap;
+}
+
+/**
+ * Pick one reaction with probability proportional to its propensity among those of the compartments not in the bulk.
+ */
+static void pickReaction(const StochasticRun run, StochasticWorker worker, const double total, const int* bulk, int* compartment,
+                         int* channel) {
+	const int n = run->mParam->targetMoleculeCount;
+	double target = gsl_rng_uniform(worker->rng) * total;
+	int i, c;
+
+	*compartment = -1;
+	for (i = 0; i <= n; ++i) {
+		if (bulk != NULL && bulk[i])
+			continue;
+		for (c = 0; c < CHANNEL_COUNT; ++c) {
+			const double propensity = worker->propensities[i * CHANNEL_COUNT + c];
+
+			if (propensity <= 0.0)
+				continue;
+			*compartment = i;
+			*channel = c;
+			if ((target -= propensity) < 0.0)
+				return;
+		}
+	}
+}
+
+/**
+ * Total propensity of the reactions of the compartments not in the bulk.
+ */
+static double sumPropensities(const StochasticRun run, const StochasticWorker worker, const int* bulk) {
+	const int n = run->mParam->targetMoleculeCount;
+	double total = 0.0;
+	int i, c;
+
+	for (i = 0; i <= n; ++i)
+		if (bulk == NULL || !bulk[i])
+			for (c = 0; c < CHANNEL_COUNT; ++c)
+				total += worker->propensities[i * CHANNEL_COUNT + c];
+	return total;
+}
+
+/**
+ * Take exact steps of the reactions of the compartments not in the bulk, or of all compartments without a bulk, until
+ * the end time or the largest number of steps. The propensities must be current.
+ */
+static void advanceExactly(const StochasticRun run, StochasticWorker worker, double* curTime, const double endTime, const int* bulk,
+                           const int maxSteps) {
+	double total = sumPropensities(run, worker, bulk);
+	int step;
+
+	for (step = 0; step < maxSteps && total > 0.0; ++step) {
+		int compartment, channel;
+
+		// The waiting time is memoryless, so a reaction beyond the end time is not kept
+		if ((*curTime += gsl_ran_exponential(worker->rng, 1.0 / total)) >= endTime) {
+			*curTime = endTime;
+			return;
+		}
+		pickReaction(run, worker, total, bulk, &compartment, &channel);
+		fireReaction(run, worker, worker->counts, compartment, channel, 1);
+		++worker->exactStepCount;
+		calculatePropensities(run, worker, *curTime);
+		total = sumPropensities(run, worker, bulk);
+	}
+	if (total <= 0.0)
+		*curTime = endTime;
+}
+
+/**
+ * Advance a replicate to the end time by adaptive tau-leaping, with exact steps when a leap would cover few reactions.
+ */
+static void advanceTauLeaping(const StochasticRun run, StochasticWorker worker, double* curTime, const double endTime) {
+	const int n = run->mParam->targetMoleculeCount;
+	int i, c;
+
+	while (*curTime < endTime) {
+		const double total = calculatePropensities(run, worker, *curTime);
+		double leap, criticalTotal, criticalLeap;
+
+		if (total <= 0.0)
+			break;
+		leap = calculateLeapTime(run, worker, STOCHASTIC_CRITICAL_COUNT, 1);
+		if (leap < STOCHASTIC_SSA_FACTOR / total) {
+			advanceExactly(run, worker, curTime, endTime, NULL, STOCHASTIC_SSA_STEPS);
+			continue;
+		}
+
+		// The compartments with fewer cells than the critical count are not leaped
+		for (i = 0; i <= n; ++i)
+			worker->bulk[i] = (worker->counts[i] >= STOCHASTIC_CRITICAL_COUNT);
+		criticalTotal = sumPropensities(run, worker, worker->bulk);
+		criticalLeap = (criticalTotal > 0.0) ? gsl_ran_exponential(worker->rng, 1.0 / criticalTotal) : INFINITY;
+		for (;;) {
+			const double duration = fmin(fmin(leap, criticalLeap), endTime - *curTime);
+			int negative = 0;
+
+			memcpy(worker->trial, worker->counts, sizeof(double) * (n + 1));
+			for (i = 0; i <= n; ++i)
+				if (worker->bulk[i])
+					for (c = 0; c < CHANNEL_COUNT; ++c) {
+						const double propensity = worker->propensities[i * CHANNEL_COUNT + c];
+
+						if (propensity > 0.0)
+							fireReaction(run, worker, worker->trial, i, c, gsl_ran_poisson(worker->rng, propensity * duration));
+					}
+			if (criticalLeap <= fmin(leap, endTime - *curTime)) {
+				int compartment, channel;
+
+				pickReaction(run, worker, criticalTotal, worker->bulk, &compartment, &channel);
+				fireReaction(run, worker, worker->trial, compartment, channel, 1);
+			}
+			for (i = 0; i <= n && !negative; ++i)
+				negative = (worker->trial[i] < 0.0);
+			if (!negative) {
+				double* swap = worker->counts;
+
+				worker->counts = worker->trial;
+				worker->trial = swap;
+				*curTime += duration;
+				++worker->leapCount;
+				break;
+			}
+			leap *= 0.5;
+		}
+	}
+	*curTime = endTime;
+}
+
+/**
+ * Move a Poisson number of cells, of the mean integrated out of an integrated compartment, into a compartment simulated
+ * exactly. The integrated compartment gets its mean back and loses the cells moved instead, so binding and unbinding
+ * neither make nor destroy cells.
+ */
+static void transferIntegratedCells(StochasticWorker worker, const int from, const int to, const double mean) {
+	const double moved = fmin(gsl_ran_poisson(worker->rng, mean), floor(worker->trial[from] + mean));
+
+	worker->trial[from] += mean - moved;
+	worker->trial[to] += moved;
+}
+
+/**
+ * Advance a replicate to the end time with the compartments holding at least the hybrid threshold of cells integrated
+ * and the others simulated exactly.
+ *
+ * Over each step the reactions of the integrated compartments are linear in their cells, the drug concentration and the
+ * crowding being held, and are integrated by implicit Euler, which stays stable however fast the binding. The cells
+ * they send into compartments below the threshold arrive as a Poisson number with the integrated mean, so those
+ * compartments keep whole cells, and the cells bound or unbound into them leave their integrated compartment as that
+ * number rather than as the mean. The reactions of the compartments below the threshold then take exact steps over the
+ * same interval, and a compartment falling below the threshold is rounded stochastically to whole cells. The step is
+ * the longest over which no integrated compartment is expected to change by more than the tolerance.
+ *
+ * @return  GSL_SUCCESS, or GSL_ESING if the implicit system is singular at the smallest step.
+ */
+static int advanceHybrid(const StochasticRun run, StochasticWorker worker, double* curTime, const double endTime) {
+	const ModelParameters mParam = run->mParam;
+	const int n = mParam->targetMoleculeCount;
+	const double threshold = run->settings->hybridThreshold;
+	int i, j, signum;
+
+	while (*curTime < endTime) {
+		double duration;
+		int bulkCount = 0;
+
+		if (calculatePropensities(run, worker, *curTime) <= 0.0)
+			break;
+		for (i = 0; i <= n; ++i) {
+			worker->bulk[i] = (worker->counts[i] >= threshold);
+			bulkCount += worker->bulk[i];
+		}
+		if (bulkCount == 0) {
+			advanceExactly(run, worker, curTime, endTime, NULL, STOCHASTIC_SSA_STEPS);
+			continue;
+		}
+		duration = fmin(calculateLeapTime(run, worker, threshold, 0), endTime - *curTime);
+
+		// Implicit Euler over the integrated compartments; the rows of the others keep their cells
+		for (;;) {
+			gsl_matrix_set_identity(worker->system);
+			for (j = 0; j <= n; ++j) {
+				const double* propensity = worker->propensities + j * CHANNEL_COUNT;
+				const double* split = run->splitProbability + (size_t)j * run->divisionCount;
+
+				gsl_vector_set(worker->solution, j, worker->counts[j]);
+				if (!worker->bulk[j])
+					continue;
+				// Rates per cell of compartment j into itself and its neighbours
+				*gsl_matrix_ptr(worker->system, j, j) += duration * (propensity[CHANNEL_BINDING] + propensity[CHANNEL_UNBINDING]
+				                                      + propensity[CHANNEL_DIVISION] + propensity[CHANNEL_DEATH]) / worker->counts[j];
+				if (j < n && worker->bulk[j + 1])
+					*gsl_matrix_ptr(worker->system, j + 1, j) -= duration * propensity[CHANNEL_BINDING] / worker->counts[j];
+				if (j > 0 && worker->bulk[j - 1])
+					*gsl_matrix_ptr(worker->system, j - 1, j) -= duration * propensity[CHANNEL_UNBINDING] / worker->counts[j];
+				if (propensity[CHANNEL_DIVISION] > 0.0)
+					for (i = 0; i <= j; ++i)
+						if (worker->bulk[i])
+							*gsl_matrix_ptr(worker->system, i, j) -= duration * 2.0 * split[i] * propensity[CHANNEL_DIVISION] / worker->counts[j];
+			}
+			gsl_linalg_LU_decomp(worker->system, worker->permutation, &signum);
+			for (i = 0; i <= n && gsl_matrix_get(worker->system, i, i) != 0.0; ++i)
+				;
+			if (i > n)
+				break;
+			if ((duration *= 0.5) < 1e-12 * endTime)
+				return GSL_ESING;
+		}
+		gsl_linalg_LU_svx(worker->system, worker->permutation, worker->solution);
+
+		// Cells sent from the integrated compartments into the others arrive whole, and leave whole when they only move
+		memcpy(worker->trial, worker->counts, sizeof(double) * (n + 1));
+		for (j = 0; j <= n; ++j) {
+			const double* propensity = worker->propensities + j * CHANNEL_COUNT;
+			const double* split = run->splitProbability + (size_t)j * run->divisionCount;
+			double scale;
+
+			if (!worker->bulk[j])
+				continue;
+			scale = duration * fmax(gsl_vector_get(worker->solution, j), 0.0) / worker->counts[j];
+			worker->trial[j] = fmax(gsl_vector_get(worker->solution, j), 0.0);
+			if (j < n && !worker->bulk[j + 1])
+				transferIntegratedCells(worker, j, j + 1, scale * propensity[CHANNEL_BINDING]);
+			if (j > 0 && !worker->bulk[j - 1])
+				transferIntegratedCells(worker, j, j - 1, scale * propensity[CHANNEL_UNBINDING]);
+			if (propensity[CHANNEL_DIVISION] > 0.0)
+				for (i = 0; i <= j; ++i)
+					if (!worker->bulk[i])
+						worker->trial[i] += gsl_ran_poisson(worker->rng, scale * 2.0 * split[i] * propensity[CHANNEL_DIVISION]);
+		}
+		{
+			double* swap = worker->counts;
+
+			worker->counts = worker->trial;
+			worker->trial = swap;
+		}
+		++worker->leapCount;
+
+		// Exact steps of the compartments below the threshold over the same interval
+		{
+			double exactTime = *curTime;
+
+			calculatePropensities(run, worker, *curTime);
+			advanceExactly(run, worker, &exactTime, *curTime + duration, worker->bulk, INT_MAX);
+		}
+		*curTime += duration;
+
+		for (i = 0; i <= n; ++i)
+			if (worker->bulk[i] && worker->counts[i] < threshold) {
+				const double whole = floor(worker->counts[i]);
+
+				worker->counts[i] = whole + (gsl_rng_uniform(worker->rng) < worker->counts[i] - whole);
+			}
+	}
+	*curTime = endTime;
+	return GSL_SUCCESS;
+}
+
+/**
+ * Task simulating one replicate and counting the time-points at which it has no cells.
+ */
+static int simulateReplicate(const int taskIndex, const int workerIndex, void* context) {
+	StochasticRun run = (StochasticRun)context;
+	StochasticWorker worker = &run->workers[workerIndex];
+	const int n = run->mParam->targetMoleculeCount;
+	double curTime = 0.0;
+	double population = 0.0;
+	int tick = 0;
+	int i;
+	int status;
+
+	gsl_rng_set(worker->rng, getTaskSeed(run->settings->seed, taskIndex));
+	for (i = 0; i <= n; ++i) {
+		worker->counts[i] = fmax(round(run->initialState[NUMBER_FREE_KINETIC_VARIABLES + i]), 0.0);
+		population += worker->counts[i];
+	}
+	while (population > 0.0 && ++tick < run->tickCount) {
+		if (run->settings->hybridThreshold > 0.0) {
+			if ((status = advanceHybrid(run, worker, &curTime, tick * run->timeInterval)) != GSL_SUCCESS) {
+				fprintf(stderr, "The hybrid step of replicate %d failed at time %lg\n", taskIndex, curTime);
+				return status;
+			}
+		} else
+			advanceTauLeaping(run, worker, &curTime, tick * run->timeInterval);
+		population = 0.0;
+		for (i = 0; i <= n; ++i)
+			population += worker->counts[i];
+	}
+	if (population <= 0.0)
+		for (; tick < run->tickCount; ++tick)
+			++worker->extinctCount[tick];
+	++worker->replicateCount;
+	if (run->settings->verbose && workerIndex == 0 && worker->replicateCount % 10 == 0) {
+		printf("replicate %d of %d          \r", taskIndex + 1, run->settings->replicateCount);
+		fflush(stdout);
+	}
+	return GSL_SUCCESS;
+}
+
+/**
+ * Simulate an ensemble of independent stochastic replicates concurrently and count the extinct replicates over time.
+ *
+ * @param mParam         Model parameters for the simulation, including the concentration profile.
+ * @param settings       The size and the accuracy of the ensemble.
+ * @param endTime        End of the simulations.
+ * @param timeInterval   Interval between the time-points.
+ * @param initialState   The initial state; the compartments are rounded to whole cells.
+ * @param threadCount    Number of threads simulating the replicates.
+ * @param results        The extinction counts; free them with freeStochasticResults.
+ *
+ * @return               GSL_SUCCESS, GSL_ENOMEM, or the error of a hybrid step.
+ */
+int runStochasticEnsemble(const ModelParameters mParam, const StochasticSettings settings, const double endTime, const double timeInterval,
+                          const double* initialState, const int threadCount, StochasticResults results) {
+	const int n = mParam->targetMoleculeCount;
+	struct _StochasticRun run;
+	double started = getWallClockTime();
+	int workerCount = (threadCount < settings->replicateCount) ? threadCount : settings->replicateCount;
+	int status = GSL_SUCCESS;
+	int w, i, j;
+
+	memset(results, 0, sizeof(struct _StochasticResults));
+	memset(&run, 0, sizeof(run));
+	run.mParam = mParam;
+	run.settings = settings;
+	run.timeInterval = timeInterval;
+	run.initialState = initialState;
+	for (run.tickCount = 1; run.tickCount * timeInterval < endTime && run.tickCount <= mParam->timepoints; ++run.tickCount)
+		;
+	if (workerCount < 1)
+		workerCount = 1;
+
+	// Probability that a daughter of a cell with i bound targets gets j of them, from the one-sided hypergeometric matrix
+	run.divisionCount = (mParam->replicationThreshold < n + 1) ? mParam->replicationThreshold : n + 1;
+	if ((run.splitProbability = (double*)calloc((size_t)run.divisionCount * run.divisionCount, sizeof(double))) == NULL)
+		return GSL_ENOMEM;
+	for (j = 0; j < run.divisionCount; ++j)
+		for (i = j; i < run.divisionCount; ++i)
+			run.splitProbability[(size_t)i * run.divisionCount + j] =
+				mParam->hyperGeometricMatrix[j * mParam->replicationThreshold - j * (j - 1) / 2 + (i - j)];
+
+	run.workers = (StochasticWorker)calloc(workerCount, sizeof(struct _StochasticWorker));
+	if (run.workers == NULL) {
+		status = GSL_ENOMEM;
+		goto cleanup;
+	}
+	for (w = 0; w < workerCount; ++w) {
+		StochasticWorker worker = &run.workers[w];
+
+		worker->rng = gsl_rng_alloc(gsl_rng_mt19937);
+		worker->counts = (double*)malloc(sizeof(double) * (n + 1));
+		worker->trial = (double*)malloc(sizeof(double) * (n + 1));
+		worker->propensities = (double*)malloc(sizeof(double) * (n + 1) * CHANNEL_COUNT);
+		worker->drift = (double*)malloc(sizeof(double) * (n + 1));
+		worker->spread = (double*)malloc(sizeof(double) * (n + 1));
+		worker->daughters = (unsigned int*)malloc(sizeof(unsigned int) * (n + 1));
+		worker->bulk = (int*)malloc(sizeof(int) * (n + 1));
+		worker->extinctCount = (unsigned int*)calloc(run.tickCount, sizeof(unsigned int));
+		if (worker->rng == NULL || worker->counts == NULL || worker->trial == NULL || worker->propensities == NULL ||
+		    worker->drift == NULL || worker->spread == NULL || worker->daughters == NULL || worker->bulk == NULL ||
+		    worker->extinctCount == NULL) {
+			status = GSL_ENOMEM;
+			goto cleanup;
+		}
+		if (settings->hybridThreshold > 0.0) {
+			worker->system = gsl_matrix_alloc(n + 1, n + 1);
+			worker->permutation = gsl_permutation_alloc(n + 1);
+			worker->solution = gsl_vector_alloc(n + 1);
+			if (worker->system == NULL || worker->permutation == NULL || worker->solution == NULL) {
+				status = GSL_ENOMEM;
+				goto cleanup;
+			}
+		}
+	}
+
+	status = runParallelTasks(settings->replicateCount, workerCount, simulateReplicate, &run);
+	if (settings->verbose)
+		printf("\n");
+	if (status != GSL_SUCCESS)
+		goto cleanup;
+
+	// Sum the counts of the workers into the results
+	if ((results->extinctCount = (unsigned int*)calloc(run.tickCount, sizeof(unsigned int))) == NULL) {
+		status = GSL_ENOMEM;
+		goto cleanup;
+	}
+	results->replicateCount = settings->replicateCount;
+	results->tickCount = run.tickCount;
+	for (w = 0; w < workerCount; ++w) {
+		for (i = 0; i < run.tickCount; ++i)
+			results->extinctCount[i] += run.workers[w].extinctCount[i];
+		results->leapCount += run.workers[w].leapCount;
+		results->exactStepCount += run.workers[w].exactStepCount;
+	}
+
+cleanup:
+	for (w = 0; run.workers != NULL && w < workerCount; ++w) {
+		StochasticWorker worker = &run.workers[w];
+
+		if (worker->rng != NULL)
+			gsl_rng_free(worker->rng);
+		free(worker->counts);
+		free(worker->trial);
+		free(worker->propensities);
+		free(worker->drift);
+		free(worker->spread);
+		free(worker->daughters);
+		free(worker->bulk);
+		free(worker->extinctCount);
+		if (worker->system != NULL)
+			gsl_matrix_free(worker->system);
+		if (worker->permutation != NULL)
+			gsl_permutation_free(worker->permutation);
+		if (worker->solution != NULL)
+			gsl_vector_free(worker->solution);
+	}
+	free(run.workers);
+	free(run.splitProbability);
+	results->wallTime = getWallClockTime() - started;
+	return status;
+}
+
+/**
+ * Write the probability of extinction at each time-point with its binomial standard error.
+ *
+ * @param results       The outcome of the ensemble.
+ * @param timeInterval  Interval between the time-points.
+ * @param oHandle       The output stream.
+ */
+void writeStochasticResults(const StochasticResults results, const double timeInterval, FILE* oHandle) {
+	int a;
+
+	fprintf(oHandle, "time extinct probability standardError\n");
+	for (a = 0; a < results->tickCount; ++a) {
+		const double probability = (double)results->extinctCount[a] / results->replicateCount;
+
+		fprintf(oHandle, "%lg %u %lg %lg\n", a * timeInterval, results->extinctCount[a], probability,
+		        sqrt(probability * (1.0 - probability) / results->replicateCount));
+	}
+}
+
+/**
+ * Free the extinction counts of an ensemble.
+ *
+ * @param results  The outcome of the ensemble.
+ */
+void freeStochasticResults(StochasticResults results) {
+	free(results->extinctCount);
+	results->extinctCount = NULL;
+}
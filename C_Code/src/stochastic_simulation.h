@@ -0,0 +1,42 @@
+/**
+ * @file   stochastic_simulation.h
+ * @version 5
+ * @updated  2026
+ * @brief  Stochastic simulation of the bacterial compartments by adaptive tau-leaping, run as parallel ensembles
+ */
+
+#define DEFAULT_STOCHASTIC_SEED 1          ///< Seed of the ensemble when none is given
+#define DEFAULT_TAU_TOLERANCE 0.03         ///< Largest expected relative change of a compartment in one leap
+#define STOCHASTIC_CRITICAL_COUNT 10       ///< Compartments with fewer cells have their reactions fired one at a time
+#define STOCHASTIC_SSA_FACTOR 10.0         ///< A leap covering fewer than this many reactions is replaced by exact steps
+#define STOCHASTIC_SSA_STEPS 100           ///< Number of exact steps taken before leaping is tried again
+
+/**
+ * Structure to hold the size and the accuracy of an ensemble
+ */
+typedef struct _StochasticSettings {
+	int replicateCount;     ///< Number of independent replicates.
+	unsigned long seed;     ///< Seed from which the stream of every replicate is derived.
+	double tauTolerance;    ///< Largest expected relative change of a compartment in one leap or hybrid step.
+	double hybridThreshold; ///< Cells from which a compartment is integrated rather than simulated, or zero for tau-leaping throughout.
+	int verbose;            ///< Print the progress of the ensemble to the standard output.
+} *StochasticSettings;
+
+/**
+ * Structure to hold the outcome of an ensemble
+ */
+typedef struct _StochasticResults {
+	int replicateCount;            ///< Number of replicates simulated.
+	int tickCount;                 ///< Number of time-points.
+	unsigned int* extinctCount;    ///< Number of replicates without a cell at each time-point.
+	unsigned long leapCount;       ///< Number of tau-leaps, or hybrid steps, over all replicates.
+	unsigned long exactStepCount;  ///< Number of exact (SSA) reactions over all replicates.
+	double wallTime;               ///< Elapsed time of the ensemble in seconds.
+} *StochasticResults;
+
+int runStochasticEnsemble(const ModelParameters mParam, const StochasticSettings settings, const double endTime, const double timeInterval,
+                          const double* initialState, const int threadCount, StochasticResults results);
+
+void writeStochasticResults(const StochasticResults results, const double timeInterval, FILE* oHandle);
+
+void freeStochasticResults(StochasticResults results);
@@ -0,0 +1,854 @@
+/**
+ * @file   trajectory_file.c
+ * @version 5
+ * @updated  2026
+ * @brief  Text and binary columnar trajectory files, their writer and reader
+ *
+ * The text layout is the historical -m output: one line per time-point of the bound-target compartments, the time, the
+ * total population, the antibiotic and a last column, each printed with "%lf ", and the column header as the last line.
+ *
+ * The binary layout holds the same rows as fixed-width values, all in the byte order of the writer:
+ *
+ *     header   magic "TBTRAJ1\n", then six 32-bit unsigned integers: byte order mark 0x01020304, version, bytes per
+ *              value (8 for doubles, 4 for floats), number of columns, number of parameters and zero
+ *     columns  per column a name and a unit of TRAJECTORY_NAME_LENGTH bytes, NUL-padded
+ *     params   per model parameter a name of TRAJECTORY_NAME_LENGTH bytes and its value as a double
+ *     rows     per time-point one value per column
+ *     index    per row its time as a double and its byte offset as a 64-bit unsigned integer
+ *     trailer  the number of rows and the offset of the index as 64-bit unsigned integers, then magic "TBINDEX\n"
+ *
+ * A reader finds the index from the trailer and seeks to any row directly. The columns are named L0 to Ln for the
+ * compartments, then time, population, antibiotic and AT. In the binary layout AT is the free bound complex; the last
+ * text column keeps its historical value for the existing readers of the text files.
+ *
+ * The summary content replaces the compartments by the time, the population, the antibiotic, the free target, the free
+ * bound complex, and the mean and variance of the bound targets per cell, the fractions of cells at or above the killing
+ * and the replication thresholds, and the 10th, 50th and 90th percentiles of the bound targets, twelve columns whatever
+ * the number of targets. The text header of the summary names these columns.
+ *
+ * The JSON layout is newline-delimited JSON meant to be piped from the standard output ("-" as the file): a metadata
+ * record with the model parameters and the names and units of the columns, sent as soon as the file is opened, then
+ * one record per time-point, {"type":"row","values":[...]}, and a last record {"type":"end","rows":count}. Values have
+ * nine significant digits, and infinities and NaN are null. The first row is handed to the output at once and the
+ * others at least every TRAJECTORY_STREAM_INTERVAL seconds, so a reader sees the trajectory as it is computed rather
+ * than at the end.
+ *
+ * With plotPoints set, the rows are decimated as they are written by largest-triangle-three-buckets on the log10
+ * population against time, so a plot of any length of run gets a bounded number of rows with its peaks and troughs.
+ *
+ * A copy stream in the options receives every byte written to the file as well, so a result cache can keep the
+ * output of a run while it is streamed.
+ *
+ * Text rows are formatted with formatFixedDouble, which gives the text of "%lf" without the stdio formatter, into the
+ * buffers of an asynchronous writer, so the simulation neither formats through stdio nor waits on the disk.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <math.h>
+#include <pthread.h>
+#include "full_model.h"
+#include "parallel_runner.h"
+#include "async_writer.h"
+#include "trajectory_file.h"
+
+/**
+ * Model parameters recorded in the header of a binary file
+ */
+static const struct {
+	const char* name;
+	size_t offset;
+	int isInteger;
+} headerParameters[] = {
+	{ "targets", offsetof(struct _ModelParameters, targetMoleculeCount), 1 },
+	{ "killThreshold", offsetof(struct _ModelParameters, killingThreshold), 1 },
+	{ "replThreshold", offsetof(struct _ModelParameters, replicationThreshold), 1 },
+	{ "stepTime", offsetof(struct _ModelParameters, steptime), 0 },
+	{ "replication", offsetof(struct _ModelParameters, baselineReplication), 0 },
+	{ "maxKillRate", offsetof(struct _ModelParameters, maximumKillRate), 0 },
+	{ "molecularWeight", offsetof(struct _ModelParameters, molecularweight), 0 },
+	{ "association", offsetof(struct _ModelParameters, targetAssociationRate), 0 },
+	{ "dissociation", offsetof(struct _ModelParameters, targetDissociationRate), 0 },
+	{ "capacity", offsetof(struct _ModelParameters, carryingCapacity), 0 },
+	{ "cellVolume", offsetof(struct _ModelParameters, intracellularVolume), 0 }
+};
+
+#define HEADER_PARAMETER_COUNT ((int)(sizeof(headerParameters) / sizeof(headerParameters[0])))
+
+/**
+ * Columns of the summary content, after which the text header is named
+ */
+static const struct {
+	const char* name;
+	const char* unit;
+	const char* textName;
+} summaryColumns[] = {
+	{ "time", "s", "tm" },
+	{ "population", "cells", "BP" },
+	{ "antibiotic", "molecules", "An" },
+	{ "freeTarget", "molecules", "FT" },
+	{ "boundComplex", "molecules", "AT" },
+	{ "meanBound", "targets", "mean" },
+	{ "varianceBound", "targets^2", "var" },
+	{ "killed", "fraction", "fK" },
+	{ "arrested", "fraction", "fR" },
+	{ "q10", "targets", "q10" },
+	{ "median", "targets", "q50" },
+	{ "q90", "targets", "q90" }
+};
+
+#define SUMMARY_COLUMN_COUNT ((int)(sizeof(summaryColumns) / sizeof(summaryColumns[0])))
+
+/**
+ * Parse the layout of a trajectory file and, after a colon, its content.
+ *
+ * @param name     "text", "double", "float" or "json", optionally followed by ":summary".
+ * @param format   The layout.
+ * @param content  The content.
+ *
+ * @return         0 on success, -1 for an unknown name.
+ */
+int parseTrajectoryFormat(const char* name, TrajectoryFormat* format, TrajectoryContent* content) {
+	const char* separator = strchr(name, ':');
+	const size_t length = (separator != NULL) ? (size_t)(separator - name) : strlen(name);
+
+	if (length == 4 && !strncmp(name, "text", length))
+		*format = TRAJECTORY_TEXT;
+	else if (length == 6 && !strncmp(name, "double", length))
+		*format = TRAJECTORY_DOUBLE;
+	else if (length == 5 && !strncmp(name, "float", length))
+		*format = TRAJECTORY_FLOAT;
+	else if (length == 4 && !strncmp(name, "json", length))
+		*format = TRAJECTORY_JSON;
+	else {
+		fprintf(stderr, "Unknown trajectory format %s; expected text, double, float or json\n", name);
+		return -1;
+	}
+	if (separator == NULL)
+		*content = TRAJECTORY_COMPARTMENTS;
+	else if (!strcmp(separator + 1, "summary"))
+		*content = TRAJECTORY_SUMMARY;
+	else {
+		fprintf(stderr, "Unknown trajectory content %s; expected summary\n", separator + 1);
+		return -1;
+	}
+	return 0;
+}
+
+/**
+ * Write bytes of a binary file, and to the copy if there is one; the owner of the copy checks it for errors.
+ */
+static int writeBytes(const TrajectoryWriter writer, const void* data, const size_t size) {
+	if (writer->copyHandle != NULL)
+		fwrite(data, 1, size, writer->copyHandle);
+	return fwrite(data, 1, size, writer->oHandle) == size ? 0 : -1;
+}
+
+/**
+ * Write a name padded with NULs to the fixed field length.
+ */
+static int writeName(const TrajectoryWriter writer, const char* name) {
+	char field[TRAJECTORY_NAME_LENGTH];
+	const size_t length = strlen(name);
+
+	memset(field, 0, sizeof(field));
+	memcpy(field, name, (length < sizeof(field)) ? length : sizeof(field) - 1);
+	return writeBytes(writer, field, sizeof(field));
+}
+
+/**
+ * The name and the unit of one column.
+ */
+static const char* describeColumn(const TrajectoryWriter writer, const int column, char* name) {
+	static const char* trailingNames[] = { "time", "population", "antibiotic", "AT" };
+	static const char* trailingUnits[] = { "s", "cells", "molecules", "molecules" };
+
+	if (writer->content == TRAJECTORY_SUMMARY) {
+		strcpy(name, summaryColumns[column].name);
+		return summaryColumns[column].unit;
+	}
+	if (column >= writer->compartmentCount) {
+		strcpy(name, trailingNames[column - writer->compartmentCount]);
+		return trailingUnits[column - writer->compartmentCount];
+	}
+	snprintf(name, TRAJECTORY_NAME_LENGTH, "L%d", column);
+	return "cells";
+}
+
+/**
+ * Format a value for a JSON record: nine significant digits, and null for the infinities and NaN, which JSON lacks.
+ */
+static int formatJsonDouble(char* text, const double value) {
+	if (!isfinite(value)) {
+		memcpy(text, "null", 4);
+		return 4;
+	}
+	return snprintf(text, TRAJECTORY_JSON_VALUE_LENGTH, "%.9g", value);
+}
+
+/**
+ * Bytes reserved for the longest text row of a writer.
+ */
+static size_t getTextRowLength(const TrajectoryWriter writer) {
+	if (writer->format == TRAJECTORY_JSON)
+		return (size_t)writer->columnCount * (TRAJECTORY_JSON_VALUE_LENGTH + 1) + 64;
+	return (size_t)writer->columnCount * FIXED_DOUBLE_MAX_LENGTH + 1;
+}
+
+/**
+ * Bytes reserved for the metadata record of a JSON stream.
+ */
+static size_t getJsonMetadataLength(const TrajectoryWriter writer) {
+	return (size_t)HEADER_PARAMETER_COUNT * (TRAJECTORY_NAME_LENGTH + TRAJECTORY_JSON_VALUE_LENGTH + 4) +
+	       (size_t)writer->columnCount * (2 * TRAJECTORY_NAME_LENGTH + 32) + 128;
+}
+
+/**
+ * Write the metadata record opening a JSON stream: the model parameters and the names and units of the columns.
+ */
+static void writeJsonMetadata(TrajectoryWriter writer, const ModelParameters mParam) {
+	char* text = reserveAsyncWriter(writer->textWriter, getJsonMetadataLength(writer));
+	char name[TRAJECTORY_NAME_LENGTH];
+	int i;
+
+	text += sprintf(text, "{\"type\":\"metadata\",\"version\":%d,\"parameters\":{", TRAJECTORY_VERSION);
+	for (i = 0; i < HEADER_PARAMETER_COUNT; ++i) {
+		const char* field = (const char*)mParam + headerParameters[i].offset;
+
+		text += sprintf(text, "%s\"%s\":", (i > 0) ? "," : "", headerParameters[i].name);
+		text += formatJsonDouble(text, headerParameters[i].isInteger ? *(const int*)field : *(const double*)field);
+	}
+	text += sprintf(text, "},\"columns\":[");
+	for (i = 0; i < writer->columnCount; ++i) {
+		const char* unit = describeColumn(writer, i, name);
+
+		text += sprintf(text, "%s{\"name\":\"%s\",\"unit\":\"%s\"}", (i > 0) ? "," : "", name, unit);
+	}
+	text += sprintf(text, "]}\n");
+	commitAsyncWriter(writer->textWriter, text);
+}
+
+/**
+ * Start the trajectory of one simulation on an open stream, writing the header of a binary layout or the metadata of a
+ * JSON one. The stream is flushed but left open when the writer is closed.
+ *
+ * @param oHandle     The stream.
+ * @param options     Its layout, its columns (every compartment, or the summaries of the distribution of bound targets)
+ *                    and the number of rows to decimate to.
+ * @param mParam      Model parameters of the simulation, recorded in a binary header.
+ * @param textHeader  Column header appended to a text file of the compartments when it is closed, or NULL for that
+ *                    of the command-line.
+ *
+ * @return            The writer, or NULL if the stream cannot be written.
+ */
+TrajectoryWriter openTrajectoryStream(FILE* oHandle, const TrajectoryOptions options, const ModelParameters mParam,
+                                      const char* textHeader) {
+	TrajectoryWriter writer = (TrajectoryWriter)calloc(1, sizeof(struct _TrajectoryWriter));
+	const TrajectoryFormat format = options->format;
+	const TrajectoryContent content = options->content;
+	int i;
+
+	if (writer == NULL)
+		return NULL;
+	writer->format = format;
+	writer->content = content;
+	writer->plotPoints = options->plotPoints;
+	writer->lastWrittenTime = -INFINITY;
+	writer->compartmentCount = mParam->targetMoleculeCount + 1;
+	writer->columnCount = (content == TRAJECTORY_SUMMARY) ? SUMMARY_COLUMN_COUNT : writer->compartmentCount + 4;
+	writer->timeColumn = (content == TRAJECTORY_SUMMARY) ? 0 : writer->compartmentCount;
+	writer->populationColumn = writer->timeColumn + 1;
+	writer->oHandle = oHandle;
+	writer->copyHandle = options->copyHandle;
+	writer->values = (double*)malloc(sizeof(double) * writer->columnCount);
+	if (writer->values == NULL) {
+		closeTrajectoryWriter(writer);
+		return NULL;
+	}
+	if (format == TRAJECTORY_TEXT || format == TRAJECTORY_JSON) {
+		size_t capacity = ASYNC_WRITER_BUFFER_SIZE;
+
+		if (getTextRowLength(writer) > capacity)
+			capacity = getTextRowLength(writer);
+		if (format == TRAJECTORY_JSON && getJsonMetadataLength(writer) > capacity)
+			capacity = getJsonMetadataLength(writer);
+		if (format == TRAJECTORY_JSON)
+			writer->textHeader = NULL;
+		else if (content == TRAJECTORY_SUMMARY) {
+			if ((writer->textHeader = (char*)malloc(SUMMARY_COLUMN_COUNT * TRAJECTORY_NAME_LENGTH)) != NULL) {
+				writer->textHeader[0] = '\0';
+				for (i = 0; i < SUMMARY_COLUMN_COUNT; ++i)
+					strcat(strcat(writer->textHeader, summaryColumns[i].textName), " ");
+			}
+		} else if (textHeader != NULL)
+			writer->textHeader = strdup(textHeader);
+		else if ((writer->textHeader = (char*)malloc(3 * (writer->compartmentCount + 4) + 1)) != NULL) {
+			// The header of the command-line: L0 Li ... Li Ln, then the time, population, antibiotic and bound complex
+			writer->textHeader[0] = '\0';
+			for (i = 0; i < writer->compartmentCount; ++i)
+				strcat(writer->textHeader, (i == writer->compartmentCount - 1) ? "Ln " : (i == 0) ? "L0 " : "Li ");
+			strcat(writer->textHeader, "tm BP An AT ");
+		}
+		writer->textWriter = openAsyncWriter(writer->oHandle, writer->copyHandle, capacity);
+		if ((format == TRAJECTORY_TEXT && writer->textHeader == NULL) || writer->textWriter == NULL) {
+			closeTrajectoryWriter(writer);
+			return NULL;
+		}
+		if (format == TRAJECTORY_JSON) {
+			// The metadata goes out at once, so a reader of the stream knows the columns before the first row
+			writeJsonMetadata(writer, mParam);
+			flushAsyncWriter(writer->textWriter);
+			writer->lastFlush = getWallClockTime();
+		}
+		return writer;
+	}
+
+	{
+		const uint32_t fields[6] = { TRAJECTORY_BYTE_ORDER, TRAJECTORY_VERSION, (format == TRAJECTORY_FLOAT) ? sizeof(float) : sizeof(double),
+		                             (uint32_t)writer->columnCount, HEADER_PARAMETER_COUNT, 0 };
+		int failed = (writeBytes(writer, TRAJECTORY_MAGIC, 8) != 0 || writeBytes(writer, fields, sizeof(fields)) != 0);
+
+		for (i = 0; i < writer->columnCount && !failed; ++i) {
+			char name[TRAJECTORY_NAME_LENGTH];
+			const char* unit = describeColumn(writer, i, name);
+
+			failed = writeName(writer, name) || writeName(writer, unit);
+		}
+		for (i = 0; i < HEADER_PARAMETER_COUNT && !failed; ++i) {
+			const char* field = (const char*)mParam + headerParameters[i].offset;
+			const double value = headerParameters[i].isInteger ? *(const int*)field : *(const double*)field;
+
+			failed = writeName(writer, headerParameters[i].name) || writeBytes(writer, &value, sizeof(value)) != 0;
+		}
+		if (format == TRAJECTORY_FLOAT)
+			failed = failed || (writer->row = malloc(sizeof(float) * writer->columnCount)) == NULL;
+		if (failed) {
+			fprintf(stderr, "Could not write the header of the trajectory\n");
+			closeTrajectoryWriter(writer);
+			return NULL;
+		}
+	}
+	return writer;
+}
+
+/**
+ * Open the trajectory file of one simulation and write the header of a binary layout.
+ *
+ * @param fileName    The file, or "-" for the standard output.
+ * @param options     Its layout, its columns (every compartment, or the summaries of the distribution of bound targets)
+ *                    and the number of rows to decimate to.
+ * @param mParam      Model parameters of the simulation, recorded in a binary header.
+ * @param textHeader  Column header appended to a text file of the compartments when it is closed, or NULL for that
+ *                    of the command-line.
+ *
+ * @return            The writer, or NULL if the file cannot be opened or written.
+ */
+TrajectoryWriter openTrajectoryWriter(const char* fileName, const TrajectoryOptions options, const ModelParameters mParam,
+                                      const char* textHeader) {
+	TrajectoryWriter writer;
+	FILE* oHandle;
+
+	if (!strcmp(fileName, "-"))
+		return openTrajectoryStream(stdout, options, mParam, textHeader);
+	if ((oHandle = fopen(fileName, "wb")) == NULL) {
+		fprintf(stderr, "Could not open %s for writing\n", fileName);
+		return NULL;
+	}
+	setvbuf(oHandle, NULL, _IOFBF, TRAJECTORY_BUFFER_SIZE);
+	if ((writer = openTrajectoryStream(oHandle, options, mParam, textHeader)) == NULL) {
+		fclose(oHandle);
+		return NULL;
+	}
+	writer->ownsStream = 1;
+	return writer;
+}
+
+/**
+ * Smallest number of bound targets below which at least a fraction of the cells lie.
+ */
+static double findBoundQuantile(const double* cells, const int compartmentCount, const double total, const double fraction) {
+	double cumulative = 0.0;
+	int i;
+
+	for (i = 0; i < compartmentCount - 1; ++i) {
+		cumulative += (cells[i] > 0.0) ? cells[i] : 0.0;
+		if (cumulative >= fraction * total)
+			break;
+	}
+	return i;
+}
+
+/**
+ * Reduce the compartments of one time-point to the summary columns. Compartments driven slightly negative by the
+ * integrator count as empty; the distribution summaries are NaN without cells.
+ */
+static void summarizeCompartments(const TrajectoryWriter writer, const ModelParameters mParam, const ModelVariables state,
+                                  const double currentTime, const double population, const double antibiotic) {
+	const double* cells = &state->firstCompartmentBoundComplex;
+	double* values = writer->values;
+	double total = 0.0, bound = 0.0, squares = 0.0, killed = 0.0, arrested = 0.0;
+	int i;
+
+	for (i = 0; i < writer->compartmentCount; ++i) {
+		const double count = (cells[i] > 0.0) ? cells[i] : 0.0;
+
+		total += count;
+		bound += count * i;
+		squares += count * i * i;
+		if (i >= mParam->killingThreshold)
+			killed += count;
+		if (i >= mParam->replicationThreshold)
+			arrested += count;
+	}
+	values[0] = currentTime;
+	values[1] = population;
+	values[2] = antibiotic;
+	values[3] = state->freeTarget;
+	values[4] = state->freeBoundComplex;
+	if (total > 0.0) {
+		const double mean = bound / total;
+		const double variance = squares / total - mean * mean;
+
+		values[5] = mean;
+		values[6] = (variance > 0.0) ? variance : 0.0;
+		values[7] = killed / total;
+		values[8] = arrested / total;
+		values[9] = findBoundQuantile(cells, writer->compartmentCount, total, 0.1);
+		values[10] = findBoundQuantile(cells, writer->compartmentCount, total, 0.5);
+		values[11] = findBoundQuantile(cells, writer->compartmentCount, total, 0.9);
+	} else
+		for (i = 5; i < SUMMARY_COLUMN_COUNT; ++i)
+			values[i] = NAN;
+}
+
+/**
+ * Write one row of values in the layout of the file.
+ */
+static int emitTrajectoryRow(TrajectoryWriter writer, const double* values) {
+	int i;
+
+	writer->lastWrittenTime = values[writer->timeColumn];
+	if (writer->format == TRAJECTORY_JSON) {
+		static const char prefix[] = "{\"type\":\"row\",\"values\":[";
+		char* text = reserveAsyncWriter(writer->textWriter, getTextRowLength(writer));
+		double now;
+
+		memcpy(text, prefix, sizeof(prefix) - 1);
+		text += sizeof(prefix) - 1;
+		for (i = 0; i < writer->columnCount; ++i) {
+			if (i > 0)
+				*text++ = ',';
+			text += formatJsonDouble(text, values[i]);
+		}
+		memcpy(text, "]}\n", 3);
+		commitAsyncWriter(writer->textWriter, text + 3);
+		++writer->rowCount;
+		if ((now = getWallClockTime()) - writer->lastFlush >= TRAJECTORY_STREAM_INTERVAL || writer->rowCount == 1) {
+			flushAsyncWriter(writer->textWriter);
+			writer->lastFlush = now;
+		}
+		return 0;
+	}
+	if (writer->format == TRAJECTORY_TEXT) {
+		char* text = reserveAsyncWriter(writer->textWriter, getTextRowLength(writer));
+
+		for (i = 0; i < writer->columnCount; ++i) {
+			text += formatFixedDouble(text, values[i]);
+			*text++ = ' ';
+		}
+		*text++ = '\n';
+		commitAsyncWriter(writer->textWriter, text);
+		++writer->rowCount;
+		return 0;
+	}
+
+	if (writer->rowCount == writer->indexCapacity) {
+		long capacity = (writer->indexCapacity > 0) ? 2 * writer->indexCapacity : 1024;
+		double* times = (double*)realloc(writer->indexTimes, sizeof(double) * capacity);
+
+		if (times == NULL)
+			return -1;
+		writer->indexTimes = times;
+		writer->indexCapacity = capacity;
+	}
+	writer->indexTimes[writer->rowCount++] = values[writer->timeColumn];
+	if (writer->format == TRAJECTORY_FLOAT) {
+		float* row = (float*)writer->row;
+
+		for (i = 0; i < writer->columnCount; ++i)
+			row[i] = (float)values[i];
+		return writeBytes(writer, row, sizeof(float) * writer->columnCount);
+	}
+	return writeBytes(writer, values, sizeof(double) * writer->columnCount);
+}
+
+/**
+ * Log10 of the population of a row, floored at one cell, on which the decimation keeps the shape.
+ */
+static double getPlotValue(const TrajectoryWriter writer, const double* values) {
+	return log10((values[writer->populationColumn] > 1.0) ? values[writer->populationColumn] : 1.0);
+}
+
+/**
+ * Prepare the decimation of the rows of a simulation, which needs their number beforehand; called by the simulation
+ * before its first row. Without decimation, or with no more rows than requested, every row is written.
+ *
+ * @param writer    The writer.
+ * @param rowCount  Number of rows the simulation will give.
+ *
+ * @return          0 on success, -1 if the buckets cannot be allocated.
+ */
+int expectTrajectoryRows(TrajectoryWriter writer, const long rowCount) {
+	int b;
+
+	writer->expectedRows = writer->receivedRows = writer->bucketIndex = 0;
+	if (writer->plotPoints < 3 || rowCount <= writer->plotPoints)
+		return 0;
+	writer->bucketWidth = (double)(rowCount - 2) / (writer->plotPoints - 2);
+	for (b = 0; b < 2; ++b) {
+		free(writer->buckets[b].rows);
+		writer->buckets[b].count = 0;
+		writer->buckets[b].sumX = writer->buckets[b].sumY = 0.0;
+		writer->buckets[b].rows = (double*)malloc(sizeof(double) * writer->columnCount * ((size_t)ceil(writer->bucketWidth) + 1));
+		if (writer->buckets[b].rows == NULL)
+			return -1;
+	}
+	free(writer->lastValues);
+	if ((writer->lastValues = (double*)malloc(sizeof(double) * writer->columnCount)) == NULL)
+		return -1;
+	writer->expectedRows = rowCount;
+	return 0;
+}
+
+/**
+ * Write the row of a bucket forming the largest triangle with the last row kept and a point after the bucket, and
+ * empty the bucket.
+ */
+static int keepLargestTriangle(TrajectoryWriter writer, TrajectoryBucket* bucket, const double nextX, const double nextY) {
+	const double* best = bucket->rows;
+	double bestArea = -1.0;
+	int r;
+
+	for (r = 0; r < bucket->count; ++r) {
+		const double* row = bucket->rows + (size_t)r * writer->columnCount;
+		const double area = fabs((writer->anchorX - nextX) * (getPlotValue(writer, row) - writer->anchorY) -
+		                         (writer->anchorX - row[writer->timeColumn]) * (nextY - writer->anchorY));
+
+		if (area > bestArea) {
+			bestArea = area;
+			best = row;
+		}
+	}
+	writer->anchorX = best[writer->timeColumn];
+	writer->anchorY = getPlotValue(writer, best);
+	bucket->count = 0;
+	bucket->sumX = bucket->sumY = 0.0;
+	return emitTrajectoryRow(writer, best);
+}
+
+/**
+ * Decide the buckets still held against the last row given, and write that row unless it was already kept.
+ */
+static int finishDecimation(TrajectoryWriter writer) {
+	const double* last = writer->lastValues;
+	const double lastX = last[writer->timeColumn], lastY = getPlotValue(writer, last);
+	TrajectoryBucket* current = &writer->buckets[0];
+	TrajectoryBucket* next = &writer->buckets[1];
+	int failed = 0;
+
+	if (current->count > 0)
+		failed = keepLargestTriangle(writer, current, (next->count > 0) ? next->sumX / next->count : lastX,
+		                             (next->count > 0) ? next->sumY / next->count : lastY) != 0;
+	if (next->count > 0)
+		failed = keepLargestTriangle(writer, next, lastX, lastY) != 0 || failed;
+	if (writer->lastWrittenTime < lastX)
+		failed = emitTrajectoryRow(writer, last) != 0 || failed;
+	writer->expectedRows = 0;
+	return failed ? -1 : 0;
+}
+
+/**
+ * Pass a row through the largest-triangle-three-buckets decimation. The rows between the first and the last are split
+ * into plotPoints - 2 buckets of consecutive rows, and each bucket keeps the row forming the largest triangle with the
+ * row kept before it and the mean of the next bucket. As the mean of the next bucket is only known once that bucket is
+ * complete, two buckets are held at a time, so the rows are written with a delay of at most two buckets.
+ */
+static int decimateTrajectoryRow(TrajectoryWriter writer, const double* values) {
+	const long r = writer->receivedRows++;
+	TrajectoryBucket* bucket;
+	long b;
+
+	memcpy(writer->lastValues, values, sizeof(double) * writer->columnCount);
+	if (r == 0) {
+		writer->anchorX = values[writer->timeColumn];
+		writer->anchorY = getPlotValue(writer, values);
+		return emitTrajectoryRow(writer, values);
+	}
+	if (r == writer->expectedRows - 1)
+		return finishDecimation(writer);
+	b = (long)((r - 1) / writer->bucketWidth);
+	if (b > writer->plotPoints - 3)
+		b = writer->plotPoints - 3;
+	if (writer->buckets[0].count == 0)
+		writer->bucketIndex = b;
+	else if (b == writer->bucketIndex + 2) {
+		// The following bucket is complete: decide the current one against its mean, and move on to it
+		TrajectoryBucket decided = writer->buckets[0];
+		TrajectoryBucket* next = &writer->buckets[1];
+
+		if (keepLargestTriangle(writer, &decided, next->sumX / next->count, next->sumY / next->count) != 0)
+			return -1;
+		writer->buckets[0] = *next;
+		writer->buckets[1] = decided;
+		++writer->bucketIndex;
+	}
+	bucket = &writer->buckets[b - writer->bucketIndex];
+	memcpy(bucket->rows + (size_t)bucket->count * writer->columnCount, values, sizeof(double) * writer->columnCount);
+	++bucket->count;
+	bucket->sumX += values[writer->timeColumn];
+	bucket->sumY += getPlotValue(writer, values);
+	return 0;
+}
+
+/**
+ * Append the row of one time-point, or pass it to the decimation.
+ *
+ * @param writer       The writer.
+ * @param mParam       Model parameters of the simulation.
+ * @param state        The state at the time-point.
+ * @param currentTime  The time.
+ * @param population   The total population.
+ * @param antibiotic   The antibiotic in molecules.
+ *
+ * @return             0 on success, -1 on failure.
+ */
+int writeTrajectoryRow(TrajectoryWriter writer, const ModelParameters mParam, const ModelVariables state, const double currentTime,
+                       const double population, const double antibiotic) {
+	double* values = writer->values;
+	int i;
+
+	if (writer->content == TRAJECTORY_SUMMARY)
+		summarizeCompartments(writer, mParam, state, currentTime, population, antibiotic);
+	else {
+		memcpy(values, &state->firstCompartmentBoundComplex, sizeof(double) * writer->compartmentCount);
+		i = writer->compartmentCount;
+		values[i++] = currentTime;
+		values[i++] = population;
+		values[i++] = antibiotic;
+		values[i] = (writer->format == TRAJECTORY_TEXT) ? (&state->freeBoundComplex)[writer->compartmentCount] : state->freeBoundComplex;
+	}
+	if (writer->expectedRows > 0)
+		return decimateTrajectoryRow(writer, values);
+	return emitTrajectoryRow(writer, values);
+}
+
+/**
+ * Finish the file, with the header line of a text file or the index of a binary one, close it if the writer opened it
+ * and free the writer.
+ *
+ * @param writer  The writer, or NULL.
+ *
+ * @return        0 on success, -1 if the file could not be finished.
+ */
+int closeTrajectoryWriter(TrajectoryWriter writer) {
+	int failed = 0;
+	long i;
+
+	if (writer == NULL)
+		return 0;
+	// A simulation which stopped early leaves buckets undecided
+	if (writer->expectedRows > 0 && writer->receivedRows > 1)
+		failed = finishDecimation(writer) != 0;
+	if (writer->oHandle != NULL) {
+		if (writer->format == TRAJECTORY_JSON && writer->textWriter != NULL) {
+			char* text = reserveAsyncWriter(writer->textWriter, 64);
+
+			commitAsyncWriter(writer->textWriter, text + sprintf(text, "{\"type\":\"end\",\"rows\":%ld}\n", writer->rowCount));
+			failed = closeAsyncWriter(writer->textWriter) != 0 || failed;
+		} else if (writer->format == TRAJECTORY_TEXT && writer->textWriter != NULL) {
+			failed = closeAsyncWriter(writer->textWriter) != 0 || failed;
+			if (writer->textHeader != NULL) {
+				if (writer->copyHandle != NULL)
+					fprintf(writer->copyHandle, "%s\n", writer->textHeader);
+				failed = fprintf(writer->oHandle, "%s\n", writer->textHeader) < 0 || failed;
+			}
+		}
+		else if (writer->format != TRAJECTORY_TEXT && writer->values != NULL) {
+			const uint64_t valueSize = (writer->format == TRAJECTORY_FLOAT) ? sizeof(float) : sizeof(double);
+			const uint64_t rowSize = valueSize * writer->columnCount;
+			const uint64_t firstRow = 8 + 6 * sizeof(uint32_t) + (uint64_t)writer->columnCount * 2 * TRAJECTORY_NAME_LENGTH
+			                        + (uint64_t)HEADER_PARAMETER_COUNT * (TRAJECTORY_NAME_LENGTH + sizeof(double));
+			const uint64_t trailer[2] = { (uint64_t)writer->rowCount, firstRow + rowSize * writer->rowCount };
+
+			for (i = 0; i < writer->rowCount && !failed; ++i) {
+				const uint64_t offset = firstRow + rowSize * i;
+
+				failed = writeBytes(writer, &writer->indexTimes[i], sizeof(double)) != 0 ||
+				         writeBytes(writer, &offset, sizeof(offset)) != 0;
+			}
+			failed = failed || writeBytes(writer, trailer, sizeof(trailer)) != 0 || writeBytes(writer, TRAJECTORY_INDEX_MAGIC, 8) != 0;
+		}
+		failed = (writer->ownsStream ? fclose(writer->oHandle) : fflush(writer->oHandle)) != 0 || failed;
+	}
+	free(writer->indexTimes);
+	free(writer->values);
+	free(writer->buckets[0].rows);
+	free(writer->buckets[1].rows);
+	free(writer->lastValues);
+	free(writer->row);
+	free(writer->textHeader);
+	free(writer);
+	return failed ? -1 : 0;
+}
+
+/**
+ * Read a name field, making sure it is terminated.
+ */
+static int readName(FILE* iHandle, char* name) {
+	if (fread(name, TRAJECTORY_NAME_LENGTH, 1, iHandle) != 1)
+		return -1;
+	name[TRAJECTORY_NAME_LENGTH - 1] = '\0';
+	return 0;
+}
+
+/**
+ * Open a binary trajectory file and read its header and index.
+ *
+ * @param fileName  The file.
+ *
+ * @return          The reader, or NULL if the file is not a complete binary trajectory of this byte order.
+ */
+TrajectoryReader openTrajectoryReader(const char* fileName) {
+	TrajectoryReader reader = (TrajectoryReader)calloc(1, sizeof(struct _TrajectoryReader));
+	char magic[8];
+	uint32_t fields[6];
+	uint64_t trailer[2];
+	long i;
+
+	if (reader == NULL)
+		return NULL;
+	if ((reader->iHandle = fopen(fileName, "rb")) == NULL) {
+		fprintf(stderr, "Could not open %s for reading\n", fileName);
+		free(reader);
+		return NULL;
+	}
+	setvbuf(reader->iHandle, NULL, _IOFBF, TRAJECTORY_BUFFER_SIZE);
+	if (fread(magic, 8, 1, reader->iHandle) != 1 || memcmp(magic, TRAJECTORY_MAGIC, 8) ||
+	    fread(fields, sizeof(fields), 1, reader->iHandle) != 1) {
+		fprintf(stderr, "%s is not a binary trajectory file\n", fileName);
+		goto failure;
+	}
+	if (fields[0] != TRAJECTORY_BYTE_ORDER || fields[1] != TRAJECTORY_VERSION || (fields[2] != sizeof(float) && fields[2] != sizeof(double))) {
+		fprintf(stderr, "%s has another byte order or an unknown version\n", fileName);
+		goto failure;
+	}
+	reader->valueSize = fields[2];
+	reader->columnCount = fields[3];
+	reader->parameterCount = fields[4];
+	reader->columnNames = malloc(TRAJECTORY_NAME_LENGTH * (size_t)reader->columnCount);
+	reader->columnUnits = malloc(TRAJECTORY_NAME_LENGTH * (size_t)reader->columnCount);
+	reader->parameterNames = malloc(TRAJECTORY_NAME_LENGTH * (size_t)(reader->parameterCount + 1));
+	reader->parameterValues = (double*)malloc(sizeof(double) * (reader->parameterCount + 1));
+	reader->row = malloc(sizeof(double) * reader->columnCount);
+	if (reader->columnNames == NULL || reader->columnUnits == NULL || reader->parameterNames == NULL || reader->parameterValues == NULL ||
+	    reader->row == NULL)
+		goto failure;
+	for (i = 0; i < reader->columnCount; ++i)
+		if (readName(reader->iHandle, reader->columnNames[i]) || readName(reader->iHandle, reader->columnUnits[i]))
+			goto truncated;
+	for (i = 0; i < reader->parameterCount; ++i)
+		if (readName(reader->iHandle, reader->parameterNames[i]) || fread(&reader->parameterValues[i], sizeof(double), 1, reader->iHandle) != 1)
+			goto truncated;
+
+	// The index is located from the trailer
+	if (fseek(reader->iHandle, -(long)(sizeof(trailer) + 8), SEEK_END) != 0 || fread(trailer, sizeof(trailer), 1, reader->iHandle) != 1 ||
+	    fread(magic, 8, 1, reader->iHandle) != 1 || memcmp(magic, TRAJECTORY_INDEX_MAGIC, 8))
+		goto truncated;
+	reader->rowCount = (long)trailer[0];
+	reader->rowTimes = (double*)malloc(sizeof(double) * (reader->rowCount + 1));
+	reader->rowOffsets = (long*)malloc(sizeof(long) * (reader->rowCount + 1));
+	if (reader->rowTimes == NULL || reader->rowOffsets == NULL || fseek(reader->iHandle, (long)trailer[1], SEEK_SET) != 0)
+		goto failure;
+	for (i = 0; i < reader->rowCount; ++i) {
+		uint64_t offset;
+
+		if (fread(&reader->rowTimes[i], sizeof(double), 1, reader->iHandle) != 1 || fread(&offset, sizeof(offset), 1, reader->iHandle) != 1)
+			goto truncated;
+		reader->rowOffsets[i] = (long)offset;
+	}
+	return reader;
+
+truncated:
+	fprintf(stderr, "%s is truncated or was not closed\n", fileName);
+failure:
+	closeTrajectoryReader(reader);
+	return NULL;
+}
+
+/**
+ * Read one row.
+ *
+ * @param reader  The reader.
+ * @param row     The index of the row.
+ * @param values  The values of the row, widened to doubles.
+ *
+ * @return        0 on success, -1 if the row does not exist or cannot be read.
+ */
+int readTrajectoryRow(TrajectoryReader reader, const long row, double* values) {
+	int i;
+
+	if (row < 0 || row >= reader->rowCount || fseek(reader->iHandle, reader->rowOffsets[row], SEEK_SET) != 0 ||
+	    fread(reader->row, reader->valueSize, reader->columnCount, reader->iHandle) != (size_t)reader->columnCount)
+		return -1;
+	if (reader->valueSize == sizeof(float))
+		for (i = 0; i < reader->columnCount; ++i)
+			values[i] = ((const float*)reader->row)[i];
+	else
+		memcpy(values, reader->row, sizeof(double) * reader->columnCount);
+	return 0;
+}
+
+/**
+ * Find the last row at or before a time, by bisection of the index.
+ *
+ * @param reader  The reader.
+ * @param time    The time.
+ *
+ * @return        The index of the row, or -1 if the time precedes the first row.
+ */
+long findTrajectoryRow(const TrajectoryReader reader, const double time) {
+	long low = 0, high = reader->rowCount;
+
+	while (low < high) {
+		const long middle = low + (high - low) / 2;
+
+		if (reader->rowTimes[middle] <= time)
+			low = middle + 1;
+		else
+			high = middle;
+	}
+	return low - 1;
+}
+
+/**
+ * Close a binary trajectory file and free the reader.
+ *
+ * @param reader  The reader, or NULL.
+ */
+void closeTrajectoryReader(TrajectoryReader reader) {
+	if (reader == NULL)
+		return;
+	if (reader->iHandle != NULL)
+		fclose(reader->iHandle);
+	free(reader->columnNames);
+	free(reader->columnUnits);
+	free(reader->parameterNames);
+	free(reader->parameterValues);
+	free(reader->rowTimes);
+	free(reader->rowOffsets);
+	free(reader->row);
+	free(reader);
+}
@@ -0,0 +1,127 @@
+/**
+ * @file   trajectory_file.h
+ * @version 5
+ * @updated  2026
+ * @brief  Text and binary columnar trajectory files, their writer and reader
+ */
+
+#define TRAJECTORY_MAGIC "TBTRAJ1\n"         ///< First eight bytes of a binary trajectory file
+#define TRAJECTORY_INDEX_MAGIC "TBINDEX\n"   ///< Last eight bytes of a complete binary trajectory file
+#define TRAJECTORY_BYTE_ORDER 0x01020304u    ///< Written natively so a reader can detect a foreign byte order
+#define TRAJECTORY_VERSION 1                 ///< Version of the binary layout
+#define TRAJECTORY_NAME_LENGTH 16            ///< Bytes of a column or parameter name and of a unit, NUL-padded
+#define TRAJECTORY_BUFFER_SIZE (1 << 20)     ///< Stream buffer of the files
+#define TRAJECTORY_STREAM_INTERVAL 0.05      ///< Longest time in seconds that JSON rows are held before they are written
+#define TRAJECTORY_JSON_VALUE_LENGTH 32      ///< Bytes reserved for one value of a JSON record
+
+/**
+ * Layout of the trajectory written by -m
+ */
+typedef enum {
+	TRAJECTORY_TEXT,    ///< One line of space-separated values per time-point, the column header last.
+	TRAJECTORY_DOUBLE,  ///< Binary columnar file of doubles.
+	TRAJECTORY_FLOAT,   ///< Binary columnar file of floats.
+	TRAJECTORY_JSON     ///< Newline-delimited JSON records, the metadata first, written in batches as they are computed.
+} TrajectoryFormat;
+
+/**
+ * Columns of the trajectory written by -m
+ */
+typedef enum {
+	TRAJECTORY_COMPARTMENTS,  ///< Every bound-target compartment, the time, the population, the antibiotic and the bound complex.
+	TRAJECTORY_SUMMARY        ///< The free kinetic variables and summaries of the distribution of bound targets per cell.
+} TrajectoryContent;
+
+/**
+ * Structure to hold the options of the trajectory files
+ */
+typedef struct _TrajectoryOptions {
+	TrajectoryFormat format;    ///< Layout of the files.
+	TrajectoryContent content;  ///< Columns of the files.
+	int plotPoints;             ///< Number of time-points the rows are decimated to, or zero to write every time-point.
+	FILE* copyHandle;           ///< Stream receiving a copy of everything written, or NULL.
+} *TrajectoryOptions;
+
+/**
+ * Rows of one bucket of the decimation
+ */
+typedef struct _TrajectoryBucket {
+	int count;        ///< Number of rows in the bucket.
+	double sumX;      ///< Sum of their times.
+	double sumY;      ///< Sum of their log10 populations.
+	double* rows;     ///< The rows, one after the other.
+} TrajectoryBucket;
+
+/**
+ * Writer of the trajectory of one simulation
+ */
+typedef struct _TrajectoryWriter {
+	TrajectoryFormat format;   ///< Layout of the file.
+	TrajectoryContent content; ///< Columns of the file.
+	FILE* oHandle;             ///< The file.
+	int ownsStream;            ///< Whether closing the writer closes the file; streams opened by the caller are only flushed.
+	FILE* copyHandle;          ///< Stream receiving a copy of everything written, or NULL; left open.
+	int compartmentCount;      ///< Number of bound-target compartments.
+	int columnCount;           ///< Number of values per row.
+	long rowCount;             ///< Number of rows written.
+	long indexCapacity;        ///< Allocated rows of the index.
+	double* indexTimes;        ///< Time of each row, for the index of a binary file.
+	double* values;            ///< The values of one row.
+	void* row;                 ///< One row of values converted to floats.
+	char* textHeader;          ///< Header line appended to a text file.
+	struct _AsyncWriter* textWriter; ///< Formats and writes the rows of a text or JSON file in the background.
+	double lastFlush;          ///< Wall-clock time at which the JSON rows were last handed to the output.
+	int timeColumn;            ///< Column of the time.
+	int populationColumn;      ///< Column of the population.
+	int plotPoints;            ///< Number of rows to decimate to, or zero.
+	long expectedRows;         ///< Number of rows the simulation will give, or zero when they are not decimated.
+	long receivedRows;         ///< Number of rows given so far.
+	double bucketWidth;        ///< Rows per bucket, not counting the first and the last row.
+	long bucketIndex;          ///< Index of the first of the two buckets held.
+	TrajectoryBucket buckets[2]; ///< The bucket being decided and the following one, whose mean decides it.
+	double anchorX;            ///< Time of the last row kept.
+	double anchorY;            ///< Log10 population of the last row kept.
+	double* lastValues;        ///< The last row given.
+	double lastWrittenTime;    ///< Time of the last row written.
+} *TrajectoryWriter;
+
+/**
+ * Reader of a binary trajectory file
+ */
+typedef struct _TrajectoryReader {
+	FILE* iHandle;             ///< The file.
+	int valueSize;             ///< Bytes per value, 4 or 8.
+	int columnCount;           ///< Number of values per row.
+	int parameterCount;        ///< Number of model parameters in the header.
+	char (*columnNames)[TRAJECTORY_NAME_LENGTH];    ///< Name of each column.
+	char (*columnUnits)[TRAJECTORY_NAME_LENGTH];    ///< Unit of each column.
+	char (*parameterNames)[TRAJECTORY_NAME_LENGTH]; ///< Name of each parameter.
+	double* parameterValues;   ///< Value of each parameter.
+	long rowCount;             ///< Number of rows.
+	double* rowTimes;          ///< Time of each row, from the index.
+	long* rowOffsets;          ///< Byte offset of each row, from the index.
+	void* row;                 ///< Buffer for one row.
+} *TrajectoryReader;
+
+int parseTrajectoryFormat(const char* name, TrajectoryFormat* format, TrajectoryContent* content);
+
+TrajectoryWriter openTrajectoryStream(FILE* oHandle, const TrajectoryOptions options, const ModelParameters mParam,
+                                      const char* textHeader);
+
+TrajectoryWriter openTrajectoryWriter(const char* fileName, const TrajectoryOptions options, const ModelParameters mParam,
+                                      const char* textHeader);
+
+int expectTrajectoryRows(TrajectoryWriter writer, const long rowCount);
+
+int writeTrajectoryRow(TrajectoryWriter writer, const ModelParameters mParam, const ModelVariables state, const double currentTime,
+                       const double population, const double antibiotic);
+
+int closeTrajectoryWriter(TrajectoryWriter writer);
+
+TrajectoryReader openTrajectoryReader(const char* fileName);
+
+int readTrajectoryRow(TrajectoryReader reader, const long row, double* values);
+
+long findTrajectoryRow(const TrajectoryReader reader, const double time);
+
+void closeTrajectoryReader(TrajectoryReader reader);
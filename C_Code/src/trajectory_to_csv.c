@@ -0,0 +1,65 @@
+/**
+ * @file   trajectory_to_csv.c
+ * @version 5
+ * @updated  2026
+ * @brief  Conversion of a binary trajectory file to CSV
+ *
+ * Usage: trajectory_to_csv [file] [start time (s)] [end time (s)]
+ *
+ * Writes the model parameters of the header as comment lines, the column names and units, then the rows from the last
+ * one at or before the start time to the last one at or before the end time, to the standard output. Without times
+ * every row is written; the start row is found from the index, so a window of a long trajectory is read directly.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include "full_model.h"
+#include "trajectory_file.h"
+
+/**
+ * Convert the file named on the command-line.
+ *
+ * @return     EXIT_SUCCESS on succesful completion
+ */
+int main(const int argc, char** argv) {
+	TrajectoryReader reader;
+	double startTime = -INFINITY, endTime = INFINITY;
+	double* values;
+	long first, last, row;
+	int i;
+
+	if (argc < 2 || argc > 4 || (argc > 2 && sscanf(argv[2], "%lg", &startTime) != 1) ||
+	    (argc > 3 && sscanf(argv[3], "%lg", &endTime) != 1)) {
+		fprintf(stderr, "Usage: %s [file] [start time (s)] [end time (s)]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+	if ((reader = openTrajectoryReader(argv[1])) == NULL)
+		return EXIT_FAILURE;
+	if ((values = (double*)malloc(sizeof(double) * reader->columnCount)) == NULL) {
+		closeTrajectoryReader(reader);
+		return EXIT_FAILURE;
+	}
+
+	for (i = 0; i < reader->parameterCount; ++i)
+		printf("# %s = %.17lg\n", reader->parameterNames[i], reader->parameterValues[i]);
+	for (i = 0; i < reader->columnCount; ++i)
+		printf("%s%s (%s)", (i > 0) ? "," : "", reader->columnNames[i], reader->columnUnits[i]);
+	printf("\n");
+	first = findTrajectoryRow(reader, startTime);
+	last = findTrajectoryRow(reader, endTime);
+	for (row = (first < 0) ? 0 : first; row <= last; ++row) {
+		if (readTrajectoryRow(reader, row, values) != 0) {
+			fprintf(stderr, "Could not read row %ld of %s\n", row, argv[1]);
+			free(values);
+			closeTrajectoryReader(reader);
+			return EXIT_FAILURE;
+		}
+		for (i = 0; i < reader->columnCount; ++i)
+			printf("%s%.17lg", (i > 0) ? "," : "", values[i]);
+		printf("\n");
+	}
+	free(values);
+	closeTrajectoryReader(reader);
+	return EXIT_SUCCESS;
+}
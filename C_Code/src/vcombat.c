@@ -0,0 +1,340 @@
+/**
+ * @file   vcombat.c
+ * @version 5
+ * @updated  2026
+ * @brief  Embeddable interface of the simulator: contexts holding the settings of a simulation and the buffers its runs reuse
+ *
+ * The settings of a context start at the defaults of the command-line and are changed by their option letters. A run
+ * completes the thresholds as the command-line does, converts the concentration profile to molecules for the current
+ * intracellular volume and molecular weight, and simulates from time zero. The model parameters with their profile, the
+ * hypergeometric matrix, the state vector, the integrator and the result vectors are held in the workspace of the
+ * context, so once a context has run its largest simulation, repeated runs allocate nothing unless they change the
+ * number of targets, the replication threshold, the integrator or the time interval.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <gsl/gsl_odeiv2.h>
+#include <gsl/gsl_errno.h>
+#include "full_model.h"
+#include "fixed_step.h"
+#include "positive_step.h"
+#include "sensitivity.h"
+#include "base_simulation.h"
+#include "trajectory_file.h"
+#include "multi_profile.h"
+#include "vcombat.h"
+
+/**
+ * Structure to hold the settings of a simulation and the buffers reused by its runs
+ */
+struct _VcombatContext {
+	struct _SimulationStepper stepper;            ///< The integrator.
+	struct _SimulationParameters simulation;      ///< The dose, population and time-points.
+	struct _TrajectoryOptions trajectoryOptions;  ///< Layout of the trajectories written by the runs.
+	ModelParameters model;                        ///< The model parameters as set, the thresholds possibly DEFAULT_DUMMY.
+	double* profile;                              ///< The concentration profile as set, one value per time-point, or NULL.
+	long profileLength;                           ///< Number of values of the profile.
+	struct _SimulationWorkspace workspace;        ///< Buffers of the runs, the parameters of the last one included.
+	char message[SIMULATION_MESSAGE_LENGTH];      ///< Reason of the last failure.
+};
+
+/**
+ * The version of the interface the library was built with, for callers checking it against VCOMBAT_API_VERSION.
+ */
+int vcombatGetApiVersion(void) {
+	return VCOMBAT_API_VERSION;
+}
+
+/**
+ * Create a context with the defaults of the command-line and no concentration profile.
+ *
+ * @return  The context, or NULL if it could not be allocated.
+ */
+VcombatContext vcombatCreate(void) {
+	VcombatContext context = (VcombatContext)calloc(1, sizeof(struct _VcombatContext));
+
+	if (context == NULL)
+		return NULL;
+	if ((context->model = (ModelParameters)calloc(1, sizeof(struct _ModelParameters))) == NULL) {
+		free(context);
+		return NULL;
+	}
+	context->stepper.gslStepping = gsl_odeiv2_step_rk2;
+	context->stepper.nativeMethod = FIXED_STEP_RK2;
+	context->stepper.positivityPreserving = 0;
+	context->stepper.fixedStepSize = 0.0;
+	context->stepper.verbose = 0;
+	context->model->transMembranePermeability = DEFAULT_TRANSMEMBRANE_PERMEABILITY;
+	context->model->intracellularVolume = DEFAULT_INTRACELLULAR_VOLUME;
+	context->model->targetMoleculeCount = DEFAULT_TARGET_MOLECULE_COUNT;
+	context->model->replicationThreshold = DEFAULT_DUMMY;
+	context->model->killingThreshold = DEFAULT_THRESHOLD;
+	context->model->baselineReplication = DEFAULT_BASELINE_REPLICATION;
+	context->model->maximumKillRate = DEFAULT_MAXIMUM_KILL_RATE;
+	context->model->targetAssociationRate = DEFAULT_TARGET_ASSOCIATION_RATE;
+	context->model->targetDissociationRate = DEFAULT_TARGET_DISSOCIATION_RATE;
+	context->model->nonSpecificAssociationRate = DEFAULT_NONSPECIFIC_ASSOCIATION_RATE;
+	context->model->nonSpecificDissociationRate = DEFAULT_NONSPECIFIC_DISSOCIATION_RATE;
+	context->model->timepoints = DEFAULT_TIMEPOINTS;
+	context->model->molecularweight = DEFAULT_MOLECULARWEIGHT;
+	context->model->steptime = DEFAULT_STEPTIME;
+	context->model->carryingCapacity = DEFAULT_CARRYING_CAPACITY;
+	context->model->hyperGeometricMatrix = NULL;
+	context->simulation.startingAntibiotic = DEFAULT_STARTING_ANTIBIOTIC;
+	context->simulation.startingPopulation = DEFAULT_STARTING_POPULATION;
+	context->simulation.endTime = DEFAULT_SIMULATION_END_TIME;
+	context->simulation.stepSize = DEFAULT_SIMULATION_STEP_SIZE;
+	context->trajectoryOptions.format = TRAJECTORY_TEXT;
+	context->trajectoryOptions.content = TRAJECTORY_COMPARTMENTS;
+	context->trajectoryOptions.plotPoints = 0;
+	context->trajectoryOptions.copyHandle = NULL;
+	return context;
+}
+
+/**
+ * Set one setting of the context as its command-line option would: V, n, r, k, R, K, A, D, C and M for the model, d, p
+ * and t for the simulation, S and H for the integrator, and T and N for the trajectories written by the runs. v with a
+ * non-zero value prints each time-point of the runs to the standard output, as the verbose mode of the command-line.
+ *
+ * @param context  The context.
+ * @param option   The option letter.
+ * @param value    The argument of the option.
+ *
+ * @return         GSL_SUCCESS, or GSL_EINVAL with the reason given by vcombatGetError.
+ */
+int vcombatConfigure(VcombatContext context, const char option, const char* value) {
+	if (option == 'v') {
+		if (sscanf(value, "%d", &context->stepper.verbose) != 1) {
+			snprintf(context->message, SIMULATION_MESSAGE_LENGTH, "Option v needs a number");
+			return GSL_EINVAL;
+		}
+		return GSL_SUCCESS;
+	}
+	if (parseSimulationOption(option, value, &context->stepper, context->model, &context->simulation, &context->trajectoryOptions,
+	                          context->message) != 0)
+		return GSL_EINVAL;
+	return GSL_SUCCESS;
+}
+
+/**
+ * Copy the settings of a context, for the command-line, which parses the options it shares with the library into a
+ * context and runs its other modes with them.
+ *
+ * @param context            The context.
+ * @param stepper            Receives the integrator.
+ * @param model              Receives the model parameters, without a profile; the thresholds may be DEFAULT_DUMMY.
+ * @param simulation         Receives the dose, population and time-points.
+ * @param trajectoryOptions  Receives the layout of the trajectories.
+ */
+void getVcombatSettings(const struct _VcombatContext* context, SimulationStepper stepper, ModelParameters model,
+                        SimulationParameters simulation, struct _TrajectoryOptions* trajectoryOptions) {
+	*stepper = context->stepper;
+	*model = *context->model;
+	*simulation = context->simulation;
+	*trajectoryOptions = context->trajectoryOptions;
+}
+
+/**
+ * Set a stream receiving a copy of the trajectory each run writes, as the result cache of the command-line keeps them.
+ *
+ * @param context  The context.
+ * @param copy     The stream, left open; or NULL for none.
+ */
+void vcombatSetTrajectoryCopy(VcombatContext context, FILE* copy) {
+	context->trajectoryOptions.copyHandle = copy;
+}
+
+/**
+ * Set the concentration profile of the runs, copied into the context. As with an input file, the values are the
+ * concentrations at successive time-points, and time-points beyond them have zero concentration.
+ *
+ * @param context         The context.
+ * @param concentrations  The concentrations, in the units of the input files.
+ * @param count           Number of concentrations.
+ *
+ * @return                GSL_SUCCESS, GSL_EINVAL for an empty profile or GSL_ENOMEM.
+ */
+int vcombatSetProfile(VcombatContext context, const double* concentrations, const long count) {
+	double* profile;
+
+	if (count < 1) {
+		snprintf(context->message, SIMULATION_MESSAGE_LENGTH, "The concentration profile is empty");
+		return GSL_EINVAL;
+	}
+	if (count > context->profileLength) {
+		if ((profile = (double*)realloc(context->profile, sizeof(double) * count)) == NULL) {
+			snprintf(context->message, SIMULATION_MESSAGE_LENGTH, "Out of memory");
+			return GSL_ENOMEM;
+		}
+		context->profile = profile;
+	}
+	memcpy(context->profile, concentrations, sizeof(double) * count);
+	context->profileLength = count;
+	return GSL_SUCCESS;
+}
+
+/**
+ * Set the concentration profile of the runs to the first column of an input file.
+ *
+ * @param context   The context.
+ * @param fileName  The input file.
+ *
+ * @return          GSL_SUCCESS, GSL_EFAILED if the file could not be read, or GSL_ENOMEM.
+ */
+int vcombatReadProfile(VcombatContext context, const char* fileName) {
+	double* values;
+	int columnCount, rowCount, x;
+	int status;
+
+	if (readProfileFile(fileName, &columnCount, &rowCount, &values) != 0) {
+		snprintf(context->message, SIMULATION_MESSAGE_LENGTH, "The input file could not be read");
+		return GSL_EFAILED;
+	}
+	for (x = 0; x < rowCount; ++x)
+		values[x] = values[(size_t)x * columnCount];
+	status = vcombatSetProfile(context, values, rowCount);
+	free(values);
+	return status;
+}
+
+/**
+ * Number of time-points of a run with the current settings, the start included; the size of the output buffers.
+ *
+ * @param context  The context.
+ *
+ * @return         The number of time-points, or zero if the time settings are invalid.
+ */
+long vcombatCountTimePoints(const VcombatContext context) {
+	if (!(context->simulation.stepSize > 0.0) || !(context->simulation.endTime >= context->simulation.stepSize))
+		return 0;
+	return countSimulationTicks(0.0, context->simulation.endTime, context->simulation.stepSize);
+}
+
+/**
+ * Prepare the parameters, profile, matrix and state of a run in the workspace of the context.
+ *
+ * @return  GSL_SUCCESS, or the error with its reason in the message of the context.
+ */
+static int prepareRun(VcombatContext context) {
+	const int timepoints = (int)countSimulationTicks(0.0, context->simulation.endTime, context->simulation.stepSize);
+	ModelParameters runParam;
+	int x;
+
+	if ((runParam = reserveWorkspaceParameters(&context->workspace, timepoints)) == NULL) {
+		snprintf(context->message, SIMULATION_MESSAGE_LENGTH, "Out of memory");
+		return GSL_ENOMEM;
+	}
+	*runParam = *context->model;
+	runParam->timepoints = timepoints;
+	runParam->steptime = context->simulation.stepSize;
+	applyDefaultThresholds(runParam);
+	if (sanityCheckModelParameters(runParam) != 0) {
+		snprintf(context->message, SIMULATION_MESSAGE_LENGTH, "Bad parameters supplied");
+		return GSL_EINVAL;
+	}
+	for (x = 0; x < timepoints; ++x)
+		runParam->realantibioticconc[x] = concentrationToMolecules(runParam, (x < context->profileLength) ? context->profile[x] : 0.0);
+	if (timepoints > 0)
+		runParam->realantibioticconc[timepoints] = runParam->realantibioticconc[timepoints - 1];
+
+	if ((runParam->hyperGeometricMatrix = reserveWorkspaceMatrix(&context->workspace, runParam->targetMoleculeCount,
+	                                                             runParam->replicationThreshold)) == NULL ||
+	    resetWorkspaceState(&context->workspace, runParam->targetMoleculeCount, context->simulation.startingAntibiotic,
+	                        context->simulation.startingPopulation) == NULL) {
+		snprintf(context->message, SIMULATION_MESSAGE_LENGTH, "Out of memory");
+		return GSL_ENOMEM;
+	}
+	return GSL_SUCCESS;
+}
+
+/**
+ * Run a simulation with the settings and profile of the context.
+ *
+ * @param context     The context.
+ * @param output      Receives the number of time-points, the final population and the step counts, and the time-points
+ *                    in its buffers, which must then hold vcombatCountTimePoints values; or NULL.
+ * @param trajectory  Stream receiving the trajectory in the layout set by the T and N options, left open; or NULL. A
+ *                    text file of the compartments ends with the column header of the command-line.
+ *
+ * @return            GSL_SUCCESS, GSL_EBADLEN if the buffers are too small (the count of the output is then set),
+ *                    otherwise the error, with the reason given by vcombatGetError.
+ */
+int vcombatRun(VcombatContext context, VcombatOutput output, FILE* trajectory) {
+	const long count = vcombatCountTimePoints(context);
+	TrajectoryWriter writer = NULL;
+	int status, i;
+
+	context->message[0] = '\0';
+	if (count == 0) {
+		snprintf(context->message, SIMULATION_MESSAGE_LENGTH, "The time needs [end (s)]:[interval (s)] with 0 < interval <= end");
+		return GSL_EINVAL;
+	}
+	if (context->profile == NULL) {
+		snprintf(context->message, SIMULATION_MESSAGE_LENGTH, "No concentration profile was set");
+		return GSL_EINVAL;
+	}
+	if (output != NULL) {
+		output->count = count;
+		if ((output->time != NULL || output->population != NULL || output->unboundAntibiotic != NULL) && output->capacity < count) {
+			snprintf(context->message, SIMULATION_MESSAGE_LENGTH, "The output holds %ld time-points, the run has %ld", output->capacity, count);
+			return GSL_EBADLEN;
+		}
+	}
+	if ((status = prepareRun(context)) != GSL_SUCCESS)
+		return status;
+	if (trajectory != NULL && (writer = openTrajectoryStream(trajectory, &context->trajectoryOptions, context->workspace.mParam, NULL)) == NULL) {
+		snprintf(context->message, SIMULATION_MESSAGE_LENGTH, "The trajectory could not be written");
+		return GSL_EFAILED;
+	}
+
+	status = runWorkspaceSimulation(&context->workspace, &context->stepper, context->simulation.endTime, context->simulation.stepSize, writer);
+	if (writer != NULL && closeTrajectoryWriter(writer) != 0 && status == GSL_SUCCESS)
+		status = GSL_EFAILED;
+	if (status != GSL_SUCCESS) {
+		snprintf(context->message, SIMULATION_MESSAGE_LENGTH, "The simulation failed: %s", gsl_strerror(status));
+		return status;
+	}
+
+	if (output != NULL) {
+		if (output->time != NULL)
+			memcpy(output->time, context->workspace.results.timePoint, sizeof(double) * count);
+		if (output->population != NULL)
+			memcpy(output->population, context->workspace.results.totalPopulation, sizeof(double) * count);
+		if (output->unboundAntibiotic != NULL)
+			memcpy(output->unboundAntibiotic, context->workspace.results.unboundantibiotic, sizeof(double) * count);
+		output->finalPopulation = 0.0;
+		for (i = NUMBER_FREE_KINETIC_VARIABLES; i < context->workspace.mParam->targetMoleculeCount + NUMBER_FREE_KINETIC_VARIABLES + 1; ++i)
+			output->finalPopulation += context->workspace.state[i];
+		output->acceptedSteps = context->workspace.results.acceptedSteps;
+		output->rejectedSteps = context->workspace.results.rejectedSteps;
+	}
+	return GSL_SUCCESS;
+}
+
+/**
+ * The reason of the last failure of a function given the context.
+ *
+ * @param context  The context.
+ *
+ * @return         The reason, owned by the context, or an empty string.
+ */
+const char* vcombatGetError(const VcombatContext context) {
+	return context->message;
+}
+
+/**
+ * Free a context and its buffers.
+ *
+ * @param context  The context, or NULL.
+ */
+void vcombatDestroy(VcombatContext context) {
+	if (context == NULL)
+		return;
+	freeSimulationWorkspace(&context->workspace);
+	free(context->profile);
+	free(context->model);
+	free(context);
+}
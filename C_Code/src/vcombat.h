@@ -0,0 +1,66 @@
+/**
+ * @file   vcombat.h
+ * @version 5
+ * @updated  2026
+ * @brief  Embeddable interface of the simulator, the public header of libvcombat
+ *
+ * A context holds the settings of a simulation and the buffers its runs reuse. Contexts share no state, so each thread
+ * may run its own; one context is used by one thread at a time. GSL reports errors through a process-wide handler,
+ * which aborts by default: callers which want the error codes instead call gsl_set_error_handler_off() once.
+ */
+
+#ifndef VCOMBAT_H
+#define VCOMBAT_H
+
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define VCOMBAT_API_VERSION 1 ///< Version of this interface, raised when it changes incompatibly
+
+/**
+ * A simulation context, created by vcombatCreate and freed by vcombatDestroy
+ */
+typedef struct _VcombatContext* VcombatContext;
+
+/**
+ * Structure to hold the buffers, provided by the caller, receiving the outcome of a run
+ */
+typedef struct _VcombatOutput {
+	double* time;                  ///< Receives the time of each time-point, or NULL.
+	double* population;            ///< Receives the population at each time-point, or NULL.
+	double* unboundAntibiotic;     ///< Receives the concentration of the profile, in molecules, at each time-point, or NULL.
+	long capacity;                 ///< Number of time-points each of the buffers holds.
+	long count;                    ///< Set to the number of time-points of the run.
+	double finalPopulation;        ///< Set to the population at the end of the run.
+	unsigned long acceptedSteps;   ///< Set to the number of integration steps accepted.
+	unsigned long rejectedSteps;   ///< Set to the number of integration steps rejected by the error control.
+} *VcombatOutput;
+
+int vcombatGetApiVersion(void);
+
+VcombatContext vcombatCreate(void);
+
+int vcombatConfigure(VcombatContext context, const char option, const char* value);
+
+void vcombatSetTrajectoryCopy(VcombatContext context, FILE* copy);
+
+int vcombatSetProfile(VcombatContext context, const double* concentrations, const long count);
+
+int vcombatReadProfile(VcombatContext context, const char* fileName);
+
+long vcombatCountTimePoints(const VcombatContext context);
+
+int vcombatRun(VcombatContext context, VcombatOutput output, FILE* trajectory);
+
+const char* vcombatGetError(const VcombatContext context);
+
+void vcombatDestroy(VcombatContext context);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,476 @@
+/**
+ * @file   virtual_population.c
+ * @version 5
+ * @updated  2026
+ * @brief  Simulation of a virtual patient population with between-subject pharmacokinetic variability
+ *
+ * Every patient draws clearance, volume and absorption rate from log-normal distributions, gets the concentration
+ * profile of the regimen from the one-compartment model and is simulated as one task on the parallel runner. Patient i
+ * draws from its own random stream, seeded from the seed and i, so the population is the same whatever the number of
+ * threads and whichever worker simulates the patient.
+ *
+ * The outcomes are aggregated as the patients complete, without keeping their trajectories: each worker adds the log10
+ * population of its patients at every time-point to its own histogram, and counts the patients attaining each log-kill
+ * target at the end time. The integer counts are summed over the workers once all patients are done, so the results do
+ * not depend on the order of completion, and the percentile bands of the log-kill are read from the summed histogram
+ * to within the bin width.
+ *
+ * The configuration file holds one setting per line; '#' starts a comment:
+ *
+ *     patients [count]
+ *     clearance [median (L/h)] [omega]
+ *     volume [median (L)] [omega]
+ *     absorption [median (1/h), zero for intravenous boluses] [omega]
+ *     bioavailability [fraction]
+ *     regimen [dose (mg)] [interval (h)] [doses]
+ *     seed [seed]
+ *     target [log-kill at the end time]           (may be repeated)
+ *     percentiles [percent] [percent] ...
+ *     resolution [histogram bin width in log10 CFU]
+ *     bands [file]
+ *     summary [file]
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <gsl/gsl_odeiv2.h>
+#include <gsl/gsl_errno.h>
+#include <gsl/gsl_rng.h>
+#include <gsl/gsl_randist.h>
+#include "full_model.h"
+#include "fixed_step.h"
+#include "positive_step.h"
+#include "sensitivity.h"
+#include "base_simulation.h"
+#include "parallel_runner.h"
+#include "pharmacokinetics.h"
+#include "virtual_population.h"
+
+/**
+ * Columns of the per-patient summary
+ */
+enum {
+	VPOP_SUMMARY_CLEARANCE,
+	VPOP_SUMMARY_VOLUME,
+	VPOP_SUMMARY_ABSORPTION,
+	VPOP_SUMMARY_FINAL_KILL,
+	VPOP_SUMMARY_MAXIMUM_KILL,
+	VPOP_SUMMARY_COUNT
+};
+
+/**
+ * Private workspace and partial aggregates of one worker
+ */
+typedef struct _VpopWorker {
+	ModelParameters mParam;           ///< The worker's copy of the model parameters, holding the profile of its current patient.
+	SimulationIntegrator integrator;  ///< The worker's integrator.
+	gsl_rng* rng;                     ///< Generator reseeded for every patient.
+	double* state;                    ///< State buffer.
+	double* logPopulation;            ///< log10 population of the current patient at every time-point.
+	unsigned int* histogram;          ///< Count of patients per bin of the log10 population, one row of bins per time-point.
+	int attained[VPOP_MAX_TARGETS];   ///< Patients attaining each target.
+	int patientCount;                 ///< Patients simulated by this worker.
+	int tickCount;                    ///< Time-points per patient.
+} *VpopWorker;
+
+/**
+ * State shared by the tasks: everything is read-only except the per-patient summary, of which each task writes its row
+ */
+typedef struct _VpopRun {
+	VpopSettings settings;       ///< The population and the outcomes.
+	double endTime;              ///< End of the simulations.
+	double timeInterval;         ///< Interval between the time-points.
+	const double* initialState;  ///< The initial state of the simulations.
+	int binCount;                ///< Number of histogram bins per time-point.
+	double* summary;             ///< Parameters and outcome of every patient, or NULL.
+	VpopWorker workers;          ///< The workspaces, one per worker.
+	int verbose;                 ///< Print the progress, from the first worker.
+} *VpopRun;
+
+/**
+ * Read the population, the regimen and the outcomes. Unset settings keep their defaults.
+ *
+ * @param fileName  The configuration file.
+ * @param settings  The settings to fill.
+ *
+ * @return          0 on success, -1 on failure.
+ */
+int readVpopSettings(const char* fileName, VpopSettings settings) {
+	static const double defaultPercentiles[] = { 5.0, 25.0, 50.0, 75.0, 95.0 };
+	FILE* iHandle;
+	char line[FILENAME_MAX + 64];
+	int lineNumber = 0;
+	int hasRegimen = 0;
+
+	memset(settings, 0, sizeof(struct _VpopSettings));
+	settings->patientCount = DEFAULT_VPOP_PATIENTS;
+	settings->bioavailability = 1.0;
+	settings->seed = 1;
+	settings->resolution = DEFAULT_VPOP_RESOLUTION;
+	settings->percentileCount = sizeof(defaultPercentiles) / sizeof(double);
+	memcpy(settings->percentiles, defaultPercentiles, sizeof(defaultPercentiles));
+	if ((iHandle = fopen(fileName, "r")) == NULL) {
+		fprintf(stderr, "Could not open %s for reading\n", fileName);
+		return -1;
+	}
+	while (fgets(line, sizeof(line), iHandle) != NULL) {
+		char key[32], first[FILENAME_MAX];
+		char* comment = strchr(line, '#');
+		VpopDistribution* distribution = NULL;
+		int fields;
+
+		++lineNumber;
+		if (comment != NULL)
+			*comment = '\0';
+		if ((fields = sscanf(line, "%31s %4095s", key, first)) < 1)
+			continue;
+		if (!strcmp(key, "clearance"))
+			distribution = &settings->clearance;
+		else if (!strcmp(key, "volume"))
+			distribution = &settings->volume;
+		else if (!strcmp(key, "absorption"))
+			distribution = &settings->absorptionRate;
+		if (distribution != NULL) {
+			if (sscanf(line, "%*s %lg %lg", &distribution->median, &distribution->omega) < 1) {
+				fprintf(stderr, "%s:%d: expected %s [median] [omega]\n", fileName, lineNumber, key);
+				fclose(iHandle);
+				return -1;
+			}
+		} else if (!strcmp(key, "regimen")) {
+			if (sscanf(line, "%*s %lg %lg %d", &settings->regimen.dose, &settings->regimen.interval, &settings->regimen.doseCount) != 3) {
+				fprintf(stderr, "%s:%d: expected regimen [dose (mg)] [interval (h)] [doses]\n", fileName, lineNumber);
+				fclose(iHandle);
+				return -1;
+			}
+			hasRegimen = 1;
+		} else if (!strcmp(key, "target") && fields >= 2) {
+			if (settings->targetCount == VPOP_MAX_TARGETS) {
+				fprintf(stderr, "%s:%d: at most %d targets\n", fileName, lineNumber, VPOP_MAX_TARGETS);
+				fclose(iHandle);
+				return -1;
+			}
+			settings->targets[settings->targetCount++] = atof(first);
+		} else if (!strcmp(key, "percentiles") && fields >= 2) {
+			char* cursor = strstr(line, key) + strlen(key);
+			char* end;
+			double value;
+
+			settings->percentileCount = 0;
+			while ((value = strtod(cursor, &end)), end != cursor) {
+				if (settings->percentileCount == VPOP_MAX_PERCENTILES || value <= 0.0 || value >= 100.0 ||
+				    (settings->percentileCount > 0 && value <= settings->percentiles[settings->percentileCount - 1])) {
+					fprintf(stderr, "%s:%d: expected at most %d ascending percentiles between 0 and 100\n", fileName, lineNumber,
+					        VPOP_MAX_PERCENTILES);
+					fclose(iHandle);
+					return -1;
+				}
+				settings->percentiles[settings->percentileCount++] = value;
+				cursor = end;
+			}
+		} else if (!strcmp(key, "patients") && fields >= 2)
+			settings->patientCount = atoi(first);
+		else if (!strcmp(key, "bioavailability") && fields >= 2)
+			settings->bioavailability = atof(first);
+		else if (!strcmp(key, "seed") && fields >= 2)
+			settings->seed = strtoul(first, NULL, 10);
+		else if (!strcmp(key, "resolution") && fields >= 2)
+			settings->resolution = atof(first);
+		else if (!strcmp(key, "bands") && fields >= 2)
+			strcpy(settings->bandsFile, first);
+		else if (!strcmp(key, "summary") && fields >= 2)
+			strcpy(settings->summaryFile, first);
+		else {
+			fprintf(stderr, "%s:%d: unknown or incomplete setting %s\n", fileName, lineNumber, key);
+			fclose(iHandle);
+			return -1;
+		}
+	}
+	fclose(iHandle);
+
+	if (!hasRegimen || settings->regimen.dose < 0.0 || settings->regimen.interval <= 0.0 || settings->regimen.doseCount < 1) {
+		fprintf(stderr, "%s: the population needs a regimen with a positive interval and at least one dose\n", fileName);
+		return -1;
+	}
+	if (settings->patientCount < 1 || settings->clearance.median <= 0.0 || settings->volume.median <= 0.0 ||
+	    settings->absorptionRate.median < 0.0 || settings->clearance.omega < 0.0 || settings->volume.omega < 0.0 ||
+	    settings->absorptionRate.omega < 0.0 || settings->bioavailability <= 0.0 || settings->resolution <= 0.0 ||
+	    settings->percentileCount == 0) {
+		fprintf(stderr, "%s: the population needs patients, positive clearance and volume, and non-negative variabilities\n", fileName);
+		return -1;
+	}
+	return 0;
+}
+
+/**
+ * Task simulating one patient and adding its outcome to the aggregates of the worker.
+ */
+static int simulatePatient(const int taskIndex, const int workerIndex, void* context) {
+	VpopRun run = (VpopRun)context;
+	const VpopSettings settings = run->settings;
+	VpopWorker worker = &run->workers[workerIndex];
+	struct _PkParameters pk;
+	double finalKill, maximumKill = -INFINITY;
+	int tickCount;
+	int a, p;
+	int status;
+
+	gsl_rng_set(worker->rng, getTaskSeed(settings->seed, taskIndex));
+	pk.clearance = settings->clearance.median * exp(gsl_ran_gaussian(worker->rng, 1.0) * settings->clearance.omega);
+	pk.volume = settings->volume.median * exp(gsl_ran_gaussian(worker->rng, 1.0) * settings->volume.omega);
+	pk.absorptionRate = settings->absorptionRate.median * exp(gsl_ran_gaussian(worker->rng, 1.0) * settings->absorptionRate.omega);
+	pk.bioavailability = settings->bioavailability;
+	fillConcentrationProfile(&pk, &settings->regimen, worker->mParam);
+
+	if ((status = recordLogPopulation(worker->integrator, worker->mParam, run->endTime, run->timeInterval, run->initialState,
+	                                  worker->state, worker->logPopulation, &tickCount)) != GSL_SUCCESS) {
+		fprintf(stderr, "The simulation of patient %d failed: %s\n", taskIndex, gsl_strerror(status));
+		return status;
+	}
+
+	for (a = 0; a < tickCount; ++a) {
+		int bin = (int)(worker->logPopulation[a] / settings->resolution);
+
+		if (bin >= run->binCount)
+			bin = run->binCount - 1;
+		++worker->histogram[(size_t)a * run->binCount + bin];
+		if (worker->logPopulation[0] - worker->logPopulation[a] > maximumKill)
+			maximumKill = worker->logPopulation[0] - worker->logPopulation[a];
+	}
+	finalKill = worker->logPopulation[0] - worker->logPopulation[tickCount - 1];
+	for (p = 0; p < settings->targetCount; ++p)
+		if (finalKill >= settings->targets[p])
+			++worker->attained[p];
+	++worker->patientCount;
+	worker->tickCount = tickCount;
+
+	if (run->summary != NULL) {
+		double* row = run->summary + (size_t)taskIndex * VPOP_SUMMARY_COUNT;
+
+		row[VPOP_SUMMARY_CLEARANCE] = pk.clearance;
+		row[VPOP_SUMMARY_VOLUME] = pk.volume;
+		row[VPOP_SUMMARY_ABSORPTION] = pk.absorptionRate;
+		row[VPOP_SUMMARY_FINAL_KILL] = finalKill;
+		row[VPOP_SUMMARY_MAXIMUM_KILL] = maximumKill;
+	}
+	if (run->verbose && workerIndex == 0 && worker->patientCount % 10 == 0) {
+		printf("patient %d of %d          \r", taskIndex + 1, settings->patientCount);
+		fflush(stdout);
+	}
+	return GSL_SUCCESS;
+}
+
+/**
+ * Value of the log10 population below which the given fraction of the patients lie at one time-point, interpolated
+ * within its histogram bin.
+ */
+static double getHistogramQuantile(const unsigned int* histogram, const int binCount, const double resolution, const double fraction,
+                                   const int patientCount) {
+	const double target = fraction * patientCount;
+	double cumulative = 0.0;
+	int bin;
+
+	for (bin = 0; bin < binCount; ++bin) {
+		if (histogram[bin] > 0 && cumulative + histogram[bin] >= target)
+			return (bin + (target - cumulative) / histogram[bin]) * resolution;
+		cumulative += histogram[bin];
+	}
+	return binCount * resolution;
+}
+
+/**
+ * Write the parameters and the outcome of every patient.
+ */
+static int writeVpopSummary(const VpopSettings settings, const double* summary) {
+	FILE* oHandle;
+	int n;
+
+	if ((oHandle = fopen(settings->summaryFile, "w")) == NULL) {
+		fprintf(stderr, "Could not open %s for writing\n", settings->summaryFile);
+		return GSL_EFAILED;
+	}
+	fprintf(oHandle, "patient clearance volume absorption finalLogKill maximumLogKill\n");
+	for (n = 0; n < settings->patientCount; ++n) {
+		const double* row = summary + (size_t)n * VPOP_SUMMARY_COUNT;
+
+		fprintf(oHandle, "%d %.6lg %.6lg %.6lg %.6lg %.6lg\n", n, row[VPOP_SUMMARY_CLEARANCE], row[VPOP_SUMMARY_VOLUME],
+		        row[VPOP_SUMMARY_ABSORPTION], row[VPOP_SUMMARY_FINAL_KILL], row[VPOP_SUMMARY_MAXIMUM_KILL]);
+	}
+	if (fclose(oHandle) != 0) {
+		fprintf(stderr, "Could not write %s\n", settings->summaryFile);
+		return GSL_EFAILED;
+	}
+	return GSL_SUCCESS;
+}
+
+/**
+ * Simulate the patients of the population concurrently and aggregate their outcomes.
+ *
+ * @param stepper        The integrator selection.
+ * @param mParam         Model parameters for the simulation; the concentration profile is replaced in per-worker copies.
+ * @param settings       The population, the regimen and the outcomes.
+ * @param endTime        End of the simulations.
+ * @param timeInterval   Interval between the time-points.
+ * @param initialState   The initial state.
+ * @param threadCount    Number of threads simulating the patients.
+ * @param results        The aggregated outcomes; free the bands with freeVpopResults.
+ *
+ * @return               GSL_SUCCESS, or the error of the first simulation which failed.
+ */
+int runVirtualPopulation(const SimulationStepper stepper, const ModelParameters mParam, const VpopSettings settings, const double endTime,
+                         const double timeInterval, const double* initialState, const int threadCount, VpopResults results) {
+	const int dim = NUMBER_FREE_KINETIC_VARIABLES + mParam->targetMoleculeCount + 1;
+	const size_t size = sizeof(struct _ModelParameters) + sizeof(double) * (mParam->timepoints + 1);
+	size_t histogramSize;
+	struct _VpopRun run;
+	double started = getWallClockTime();
+	int workerCount = (threadCount < settings->patientCount) ? threadCount : settings->patientCount;
+	int status = GSL_SUCCESS;
+	int w, a, p;
+	size_t b;
+
+	memset(results, 0, sizeof(struct _VpopResults));
+	memset(&run, 0, sizeof(run));
+	run.settings = settings;
+	run.endTime = endTime;
+	run.verbose = stepper->verbose;
+	run.timeInterval = timeInterval;
+	run.initialState = initialState;
+	run.binCount = (int)ceil(VPOP_MAX_LOG_POPULATION / settings->resolution);
+	if (workerCount < 1)
+		workerCount = 1;
+	histogramSize = (size_t)(mParam->timepoints + 1) * run.binCount;
+
+	run.workers = (VpopWorker)calloc(workerCount, sizeof(struct _VpopWorker));
+	if (settings->summaryFile[0] != '\0')
+		run.summary = (double*)malloc(sizeof(double) * settings->patientCount * VPOP_SUMMARY_COUNT);
+	if (run.workers == NULL || (settings->summaryFile[0] != '\0' && run.summary == NULL)) {
+		status = GSL_ENOMEM;
+		goto cleanup;
+	}
+	for (w = 0; w < workerCount; ++w) {
+		VpopWorker worker = &run.workers[w];
+
+		if ((worker->mParam = (ModelParameters)malloc(size)) == NULL) {
+			status = GSL_ENOMEM;
+			goto cleanup;
+		}
+		memcpy(worker->mParam, mParam, size);
+		worker->integrator = allocateSimulationIntegrator(stepper, worker->mParam, timeInterval);
+		worker->rng = gsl_rng_alloc(gsl_rng_mt19937);
+		worker->state = (double*)malloc(sizeof(double) * dim);
+		worker->logPopulation = (double*)malloc(sizeof(double) * (mParam->timepoints + 1));
+		worker->histogram = (unsigned int*)calloc(histogramSize, sizeof(unsigned int));
+		if (worker->integrator == NULL || worker->rng == NULL || worker->state == NULL || worker->logPopulation == NULL ||
+		    worker->histogram == NULL) {
+			status = GSL_ENOMEM;
+			goto cleanup;
+		}
+	}
+
+	status = runParallelTasks(settings->patientCount, workerCount, simulatePatient, &run);
+	if (run.verbose)
+		printf("\n");
+	if (status != GSL_SUCCESS)
+		goto cleanup;
+
+	// Sum the aggregates of the workers into those of the first
+	for (w = 1; w < workerCount; ++w) {
+		VpopWorker worker = &run.workers[w];
+
+		for (b = 0; b < histogramSize; ++b)
+			run.workers[0].histogram[b] += worker->histogram[b];
+		for (p = 0; p < settings->targetCount; ++p)
+			run.workers[0].attained[p] += worker->attained[p];
+		if (worker->tickCount > run.workers[0].tickCount)
+			run.workers[0].tickCount = worker->tickCount;
+	}
+	results->patientCount = settings->patientCount;
+	results->tickCount = run.workers[0].tickCount;
+	for (p = 0; p < settings->targetCount; ++p)
+		results->attainment[p] = (double)run.workers[0].attained[p] / settings->patientCount;
+
+	// The upper percentiles of the log-kill are the lower percentiles of the population
+	if ((results->bands = (double*)malloc(sizeof(double) * results->tickCount * settings->percentileCount)) == NULL) {
+		status = GSL_ENOMEM;
+		goto cleanup;
+	}
+	for (a = 0; a < results->tickCount; ++a) {
+		const unsigned int* histogram = run.workers[0].histogram + (size_t)a * run.binCount;
+
+		for (p = 0; p < settings->percentileCount; ++p)
+			results->bands[a * settings->percentileCount + p] = log10(fmax(initialState[NUMBER_FREE_KINETIC_VARIABLES], POPULATION_FLOOR))
+				- getHistogramQuantile(histogram, run.binCount, settings->resolution, 1.0 - settings->percentiles[p] / 100.0,
+				                       settings->patientCount);
+	}
+	if (run.summary != NULL)
+		status = writeVpopSummary(settings, run.summary);
+
+cleanup:
+	for (w = 0; run.workers != NULL && w < workerCount; ++w) {
+		VpopWorker worker = &run.workers[w];
+
+		freeSimulationIntegrator(worker->integrator);
+		if (worker->rng != NULL)
+			gsl_rng_free(worker->rng);
+		free(worker->mParam);
+		free(worker->state);
+		free(worker->logPopulation);
+		free(worker->histogram);
+	}
+	free(run.workers);
+	free(run.summary);
+	results->wallTime = getWallClockTime() - started;
+	return status;
+}
+
+/**
+ * Print the probability of target attainment and write the percentile bands of the log-kill over time.
+ *
+ * @param settings      The population, the regimen and the outcomes.
+ * @param results       The aggregated outcomes.
+ * @param timeInterval  Interval between the time-points.
+ *
+ * @return              GSL_SUCCESS, or GSL_EFAILED if the bands cannot be written.
+ */
+int writeVpopResults(const VpopSettings settings, const VpopResults results, const double timeInterval) {
+	FILE* oHandle = stdout;
+	int a, p;
+
+	printf("%d patients, regimen %lg mg every %lg h for %d doses\n", results->patientCount, settings->regimen.dose,
+	       settings->regimen.interval, settings->regimen.doseCount);
+	for (p = 0; p < settings->targetCount; ++p)
+		printf("Probability of a log-kill of at least %lg at the end time: %.4lf\n", settings->targets[p], results->attainment[p]);
+	printf("%lg s elapsed\n", results->wallTime);
+
+	if (settings->bandsFile[0] != '\0' && (oHandle = fopen(settings->bandsFile, "w")) == NULL) {
+		fprintf(stderr, "Could not open %s for writing\n", settings->bandsFile);
+		return GSL_EFAILED;
+	}
+	fprintf(oHandle, "time");
+	for (p = 0; p < settings->percentileCount; ++p)
+		fprintf(oHandle, " p%lg", settings->percentiles[p]);
+	fprintf(oHandle, "\n");
+	for (a = 0; a < results->tickCount; ++a) {
+		fprintf(oHandle, "%lg", a * timeInterval);
+		for (p = 0; p < settings->percentileCount; ++p)
+			fprintf(oHandle, " %.4lf", results->bands[a * settings->percentileCount + p]);
+		fprintf(oHandle, "\n");
+	}
+	if (oHandle != stdout && fclose(oHandle) != 0) {
+		fprintf(stderr, "Could not write %s\n", settings->bandsFile);
+		return GSL_EFAILED;
+	}
+	return GSL_SUCCESS;
+}
+
+/**
+ * Free the bands of the aggregated outcomes.
+ *
+ * @param results  The aggregated outcomes.
+ */
+void freeVpopResults(VpopResults results) {
+	free(results->bands);
+	results->bands = NULL;
+}
@@ -0,0 +1,60 @@
+/**
+ * @file   virtual_population.h
+ * @version 5
+ * @updated  2026
+ * @brief  Simulation of a virtual patient population with between-subject pharmacokinetic variability
+ */
+
+#define DEFAULT_VPOP_PATIENTS 1000        ///< Number of simulated patients
+#define DEFAULT_VPOP_RESOLUTION 0.02      ///< Width of the histogram bins of the log10 population
+#define VPOP_MAX_LOG_POPULATION 16.0      ///< Upper end of the histogram of the log10 population; larger values fall in the last bin
+#define VPOP_MAX_TARGETS 8                ///< Largest number of log-kill targets
+#define VPOP_MAX_PERCENTILES 16           ///< Largest number of percentiles of the log-kill bands
+
+/**
+ * Log-normal between-subject distribution of a pharmacokinetic parameter
+ */
+typedef struct _VpopDistribution {
+	double median; ///< Typical value.
+	double omega;  ///< Standard deviation of the logarithm; zero gives every patient the typical value.
+} VpopDistribution;
+
+/**
+ * Structure to hold the population, the regimen and the reported outcomes read from the configuration file
+ */
+typedef struct _VpopSettings {
+	int patientCount;                          ///< Number of patients.
+	VpopDistribution clearance;                ///< Clearance (L/h).
+	VpopDistribution volume;                   ///< Volume of distribution (L).
+	VpopDistribution absorptionRate;           ///< Absorption rate constant (1/h); a zero median gives intravenous boluses.
+	double bioavailability;                    ///< Fraction of the dose reaching the circulation.
+	struct _DosingRegimen regimen;             ///< The regimen given to every patient.
+	unsigned long seed;                        ///< Seed from which the stream of every patient is derived.
+	int targetCount;                           ///< Number of log-kill targets.
+	double targets[VPOP_MAX_TARGETS];          ///< Log-kill at the end time which a patient must reach to attain each target.
+	int percentileCount;                       ///< Number of percentiles of the log-kill bands.
+	double percentiles[VPOP_MAX_PERCENTILES];  ///< The percentiles, ascending, in percent.
+	double resolution;                         ///< Width of the histogram bins of the log10 population.
+	char bandsFile[FILENAME_MAX];              ///< File receiving the percentile bands of the log-kill over time, or empty for the standard output.
+	char summaryFile[FILENAME_MAX];            ///< File receiving the parameters and outcome of every patient, or empty for none.
+} *VpopSettings;
+
+/**
+ * Structure to hold the aggregated outcomes of a population
+ */
+typedef struct _VpopResults {
+	int patientCount;                             ///< Number of patients simulated.
+	int tickCount;                                ///< Number of time-points of the bands.
+	double attainment[VPOP_MAX_TARGETS];          ///< Probability of attaining each target.
+	double* bands;                                ///< Log-kill at each percentile, one row of percentileCount values per time-point.
+	double wallTime;                              ///< Elapsed time of the run in seconds.
+} *VpopResults;
+
+int readVpopSettings(const char* fileName, VpopSettings settings);
+
+int runVirtualPopulation(const SimulationStepper stepper, const ModelParameters mParam, const VpopSettings settings, const double endTime,
+                         const double timeInterval, const double* initialState, const int threadCount, VpopResults results);
+
+int writeVpopResults(const VpopSettings settings, const VpopResults results, const double timeInterval);
+
+void freeVpopResults(VpopResults results);
@@ -0,0 +1,179 @@
+/**
+ * @file   test_batch.c
+ * @version 5
+ * @updated  2026
+ * @brief  Checks of the batches of the simulation server, run from a string as runSimulationBatch reads them
+ *
+ * A batch mixing valid items with items the server refuses, one of them with a quote in its key, is run on several
+ * threads. Its records must come back in the order of the items, an error record for each refused item with its message
+ * a valid JSON string, and a batch record counting the items, the failures and the workspace buffers allocated. An item
+ * must get the same reply whichever thread and workspace run it, and items run one after another in one workspace must
+ * allocate no more buffers than the first of them.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include <gsl/gsl_odeiv2.h>
+#include <gsl/gsl_errno.h>
+#include "full_model.h"
+#include "fixed_step.h"
+#include "positive_step.h"
+#include "sensitivity.h"
+#include "base_simulation.h"
+#include "trajectory_file.h"
+#include "result_cache.h"
+#include "simulation_server.h"
+#include "test_model.h"
+
+#define TEST_TARGETS 10                  ///< Number of targets of the default model
+#define TEST_INPUT "test_batch.txt"      ///< Input file of the profile, in the working directory
+#define TEST_THREADS 3                   ///< Threads of the mixed batch
+#define TEST_TIMEPOINTS 13               ///< Values of the profile, one per output time-point
+
+/**
+ * Run a batch given as a string, returning everything written.
+ */
+static char* runTestBatch(const ServerSettings settings, const char* request) {
+	FILE* iHandle = tmpfile();
+	FILE* oHandle = tmpfile();
+	char* text = NULL;
+	long length;
+
+	if (iHandle == NULL || oHandle == NULL)
+		return NULL;
+	fputs(request, iHandle);
+	rewind(iHandle);
+	CHECK(runSimulationBatch(settings, iHandle, oHandle) == GSL_SUCCESS, "the batch %s was not run", request);
+	fclose(iHandle);
+	length = ftell(oHandle);
+	rewind(oHandle);
+	if ((text = (char*)malloc(length + 1)) != NULL) {
+		text[fread(text, 1, length, oHandle)] = '\0';
+	}
+	fclose(oHandle);
+	return text;
+}
+
+/**
+ * Find the record of an item, and the length of the records following it up to the next item or the batch record.
+ *
+ * @return  The record of the item, or NULL.
+ */
+static const char* findItem(const char* text, const int index, size_t* replyLength) {
+	char record[64];
+	const char* start;
+	const char* reply;
+	const char* end;
+
+	snprintf(record, sizeof(record), "{\"type\":\"item\",\"index\":%d,", index);
+	if (text == NULL || (start = strstr(text, record)) == NULL)
+		return NULL;
+	reply = strchr(start, '\n') + 1;
+	if ((end = strstr(reply, "{\"type\":\"item\"")) == NULL)
+		end = strstr(reply, "{\"type\":\"batch\"");
+	*replyLength = (end != NULL) ? (size_t)(end - reply) : strlen(reply);
+	return start;
+}
+
+/**
+ * Whether a record line has its quotes paired, the escaped ones aside.
+ */
+static int hasPairedQuotes(const char* line) {
+	int quotes = 0;
+
+	for (; *line != '\0' && *line != '\n'; ++line)
+		if (*line == '\\' && line[1] != '\0')
+			++line;
+		else if (*line == '"')
+			++quotes;
+	return quotes % 2 == 0;
+}
+
+int main(void) {
+	ModelParameters mParam = createTestModel(TEST_TARGETS, 5, 2);
+	struct _SimulationStepper stepper;
+	struct _SimulationParameters simulation = { .startingAntibiotic = 0.0, .startingPopulation = DEFAULT_STARTING_POPULATION,
+	                                            .endTime = 7200.0, .stepSize = 600.0 };
+	struct _TrajectoryOptions trajectoryOptions = { TRAJECTORY_TEXT, TRAJECTORY_COMPARTMENTS, 0, NULL };
+	struct _ServerSettings settings;
+	const char* statuses[] = { "ok", "error", "error", "ok", "ok" };
+	const char *record, *previous = NULL, *first, *last, *alone;
+	size_t firstLength = 0, lastLength = 0, aloneLength = 0, length;
+	unsigned long singleAllocations = 0, repeatedAllocations = 0;
+	char *mixed, *single, *repeated;
+	FILE* oHandle;
+	int items, failed, i;
+
+	if (mParam == NULL || (oHandle = fopen(TEST_INPUT, "w")) == NULL) {
+		fprintf(stderr, "Could not set up the model and the input file\n");
+		return 1;
+	}
+	for (i = 0; i < TEST_TIMEPOINTS; ++i)
+		fprintf(oHandle, "%g\n", exp(-0.3 * i));
+	fclose(oHandle);
+	memset(&stepper, 0, sizeof(stepper));
+	parseSimulationStepper("positive", &stepper);
+	memset(&settings, 0, sizeof(settings));
+	settings.inputFile = TEST_INPUT;
+	settings.stepper = &stepper;
+	settings.model = mParam;
+	settings.simulation = &simulation;
+	settings.trajectoryOptions = &trajectoryOptions;
+
+	// Valid items, an unknown stepping function and a key which is a quote, on several threads
+	settings.threadCount = TEST_THREADS;
+	mixed = runTestBatch(&settings, "[{\"k\":\"4\"}, {\"S\":\"bogus\"}, {\"\\\"\":\"1\"}, {\"k\":\"6\",\"t\":\"3600:600\"}, {\"k\":4}]");
+	for (i = 0; i < 5; ++i) {
+		char status[32];
+
+		snprintf(status, sizeof(status), "\"status\":\"%s\"", statuses[i]);
+		record = findItem(mixed, i, &length);
+		CHECK(record != NULL && record > previous, "item %d has no record after the one before", i);
+		if (record == NULL)
+			continue;
+		CHECK(strstr(record, status) != NULL && strstr(record, status) < strchr(record, '\n'), "item %d is not %s", i, statuses[i]);
+		CHECK(hasPairedQuotes(record), "the record of item %d is not valid JSON: %.*s", i, (int)(strchr(record, '\n') - record), record);
+		CHECK((length > 0) == !strcmp(statuses[i], "ok"), "item %d has %zu bytes of records", i, length);
+		CHECK(strstr(record, "null") == NULL || strstr(record, "null") > strchr(record, '\n') + length,
+		      "the trajectory of item %d is not finite", i);
+		previous = record;
+	}
+	record = (mixed != NULL) ? strstr(mixed, "{\"type\":\"batch\"") : NULL;
+	CHECK(record != NULL && record > previous && sscanf(record, "{\"type\":\"batch\",\"items\":%d,\"failed\":%d", &items, &failed) == 2 &&
+	      items == 5 && failed == 2, "the batch record does not end the reply with 5 items and 2 failures");
+
+	// The same item gives the same reply on any thread, and alone
+	first = findItem(mixed, 0, &firstLength);
+	last = findItem(mixed, 4, &lastLength);
+	settings.threadCount = 1;
+	single = runTestBatch(&settings, "[{\"k\":\"4\"}]");
+	alone = findItem(single, 0, &aloneLength);
+	CHECK(first != NULL && last != NULL && alone != NULL, "the replies of the same item are missing");
+	if (first != NULL && last != NULL && alone != NULL) {
+		first = strchr(first, '\n') + 1;
+		last = strchr(last, '\n') + 1;
+		alone = strchr(alone, '\n') + 1;
+		CHECK(firstLength == lastLength && !memcmp(first, last, firstLength), "the same item gave different replies in one batch");
+		CHECK(firstLength == aloneLength && !memcmp(first, alone, firstLength), "the item gave a different reply alone");
+	}
+
+	// Items repeated in one workspace allocate nothing after the first
+	repeated = runTestBatch(&settings, "[{\"k\":\"4\"}, {\"k\":\"4\"}, {\"k\":\"4\"}]");
+	CHECK(single != NULL && (record = strstr(single, "{\"type\":\"batch\"")) != NULL &&
+	      sscanf(record, "{\"type\":\"batch\",\"items\":%*d,\"failed\":%*d,\"allocations\":%lu", &singleAllocations) == 1 &&
+	      singleAllocations > 0, "the batch record of one item counts no allocations");
+	CHECK(repeated != NULL && (record = strstr(repeated, "{\"type\":\"batch\"")) != NULL &&
+	      sscanf(record, "{\"type\":\"batch\",\"items\":%*d,\"failed\":%*d,\"allocations\":%lu", &repeatedAllocations) == 1 &&
+	      repeatedAllocations == singleAllocations, "three items allocated %lu buffers, one alone %lu", repeatedAllocations,
+	      singleAllocations);
+
+	free(mixed);
+	free(single);
+	free(repeated);
+	remove(TEST_INPUT);
+	freeTestModel(mParam);
+	return (failedChecks > 0) ? 1 : 0;
+}
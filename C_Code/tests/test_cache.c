@@ -0,0 +1,235 @@
+/**
+ * @file   test_cache.c
+ * @version 5
+ * @updated  2026
+ * @brief  Checks of the result cache: hits, damaged and colliding entries, eviction and stale unfinished entries
+ *
+ * A run through the library is a miss whose trajectory is copied into its entry; looked up again it is a hit whose
+ * output and summary are those of the run, byte for byte. An entry cut short and another key with the same hash are
+ * misses which remove the entry. Entries of known sizes, their last uses set, are evicted least recently used first
+ * down to the size of the cache, and an unfinished entry older than RESULT_CACHE_STALE_TIME is removed while a recent
+ * one is kept.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <gsl/gsl_odeiv2.h>
+#include <gsl/gsl_errno.h>
+#include "full_model.h"
+#include "fixed_step.h"
+#include "positive_step.h"
+#include "sensitivity.h"
+#include "base_simulation.h"
+#include "trajectory_file.h"
+#include "result_cache.h"
+#include "vcombat.h"
+#include "test_model.h"
+
+#define TEST_TARGETS 10                   ///< Number of targets of the model
+#define TEST_DIRECTORY "test_cache.d"     ///< Cache directory, in the working directory
+#define TEST_PAYLOAD 4000                 ///< Bytes of the output of the entries of the eviction checks
+
+/**
+ * Remove the cache directory and everything in it.
+ */
+static void removeTestDirectory(void) {
+	char name[FILENAME_MAX];
+	struct dirent* item;
+	DIR* directory;
+
+	if ((directory = opendir(TEST_DIRECTORY)) == NULL)
+		return;
+	while ((item = readdir(directory)) != NULL) {
+		if (!strcmp(item->d_name, ".") || !strcmp(item->d_name, ".."))
+			continue;
+		snprintf(name, FILENAME_MAX, "%s/%s", TEST_DIRECTORY, item->d_name);
+		unlink(name);
+	}
+	closedir(directory);
+	rmdir(TEST_DIRECTORY);
+}
+
+/**
+ * Name of the entry of a key, as the cache names it.
+ */
+static void getTestEntryName(const ResultKey key, char* name) {
+	snprintf(name, FILENAME_MAX, "%s/%016llx" RESULT_CACHE_SUFFIX, TEST_DIRECTORY, key->hash);
+}
+
+/**
+ * Whether a file exists.
+ */
+static int fileExists(const char* name) {
+	struct stat status;
+
+	return stat(name, &status) == 0;
+}
+
+/**
+ * Set the modification time of a file to some seconds ago.
+ */
+static void setFileAge(const char* name, const time_t age) {
+	struct timeval times[2];
+
+	times[0].tv_sec = times[1].tv_sec = time(NULL) - age;
+	times[0].tv_usec = times[1].tv_usec = 0;
+	CHECK(utimes(name, times) == 0, "could not set the time of %s", name);
+}
+
+/**
+ * Add an entry of TEST_PAYLOAD bytes of output for a key.
+ */
+static void addTestEntry(ResultCache cache, const ResultKey key) {
+	struct _ResultSummary summary = { .finalPopulation = 1.0, .acceptedSteps = 1, .rejectedSteps = 0 };
+	ResultEntry entry = beginCachedResult(cache, key);
+	int i;
+
+	CHECK(entry != NULL, "could not begin the entry %016llx", key->hash);
+	if (entry == NULL)
+		return;
+	for (i = 0; i < TEST_PAYLOAD; ++i)
+		fputc('a' + i % 26, entry->oHandle);
+	CHECK(finishCachedResult(entry, &summary) == 0, "could not finish the entry %016llx", key->hash);
+}
+
+/**
+ * Read a whole stream from its start.
+ */
+static char* readStream(FILE* stream, long* length) {
+	char* text;
+
+	fflush(stream);
+	fseek(stream, 0, SEEK_END);
+	*length = ftell(stream);
+	rewind(stream);
+	if ((text = (char*)malloc(*length + 1)) != NULL && fread(text, 1, *length, stream) != (size_t)*length) {
+		free(text);
+		text = NULL;
+	}
+	return text;
+}
+
+int main(void) {
+	ModelParameters mParam = createTestModel(TEST_TARGETS, 5, 3);
+	struct _SimulationStepper stepper;
+	struct _SimulationParameters sParam = { .startingAntibiotic = 0.0, .startingPopulation = DEFAULT_STARTING_POPULATION,
+	                                        .endTime = 7200.0, .stepSize = 600.0 };
+	struct _TrajectoryOptions trajectoryOptions = { TRAJECTORY_TEXT, TRAJECTORY_COMPARTMENTS, 0, NULL };
+	struct _VcombatOutput output = { .time = NULL, .population = NULL, .unboundAntibiotic = NULL, .capacity = 0 };
+	struct _ResultKey key, colliding, keys[3];
+	struct _ResultSummary summary, cachedSummary;
+	const double profile[3] = { 1.0, 0.5, 0.25 };
+	char name[FILENAME_MAX], names[3][FILENAME_MAX], staleName[FILENAME_MAX], recentName[FILENAME_MAX];
+	VcombatContext context = vcombatCreate();
+	ResultCache cache;
+	ResultEntry entry;
+	FILE *trajectory, *copy, *cached, *oHandle;
+	char *written, *copied;
+	long writtenLength = 0, copiedLength = 0;
+	int i;
+
+	removeTestDirectory();
+	if (mParam == NULL || context == NULL || (cache = openResultCache(TEST_DIRECTORY)) == NULL) {
+		fprintf(stderr, "Could not set up the model and the cache\n");
+		return 1;
+	}
+	memset(&stepper, 0, sizeof(stepper));
+	parseSimulationStepper("rk4-native", &stepper);
+	makeResultKey(&key, &stepper, mParam, &sParam, &trajectoryOptions);
+	getTestEntryName(&key, name);
+
+	// A miss, the run copying its trajectory into the entry as the command-line does
+	CHECK(findCachedResult(cache, &key, &summary) == NULL && cache->missCount == 1, "the empty cache did not miss");
+	CHECK((entry = beginCachedResult(cache, &key)) != NULL, "could not begin the entry");
+	vcombatConfigure(context, 't', "7200:600");
+	vcombatConfigure(context, 'S', "rk4-native");
+	vcombatSetProfile(context, profile, 3);
+	vcombatSetTrajectoryCopy(context, entry->oHandle);
+	trajectory = tmpfile();
+	CHECK(vcombatRun(context, &output, trajectory) == GSL_SUCCESS, "the run failed: %s", vcombatGetError(context));
+	summary.finalPopulation = output.finalPopulation;
+	summary.acceptedSteps = output.acceptedSteps;
+	summary.rejectedSteps = output.rejectedSteps;
+	CHECK(finishCachedResult(entry, &summary) == 0 && fileExists(name), "the entry was not kept");
+
+	// The hit gives back the output and the summary
+	CHECK((cached = findCachedResult(cache, &key, &cachedSummary)) != NULL && cache->hitCount == 1, "the run did not hit");
+	if (cached != NULL) {
+		copy = tmpfile();
+		CHECK(copyCachedResult(cached, copy) == 0, "the entry could not be copied");
+		written = readStream(trajectory, &writtenLength);
+		copied = readStream(copy, &copiedLength);
+		CHECK(written != NULL && copied != NULL && writtenLength > 0 && writtenLength == copiedLength &&
+		      !memcmp(written, copied, writtenLength), "the hit gave %ld bytes, the run wrote %ld", copiedLength, writtenLength);
+		CHECK(!memcmp(&cachedSummary, &summary, sizeof(summary)), "the hit gave a population of %lg, the run %lg",
+		      cachedSummary.finalPopulation, summary.finalPopulation);
+		free(written);
+		free(copied);
+		fclose(copy);
+	}
+	fclose(trajectory);
+
+	// Another key with the same hash is a miss which makes way for it
+	colliding = key;
+	colliding.values[RESULT_KEY_LENGTH - 1] += 1.0;
+	CHECK(findCachedResult(cache, &colliding, &cachedSummary) == NULL, "a colliding key hit");
+	CHECK(!fileExists(name), "the entry of a colliding key was kept");
+
+	// An entry cut short is a miss which removes it
+	addTestEntry(cache, &key);
+	CHECK(truncate(name, TEST_PAYLOAD / 2) == 0, "could not cut the entry short");
+	CHECK(findCachedResult(cache, &key, &cachedSummary) == NULL, "a damaged entry hit");
+	CHECK(!fileExists(name), "a damaged entry was kept");
+
+	// Three entries in a cache which holds two: the least recently used goes, the one just hit stays
+	cache->maxBytes = 1ULL << 30;
+	for (i = 0; i < 3; ++i) {
+		sParam.startingPopulation = DEFAULT_STARTING_POPULATION * (i + 2);
+		makeResultKey(&keys[i], &stepper, mParam, &sParam, &trajectoryOptions);
+		getTestEntryName(&keys[i], names[i]);
+	}
+	addTestEntry(cache, &keys[0]);
+	addTestEntry(cache, &keys[1]);
+	setFileAge(names[0], 300);
+	setFileAge(names[1], 200);
+	CHECK((cached = findCachedResult(cache, &keys[0], &cachedSummary)) != NULL, "the first entry did not hit");
+	if (cached != NULL)
+		copyCachedResult(cached, NULL);
+	{
+		struct stat status;
+
+		CHECK(stat(names[0], &status) == 0, "the first entry is missing");
+		cache->maxBytes = 2 * (unsigned long long)status.st_size;
+	}
+	addTestEntry(cache, &keys[2]);
+	CHECK(fileExists(names[0]), "the entry hit last was evicted");
+	CHECK(!fileExists(names[1]), "the least recently used entry was kept");
+	CHECK(fileExists(names[2]), "the entry just added was evicted");
+
+	// Unfinished entries are removed once stale, when an entry is added
+	snprintf(staleName, FILENAME_MAX, "%s/%016llx" RESULT_CACHE_SUFFIX ".stale0", TEST_DIRECTORY, keys[1].hash);
+	snprintf(recentName, FILENAME_MAX, "%s/%016llx" RESULT_CACHE_SUFFIX ".fresh0", TEST_DIRECTORY, keys[1].hash);
+	for (i = 0; i < 2; ++i)
+		if ((oHandle = fopen((i == 0) ? staleName : recentName, "w")) != NULL) {
+			fputs("unfinished", oHandle);
+			fclose(oHandle);
+		}
+	setFileAge(staleName, RESULT_CACHE_STALE_TIME + 60);
+	addTestEntry(cache, &keys[1]);
+	CHECK(!fileExists(staleName), "a stale unfinished entry was kept");
+	CHECK(fileExists(recentName), "a recent unfinished entry was removed");
+
+	closeResultCache(cache);
+	removeTestDirectory();
+	vcombatDestroy(context);
+	freeTestModel(mParam);
+	return (failedChecks > 0) ? 1 : 0;
+}
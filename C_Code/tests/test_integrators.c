@@ -0,0 +1,142 @@
+/**
+ * @file   test_integrators.c
+ * @version 5
+ * @updated  2026
+ * @brief  Checks of the native and positivity-preserving integrators against the GSL steppers on the binding model
+ *
+ * Every integrator advances the same six hours of the model from a single populated compartment, with the output
+ * interval of a run, and its state is compared with that of the GSL rk8pd stepper at tolerances far below those of the
+ * simulations. rk2-native is also compared with gsl_odeiv2_step_rk2 driven at the same fixed step.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <gsl/gsl_odeiv2.h>
+#include <gsl/gsl_errno.h>
+#include "full_model.h"
+#include "fixed_step.h"
+#include "positive_step.h"
+#include "sensitivity.h"
+#include "base_simulation.h"
+#include "test_model.h"
+
+#define TEST_TARGETS 20             ///< Number of targets of the model
+#define TEST_KILLING_THRESHOLD 10   ///< Killing threshold of the model
+#define TEST_END_TIME 21600.0       ///< Time integrated over, in seconds
+#define TEST_INTERVAL 600.0         ///< Time between the output time-points
+#define TEST_FIXED_STEP 0.5         ///< Step of the native integrators
+
+/**
+ * Largest difference between two vectors relative to the largest magnitude of the second.
+ */
+static double relativeDifference(const double* a, const double* b, const int length) {
+	double difference = 0.0, scale = 0.0;
+	int i;
+
+	for (i = 0; i < length; ++i) {
+		difference = fmax(difference, fabs(a[i] - b[i]));
+		scale = fmax(scale, fabs(b[i]));
+	}
+	return (scale > 0.0) ? difference / scale : difference;
+}
+
+/**
+ * The initial state: the default population with no target bound.
+ */
+static void initializeTestState(double* state, const int dim) {
+	memset(state, 0, sizeof(double) * dim);
+	state[NUMBER_FREE_KINETIC_VARIABLES] = DEFAULT_STARTING_POPULATION;
+}
+
+/**
+ * Integrate over the test time with the integrator of a stepper, stopping at every output time-point.
+ *
+ * @return  GSL_SUCCESS, or the error of the integrator.
+ */
+static int integrateWithStepper(const SimulationStepper stepper, const ModelParameters mParam, double* state) {
+	SimulationIntegrator integrator = allocateSimulationIntegrator(stepper, mParam, TEST_INTERVAL);
+	double curTime = 0.0, nextTime;
+	int status = GSL_SUCCESS;
+
+	if (integrator == NULL)
+		return GSL_ENOMEM;
+	for (nextTime = TEST_INTERVAL; nextTime <= TEST_END_TIME && status == GSL_SUCCESS; nextTime += TEST_INTERVAL)
+		status = advanceSimulationIntegrator(integrator, &curTime, nextTime, state);
+	freeSimulationIntegrator(integrator);
+	return status;
+}
+
+int main(void) {
+	ModelParameters mParam = createTestModel(TEST_TARGETS, TEST_KILLING_THRESHOLD, (int)(TEST_END_TIME / 3600.0) + 2);
+	const int dim = NUMBER_FREE_KINETIC_VARIABLES + TEST_TARGETS + 1;
+	double reference[NUMBER_FREE_KINETIC_VARIABLES + TEST_TARGETS + 1];
+	double state[NUMBER_FREE_KINETIC_VARIABLES + TEST_TARGETS + 1];
+	const struct {
+		const char* name;     ///< Name of the integrator given to -S.
+		double tolerance;     ///< Largest relative difference from the reference.
+	} integrators[] = { { "rk2-native", 1e-6 }, { "rk4-native", 1e-6 }, { "ssprk3", 1e-6 }, { "positive", 1e-3 } };
+	gsl_odeiv2_system system;
+	gsl_odeiv2_driver* driver;
+	double curTime, nextTime;
+	int i, status;
+
+	if (mParam == NULL) {
+		fprintf(stderr, "Could not set up the model\n");
+		return 1;
+	}
+	gsl_set_error_handler_off();
+	system.function = (GSLDerivCalcFunc)calculateModelDerivative_BindingOnly;
+	system.jacobian = (GSLJacobianCalcFunc)calculateModelJacobian_BindingOnly;
+	system.dimension = dim;
+	system.params = mParam;
+
+	// The reference, from an eighth-order GSL stepper at tight tolerances
+	initializeTestState(reference, dim);
+	driver = gsl_odeiv2_driver_alloc_y_new(&system, gsl_odeiv2_step_rk8pd, 1e-2, 1e-10, 1e-10);
+	for (curTime = 0.0, nextTime = TEST_INTERVAL, status = GSL_SUCCESS; nextTime <= TEST_END_TIME && status == GSL_SUCCESS;
+	     nextTime += TEST_INTERVAL)
+		status = gsl_odeiv2_driver_apply(driver, &curTime, nextTime, reference);
+	gsl_odeiv2_driver_free(driver);
+	CHECK(status == GSL_SUCCESS, "the reference integration failed: %d", status);
+	CHECK(reference[NUMBER_FREE_KINETIC_VARIABLES + 1] > 0.0, "no target was bound in the reference integration");
+
+	for (i = 0; i < (int)(sizeof(integrators) / sizeof(integrators[0])); ++i) {
+		struct _SimulationStepper stepper;
+		double difference;
+
+		memset(&stepper, 0, sizeof(stepper));
+		parseSimulationStepper(integrators[i].name, &stepper);
+		stepper.fixedStepSize = TEST_FIXED_STEP;
+		initializeTestState(state, dim);
+		status = integrateWithStepper(&stepper, mParam, state);
+		CHECK(status == GSL_SUCCESS, "%s failed: %d", integrators[i].name, status);
+		difference = relativeDifference(state, reference, dim);
+		CHECK(difference <= integrators[i].tolerance, "%s differs from rk8pd by %g relative, more than %g", integrators[i].name,
+		      difference, integrators[i].tolerance);
+	}
+
+	// rk2-native takes the steps of gsl_odeiv2_step_rk2
+	initializeTestState(reference, dim);
+	driver = gsl_odeiv2_driver_alloc_y_new(&system, gsl_odeiv2_step_rk2, TEST_FIXED_STEP, 1e-5, 1e-5);
+	curTime = 0.0;
+	status = gsl_odeiv2_driver_apply_fixed_step(driver, &curTime, TEST_FIXED_STEP, (unsigned long)(TEST_END_TIME / TEST_FIXED_STEP), reference);
+	gsl_odeiv2_driver_free(driver);
+	CHECK(status == GSL_SUCCESS, "the fixed-step GSL rk2 integration failed: %d", status);
+	{
+		struct _SimulationStepper stepper;
+		double difference;
+
+		memset(&stepper, 0, sizeof(stepper));
+		parseSimulationStepper("rk2-native", &stepper);
+		stepper.fixedStepSize = TEST_FIXED_STEP;
+		initializeTestState(state, dim);
+		integrateWithStepper(&stepper, mParam, state);
+		difference = relativeDifference(state, reference, dim);
+		CHECK(difference <= 1e-10, "rk2-native differs from fixed-step GSL rk2 by %g relative", difference);
+	}
+
+	freeTestModel(mParam);
+	return (failedChecks > 0) ? 1 : 0;
+}
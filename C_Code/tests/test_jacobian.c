@@ -0,0 +1,128 @@
+/**
+ * @file   test_jacobian.c
+ * @version 5
+ * @updated  2026
+ * @brief  Checks of the analytic Jacobian and parameter derivatives of the binding model against central finite
+ *         differences of its derivative
+ *
+ * The derivative is at most quadratic in the state, through the carrying capacity, linear in time within an interval
+ * of the profile and linear in every parameter but the carrying capacity, so central differences are exact up to
+ * rounding and the tolerances are tight. The state populates every compartment, above and below both thresholds, so
+ * each branch of the model is exercised.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <gsl/gsl_odeiv2.h>
+#include <gsl/gsl_errno.h>
+#include "full_model.h"
+#include "fixed_step.h"
+#include "positive_step.h"
+#include "sensitivity.h"
+#include "base_simulation.h"
+#include "test_model.h"
+
+#define TEST_TARGETS 12             ///< Number of targets of the model
+#define TEST_KILLING_THRESHOLD 7    ///< Killing threshold of the model
+#define TEST_TIME 5400.0            ///< Time at which the Jacobian is taken, inside an interval of the profile
+#define TEST_TOLERANCE 1e-7         ///< Largest difference, relative to the largest entry of its row
+
+int main(void) {
+	ModelParameters mParam = createTestModel(TEST_TARGETS, TEST_KILLING_THRESHOLD, 4);
+	enum { dim = NUMBER_FREE_KINETIC_VARIABLES + TEST_TARGETS + 1 };
+	double state[dim], shifted[dim], plus[dim], minus[dim], direction[dim], product[dim], parameterDerivative[dim];
+	double jacobian[dim * dim];
+	double timeDerivative[dim];
+	double rowScale[dim];
+	int i, j, p;
+
+	if (mParam == NULL) {
+		fprintf(stderr, "Could not set up the model\n");
+		return 1;
+	}
+	// Populations large enough for the carrying capacity to matter
+	mParam->carryingCapacity = 1e7;
+	state[0] = 3.0e4;
+	state[1] = 1.5e4;
+	for (i = NUMBER_FREE_KINETIC_VARIABLES; i < dim; ++i)
+		state[i] = 2.0e5 * (1.0 + 0.3 * cos(1.3 * i));
+
+	calculateModelJacobian_BindingOnly(TEST_TIME, (ModelVariables)state, jacobian, timeDerivative, mParam);
+	for (i = 0; i < dim; ++i) {
+		rowScale[i] = 0.0;
+		for (j = 0; j < dim; ++j)
+			rowScale[i] = fmax(rowScale[i], fabs(jacobian[i * dim + j]));
+	}
+
+	// Each column against the central difference in its component
+	for (j = 0; j < dim; ++j) {
+		const double h = 1e-3 * fabs(state[j]);
+
+		memcpy(shifted, state, sizeof(shifted));
+		shifted[j] = state[j] + h;
+		calculateModelDerivative_BindingOnly(TEST_TIME, (ModelVariables)shifted, (ModelVariables)plus, mParam);
+		shifted[j] = state[j] - h;
+		calculateModelDerivative_BindingOnly(TEST_TIME, (ModelVariables)shifted, (ModelVariables)minus, mParam);
+		for (i = 0; i < dim; ++i) {
+			const double difference = (plus[i] - minus[i]) / (2.0 * h);
+
+			CHECK(fabs(jacobian[i * dim + j] - difference) <= TEST_TOLERANCE * rowScale[i],
+			      "d f%d / d y%d is %.10g, the central difference %.10g", i, j, jacobian[i * dim + j], difference);
+		}
+	}
+
+	// The time derivative against the central difference in time
+	calculateModelDerivative_BindingOnly(TEST_TIME + 1.0, (ModelVariables)state, (ModelVariables)plus, mParam);
+	calculateModelDerivative_BindingOnly(TEST_TIME - 1.0, (ModelVariables)state, (ModelVariables)minus, mParam);
+	for (i = 0; i < dim; ++i) {
+		const double difference = (plus[i] - minus[i]) / 2.0;
+
+		CHECK(fabs(timeDerivative[i] - difference) <= TEST_TOLERANCE * (fabs(difference) + rowScale[i]),
+		      "d f%d / dt is %.10g, the central difference %.10g", i, timeDerivative[i], difference);
+	}
+
+	// The Jacobian-vector product against the product with the dense Jacobian
+	for (j = 0; j < dim; ++j)
+		direction[j] = sin(0.9 * j + 0.2);
+	calculateModelJacobianProduct_BindingOnly(TEST_TIME, (ModelVariables)state, direction, product, mParam);
+	for (i = 0; i < dim; ++i) {
+		double expected = 0.0, scale = 0.0;
+
+		for (j = 0; j < dim; ++j) {
+			expected += jacobian[i * dim + j] * direction[j];
+			scale += fabs(jacobian[i * dim + j] * direction[j]);
+		}
+		CHECK(fabs(product[i] - expected) <= 1e-12 * scale + 1e-300, "(J v)%d is %.10g, the dense product %.10g", i, product[i], expected);
+	}
+
+	// The derivative in each parameter of the sensitivities against the central difference in the parameter
+	for (p = 0; p < MODEL_PARAMETER_COUNT; ++p) {
+		double* parameter = getModelParameterAddress(mParam, (ModelParameterIndex)p);
+		const double value = *parameter;
+		const double h = 1e-4 * fabs(value);
+
+		CHECK(calculateModelParameterDerivative_BindingOnly(TEST_TIME, (ModelVariables)state, (ModelParameterIndex)p, parameterDerivative,
+		                                                    mParam) == GSL_SUCCESS, "no derivative in parameter %d", p);
+		*parameter = value + h;
+		calculateModelDerivative_BindingOnly(TEST_TIME, (ModelVariables)state, (ModelVariables)plus, mParam);
+		*parameter = value - h;
+		calculateModelDerivative_BindingOnly(TEST_TIME, (ModelVariables)state, (ModelVariables)minus, mParam);
+		*parameter = value;
+		for (i = 0; i < dim; ++i) {
+			const double difference = (plus[i] - minus[i]) / (2.0 * h);
+			// The rounding of the two derivatives, magnified by the division by the step
+			const double rounding = 1e-14 * (fabs(plus[i]) + fabs(minus[i])) / h;
+
+			CHECK(fabs(parameterDerivative[i] - difference) <= TEST_TOLERANCE * fabs(difference) + rounding,
+			      "d f%d / d %c is %.10g, the central difference %.10g", i, getModelParameterOption((ModelParameterIndex)p),
+			      parameterDerivative[i], difference);
+		}
+	}
+	CHECK(calculateModelParameterDerivative_BindingOnly(TEST_TIME, (ModelVariables)state, MODEL_PARAMETER_COUNT, parameterDerivative,
+	                                                    mParam) == GSL_EINVAL, "a derivative in an unknown parameter was given");
+
+	freeTestModel(mParam);
+	return (failedChecks > 0) ? 1 : 0;
+}
@@ -0,0 +1,127 @@
+/**
+ * @file   test_mic.c
+ * @version 5
+ * @updated  2026
+ * @brief  Checks of the search for the minimum inhibitory and bactericidal concentrations
+ *
+ * The brackets found, with one and with several concentrations per worker round, must be narrower than the tolerance
+ * and must straddle their criterion: simulated again at their bounds, the lower one must fail it and the upper one meet
+ * it. A range above the thresholds must report them below it, and a time of the criteria past the last time-point must
+ * be refused, while the last time-point itself is accepted.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <gsl/gsl_odeiv2.h>
+#include <gsl/gsl_errno.h>
+#include "full_model.h"
+#include "fixed_step.h"
+#include "positive_step.h"
+#include "sensitivity.h"
+#include "base_simulation.h"
+#include "mic_search.h"
+#include "test_model.h"
+
+#define TEST_TARGETS 10                 ///< Number of targets of the model
+#define TEST_KILLING_THRESHOLD 5        ///< Killing threshold of the model
+#define TEST_TIMEPOINTS 25              ///< Hourly time-points of the model
+#define TEST_INTERVAL 3600.0            ///< Time between the time-points
+#define TEST_TIME 12.0                  ///< Time (h) of the criteria
+#define TEST_LOG_KILL 0.2               ///< Log-kill of the bactericidal criterion, below the most the model reaches by then
+
+/**
+ * Change of the log10 population at the time of the criteria under a constant concentration, simulated as the search does.
+ */
+static double getLogChange(const SimulationStepper stepper, const ModelParameters mParam, const double concentration,
+                           const double* initialState) {
+	const int dim = NUMBER_FREE_KINETIC_VARIABLES + mParam->targetMoleculeCount + 1;
+	const double molecules = concentrationToMolecules(mParam, concentration);
+	SimulationIntegrator integrator = allocateSimulationIntegrator(stepper, mParam, TEST_INTERVAL);
+	double state[dim], logPopulation[TEST_TIMEPOINTS + 1];
+	int tickCount = 0;
+	int x;
+
+	for (x = 0; x <= mParam->timepoints; ++x)
+		mParam->realantibioticconc[x] = molecules;
+	CHECK(integrator != NULL && recordLogPopulation(integrator, mParam, TEST_TIME * 3600.0 + 0.5 * TEST_INTERVAL, TEST_INTERVAL,
+	                                                initialState, state, logPopulation, &tickCount) == GSL_SUCCESS,
+	      "the simulation at %lg mg/L failed", concentration);
+	freeSimulationIntegrator(integrator);
+	return (tickCount > 0) ? logPopulation[tickCount - 1] - logPopulation[0] : NAN;
+}
+
+/**
+ * Check that a bracket is narrower than the tolerance and that its bounds fail and meet the criterion.
+ */
+static void checkBracket(const char* name, const SimulationStepper stepper, const ModelParameters mParam, const MicSettings settings,
+                         const ThresholdBracket bracket, const double logKill, const double* initialState) {
+	double lowerChange, upperChange;
+
+	CHECK(bracket->status == THRESHOLD_BRACKETED, "the %s is not bracketed", name);
+	if (bracket->status != THRESHOLD_BRACKETED)
+		return;
+	CHECK(settings->lowerConcentration <= bracket->lower && bracket->lower < bracket->upper &&
+	      bracket->upper <= settings->upperConcentration, "the %s bracket [%lg, %lg] is not inside the range", name, bracket->lower,
+	      bracket->upper);
+	CHECK(bracket->upper <= bracket->lower * (1.0 + settings->tolerance), "the %s bracket [%lg, %lg] is wider than the tolerance", name,
+	      bracket->lower, bracket->upper);
+	lowerChange = getLogChange(stepper, mParam, bracket->lower, initialState);
+	upperChange = getLogChange(stepper, mParam, bracket->upper, initialState);
+	CHECK(-lowerChange < logKill && -upperChange >= logKill, "the %s bracket [%lg, %lg] has log changes %lg and %lg", name,
+	      bracket->lower, bracket->upper, lowerChange, upperChange);
+}
+
+int main(void) {
+	enum { dim = NUMBER_FREE_KINETIC_VARIABLES + TEST_TARGETS + 1 };
+	ModelParameters mParam = createTestModel(TEST_TARGETS, TEST_KILLING_THRESHOLD, TEST_TIMEPOINTS);
+	struct _SimulationStepper stepper;
+	struct _MicSettings settings = { .lowerConcentration = 0.01, .upperConcentration = 100.0, .time = TEST_TIME,
+	                                 .killLogReduction = TEST_LOG_KILL, .tolerance = DEFAULT_MIC_TOLERANCE };
+	struct _MicResults results;
+	double initial[dim];
+	const int threadCounts[2] = { 1, 4 };
+	int t;
+
+	if (mParam == NULL) {
+		fprintf(stderr, "Could not set up the model\n");
+		return 1;
+	}
+	memset(initial, 0, sizeof(initial));
+	initial[NUMBER_FREE_KINETIC_VARIABLES] = DEFAULT_STARTING_POPULATION;
+	memset(&stepper, 0, sizeof(stepper));
+	parseSimulationStepper("positive", &stepper);
+
+	// Both thresholds bracketed, with two and with four concentrations per round
+	for (t = 0; t < 2; ++t) {
+		CHECK(findThresholdConcentrations(&stepper, mParam, &settings, TEST_INTERVAL, initial, threadCounts[t], &results) == GSL_SUCCESS,
+		      "the search on %d threads failed", threadCounts[t]);
+		checkBracket("MIC", &stepper, mParam, &settings, &results.inhibitory, 0.0, initial);
+		checkBracket("MBC", &stepper, mParam, &settings, &results.bactericidal, TEST_LOG_KILL, initial);
+		CHECK(results.inhibitory.upper <= results.bactericidal.upper, "the MIC %lg is above the MBC %lg", results.inhibitory.upper,
+		      results.bactericidal.upper);
+		CHECK(results.simulations >= results.rounds && results.rounds > 1, "%d simulations in %d rounds", results.simulations,
+		      results.rounds);
+	}
+
+	// A range above both thresholds
+	settings.lowerConcentration = 2.0 * results.bactericidal.upper;
+	settings.upperConcentration = 4.0 * results.bactericidal.upper;
+	CHECK(findThresholdConcentrations(&stepper, mParam, &settings, TEST_INTERVAL, initial, 2, &results) == GSL_SUCCESS,
+	      "the search above the thresholds failed");
+	CHECK(results.inhibitory.status == THRESHOLD_BELOW_RANGE && results.bactericidal.status == THRESHOLD_BELOW_RANGE,
+	      "the thresholds are not below the range: %d and %d", results.inhibitory.status, results.bactericidal.status);
+	CHECK(results.rounds == 1, "%d rounds without a bracket", results.rounds);
+
+	// The criteria may be read at the last time-point, not after it
+	settings.time = (TEST_TIMEPOINTS - 1) * TEST_INTERVAL / 3600.0;
+	CHECK(findThresholdConcentrations(&stepper, mParam, &settings, TEST_INTERVAL, initial, 2, &results) == GSL_SUCCESS,
+	      "the criteria at the last time-point were refused");
+	settings.time = TEST_TIMEPOINTS * TEST_INTERVAL / 3600.0;
+	CHECK(findThresholdConcentrations(&stepper, mParam, &settings, TEST_INTERVAL, initial, 2, &results) == GSL_EINVAL,
+	      "the criteria after the last time-point were accepted");
+
+	freeTestModel(mParam);
+	return (failedChecks > 0) ? 1 : 0;
+}
@@ -0,0 +1,71 @@
+/**
+ * @file   test_model.h
+ * @version 5
+ * @updated  2026
+ * @brief  Checks and model set-up shared by the tests
+ *
+ * Each test is a program which runs its checks, prints every failed one to the standard error and exits with a
+ * non-zero status if any failed, as ctest expects.
+ */
+
+static int failedChecks = 0; ///< Number of checks which failed
+
+/**
+ * Count and report a check which does not hold, with a printf-style description.
+ */
+#define CHECK(condition, ...)                                        \
+	do {                                                             \
+		if (!(condition)) {                                          \
+			fprintf(stderr, "%s:%d: ", __FILE__, __LINE__);          \
+			fprintf(stderr, __VA_ARGS__);                            \
+			fputc('\n', stderr);                                     \
+			++failedChecks;                                          \
+		}                                                            \
+	} while (0)
+
+/**
+ * Model parameters at the defaults of the command-line, with a given number of targets and killing threshold and a
+ * concentration profile which varies over each of its hourly time-points.
+ *
+ * @param targetMoleculeCount  Number of target molecules per cell.
+ * @param killingThreshold     Killing threshold; the replication threshold is set just below it.
+ * @param timepoints           Number of hours of the profile.
+ *
+ * @return                     The parameters with their matrix, freed with freeTestModel, or NULL.
+ */
+static ModelParameters createTestModel(const int targetMoleculeCount, const int killingThreshold, const int timepoints) {
+	ModelParameters mParam = (ModelParameters)calloc(1, sizeof(struct _ModelParameters) + sizeof(double) * (timepoints + 1));
+	int x;
+
+	if (mParam == NULL)
+		return NULL;
+	mParam->intracellularVolume = DEFAULT_INTRACELLULAR_VOLUME;
+	mParam->targetMoleculeCount = targetMoleculeCount;
+	mParam->replicationThreshold = DEFAULT_DUMMY;
+	mParam->killingThreshold = killingThreshold;
+	mParam->baselineReplication = DEFAULT_BASELINE_REPLICATION;
+	mParam->maximumKillRate = DEFAULT_MAXIMUM_KILL_RATE;
+	mParam->targetAssociationRate = DEFAULT_TARGET_ASSOCIATION_RATE;
+	mParam->targetDissociationRate = DEFAULT_TARGET_DISSOCIATION_RATE;
+	mParam->molecularweight = DEFAULT_MOLECULARWEIGHT;
+	mParam->carryingCapacity = DEFAULT_CARRYING_CAPACITY;
+	mParam->timepoints = timepoints;
+	mParam->steptime = 3600.0;
+	applyDefaultThresholds(mParam);
+	for (x = 0; x <= timepoints; ++x)
+		mParam->realantibioticconc[x] = concentrationToMolecules(mParam, 1.0 + 0.5 * sin(0.7 * x));
+	if ((mParam->hyperGeometricMatrix = generateHypergeometricMatrix(targetMoleculeCount, mParam->replicationThreshold)) == NULL) {
+		free(mParam);
+		return NULL;
+	}
+	return mParam;
+}
+
+/**
+ * Free model parameters made by createTestModel.
+ */
+static void freeTestModel(ModelParameters mParam) {
+	if (mParam != NULL)
+		free(mParam->hyperGeometricMatrix);
+	free(mParam);
+}
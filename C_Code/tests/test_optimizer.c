@@ -0,0 +1,82 @@
+/**
+ * @file   test_optimizer.c
+ * @version 5
+ * @updated  2026
+ * @brief  Checks of the regimen optimizer with the range of one variable fixed
+ *
+ * A range whose smallest and largest values are equal drops its variable from the search, so the points of the simplex
+ * have fewer coordinates than the rows holding them. The first candidates simulated must be the vertices of the
+ * initial simplex, in order, and every candidate must keep the fixed value and lie within the other ranges.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <gsl/gsl_odeiv2.h>
+#include <gsl/gsl_errno.h>
+#include "full_model.h"
+#include "fixed_step.h"
+#include "positive_step.h"
+#include "sensitivity.h"
+#include "base_simulation.h"
+#include "pharmacokinetics.h"
+#include "regimen_optimizer.h"
+#include "test_model.h"
+
+#define TEST_TARGETS 10                    ///< Number of targets of the model
+#define TEST_HOURS 96                      ///< Hours simulated for each candidate
+#define TEST_SETTINGS "test_optimizer.cfg" ///< Configuration written and read back, in the working directory
+#define TEST_DOSE_COUNT 4                  ///< The fixed number of doses
+
+int main(void) {
+	ModelParameters mParam = createTestModel(TEST_TARGETS, 5, TEST_HOURS);
+	struct _OptimizerSettings settings;
+	struct _OptimizerResults results;
+	struct _SimulationStepper stepper;
+	const double vertices[3][2] = { { 0.5, 0.5 }, { 0.75, 0.5 }, { 0.5, 0.75 } };
+	double* state;
+	FILE* oHandle;
+	int status, e;
+
+	if (mParam == NULL || (oHandle = fopen(TEST_SETTINGS, "w")) == NULL) {
+		fprintf(stderr, "Could not set up the model and the settings\n");
+		return 1;
+	}
+	fprintf(oHandle, "clearance 10\nvolume 50\nabsorption 0\n");
+	fprintf(oHandle, "dose 100 1000\ninterval 12 24\ndoses %d %d\n", TEST_DOSE_COUNT, TEST_DOSE_COUNT);
+	fprintf(oHandle, "target 2 48\nevaluations 40\ntolerance 1e-2\n");
+	fclose(oHandle);
+	CHECK(readOptimizerSettings(TEST_SETTINGS, &settings) == 0, "the settings with a fixed range were rejected");
+	remove(TEST_SETTINGS);
+
+	memset(&stepper, 0, sizeof(stepper));
+	parseSimulationStepper("positive", &stepper);
+	state = initializeStateVector(TEST_TARGETS, DEFAULT_STARTING_ANTIBIOTIC, DEFAULT_STARTING_POPULATION);
+	status = optimizeRegimen(&stepper, mParam, &settings, TEST_HOURS * 3600.0, 3600.0, state, 2, &results);
+	CHECK(status == GSL_SUCCESS || status == GSL_EMAXITER, "the search failed: %d", status);
+	CHECK(results.evaluationCount >= 3, "%d candidates were simulated", results.evaluationCount);
+
+	// The initial simplex steps a quarter of the range of the dose, then of the interval, from the middle
+	for (e = 0; e < 3 && e < results.evaluationCount; ++e) {
+		const struct _DosingRegimen* regimen = &results.evaluations[e].regimen;
+		const double dose = settings.lower[0] + vertices[e][0] * (settings.upper[0] - settings.lower[0]);
+		const double interval = settings.lower[1] + vertices[e][1] * (settings.upper[1] - settings.lower[1]);
+
+		CHECK(regimen->dose == dose && regimen->interval == interval, "candidate %d is %lg mg every %lg h, the vertex %lg mg every %lg h",
+		      e, regimen->dose, regimen->interval, dose, interval);
+	}
+	for (e = 0; e < results.evaluationCount; ++e) {
+		const struct _DosingRegimen* regimen = &results.evaluations[e].regimen;
+
+		CHECK(regimen->doseCount == TEST_DOSE_COUNT, "candidate %d has %d doses, the range fixes %d", e, regimen->doseCount, TEST_DOSE_COUNT);
+		CHECK(regimen->dose >= settings.lower[0] && regimen->dose <= settings.upper[0], "candidate %d has a dose of %lg mg", e, regimen->dose);
+		CHECK(regimen->interval >= settings.lower[1] && regimen->interval <= settings.upper[1], "candidate %d has an interval of %lg h", e,
+		      regimen->interval);
+	}
+
+	freeOptimizerResults(&results);
+	free(state);
+	freeTestModel(mParam);
+	return (failedChecks > 0) ? 1 : 0;
+}
@@ -0,0 +1,171 @@
+/**
+ * @file   test_periodic.c
+ * @version 5
+ * @updated  2026
+ * @brief  Checks of the periodic orbit of a repeated dosing regimen and of its Floquet multipliers
+ *
+ * The orbit of a daily dose is solved for with a native fixed-step integrator and must reproduce itself over a period.
+ * Its multipliers come from the variational equations; their sum, the trace of the monodromy matrix, and their largest
+ * modulus are compared with central differences of the period map and power iteration on them. With a fixed step the
+ * shifted integrations take the same steps, so the differences are accurate. The positivity-preserving integrator,
+ * whose adaptive steps would make differences noisy, must find the same orbit.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <gsl/gsl_odeiv2.h>
+#include <gsl/gsl_errno.h>
+#include "full_model.h"
+#include "fixed_step.h"
+#include "positive_step.h"
+#include "sensitivity.h"
+#include "base_simulation.h"
+#include "periodic_orbit.h"
+#include "test_model.h"
+
+#define TEST_TARGETS 10                   ///< Number of targets of the model
+#define TEST_KILLING_THRESHOLD 6          ///< Killing threshold of the model
+#define TEST_PERIOD (24.0 * 3600.0)       ///< The dosing interval
+#define TEST_START (20.0 * 86400.0)       ///< Start of the interval whose orbit is solved for, once the population settles
+#define TEST_INTERVAL 3600.0              ///< Time between the output time-points
+#define TEST_FIXED_STEP 20.0              ///< Step of the native integrator
+#define TEST_POWER_ITERATIONS 60          ///< Iterations of the power method for the spectral radius
+
+/**
+ * Apply the period map with a fresh integrator.
+ */
+static void applyTestPeriodMap(const SimulationStepper stepper, const ModelParameters mParam, const double* initial, double* final,
+                               const int dim) {
+	SimulationIntegrator integrator = allocateSimulationIntegrator(stepper, mParam, TEST_INTERVAL);
+	double curTime = TEST_START;
+
+	memcpy(final, initial, sizeof(double) * dim);
+	CHECK(integrator != NULL && advanceSimulationIntegrator(integrator, &curTime, TEST_START + TEST_PERIOD, final) == GSL_SUCCESS,
+	      "the period map failed");
+	freeSimulationIntegrator(integrator);
+}
+
+/**
+ * Product of the monodromy matrix of the compartments with a vector, by central differences of the period map.
+ */
+static void applyDifferenceMonodromy(const SimulationStepper stepper, const ModelParameters mParam, const double* orbit, const double* v,
+                                     double* mv, const int dim) {
+	const int offset = NUMBER_FREE_KINETIC_VARIABLES;
+	double shifted[dim], plus[dim], minus[dim];
+	double scale = 0.0, norm = 0.0, h;
+	int i;
+
+	for (i = offset; i < dim; ++i) {
+		scale = fmax(scale, fabs(orbit[i]));
+		norm = fmax(norm, fabs(v[i - offset]));
+	}
+	h = 1e-4 * fmax(scale, 1.0) / norm;
+	memcpy(shifted, orbit, sizeof(shifted));
+	for (i = offset; i < dim; ++i)
+		shifted[i] = orbit[i] + h * v[i - offset];
+	applyTestPeriodMap(stepper, mParam, shifted, plus, dim);
+	for (i = offset; i < dim; ++i)
+		shifted[i] = orbit[i] - h * v[i - offset];
+	applyTestPeriodMap(stepper, mParam, shifted, minus, dim);
+	for (i = offset; i < dim; ++i)
+		mv[i - offset] = (plus[i] - minus[i]) / (2.0 * h);
+}
+
+int main(void) {
+	enum { dim = NUMBER_FREE_KINETIC_VARIABLES + TEST_TARGETS + 1, compartments = TEST_TARGETS + 1 };
+	const int timepoints = (int)((TEST_START + TEST_PERIOD) / TEST_INTERVAL) + 2;
+	ModelParameters mParam = createTestModel(TEST_TARGETS, TEST_KILLING_THRESHOLD, timepoints);
+	struct _SimulationStepper stepper;
+	struct _PeriodicOrbitResults orbit;
+	double initial[dim], state[dim], mapped[dim], positiveState[dim];
+	double v[compartments], mv[compartments];
+	double trace = 0.0, differenceTrace = 0.0, imaginarySum = 0.0, radius = 0.0, residual = 0.0, scale = 0.0;
+	int i, k, status;
+
+	if (mParam == NULL) {
+		fprintf(stderr, "Could not set up the model\n");
+		return 1;
+	}
+	// A dose every day, eliminated with a half-life of about three and a half hours, which holds the population below a
+	// carrying capacity it would otherwise approach
+	mParam->carryingCapacity = 1e7;
+	for (i = 0; i <= timepoints; ++i)
+		mParam->realantibioticconc[i] = concentrationToMolecules(mParam, exp(-0.2 * (i % 24)));
+	memset(initial, 0, sizeof(initial));
+	initial[NUMBER_FREE_KINETIC_VARIABLES] = DEFAULT_STARTING_POPULATION;
+
+	memset(&stepper, 0, sizeof(stepper));
+	parseSimulationStepper("rk4-native", &stepper);
+	stepper.fixedStepSize = TEST_FIXED_STEP;
+	memcpy(state, initial, sizeof(state));
+	status = findPeriodicOrbit(&stepper, mParam, TEST_START, TEST_PERIOD, TEST_INTERVAL, DEFAULT_PERIODIC_TOLERANCE,
+	                           DEFAULT_PERIODIC_MAX_ITERATIONS, state, &orbit);
+	CHECK(status == GSL_SUCCESS && orbit.converged, "the orbit was not found: %d after %d iterations, residual %g", status, orbit.iterations,
+	      orbit.residual);
+	CHECK(orbit.multiplierCount == compartments, "%d multipliers for %d compartments", orbit.multiplierCount, compartments);
+
+	// The state reproduces itself over a period
+	applyTestPeriodMap(&stepper, mParam, state, mapped, dim);
+	for (i = NUMBER_FREE_KINETIC_VARIABLES; i < dim; ++i) {
+		residual = fmax(residual, fabs(mapped[i] - state[i]));
+		scale = fmax(scale, fabs(state[i]));
+	}
+	CHECK(residual <= 10.0 * DEFAULT_PERIODIC_TOLERANCE * (1.0 + scale), "the orbit moves by %g over a period", residual);
+
+	// The sum of the multipliers is the trace of the monodromy matrix
+	for (k = 0; k < orbit.multiplierCount; ++k) {
+		trace += orbit.multipliers[2 * k];
+		imaginarySum += orbit.multipliers[2 * k + 1];
+	}
+	for (k = 0; k < compartments; ++k) {
+		memset(v, 0, sizeof(v));
+		v[k] = 1.0;
+		applyDifferenceMonodromy(&stepper, mParam, state, v, mv, dim);
+		differenceTrace += mv[k];
+	}
+	CHECK(fabs(trace - differenceTrace) <= 1e-5 * fmax(fabs(differenceTrace), 1.0), "the multipliers sum to %.10g, the trace is %.10g",
+	      trace, differenceTrace);
+	CHECK(fabs(imaginarySum) <= 1e-8 * fmax(fabs(trace), 1.0), "the imaginary parts of the multipliers sum to %g", imaginarySum);
+
+	// The spectral radius against power iteration on the differences
+	for (k = 0; k < compartments; ++k)
+		v[k] = 1.0 + 0.1 * k;
+	for (k = 0; k < TEST_POWER_ITERATIONS; ++k) {
+		double norm = 0.0;
+
+		applyDifferenceMonodromy(&stepper, mParam, state, v, mv, dim);
+		for (i = 0; i < compartments; ++i)
+			norm += mv[i] * mv[i];
+		norm = sqrt(norm);
+		radius = 0.0;
+		for (i = 0; i < compartments; ++i) {
+			radius += v[i] * v[i];
+			v[i] = mv[i] / norm;
+		}
+		radius = norm / sqrt(radius);
+	}
+	CHECK(fabs(orbit.spectralRadius - radius) <= 1e-4 * radius, "the spectral radius is %.10g, power iteration gives %.10g",
+	      orbit.spectralRadius, radius);
+	free(orbit.multipliers);
+
+	// The adaptive positivity-preserving integrator finds the same orbit
+	memset(&stepper, 0, sizeof(stepper));
+	parseSimulationStepper("positive", &stepper);
+	memcpy(positiveState, initial, sizeof(positiveState));
+	status = findPeriodicOrbit(&stepper, mParam, TEST_START, TEST_PERIOD, TEST_INTERVAL, DEFAULT_PERIODIC_TOLERANCE,
+	                           DEFAULT_PERIODIC_MAX_ITERATIONS, positiveState, &orbit);
+	CHECK(status == GSL_SUCCESS && orbit.converged, "the positive stepper did not find the orbit: %d after %d iterations, residual %g",
+	      status, orbit.iterations, orbit.residual);
+	residual = 0.0;
+	for (i = NUMBER_FREE_KINETIC_VARIABLES; i < dim; ++i)
+		residual = fmax(residual, fabs(positiveState[i] - state[i]));
+	CHECK(residual <= 1e-3 * (1.0 + scale), "the orbits of the two integrators differ by %g", residual);
+	CHECK(fabs(orbit.spectralRadius - radius) <= 1e-2 * radius, "the spectral radius with the positive stepper is %.10g, against %.10g",
+	      orbit.spectralRadius, radius);
+	free(orbit.multipliers);
+
+	freeTestModel(mParam);
+	return (failedChecks > 0) ? 1 : 0;
+}
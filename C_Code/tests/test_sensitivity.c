@@ -0,0 +1,115 @@
+/**
+ * @file   test_sensitivity.c
+ * @version 5
+ * @updated  2026
+ * @brief  Checks of the forward sensitivities integrated by runSimulation against central differences of whole runs
+ *
+ * Two hours of the binding model are integrated with the sensitivities of the population to every parameter, and the
+ * last time-point written, at which the runs stop, is compared with the central difference of the final population of
+ * runs at the parameter shifted either way. The runs use a native fixed-step integrator, so the shifted runs take the
+ * same steps and the difference approximates the derivative of the numerical solution, which the sensitivities give
+ * exactly.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <gsl/gsl_odeiv2.h>
+#include <gsl/gsl_errno.h>
+#include "full_model.h"
+#include "fixed_step.h"
+#include "positive_step.h"
+#include "sensitivity.h"
+#include "base_simulation.h"
+#include "test_model.h"
+
+#define TEST_TARGETS 10             ///< Number of targets of the model
+#define TEST_KILLING_THRESHOLD 3    ///< Killing threshold of the model, low enough for the kill to act within the run
+#define TEST_END_TIME 7200.0        ///< Time integrated over, in seconds
+#define TEST_INTERVAL 600.0         ///< Time between the output time-points
+#define TEST_FIXED_STEP 5.0         ///< Step of the native integrator
+#define TEST_TOLERANCE 1e-5         ///< Largest difference, relative to the central difference
+
+/**
+ * Final population of a run of the model alone from the default initial state.
+ */
+static double runFinalPopulation(const SimulationStepper stepper, const ModelParameters mParam, SimulationResults results) {
+	double* state = initializeStateVector(TEST_TARGETS, DEFAULT_STARTING_ANTIBIOTIC, DEFAULT_STARTING_POPULATION);
+	double population = 0.0;
+	int i;
+
+	CHECK(runSimulation(stepper, mParam, 0.0, TEST_END_TIME, TEST_INTERVAL, state, results, NULL, NULL) == GSL_SUCCESS,
+	      "a run of the model alone failed");
+	for (i = NUMBER_FREE_KINETIC_VARIABLES; i < NUMBER_FREE_KINETIC_VARIABLES + TEST_TARGETS + 1; ++i)
+		population += state[i];
+	free(state);
+	return population;
+}
+
+int main(void) {
+	ModelParameters mParam = createTestModel(TEST_TARGETS, TEST_KILLING_THRESHOLD, (int)(TEST_END_TIME / 3600.0) + 2);
+	struct _SimulationResults results = { .timePoint = NULL, .totalPopulation = NULL, .unboundantibiotic = NULL, .capacity = 0 };
+	struct _SensitivitySelection selection;
+	struct _SimulationStepper stepper;
+	double sensitivities[MODEL_PARAMETER_COUNT];
+	char line[1024], lastLine[1024] = "";
+	double* state;
+	double population, time;
+	int p, offset, read;
+
+	if (mParam == NULL) {
+		fprintf(stderr, "Could not set up the model\n");
+		return 1;
+	}
+	// A carrying capacity the population approaches, so that its sensitivity is not negligible
+	mParam->carryingCapacity = 1e7;
+	memset(&stepper, 0, sizeof(stepper));
+	parseSimulationStepper("rk4-native", &stepper);
+	stepper.fixedStepSize = TEST_FIXED_STEP;
+
+	// The sensitivities to every parameter, the last time-point read back from their file
+	memset(&selection, 0, sizeof(selection));
+	for (p = 0; p < MODEL_PARAMETER_COUNT; ++p)
+		selection.parameters[selection.parameterCount++] = (ModelParameterIndex)p;
+	if ((selection.oHandle = tmpfile()) == NULL) {
+		fprintf(stderr, "Could not open a temporary file\n");
+		return 1;
+	}
+	state = initializeStateVector(TEST_TARGETS, DEFAULT_STARTING_ANTIBIOTIC, DEFAULT_STARTING_POPULATION);
+	CHECK(runSimulation(&stepper, mParam, 0.0, TEST_END_TIME, TEST_INTERVAL, state, &results, NULL, &selection) == GSL_SUCCESS,
+	      "the run with sensitivities failed");
+	free(state);
+	rewind(selection.oHandle);
+	while (fgets(line, sizeof(line), selection.oHandle) != NULL)
+		strcpy(lastLine, line);
+	fclose(selection.oHandle);
+	CHECK(sscanf(lastLine, "%lg%n", &time, &offset) == 1 && time > 0.0, "no time-point was written after the start: %s", lastLine);
+	for (p = 0; p < MODEL_PARAMETER_COUNT; ++p) {
+		CHECK(sscanf(lastLine + offset, "%lg%n", &sensitivities[p], &read) == 1, "no sensitivity %d in %s", p, lastLine);
+		offset += read;
+	}
+
+	population = runFinalPopulation(&stepper, mParam, &results);
+	for (p = 0; p < MODEL_PARAMETER_COUNT; ++p) {
+		double* parameter = getModelParameterAddress(mParam, (ModelParameterIndex)p);
+		const double value = *parameter;
+		const double h = 1e-4 * fabs(value);
+		double plus, minus, difference;
+
+		*parameter = value + h;
+		plus = runFinalPopulation(&stepper, mParam, &results);
+		*parameter = value - h;
+		minus = runFinalPopulation(&stepper, mParam, &results);
+		*parameter = value;
+		difference = (plus - minus) / (2.0 * h);
+		// The rounding of the two final populations, magnified by the division by the step
+		CHECK(fabs(sensitivities[p] - difference) <= TEST_TOLERANCE * fabs(difference) + 1e-12 * population / h,
+		      "dP/d%c is %.10g at the end, the central difference of the runs %.10g", getModelParameterOption((ModelParameterIndex)p),
+		      sensitivities[p], difference);
+	}
+
+	freeSimulationResults(&results);
+	freeTestModel(mParam);
+	return (failedChecks > 0) ? 1 : 0;
+}
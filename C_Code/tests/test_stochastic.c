@@ -0,0 +1,137 @@
+/**
+ * @file   test_stochastic.c
+ * @version 5
+ * @updated  2026
+ * @brief  Checks of the stochastic ensembles, by tau-leaping and by the hybrid solver, under a killing dose
+ *
+ * A small population under a constant dose which saturates killing dies out within the day. The extinction counts of an
+ * ensemble must not depend on the number of threads, must change with the seed, and must never fall, since extinction
+ * is absorbing. Those of tau-leaping and of the hybrid solver must agree, at every time-point, within a few binomial
+ * standard errors with those of the exact stochastic simulation algorithm, which is the hybrid solver with a threshold
+ * no compartment reaches.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <gsl/gsl_odeiv2.h>
+#include <gsl/gsl_errno.h>
+#include "full_model.h"
+#include "fixed_step.h"
+#include "positive_step.h"
+#include "sensitivity.h"
+#include "base_simulation.h"
+#include "stochastic_simulation.h"
+#include "test_model.h"
+
+#define TEST_TARGETS 10                 ///< Number of targets of the model
+#define TEST_KILLING_THRESHOLD 5        ///< Killing threshold of the model
+#define TEST_MAXIMUM_KILL_RATE 1e-4     ///< Kill rate, fast enough for the population to die out within the day
+#define TEST_CONCENTRATION 100.0        ///< Constant concentration (mg/L), at which killing is saturated
+#define TEST_POPULATION 50.0            ///< Starting cells
+#define TEST_HOURS 24                   ///< Hours simulated
+#define TEST_INTERVAL 3600.0            ///< Time between the time-points
+#define TEST_REPLICATES 200             ///< Replicates of the ensembles compared with the exact ones
+#define TEST_SMALL_REPLICATES 40        ///< Replicates of the ensembles compared across thread counts
+#define TEST_HYBRID_THRESHOLD 20.0      ///< Cells from which the hybrid solver integrates a compartment
+#define TEST_EXACT_THRESHOLD 1e12       ///< Hybrid threshold no compartment reaches, for exact simulation throughout
+#define TEST_STANDARD_ERRORS 4.0        ///< Standard errors by which the extinct fractions of two ensembles may differ
+
+/**
+ * Run an ensemble, checking that it succeeds.
+ */
+static void runTestEnsemble(const ModelParameters mParam, const double hybridThreshold, const int replicateCount, const unsigned long seed,
+                            const int threadCount, const double* initialState, StochasticResults results) {
+	struct _StochasticSettings settings = { .replicateCount = replicateCount, .seed = seed, .tauTolerance = DEFAULT_TAU_TOLERANCE,
+	                                        .hybridThreshold = hybridThreshold, .verbose = 0 };
+
+	CHECK(runStochasticEnsemble(mParam, &settings, TEST_HOURS * TEST_INTERVAL, TEST_INTERVAL, initialState, threadCount, results) ==
+	      GSL_SUCCESS && results->extinctCount != NULL, "the ensemble with threshold %lg on %d threads failed", hybridThreshold,
+	      threadCount);
+}
+
+/**
+ * Whether two ensembles have the same extinction counts and steps.
+ */
+static int isSameEnsemble(const StochasticResults first, const StochasticResults second) {
+	return first->extinctCount != NULL && second->extinctCount != NULL && first->tickCount == second->tickCount &&
+	       !memcmp(first->extinctCount, second->extinctCount, sizeof(unsigned int) * first->tickCount) &&
+	       first->leapCount == second->leapCount && first->exactStepCount == second->exactStepCount;
+}
+
+/**
+ * Check that the extinct fractions of an ensemble stay within the standard errors of those of the exact one.
+ */
+static void checkAgainstExact(const char* name, const StochasticResults results, const StochasticResults exact) {
+	int a;
+
+	if (results->extinctCount == NULL || exact->extinctCount == NULL)
+		return;
+	for (a = 0; a < exact->tickCount; ++a) {
+		const double p = (double)exact->extinctCount[a] / exact->replicateCount;
+		const double q = (double)results->extinctCount[a] / results->replicateCount;
+		const double error = sqrt(fmax(p * (1.0 - p), 1.0 / exact->replicateCount) * 2.0 / exact->replicateCount);
+
+		CHECK(fabs(q - p) <= TEST_STANDARD_ERRORS * error, "%s: %lg extinct at %lg h, the exact simulation %lg", name, q,
+		      a * TEST_INTERVAL / 3600.0, p);
+	}
+}
+
+int main(void) {
+	enum { dim = NUMBER_FREE_KINETIC_VARIABLES + TEST_TARGETS + 1 };
+	ModelParameters mParam = createTestModel(TEST_TARGETS, TEST_KILLING_THRESHOLD, TEST_HOURS);
+	struct _StochasticResults exact, tauLeaping, hybrid, single, threaded, reseeded;
+	double initial[dim];
+	int x, a;
+
+	if (mParam == NULL) {
+		fprintf(stderr, "Could not set up the model\n");
+		return 1;
+	}
+	mParam->maximumKillRate = TEST_MAXIMUM_KILL_RATE;
+	for (x = 0; x <= mParam->timepoints; ++x)
+		mParam->realantibioticconc[x] = concentrationToMolecules(mParam, TEST_CONCENTRATION);
+	memset(initial, 0, sizeof(initial));
+	initial[NUMBER_FREE_KINETIC_VARIABLES] = TEST_POPULATION;
+
+	// The ensembles are those of their seed, whatever the number of threads
+	runTestEnsemble(mParam, 0.0, TEST_SMALL_REPLICATES, DEFAULT_STOCHASTIC_SEED, 1, initial, &single);
+	runTestEnsemble(mParam, 0.0, TEST_SMALL_REPLICATES, DEFAULT_STOCHASTIC_SEED, 3, initial, &threaded);
+	runTestEnsemble(mParam, 0.0, TEST_SMALL_REPLICATES, DEFAULT_STOCHASTIC_SEED + 1, 3, initial, &reseeded);
+	CHECK(isSameEnsemble(&single, &threaded), "tau-leaping on one and on three threads differ");
+	CHECK(!isSameEnsemble(&single, &reseeded), "tau-leaping with another seed is the same");
+	freeStochasticResults(&single);
+	freeStochasticResults(&threaded);
+	freeStochasticResults(&reseeded);
+	runTestEnsemble(mParam, TEST_HYBRID_THRESHOLD, TEST_SMALL_REPLICATES, DEFAULT_STOCHASTIC_SEED, 1, initial, &single);
+	runTestEnsemble(mParam, TEST_HYBRID_THRESHOLD, TEST_SMALL_REPLICATES, DEFAULT_STOCHASTIC_SEED, 3, initial, &threaded);
+	CHECK(isSameEnsemble(&single, &threaded), "the hybrid solver on one and on three threads differ");
+	freeStochasticResults(&single);
+	freeStochasticResults(&threaded);
+
+	// Extinction is absorbing and, under the dose, almost certain by the end
+	runTestEnsemble(mParam, TEST_EXACT_THRESHOLD, TEST_REPLICATES, DEFAULT_STOCHASTIC_SEED, 3, initial, &exact);
+	runTestEnsemble(mParam, 0.0, TEST_REPLICATES, DEFAULT_STOCHASTIC_SEED, 3, initial, &tauLeaping);
+	runTestEnsemble(mParam, TEST_HYBRID_THRESHOLD, TEST_REPLICATES, DEFAULT_STOCHASTIC_SEED, 3, initial, &hybrid);
+	if (exact.extinctCount != NULL) {
+		CHECK(exact.tickCount == TEST_HOURS && exact.extinctCount[0] == 0, "%d time-points, %u extinct at the start", exact.tickCount,
+		      exact.extinctCount[0]);
+		for (a = 1; a < exact.tickCount; ++a)
+			CHECK(exact.extinctCount[a] >= exact.extinctCount[a - 1], "fewer extinct at %d h than before", a);
+		CHECK(exact.extinctCount[exact.tickCount - 1] >= 0.9 * TEST_REPLICATES, "only %u of %d replicates died out",
+		      exact.extinctCount[exact.tickCount - 1], TEST_REPLICATES);
+		CHECK(exact.leapCount == 0 && exact.exactStepCount > 0, "the exact simulation leaped %lu times", exact.leapCount);
+	}
+
+	// Both approximations follow the exact simulation
+	checkAgainstExact("tau-leaping", &tauLeaping, &exact);
+	checkAgainstExact("hybrid", &hybrid, &exact);
+	CHECK(hybrid.leapCount > 0, "the hybrid solver integrated no compartment");
+
+	freeStochasticResults(&exact);
+	freeStochasticResults(&tauLeaping);
+	freeStochasticResults(&hybrid);
+	freeTestModel(mParam);
+	return (failedChecks > 0) ? 1 : 0;
+}
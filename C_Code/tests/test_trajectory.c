@@ -0,0 +1,194 @@
+/**
+ * @file   test_trajectory.c
+ * @version 5
+ * @updated  2026
+ * @brief  Checks of the formatting of the text files and of the binary trajectory files and their decimation
+ *
+ * formatFixedDouble is compared with printf("%.6f") over values of every magnitude, including those halfway between
+ * two outputs. Binary files of doubles and of floats are written and read back row by row, and a file decimated to a
+ * number of plot points is checked to keep exactly that many rows, the first and the last among them.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <stdint.h>
+#include <gsl/gsl_odeiv2.h>
+#include "full_model.h"
+#include "fixed_step.h"
+#include "positive_step.h"
+#include "sensitivity.h"
+#include "base_simulation.h"
+#include "async_writer.h"
+#include "trajectory_file.h"
+#include "test_model.h"
+
+#define TEST_TARGETS 5                    ///< Number of targets of the model
+#define TEST_FILE "test_trajectory.bin"   ///< File written and read back, in the working directory
+#define TEST_ROWS 100                     ///< Rows of the round-trip files
+#define TEST_DECIMATED_ROWS 1000          ///< Rows given to the decimated file
+#define TEST_PLOT_POINTS 50               ///< Rows the decimated file keeps
+#define TEST_INTERVAL 60.0                ///< Time between the rows
+#define TEST_RANDOM_VALUES 200000         ///< Random values compared with printf
+
+/**
+ * Compare formatFixedDouble with printf("%.6f") for one value.
+ */
+static void checkFixedDouble(const double value) {
+	char expected[FIXED_DOUBLE_MAX_LENGTH + 1], text[FIXED_DOUBLE_MAX_LENGTH + 1];
+	const int length = formatFixedDouble(text, value);
+
+	snprintf(expected, sizeof(expected), "%.6f", value);
+	text[length] = '\0';
+	CHECK(strcmp(text, expected) == 0, "formatFixedDouble gives %s for %.17g, printf %s", text, value, expected);
+}
+
+/**
+ * The state of a row, which varies with the row so each value read back identifies it.
+ */
+static void fillTestState(double* state, const int dim, const long row) {
+	int i;
+
+	for (i = 0; i < dim; ++i)
+		state[i] = 1e3 * (i + 1) + 0.125 * row + sin(0.37 * row + i);
+}
+
+/**
+ * Write a file of a binary format and check every row and the search of the times read back.
+ */
+static void checkRoundTrip(const ModelParameters mParam, const TrajectoryFormat format) {
+	const int dim = NUMBER_FREE_KINETIC_VARIABLES + TEST_TARGETS + 1;
+	const int compartments = TEST_TARGETS + 1;
+	struct _TrajectoryOptions options = { format, TRAJECTORY_COMPARTMENTS, 0, NULL };
+	double state[NUMBER_FREE_KINETIC_VARIABLES + TEST_TARGETS + 1];
+	double values[TEST_TARGETS + 1 + 4];
+	TrajectoryWriter writer;
+	TrajectoryReader reader;
+	long row;
+	int i;
+
+	writer = openTrajectoryWriter(TEST_FILE, &options, mParam, NULL);
+	CHECK(writer != NULL, "could not open %s for writing", TEST_FILE);
+	if (writer == NULL)
+		return;
+	for (row = 0; row < TEST_ROWS; ++row) {
+		fillTestState(state, dim, row);
+		writeTrajectoryRow(writer, mParam, (ModelVariables)state, row * TEST_INTERVAL, 1e6 + row, 2e5 - row);
+	}
+	CHECK(closeTrajectoryWriter(writer) == 0, "could not finish %s", TEST_FILE);
+
+	reader = openTrajectoryReader(TEST_FILE);
+	CHECK(reader != NULL, "could not read %s back", TEST_FILE);
+	if (reader == NULL)
+		return;
+	CHECK(reader->rowCount == TEST_ROWS, "%ld rows read back, %d written", reader->rowCount, TEST_ROWS);
+	CHECK(reader->columnCount == compartments + 4, "%d columns read back, %d written", reader->columnCount, compartments + 4);
+	for (row = 0; row < reader->rowCount && reader->columnCount == compartments + 4; ++row) {
+		double expected[TEST_TARGETS + 1 + 4];
+
+		fillTestState(state, dim, row);
+		memcpy(expected, state + NUMBER_FREE_KINETIC_VARIABLES, sizeof(double) * compartments);
+		expected[compartments] = row * TEST_INTERVAL;
+		expected[compartments + 1] = 1e6 + row;
+		expected[compartments + 2] = 2e5 - row;
+		expected[compartments + 3] = state[1];
+		CHECK(readTrajectoryRow(reader, row, values) == 0, "could not read row %ld", row);
+		for (i = 0; i < compartments + 4; ++i) {
+			const double value = (format == TRAJECTORY_FLOAT) ? (double)(float)expected[i] : expected[i];
+
+			CHECK(values[i] == value, "row %ld column %d reads %.17g, %.17g was written", row, i, values[i], value);
+		}
+	}
+	CHECK(readTrajectoryRow(reader, TEST_ROWS, values) != 0, "a row past the end was read");
+
+	CHECK(findTrajectoryRow(reader, -1.0) == -1, "a row was found before the first");
+	CHECK(findTrajectoryRow(reader, 0.0) == 0, "the first row was not found at its time");
+	CHECK(findTrajectoryRow(reader, TEST_INTERVAL - 0.1) == 0, "the first row was not found before the second");
+	CHECK(findTrajectoryRow(reader, TEST_INTERVAL) == 1, "the second row was not found at its time");
+	CHECK(findTrajectoryRow(reader, 50.5 * TEST_INTERVAL) == 50, "the row before a time between two was not found");
+	CHECK(findTrajectoryRow(reader, 1e12) == TEST_ROWS - 1, "the last row was not found after the end");
+	closeTrajectoryReader(reader);
+	remove(TEST_FILE);
+}
+
+/**
+ * Write a file decimated to the plot points and check the rows kept.
+ */
+static void checkDecimation(const ModelParameters mParam) {
+	const int dim = NUMBER_FREE_KINETIC_VARIABLES + TEST_TARGETS + 1;
+	const int timeColumn = TEST_TARGETS + 1;
+	struct _TrajectoryOptions options = { TRAJECTORY_DOUBLE, TRAJECTORY_COMPARTMENTS, TEST_PLOT_POINTS, NULL };
+	double state[NUMBER_FREE_KINETIC_VARIABLES + TEST_TARGETS + 1];
+	double values[TEST_TARGETS + 1 + 4];
+	double lastTime = -1.0;
+	TrajectoryWriter writer;
+	TrajectoryReader reader;
+	long row;
+
+	writer = openTrajectoryWriter(TEST_FILE, &options, mParam, NULL);
+	CHECK(writer != NULL, "could not open %s for writing", TEST_FILE);
+	if (writer == NULL)
+		return;
+	CHECK(expectTrajectoryRows(writer, TEST_DECIMATED_ROWS) == 0, "could not set up the decimation");
+	for (row = 0; row < TEST_DECIMATED_ROWS; ++row) {
+		// A population which falls and regrows, so the rows kept differ from an even subsampling
+		fillTestState(state, dim, row);
+		writeTrajectoryRow(writer, mParam, (ModelVariables)state, row * TEST_INTERVAL, 1e6 * exp(-0.01 * row) + 1e3 * exp(0.008 * row),
+		                   1e5);
+	}
+	CHECK(closeTrajectoryWriter(writer) == 0, "could not finish %s", TEST_FILE);
+
+	reader = openTrajectoryReader(TEST_FILE);
+	CHECK(reader != NULL, "could not read %s back", TEST_FILE);
+	if (reader == NULL)
+		return;
+	CHECK(reader->rowCount == TEST_PLOT_POINTS, "%ld rows kept, %d plot points", reader->rowCount, TEST_PLOT_POINTS);
+	for (row = 0; row < reader->rowCount; ++row) {
+		CHECK(readTrajectoryRow(reader, row, values) == 0, "could not read row %ld", row);
+		CHECK(values[timeColumn] > lastTime, "row %ld at %g does not follow the row before at %g", row, values[timeColumn], lastTime);
+		lastTime = values[timeColumn];
+		if (row == 0)
+			CHECK(values[timeColumn] == 0.0, "the first row kept is at %g", values[timeColumn]);
+	}
+	CHECK(lastTime == (TEST_DECIMATED_ROWS - 1) * TEST_INTERVAL, "the last row kept is at %g", lastTime);
+	closeTrajectoryReader(reader);
+	remove(TEST_FILE);
+}
+
+int main(void) {
+	ModelParameters mParam = createTestModel(TEST_TARGETS, 3, 4);
+	const double ties[] = { 0.0, -0.0, 0.5, 1.0000005, 2.5e-7, 0.0000005, 0.0000015, 0.0000025, 123456.0000005, 1e-7, 9.9999995,
+	                        999999.9999995, 1e14 + 0.5, 1e15, 1e300, -1e-320, 4503599627370496.5, 0.1, -0.1, 0.3 };
+	uint64_t seed = 88172645463325252ULL;
+	int i;
+
+	if (mParam == NULL) {
+		fprintf(stderr, "Could not set up the model\n");
+		return 1;
+	}
+	for (i = 0; i < (int)(sizeof(ties) / sizeof(ties[0])); ++i) {
+		checkFixedDouble(ties[i]);
+		checkFixedDouble(-ties[i]);
+	}
+	checkFixedDouble(INFINITY);
+	checkFixedDouble(-INFINITY);
+	checkFixedDouble(NAN);
+	// Random mantissas over the magnitudes of the simulations and beyond the shortcut of the formatter
+	for (i = 0; i < TEST_RANDOM_VALUES; ++i) {
+		double mantissa;
+
+		seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+		mantissa = (double)(seed >> 11) / 9007199254740992.0;
+		checkFixedDouble(ldexp(mantissa, (int)(seed % 80) - 30) * ((seed & 1024) ? -1.0 : 1.0));
+		// Values a few units of the last place from halfway between two outputs
+		checkFixedDouble((floor(mantissa * 1e9) + 0.5) / 1e6);
+	}
+
+	checkRoundTrip(mParam, TRAJECTORY_DOUBLE);
+	checkRoundTrip(mParam, TRAJECTORY_FLOAT);
+	checkDecimation(mParam);
+
+	freeTestModel(mParam);
+	return (failedChecks > 0) ? 1 : 0;
+}
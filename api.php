@@ -3,6 +3,7 @@
 define("EXECUTABLE_PATH", "bin/tuberculosis_simulation");
 define("STD_OUT_FILE_PATH", "bin/stdout.out");
 define("OUT_FILE_PATH", "bin/output.out");
+define("SOCKET_PATH", "bin/tuberculosis_simulation.sock"); // listened on by "tuberculosis_simulation -Z bin/tuberculosis_simulation.sock -i [input]", if running
 @$useJSONP = $_GET['callback']; //checks if the call is being made with jsonp. if true, returns json output as a text within given callback function
 $dictionary = false; //returns output as object dictionary. otherwise, double array without columns
 //eg. [{'a':12,'at':123,'t':123,'l0':123,'l1':123},...]
@@ -28,13 +29,144 @@ $input = json_decode(file_get_contents('php://input'), true);
 
 $options = array();
 if ($input) {
-    $allowedOptions = array( 'V', 'n', 'r', 'k', 'R', 'K', 'A', 'D', 'C', 't', 'd', 'p', 'S', );    // for more information on options refer to "tuberculosis_simulation" documentation
+    $allowedOptions = array( 'V', 'n', 'r', 'k', 'R', 'K', 'A', 'D', 'C', 't', 'd', 'p', 'S', 'N', );    // for more information on options refer to "tuberculosis_simulation" documentation
     foreach ($allowedOptions as $allowedOption) {
         if (array_key_exists($allowedOption, $input)) {
             $options[$allowedOption] = $input[$allowedOption];
         }
     }
 }
+
+// A JSON array of parameter sets is a batch, e.g. a slider sweep: its items are run concurrently by one simulator
+// and answered together as an array with one entry per item, {"status":"ok","verbose":...,"output":...} or
+// {"status":"error","message":...}, in the order of the request
+if ($input && array_keys($input) === range(0, count($input) - 1)) {
+    $batch = array();
+    foreach ($input as $item) {
+        $itemOptions = array();
+        foreach ($allowedOptions as $allowedOption) {
+            if (is_array($item) && array_key_exists($allowedOption, $item)) {
+                $itemOptions[$allowedOption] = $item[$allowedOption];
+            }
+        }
+        array_push($batch, (object)$itemOptions);
+    }
+    // Through the simulation server if it is running, otherwise by one run of the executable in batch mode
+    $process = FALSE;
+    $records = file_exists(SOCKET_PATH) ? @stream_socket_client("unix://" . SOCKET_PATH, $errorCode, $errorMessage) : FALSE;
+    if ($records !== FALSE) {
+        fwrite($records, json_encode($batch) . "\n");
+    } else {
+        $process = proc_open(EXECUTABLE_PATH . " -b -", array(0 => array("pipe", "r"), 1 => array("pipe", "w")), $pipes);
+        if ($process === FALSE) {
+            throw new Exception("Unable to run: " . EXECUTABLE_PATH);
+        }
+        fwrite($pipes[0], json_encode($batch));
+        fclose($pipes[0]);
+        $records = $pipes[1];
+    }
+    $responseData = array();
+    $item = -1;
+    while (($line = fgets($records)) !== FALSE) {
+        $record = json_decode($line, true);
+        if ($record["type"] == "item") {
+            $item = $record["index"];
+            $responseData[$item] = ($record["status"] == "ok") ? array("status" => "ok", "verbose" => "", "output" => array())
+                                                                : array("status" => "error", "message" => $record["message"]);
+        } else if ($record["type"] == "row") {
+            array_push($responseData[$item]["output"], $record["values"]);
+        } else if ($record["type"] == "metadata") {
+            foreach ($record["parameters"] as $name => $value) {
+                $responseData[$item]["verbose"] .= $name . "\t" . $value . "\n";
+            }
+        } else if ($record["type"] == "error") {
+            throw new Exception($record["message"]);
+        }
+    }
+    fclose($records);
+    if ($process !== FALSE) {
+        proc_close($process);
+    }
+    if (count($responseData) != count($batch)) {
+        throw new Exception("The batch was not answered");
+    }
+    http_response_code(200);
+    if($useJSONP){
+       echo "$useJSONP(".json_encode($responseData).')';
+    }else{
+        header("Content-type:application/json; charset=utf-8");
+        echo json_encode($responseData);
+    }
+    exit;
+}
+
+// With a simulation server running, send it the options instead of starting the executable: it answers with the
+// trajectory as newline-delimited JSON records, passed through with ?stream=1 or gathered into the usual response
+if (file_exists(SOCKET_PATH)) {
+    $socket = @stream_socket_client("unix://" . SOCKET_PATH, $errorCode, $errorMessage);
+    if ($socket !== FALSE) {
+        fwrite($socket, json_encode((object)$options) . "\n");
+        if (isset($_GET['stream'])) {
+            http_response_code(200);
+            header("Content-type:application/x-ndjson; charset=utf-8");
+            header("X-Accel-Buffering: no");
+            while (($line = fgets($socket)) !== FALSE) {
+                echo $line;
+                @ob_flush();
+                flush();
+            }
+            fclose($socket);
+            exit;
+        }
+        $responseData = array("verbose" => "", "output" => array());
+        while (($line = fgets($socket)) !== FALSE) {
+            $record = json_decode($line, true);
+            if ($record["type"] == "row") {
+                array_push($responseData["output"], $record["values"]);
+            } else if ($record["type"] == "metadata") {
+                foreach ($record["parameters"] as $name => $value) {
+                    $responseData["verbose"] .= $name . "\t" . $value . "\n";
+                }
+            } else if ($record["type"] == "error") {
+                fclose($socket);
+                throw new Exception($record["message"]);
+            }
+        }
+        fclose($socket);
+        http_response_code(200);
+        if($useJSONP){
+           echo "$useJSONP(".json_encode($responseData).')';
+        }else{
+            header("Content-type:application/json; charset=utf-8");
+            echo json_encode($responseData);
+        }
+        exit;
+    }
+}
+
+// With ?stream=1, pipe the trajectory as newline-delimited JSON records while it is computed, without temporary files
+if (isset($_GET['stream'])) {
+    $command = EXECUTABLE_PATH;
+    foreach ($options as $name => $value) {
+        $command .= " -" . $name . " " . escapeshellarg($value);
+    }
+    $command .= " -m - -T json";
+    $process = popen($command, "r");
+    if ($process === FALSE) {
+        throw new Exception("Unable to run: " . EXECUTABLE_PATH);
+    }
+    http_response_code(200);
+    header("Content-type:application/x-ndjson; charset=utf-8");
+    header("X-Accel-Buffering: no");
+    while (($line = fgets($process)) !== FALSE) {
+        echo $line;
+        @ob_flush();
+        flush();
+    }
+    pclose($process);
+    exit;
+}
+
 $options['m'] = OUT_FILE_PATH;
 
 $command = EXECUTABLE_PATH;